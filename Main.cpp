@@ -15,13 +15,15 @@
 Vec2 ScrPos(50,50);
 
 void InitializeEverything(Vec2 _ScrPos);
-void InitializeInterfaces(void);
+void InitializeInterfaces(int _archiveTask, int _sdlTask);
 
 #undef main
 int main(int argc, char* argv[]) 
 {
+#if M22_PROFILING
+	March22::M22Profiler::Initialize();
+#endif
 	InitializeEverything(ScrPos);
-	March22::M22Script::font = new NFont(March22::M22Renderer::SDL_RENDERER, "graphics/FONT.ttf", 29, NFont::Color(255, 255, 255, 255));
 
 	if(March22::M22Engine::GAMESTATE == March22::M22Engine::GAMESTATES::INGAME)
 	{
@@ -33,15 +35,25 @@ int main(int argc, char* argv[])
 		March22::M22Interface::activeInterfaces.push_back(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::MAIN_MENU_INTRFC]);
 	};
 
+	March22::M22FrameScheduler::Initialize(FPS);
+
 	while( !March22::M22Engine::QUIT )
 	{
+		// Sleeps until there's input or something to draw, if nothing's changing
+		March22::M22FrameScheduler::WaitForWork();
+#if M22_PROFILING
+		March22::M22Profiler::BeginFrame();
+#endif
+
 		March22::M22Engine::UpdateDeltaTime();
 		March22::M22Engine::UpdateEvents();
 		March22::M22Sound::UpdateSound();
+		March22::M22AssetLoader::UpdateUploads();
+		March22::M22GlyphCache::Update();
 
 		if(March22::M22Engine::skipping)
 		{
-			March22::M22Script::ChangeLine(++March22::M22Script::currentLineIndex);
+			March22::M22Engine::FastForward(FAST_FORWARD_BUDGET_MS);
 		};
 		if(March22::M22Engine::TIMER_TARGET != 0)
 		{
@@ -57,28 +69,40 @@ int main(int argc, char* argv[])
 			};
 		};
 		if(March22::M22Engine::GAMESTATE == March22::M22Engine::GAMESTATES::MAIN_MENU) March22::M22Graphics::UpdateBackgrounds();
-		March22::M22Graphics::UpdateCharacters();
+		March22::M22Tween::Update(March22::M22Engine::DELTA_TIME);
+		March22::M22Script::UpdateTypewriter(March22::M22Engine::DELTA_TIME);
+		March22::M22CharacterLayer::Update();
 		//March22::M22Interface::UpdateActiveInterfaces( int(March22::M22Engine::ScrSize.x()), int(March22::M22Engine::ScrSize.y()) );
 		
-		March22::M22Renderer::RenderClear();
-
-		switch(March22::M22Engine::GAMESTATE)
+		if(March22::M22FrameScheduler::BeginDraw())
 		{
-			case March22::M22Engine::GAMESTATES::MAIN_MENU:
-				March22::M22Renderer::RenderCopy(March22::M22Graphics::activeMenuBackground);
-				March22::M22Renderer::RenderCopy(March22::M22Graphics::menuLogo);
-				March22::M22Interface::DrawActiveInterfaces();
-				break;
-			case March22::M22Engine::GAMESTATES::INGAME:
-				March22::M22Graphics::DrawInGame();
-				break;
-			default:
-				break;
+			March22::M22Renderer::RenderClear();
+
+			switch(March22::M22Engine::GAMESTATE)
+			{
+				case March22::M22Engine::GAMESTATES::MAIN_MENU:
+					March22::M22Renderer::RenderCopy(March22::M22Graphics::activeMenuBackground);
+					March22::M22Renderer::RenderCopy(March22::M22Graphics::menuLogo);
+					March22::M22Interface::DrawActiveInterfaces();
+					break;
+				case March22::M22Engine::GAMESTATES::INGAME:
+					March22::M22Graphics::DrawInGame();
+					break;
+				default:
+					break;
+			};
+
+#if M22_PROFILING
+			March22::M22Profiler::DrawOverlay();
+#endif
+			if(!March22::M22Engine::QUIT) March22::M22Renderer::RenderPresent();
 		};
 
 		March22::M22Engine::LMB_Pressed = false;
-		if(!March22::M22Engine::QUIT) March22::M22Renderer::RenderPresent();
-		March22::M22Renderer::Delay(1000/FPS); 
+#if M22_PROFILING
+		March22::M22Profiler::EndFrame();
+#endif
+		March22::M22FrameScheduler::EndFrame();
 	};
 
 	March22::M22Engine::Shutdown();
@@ -87,68 +111,103 @@ int main(int argc, char* argv[])
 
 void InitializeEverything(Vec2 _ScrPos)
 {
-	int ERROR_CODE = 0;
-	// Initialize Lua
-	ERROR_CODE = March22::M22Lua::Initialize();
+	// Loads run on worker threads as soon as what they need is done; uploads (anything touching
+	// the window/renderer) run on this thread, one at a time
+	using March22::M22Startup;
 
-	// Initialize the options file
-	March22::M22Engine::OptionsFileInitializer();
+	// Mount the packed assets, if the game was shipped with them; anything not in there is loaded from disk
+	int archive = M22Startup::AddTask("Archive", []{ March22::M22Archive::Mount(M22PAK_FILENAME); return short(0); }, NULL);
+
+	// Initialize Lua (its scripts can be in the archive, like everything else read below)
+	M22Startup::AddTask("Lua", []{ return short(March22::M22Lua::Initialize()); }, NULL, {archive});
+
+	// Initialize the options file (before the window, so it opens the right way)
+	int options = M22Startup::AddTask("Options", NULL, []{ March22::M22Engine::OptionsFileInitializer(); return short(0); });
+
+	// Load which lines have been read before, for skipping
+	M22Startup::AddTask("Read lines", []{ March22::M22Script::LoadReadLines("READLINES.SAV"); return short(0); }, NULL, {archive});
 
 	// Initialize SDL with specified title, version and at the specified position of the screen (if windowed)
-	ERROR_CODE = March22::M22Engine::InitializeSDL(WINDOW_TITLE, _ScrPos);
+	int sdl = M22Startup::AddTask("SDL", NULL, [_ScrPos]{ return March22::M22Engine::InitializeSDL(WINDOW_TITLE, _ScrPos); }, {}, {options});
 
-	// Initialize sound engine (setup mixers, etc.)
-	ERROR_CODE = March22::M22Sound::InitializeSound();
+	// Start the image decoding threads (needs the renderer for uploads, and the archive mounted before they read anything)
+	M22Startup::AddTask("Asset loader", NULL, []{ return March22::M22AssetLoader::Initialize(); }, {archive}, {sdl});
 
-	// Initialize the M22 engine (loads all required files, returns -1 if error encountered)
-	ERROR_CODE = March22::M22Engine::InitializeM22(int(March22::M22Engine::ScrSize.x()),int(March22::M22Engine::ScrSize.y()));
+	// Initialize sound engine (reads the music/sting indexes; audio is opened when it's first needed)
+	M22Startup::AddTask("Sound", []{ return March22::M22Sound::InitializeSound(); }, NULL, {archive});
+
+	// Initialize the M22 engine (character text frames, main menu, etc.)
+	M22Startup::AddTask("Engine", []{ return March22::M22Engine::PreloadM22(); }, []
+	{
+		return March22::M22Engine::InitializeM22(int(March22::M22Engine::ScrSize.x()),int(March22::M22Engine::ScrSize.y()));
+	}, {archive}, {sdl});
 	
-	// Loads all the background files from the specified index file
-	March22::M22Graphics::BACKGROUND_RENDER_TARGET = SDL_CreateTexture( March22::M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET , 1920, 1080 );
-	SDL_SetTextureBlendMode(March22::M22Graphics::BACKGROUND_RENDER_TARGET, SDL_BLENDMODE_BLEND);
-	March22::M22Graphics::NEXT_BACKGROUND_RENDER_TARGET = SDL_CreateTexture( March22::M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET , 1920, 1080);
-	SDL_SetTextureBlendMode(March22::M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, SDL_BLENDMODE_BLEND);
+	// The logical resolution, and the render targets backgrounds are drawn into
+	M22Startup::AddTask("Render targets", NULL, []{ return March22::M22Compositor::Initialize(); }, {archive}, {sdl});
 	
 	// Initializes the text box (loads appropriate files)
-	March22::M22Interface::InitTextBox();
+	M22Startup::AddTask("Text box", []{ M22Startup::DecodeImage("graphics/frame.png"); return short(0); }, []{ March22::M22Interface::InitTextBox(); return short(0); }, {archive}, {sdl});
 	
 	// Loads list of game decisions from the decisions file
-	ERROR_CODE = March22::M22Script::LoadGameDecisions("scripts/DECISIONS.txt");
+	M22Startup::AddTask("Decisions", []{ return March22::M22Script::LoadGameDecisions("scripts/DECISIONS.txt"); }, NULL, {archive});
 
 	// Load the text box position
-	ERROR_CODE = March22::M22Script::LoadTextBoxPosition("graphics/TEXT_BOX_POSITION.txt");
+	M22Startup::AddTask("Text box position", []{ return March22::M22Script::LoadTextBoxPosition("graphics/TEXT_BOX_POSITION.txt"); }, NULL, {archive});
 	
 	// Loads the script file into the current file
 	//ERROR_CODE = March22::M22ScriptCompiler::CompileLoadScriptFile("START_SCRIPT.txt");
 	
-	// Load the desired font
-	March22::M22Graphics::textFont = TTF_OpenFont( "graphics/FONT.ttf", 19);
-	
-	// Initialize the black wipe files/textures
-	March22::M22Graphics::wipeBlack = March22::M22Renderer::LoadTexture("graphics/wipeblack.png");
-	March22::M22Renderer::GetTextureInfo(March22::M22Graphics::wipeBlack, March22::M22Graphics::wipeBlackRect.w, March22::M22Graphics::wipeBlackRect.h);
-	March22::M22Graphics::wipeBlackRect.w /= 3;
+	// Load the desired fonts (SDL_ttf isn't thread-safe, so these stay on the main thread) and the black wipe
+	M22Startup::AddTask("Fonts and wipe", []{ M22Startup::DecodeImage("graphics/wipeblack.png"); return short(0); }, []
+	{
+		// Through M22Archive, so the font can be packed like everything else; both keep their RWops open to read glyphs
+		March22::M22Graphics::textFont = TTF_OpenFontRW(March22::M22Archive::OpenRW("graphics/FONT.ttf"), 1, 19);
+		March22::M22Script::font = new NFont(March22::M22Renderer::SDL_RENDERER, March22::M22Archive::OpenRW("graphics/FONT.ttf"), 1, 29, NFont::Color(255, 255, 255, 255));
+		March22::M22Graphics::wipeBlack = March22::M22Renderer::LoadTexture("graphics/wipeblack.png");
+		March22::M22Renderer::GetTextureInfo(March22::M22Graphics::wipeBlack, March22::M22Graphics::wipeBlackRect.w, March22::M22Graphics::wipeBlackRect.h);
+		March22::M22Graphics::wipeBlackRect.w /= 3;
+		return short(0);
+	}, {archive}, {sdl});
 
-	InitializeInterfaces();
+	InitializeInterfaces(archive, sdl);
 
-	March22::M22Renderer::SetDrawColor(255, 255, 255, 255);
+	short int failed = M22Startup::Run();
 
-	March22::M22Graphics::wipePosition = new SDL_Rect();
-	March22::M22Graphics::wipePosition->x = (0 - 1920);
-	March22::M22Graphics::wipePosition->y = 0;
-	March22::M22Graphics::wipePosition->w = 1920;
-	March22::M22Graphics::wipePosition->h = 1080;
+	March22::M22Renderer::SetDrawColor(255, 255, 255, 255);
 
-	if(ERROR_CODE != 0) printf("Error detected! Expect problems!\n");
+	if(failed != 0) printf("Error detected! Expect problems!\n");
 	return;
 };
 
-void InitializeInterfaces(void)
+void InitializeInterfaces(int _archiveTask, int _sdlTask)
 {
+	struct InterfaceFile
+	{
+		March22::M22Interface::INTERFACES type;
+		int num_of_buttons;
+		const char* filename;
+		bool opaque;
+	};
+	static const InterfaceFile files[] =
+	{
+		{ March22::M22Interface::INTERFACES::INGAME_INTRFC, 2, "graphics/interface/GAME_BUTTONS.txt", true },
+		{ March22::M22Interface::INTERFACES::MENU_BUTTON_INTRFC, 4, "graphics/interface/MENU_BUTTONS.txt", true },
+		{ March22::M22Interface::INTERFACES::MAIN_MENU_INTRFC, 3, "graphics/mainmenu/BUTTONS.txt", false },
+		{ March22::M22Interface::INTERFACES::OPTIONS_MENU_INTRFC, 7, "graphics/optionsmenu/BUTTONS.txt", true }
+	};
+
+	// Sized up front, so the tasks can fill them in without anything moving
 	March22::M22Interface::storedInterfaces.resize(March22::M22Interface::INTERFACES::NUM_OF_INTERFACES);
-	March22::M22Interface::InitializeInterface(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::INGAME_INTRFC], 2, 0, "graphics/interface/GAME_BUTTONS.txt", true, March22::M22Interface::INTERFACES::INGAME_INTRFC);
-	March22::M22Interface::InitializeInterface(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::MENU_BUTTON_INTRFC], 4, 0, "graphics/interface/MENU_BUTTONS.txt", true, March22::M22Interface::INTERFACES::MENU_BUTTON_INTRFC);
-	March22::M22Interface::InitializeInterface(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::MAIN_MENU_INTRFC], 3, 0, "graphics/mainmenu/BUTTONS.txt", false, March22::M22Interface::INTERFACES::MAIN_MENU_INTRFC);
-	March22::M22Interface::InitializeInterface(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::OPTIONS_MENU_INTRFC], 7, 0, "graphics/optionsmenu/BUTTONS.txt", true, March22::M22Interface::INTERFACES::OPTIONS_MENU_INTRFC);
+	for(size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+	{
+		const InterfaceFile& file = files[i];
+		March22::M22Startup::AddTask(std::string("Interface ") + file.filename, [&file]
+		{
+			return March22::M22Interface::PreloadInterface(file.num_of_buttons, 0, file.filename);
+		}, [&file]
+		{
+			return March22::M22Interface::InitializeInterface(&March22::M22Interface::storedInterfaces[file.type], file.num_of_buttons, 0, file.filename, file.opaque, file.type);
+		}, {_archiveTask}, {_sdlTask});
+	};
 	return;
 };
\ No newline at end of file
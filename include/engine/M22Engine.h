@@ -13,6 +13,8 @@
 #define PATCH 0
 
 #define SPRITE_DEFAULT_FORMAT ".png"
+#define SPRITE_ANIMATION_FPS 60
+	/*!< Frame rate DrawAnimSprite speeds are given at; a speed of 1 shows a new frame every 1/60th of a second */
 
 #define DEFAULT_MUSIC_VOLUME_MULT 0.25f
 	/*!< The default volume of music playback. */
@@ -29,6 +31,91 @@
 #define DECISION_CHOICE_TEXT_SPACING 20
 	/*!< Defines how far apart the decision texts are in pixels */
 
+#define ASSET_UPLOAD_BUDGET_MS 4
+	/*!< Defines how many milliseconds per frame the main thread may spend uploading decoded images to the GPU */
+#define TEXTURE_CACHE_BUDGET_MB 256
+	/*!< Defines the default amount of texture memory (in megabytes) the asset cache may keep resident */
+#define M22C_VERSION 5
+	/*!< Version of the precompiled (.m22c) script format; bump whenever the layout changes */
+#define M22C_NO_STRING 0xFFFFFFFF
+	/*!< String index meaning "no string" in a precompiled script */
+#define MAX_COMMANDS_PER_CHANGELINE 100000
+	/*!< Defines how many non-blocking commands ChangeLine runs back to back before giving up (catches Goto loops) */
+#define MAX_IDLE_WAIT_MS 250
+	/*!< Defines the longest the main loop sleeps waiting for events when nothing on screen is changing */
+#define ARROW_FRAME_MS 167
+	/*!< Defines how long each frame of the "next line" arrow is shown for, in milliseconds */
+#define FAST_FORWARD_BUDGET_MS 8
+	/*!< Defines how many milliseconds per frame skipping may spend running script lines */
+#define READ_LINES_VERSION 1
+	/*!< Version of the READLINES.SAV format; bump whenever the layout changes */
+#define SFX_CACHE_BUDGET_MB 32
+	/*!< Defines how much decoded sting audio (in megabytes) may be kept in memory at once */
+#define PREFETCH_WINDOW_LINES 48
+	/*!< Defines the default number of upcoming script lines (across every branch) whose assets are kept loaded ahead of time */
+#define M22PAK_VERSION 1
+	/*!< Version of the packed archive (.m22pak) format; bump whenever the layout changes */
+#define M22PAK_ALIGNMENT 16
+	/*!< Defines the boundary (in bytes) each file in a packed archive starts on */
+#define M22PAK_FILENAME "data.m22pak"
+	/*!< Defines the packed archive mounted at startup, if it exists */
+#define ATLAS_PAGE_SIZE 2048
+	/*!< Defines the width/height of a texture atlas page, in pixels (capped to what the renderer supports) */
+#define ATLAS_PADDING 1
+	/*!< Defines the transparent gap left around each image in an atlas page, so filtering doesn't bleed between them */
+#define M22SAVE_VERSION 3
+	/*!< Version of the savegame (.SAV) snapshot format; bump whenever the layout changes */
+#define QUICKSAVE_FILENAME "QUICK.SAV"
+	/*!< Defines the file quick-saves are written to */
+#define QUICKSAVE_KEY SDL_SCANCODE_F5
+	/*!< Defines the key that quick-saves */
+#define QUICKLOAD_KEY SDL_SCANCODE_F9
+	/*!< Defines the key that quick-loads */
+#define HISTORY_LENGTH 1024
+	/*!< Defines how many lines back the rewind history goes, at most */
+#define HISTORY_KEYFRAME_INTERVAL 32
+	/*!< Defines how many lines of rewind history are kept as deltas between each full snapshot */
+#define HISTORY_REWIND_KEY SDL_SCANCODE_PAGEUP
+	/*!< Defines the key that rewinds a line (as well as scrolling the mouse wheel up) */
+#ifndef M22_PROFILING
+	#ifdef NDEBUG
+		#define M22_PROFILING 0
+	#else
+		#define M22_PROFILING 1
+	#endif
+#endif
+	/*!< Set to 1 to build the frame profiler in, 0 to compile its markers out; defaults to off in release (NDEBUG) builds */
+#define PROFILER_FRAMES 240
+	/*!< Defines how many frames of timings the profiler keeps */
+#define PROFILER_OVERLAY_KEY SDL_SCANCODE_F3
+	/*!< Defines the key that shows/hides the profiler overlay */
+#define PROFILER_DUMP_KEY SDL_SCANCODE_F4
+	/*!< Defines the key that writes the profiler's frames to profile.csv and profile.json */
+#define TWEEN_SLOTS 64
+	/*!< Defines how many tweens can run at once */
+#define CHARACTER_SLOTS 16
+	/*!< Defines how many characters can be on screen at once (including ones fading out) */
+#define CHARACTER_FADE_MS 500
+	/*!< Defines how long characters take to fade in or out, in milliseconds */
+#define CHARACTER_MOVE_MS 300
+	/*!< Defines how long a character drawn again somewhere else takes to slide there, in milliseconds */
+#define GLYPH_PREWARM_BUDGET_MS 2
+	/*!< Defines how many milliseconds per frame the main thread may spend rendering a script's glyphs into the font cache ahead of time */
+#define TYPEWRITER_CHARS_PER_SECOND 60
+	/*!< Defines how fast the typewriter types text out, in characters per second (one a frame at 60fps, as it used to be) */
+#define TEXT_COLUMN_X 55
+	/*!< Defines the left edge of the column script text is laid out in, in logical pixels */
+#define TEXT_COLUMN_Y 50
+	/*!< Defines the top of the column script text is laid out in, in logical pixels */
+#define TEXT_COLUMN_MARGIN 90
+	/*!< Defines how much narrower than the screen the text column is, in logical pixels */
+#define TEXT_PAGE_MARGIN_BOTTOM 50
+	/*!< Defines the space left below a full page of text, in logical pixels; a line that won't fit above it goes on a new page */
+#define TRANSITION_SWIPE_MS 1000
+	/*!< Defines how long the swipe transitions take to uncover the next background, in milliseconds */
+#define TRANSITION_FADE_MS 1250
+	/*!< Defines how long the next background takes to fade in over the current one, in milliseconds */
+
 
 #include <SDL.h>
 #include <lua/lua.hpp>
@@ -38,19 +125,260 @@
 #include <SDL_mixer.h>
 #include <SDL_ttf.h>
 #include <engine/Vectors.h>
+#include <engine/Matrices.h>
+#include <engine/M22Keywords.h>
+#include <engine/M22UTF8.h>
 #include <vector>
 #include <fstream>
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <chrono>
-#include <codecvt>
 #include <sstream>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <nfont\NFont.h>
 
 namespace March22
 { 
 
+	/// \class 		M22MappedFile M22Engine.h "include/M22Engine.h"
+	/// \brief 		Read-only memory-mapped file
+	///
+	/// \details 	Maps a whole file into memory so it can be read in place, rather than streamed into buffers.
+	///				Unmapped on Close() or when destroyed.
+	///
+	class M22MappedFile
+	{
+		private:
+			const Uint8* m_data;							///< Start of the mapped file, NULL if not open
+			size_t m_size;									///< Size of the mapped file in bytes
+#ifdef _WIN32
+			void* m_file;									///< HANDLE of the file
+			void* m_mapping;								///< HANDLE of the file mapping
+#else
+			int m_file;										///< File descriptor
+#endif
+			M22MappedFile(const M22MappedFile&) = delete;
+			M22MappedFile& operator=(const M22MappedFile&) = delete;
+		public:
+			M22MappedFile();
+			~M22MappedFile();
+
+			/// Maps the specified file, closing any file already mapped
+			///
+			/// \param _filename Path of the file
+			/// \return true if mapped fine
+			bool Open(const std::string& _filename);
+
+			/// Unmaps the file
+			void Close(void);
+
+			/// Start of the mapped file, NULL if not open
+			inline const Uint8* GetData(void) const
+			{
+				return m_data;
+			};
+
+			/// Size of the mapped file in bytes
+			inline size_t GetSize(void) const
+			{
+				return m_size;
+			};
+
+			/// Is a file mapped?
+			inline bool IsOpen(void) const
+			{
+				return (m_data != NULL);
+			};
+	};
+
+	/// \class 		M22Archive M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for reading game files out of packed archives
+	///
+	/// \details 	A .m22pak is one memory-mapped file holding the game's assets, with a table of path hashes
+	///				in front, so opening a file is a binary search instead of a trip to the filesystem. Files
+	///				are read straight out of the mapping through SDL_RWops; anything not in a mounted archive
+	///				is read from disk as before. Archives are made from the game directory with tools/m22pak.
+	///
+	class M22Archive
+	{
+		public:
+			/// Header of a packed archive
+			///
+			/// Followed by the entries (sorted by \a m_hash), then the path strings, then the file data; each
+			/// file starts on a \a M22PAK_ALIGNMENT boundary. Stored in the byte order of the machine that packed it.
+			struct m22pak_header
+			{
+				char m_magic[4];								///< "M22P"
+				Uint32 m_version;								///< \a M22PAK_VERSION it was written with
+				Uint32 m_numEntries;							///< Number of files
+				Uint32 m_pathDataSize;							///< Size of the path strings in bytes
+			};
+			/// A file in a packed archive
+			struct m22pak_entry
+			{
+				Uint64 m_hash;									///< \a HashPath of the file's path
+				Uint64 m_offset;								///< Where the file starts, from the start of the archive
+				Uint64 m_size;									///< Size of the file in bytes
+				Uint32 m_path;									///< Offset of the path in the path strings
+				Uint32 m_pathLength;							///< Length of the path
+			};
+		private:
+			/// A mounted archive
+			struct MountedArchive
+			{
+				M22MappedFile file;								///< The mapped archive
+				const m22pak_entry* entries;					///< Start of the entry table
+				Uint32 numEntries;								///< Number of entries
+				const char* paths;								///< Start of the path strings
+				Uint32 pathDataSize;							///< Size of the path strings in bytes
+			};
+			static std::deque<MountedArchive> ARCHIVES;			///< Mounted archives, searched newest first; a deque since M22MappedFile can't be copied
+		public:
+			/// Normalises a path the way archives store them: forward slashes, no leading "./"
+			///
+			/// \param _path Path to normalise
+			/// \return The normalised path
+			static std::string NormalisePath(const std::string& _path);
+
+			/// 64-bit FNV-1a hash of a normalised path
+			///
+			/// \param _path Normalised path
+			static Uint64 HashPath(const std::string& _path);
+
+			/// Maps an archive so its files are found before loose ones (and before older archives); mount before
+			/// the asset loader starts, since its threads read the tables without locking
+			///
+			/// \param _filename Path of the .m22pak
+			/// \return Error code, if 0 then mounted fine
+			static short int Mount(const std::string& _filename);
+
+			/// Unmounts every archive; anything still reading out of them must be freed first
+			static void Shutdown(void);
+
+			/// Finds a file in the mounted archives
+			///
+			/// \param _path Path of the file, as it would be opened from disk
+			/// \param _data Set to the start of the file inside the mapping
+			/// \param _size Set to the size of the file
+			/// \return true if found
+			static bool Find(const std::string& _path, const Uint8*& _data, size_t& _size);
+
+			/// Opens a file for SDL to read, from an archive if it's in one (without copying), otherwise from disk
+			///
+			/// \param _path Path of the file
+			/// \return The SDL_RWops, NULL if it couldn't be opened; pass freesrc=1 to whatever reads it
+			static SDL_RWops* OpenRW(const std::string& _path);
+
+			/// Reads a text file into a stream, from an archive if it's in one, otherwise from disk
+			///
+			/// \param _path Path of the file
+			/// \param _stream Stream to fill
+			/// \return true if the file was found
+			static bool OpenStream(const std::string& _path, std::stringstream& _stream);
+
+			/// Reads a whole text file into one string, from an archive if it's in one, otherwise from disk
+			///
+			/// \param _path Path of the file
+			/// \param _text String to fill, with any \\r stripped out
+			/// \return true if the file was found
+			static bool ReadText(const std::string& _path, std::string& _text);
+	};
+
+	/// \class 		M22AssetRegistry M22Engine.h "include/M22Engine.h"
+	/// \brief 		Interned asset names, and where each subsystem keeps them
+	///
+	/// \details 	Every asset name (file paths, character/outfit/emotion names) is interned once and gets an ID that
+	///				stays the same for the rest of the run. Subsystems bind the names they load to their own indices,
+	///				per \a KINDS, so finding one is a single hash rather than a scan comparing strings. Scripts (and Lua
+	///				commands) look names up when they're linked, so running them only ever uses the indices.
+	///				Safe to use from startup tasks on other threads.
+	///
+	class M22AssetRegistry
+	{
+		public:
+			typedef Uint32 AssetID;									///< Index of an interned name in \a NAMES
+			static const AssetID INVALID = 0xFFFFFFFF;				///< ID of a name that was never interned
+
+			/// What an index is bound to
+			enum KINDS
+			{
+				BACKGROUND,											///< Index in \a M22Graphics::backgroundIndex, by file path
+				CHARACTER,											///< Index in \a M22Engine::CHARACTERS_ARRAY, by name
+				OUTFIT,												///< Index in a character's outfits, by name; the owner is the character
+				EMOTION,											///< Index in a character's emotions, by name; the owner is the character
+				MUSIC,												///< Index in \a M22Sound::MUSIC_NAMES, by file path
+				STING,												///< Index in \a M22Sound::SFX_NAMES, by file path
+				SPRITE,												///< Index in \a M22Graphics::LOADED_SPRITES, by name and frame count ("name:frames")
+				NUMBER_OF_KINDS
+			};
+		private:
+			static std::deque<std::string> NAMES;					///< Interned names, by ID; a deque so the views in \a IDS stay valid
+			static std::unordered_map<std::string_view, AssetID> IDS;	///< Interned name to ID
+			static std::unordered_map<Uint64, int> BINDINGS[NUMBER_OF_KINDS];	///< Owner+1 (high 32 bits) and ID (low 32 bits) to index, per kind
+			static std::mutex MUTEX;								///< Guards everything above
+
+			/// Key in \a BINDINGS for an ID and owner
+			static inline Uint64 Key(AssetID _id, int _owner)
+			{
+				return (Uint64(Uint32(_owner + 1)) << 32) | _id;
+			};
+		public:
+			/// Interns a name, or returns its ID if it already has one
+			///
+			/// \param _name Name to intern
+			/// \return ID of the name
+			static AssetID Intern(std::string_view _name);
+
+			/// Finds the ID of a name without interning it
+			///
+			/// \param _name Name to find
+			/// \return ID of the name, \a INVALID if never interned
+			static AssetID Find(std::string_view _name);
+
+			/// Returns the name an ID was interned from
+			///
+			/// \param _id ID of the name
+			/// \return The name, empty if the ID is invalid
+			static std::string Name(AssetID _id);
+
+			/// Binds a name to an index; the first index bound to a name is kept, like a scan would find
+			///
+			/// \param _kind What the index is into
+			/// \param _name Name to bind
+			/// \param _index Index to bind it to
+			/// \param _owner Index of what owns the list (e.g. the character, for outfits), -1 if none
+			static void Bind(KINDS _kind, std::string_view _name, int _index, int _owner = -1);
+
+			/// Finds the index a name is bound to
+			///
+			/// \param _kind What the index is into
+			/// \param _name Name to find
+			/// \param _owner Index of what owns the list, -1 if none
+			/// \return Index bound to the name, -1 if none
+			static int Lookup(KINDS _kind, std::string_view _name, int _owner = -1);
+
+			/// Finds the index an interned name is bound to
+			///
+			/// \param _kind What the index is into
+			/// \param _id ID of the name
+			/// \param _owner Index of what owns the list, -1 if none
+			/// \return Index bound to the name, -1 if none
+			static int Lookup(KINDS _kind, AssetID _id, int _owner = -1);
+
+			/// Drops every binding of a kind, for when its list is cleared; the names stay interned
+			///
+			/// \param _kind What the indices were into
+			static void Unbind(KINDS _kind);
+	};
+
 	/// \class 		M22Engine M22Engine.h "include/M22Engine.h"
 	/// \brief 		The main class of M22.
 	///
@@ -84,12 +412,15 @@ namespace March22
 					///< Volume to play music at.
 				float SFX_VOLUME;
 					///< Volume to play \a SFX at.
+				Uint8 SKIP_UNREAD;
+					///< Does skipping carry on through lines that haven't been read before? (Kept last, so older files still load)
 				OPTIONS_STRUCTURE()
 				{
 					WINDOWED = 0;
 					AUTO_SPEED = 1.0f;
 					MUSIC_VOLUME = DEFAULT_MUSIC_VOLUME_MULT;
 					SFX_VOLUME = DEFAULT_SFX_VOLUME_MULT;
+					SKIP_UNREAD = 0;
 				};
 			};
 
@@ -127,24 +458,6 @@ namespace March22
 				std::vector<std::string> outfits;
 					///< Outfit names (for file-loading, e.g. "School" - "School/Happy_1.png")
 			};
-			/// Structure for characters to draw on-screen.
-			struct CharacterReference
-			{
-				SDL_Texture* sprite;
-					///< The active sprite
-				SDL_Rect rect;
-					///< Position to draw to screen
-				float alpha;
-					///< Current alpha amount
-				bool clearing;
-					///< Is this character currently being erased off the screen?
-				CharacterReference()
-				{
-					alpha = 0.0f;
-					clearing = false;
-					sprite = NULL;
-				};
-			};
 			/// Structure for backgrounds
 			struct Background
 			{
@@ -154,6 +467,14 @@ namespace March22
 					///< Current alpha amount
 				std::string name;
 					///< Name of background
+				int asset;
+					///< Handle from \a M22AssetLoader held while this is displayed, -1 if none
+				Background()
+				{
+					sprite = NULL;
+					alpha = 0.0f;
+					asset = -1;
+				};
 			};
 			/// Possible gamestates
 			enum GAMESTATES
@@ -164,17 +485,6 @@ namespace March22
 					///< Is in-game
 			};
 
-			/// Savegame structure (unused?)
-			struct SAVEGAME_STRUCTURE
-			{
-				GAMESTATES		GAMESTATE;
-				std::string		CURRENTBACKGROUND;
-				std::string		CURRENTMUSIC;
-				std::string		CURRENTLOOPINGSFX;
-				std::string		CURRENTSCRIPTFILE;
-				Uint32			CURRENTLINEPOSITION;
-			};
-		
 			static Vec2 MousePos; 		///< Current mouse position
 			static bool LMB_Pressed; 	///< Is LMB currently pressed?
 
@@ -212,14 +522,7 @@ namespace March22
 			/// \param _name Character's name.
 			/// \param _dialogue Don't know; just leave it blank!
 			/// \return Index of character, 0 if narrative
-			static int GetCharacterIndexFromName(std::string, bool _dialogue = false); 
-
-			/// Finds the index of the character from the string
-			///
-			/// \param _name Character's name.
-			/// \param _dialogue Don't know; just leave it blank!
-			/// \return Index of character, 0 if narrative
-			static int GetCharacterIndexFromName(std::wstring, bool _dialogue = false); 
+			static int GetCharacterIndexFromName(std::string_view, bool _dialogue = false); 
 
 			/// Finds the outfit index for the specified character
 			///
@@ -241,10 +544,10 @@ namespace March22
 			/// Starts the game
 			static void StartGame(void);
 
-			/// Saves the game state
+			/// Saves the game state (see \a M22SaveState)
 			static void SaveGame(const char* _filename);
 
-			/// Loads the game state
+			/// Loads the game state (see \a M22SaveState)
 			static void LoadGame(const char* _filename);
 
 			/// Saves the current configuration of options to OPTIONS.SAV
@@ -273,6 +576,13 @@ namespace March22
 		
 			/// Updates SDL Events
 			static void UpdateEvents(void);
+
+			/// Runs as many lines as fit in the time budget while \a skipping, finishing transitions
+			/// instantly so only the end result gets drawn. Stops at decisions, and at unread lines
+			/// unless \a OPTIONS.SKIP_UNREAD is set.
+			///
+			/// \param _budgetMs Time to spend skipping this frame, in milliseconds
+			static void FastForward(Uint32 _budgetMs);
 		
 			/// Updates keyboard input array
 			static void UpdateKeyboard(void);
@@ -296,12 +606,24 @@ namespace March22
 			static const Uint8 *SDL_KEYBOARDSTATE;					///< Current keyboard button states
 			static SDL_DisplayMode SDL_DISPLAYMODE;
 		
-			/// Initializes the M22 engine
+			/// Initializes the M22 engine; the character names must be loaded first (see \a PreloadM22)
 			///
 			/// \param ScrW Screen width
 			/// \param ScrH Screen height
 			/// \return Error code, if 0 then init'd fine
 			static short int InitializeM22(int ScrW, int ScrH);
+
+			/// Loads the character names and decodes the images \a InitializeM22 uses, ready for it to upload
+			///
+			/// \details Doesn't touch the renderer, so it can be a \a M22Startup load step
+			/// \return Error code, if 0 then loaded fine
+			static short int PreloadM22(void);
+
+			/// Loads the character names into \a CHARACTERS_ARRAY
+			///
+			/// \param _filename File with one character name per line
+			/// \return Error code, if 0 then loaded fine
+			static short int LoadCharacterNames(const char* _filename = "graphics/characters/CHARACTERS.txt");
 		
 			/// Initializes the SDL part of the engine
 			///
@@ -311,6 +633,63 @@ namespace March22
 			static short int InitializeSDL(const std::string _windowTitle, Vec2 ScrPos);
 	};
 
+	/// \class 		M22Atlas M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for packing small images into shared textures
+	///
+	/// \details 	Interface images are packed into a few large pages as they're loaded, in rows ("shelves"), so the
+	///				buttons, arrow and text frame drawn each frame come from the same texture instead of one each.
+	///				Images too big for a page get a page to themselves. Pages are only freed in \a Shutdown.
+	///
+	///				Character sprites aren't packed: they're full-height images, so a page holds very few of them;
+	///				\a M22AssetLoader streams them in and evicts them per script, which a page freed only at shutdown
+	///				can't do; and only the few on screen are drawn (each a quad of its own in \a M22CharacterLayer).
+	///
+	class M22Atlas
+	{
+		public:
+			/// Where a loaded image ended up
+			struct Region
+			{
+				SDL_Texture* texture;										///< The page the image is on, NULL if it failed to load
+				SDL_Rect rect;												///< Where the image is on the page
+				Region()
+				{
+					texture = NULL;
+					rect.x = rect.y = rect.w = rect.h = 0;
+				};
+			};
+		private:
+			/// A page of the atlas
+			struct Page
+			{
+				SDL_Texture* texture;										///< The page itself
+				int shelfX;													///< Where the next image goes along the current shelf
+				int shelfY;													///< Top of the current shelf
+				int shelfHeight;											///< Height of the tallest image on the current shelf
+				bool shared;												///< False if it holds a single oversized image
+			};
+			static std::vector<Page> PAGES;									///< Every page made so far
+			static std::unordered_map<std::string, Region> LOOKUP;			///< File path to region, so an image is only packed once
+			static int PAGE_SIZE;											///< Width/height of shared pages; 0 until the first image is loaded
+
+			/// Finds room for an image on a shared page, making a new page if none has any
+			///
+			/// \param _w Width of the image, including padding
+			/// \param _h Height of the image, including padding
+			/// \param _rect Set to where the image goes
+			/// \return Index of the page in \a PAGES, -1 if a new page couldn't be made
+			static int Pack(int _w, int _h, SDL_Rect& _rect);
+		public:
+			/// Loads an image into the atlas, or returns where it already is
+			///
+			/// \param _path File path of the image
+			/// \return Where the image is; its texture is NULL if it failed to load
+			static Region Load(const std::string& _path);
+
+			/// Destroys every page; any \a Region handed out is invalid afterwards
+			static void Shutdown(void);
+	};
+
 	/// \class 		M22Graphics M22Engine.h "include/M22Engine.h"
 	/// \brief 		Class for graphics drawing
 	///
@@ -324,136 +703,146 @@ namespace March22
 			enum BACKGROUND_UPDATE_TYPES
 			{
 				NONE,
-				BACKGROUND,				///< Changing the background
-				CHARACTER				///< Updating the characters
+				BACKGROUND				///< Changing the background
 			};
 			/// Data structure for the animated arrow for text progression
 			struct ArrowObj
 			{
-				SDL_Texture* sprite;	///< Sprite
+				SDL_Texture* sprite;	///< Sprite (an atlas page)
+				SDL_Rect rect;			///< Where the arrow's frames are on \a sprite
 				float frame;			///< The frame that the arrow is on
 				ArrowObj()
 				{
 					sprite = NULL;
+					rect.x = rect.y = rect.w = rect.h = 0;
 					frame = 0.0f;
 				};
 			};
 
-			/// Sprite object
+			/// How an animated sprite plays through its frames
+			enum ANIMATION_MODES
+			{
+				LOOP,					///< Back to the first frame after the last one
+				PING_PONG,				///< Back and forth between the first and last frames
+				ONCE,					///< Stops on the last frame
+				NUMBER_OF_ANIMATION_MODES
+			};
+
+			/// Names of animation modes for scripts to use (DrawAnimSprite); sorted by name
+			static constexpr M22Keyword<ANIMATION_MODES> ANIMATION_MODE_KEYWORDS[] =
+			{
+				{ "Loop",					LOOP },
+				{ "Once",					ONCE },
+				{ "PingPong",				PING_PONG },
+			};
+
+			/// A sprite sheet; one texture holding every frame of a sprite, loaded once per name
 			class M22Sprite
 			{
 				private:
-					bool m_animated;							///< Is the sprite animated?
-					float m_frame;								///< The current frame of the animation (ignore if not animated)
-					std::vector<SDL_Texture*> m_sprites;		///< The actual sprites
-					float m_speed;								///< How fast to animate the sprite
-					SDL_Rect m_coords;							///< Position and size of sprite
+					SDL_Texture* m_texture;						///< The sheet, NULL if it failed to load
+					std::vector<SDL_Rect> m_frames;				///< Where each frame is on the sheet
 					std::string m_name;							///< Name of sprite
 				public:
-					SDL_Texture** currSprite;
-					inline bool IsAnimated()
-					{
-						return m_animated;
-					};
-					inline float frame()
-					{
-						return m_frame;
-					};
-					inline int x()
-					{
-						return m_coords.x;
-					}
-					inline int y()
-					{
-						return m_coords.y;
-					}
-					inline int w()
-					{
-						return m_coords.w;
-					}
-					inline int h()
-					{
-						return m_coords.h;
-					}
-					inline void Update()
+					inline const std::string& name() const
 					{
-						m_frame += m_speed;
-						currSprite = &m_sprites.at((int)m_frame);
+						return m_name;
 					}
-					inline bool CompareName(std::string _name)
+					inline SDL_Texture* texture() const
 					{
-						return (_name == m_name);
+						return m_texture;
 					}
-					inline void Draw(SDL_Renderer* _renderer)
+					inline size_t frames() const
 					{
-						SDL_RenderCopyEx(
-							_renderer,
-							*currSprite,
-							NULL,
-							&m_coords,
-							NULL,
-							NULL,
-							SDL_FLIP_NONE
-						);
+						return m_frames.size();
 					}
-					M22Sprite( std::string _file, SDL_Renderer* _renderer, int _x = 0, int _y = 0, bool _animated = false, float _speed = 1.0f,  unsigned short int _num_of_frames = 1)
+					inline const SDL_Rect& frame(size_t _frame) const
 					{
-						m_name = _file;
-						m_coords.x = _x;
-						m_coords.y = _y;
-						m_frame = 0.0f;
-						m_animated = _animated;
-						m_speed = _speed;
-						m_sprites.resize(_num_of_frames);
-						currSprite = &m_sprites.at(0);
-
-						if (_animated)
-						{
-							for (size_t i = 0; i < m_sprites.size(); i++)
-							{
-								std::string tempStr = "./graphics/sprites/";
-								tempStr += _file + "_";
-								tempStr += (i + SPRITE_DEFAULT_FORMAT);
-								m_sprites.at(i) = IMG_LoadTexture(_renderer, tempStr.c_str());
-								if (!m_sprites.at(i)) printf("[M22Sprite] Failed to load sprite file %s!\n", tempStr.c_str());
-							}
-						}
-						else
-						{
-							std::string tempStr = "./graphics/sprites/";
-							tempStr += (_file + SPRITE_DEFAULT_FORMAT);
-							*currSprite = IMG_LoadTexture(_renderer, tempStr.c_str());
-							if (!*currSprite) printf("[M22Sprite] Failed to load sprite file %s!\n", tempStr.c_str());
-						}
-
-						SDL_QueryTexture(*currSprite, NULL, NULL, &m_coords.w, &m_coords.h);
+						return m_frames.at(_frame);
 					}
-					~M22Sprite()
+
+					/// Loads graphics/sprites/<name>.png, split into _num_of_frames frames side by side. Without one,
+					/// the frames are loaded from <name>_0.png, <name>_1.png, etc. and put together into a sheet.
+					///
+					/// \param _file Name of the sprite
+					/// \param _renderer Renderer to make the sheet for
+					/// \param _num_of_frames Number of frames
+					M22Sprite(const std::string& _file, SDL_Renderer* _renderer, unsigned short int _num_of_frames = 1);
+					~M22Sprite();
+
+					// The sheet belongs to the sprite
+					M22Sprite(const M22Sprite&) = delete;
+					M22Sprite& operator=(const M22Sprite&) = delete;
+			};
+
+			/// A sprite on screen, playing through the frames of its sheet
+			struct ActiveSprite
+			{
+				const M22Sprite* sprite;						///< The sheet, in \a LOADED_SPRITES
+				SDL_Rect rect;									///< Where it's drawn
+				ANIMATION_MODES mode;							///< How it plays through the frames
+				Uint32 frameTime;								///< Milliseconds each frame is shown for; 0 if it isn't animated
+				Uint32 elapsed;									///< Milliseconds it has been playing for
+
+				/// Is it still moving on by itself?
+				inline bool IsAnimated() const
+				{
+					if(frameTime == 0 || sprite->frames() < 2)
 					{
-						for (size_t i = 0; i < m_sprites.size(); i++)
-						{
-							SDL_DestroyTexture(m_sprites.at(i));
-						}
-						m_sprites.clear();
-						m_sprites.resize(0);
-						currSprite = nullptr;
-						m_frame = 0.0f;
-						m_speed = 0.0f;
-					}
+						return false;
+					};
+					return (mode != ONCE || elapsed / frameTime < sprite->frames() - 1);
+				};
+
+				/// Moves the animation on
+				///
+				/// \param _ms Milliseconds since the last update (\a M22Engine::DELTA_TIME)
+				void Update(Uint32 _ms);
+
+				/// The frame to draw, for how long it has been playing
+				size_t Frame() const;
 			};
 
-			static SDL_Texture* BACKGROUND_RENDER_TARGET;						///< The off-screen render target for the background
-			static SDL_Texture* NEXT_BACKGROUND_RENDER_TARGET;					///< The off-screen render target for the next background
-			static float NEXT_BACKGROUND_ALPHA;									///< The alpha of the next background (for fading in)
+			static SDL_Texture* BACKGROUND_RENDER_TARGET;						///< The off-screen render target for the background; an \a M22Compositor layer
+			static SDL_Texture* NEXT_BACKGROUND_RENDER_TARGET;					///< The off-screen render target for the next background; an \a M22Compositor layer
+			static float TRANSITION_PROGRESS;									///< How far along the active transition is, 0 to 1; an \a M22Tween tween while one is running
 			static BACKGROUND_UPDATE_TYPES changeQueued;						///< The type of the background change scheduled
 
-			static std::vector<M22Sprite*> ACTIVE_SPRITES;						///< Sprites to draw
-			static std::vector<M22Sprite> LOADED_SPRITES;						///< Sprites that have been loaded
+			static std::vector<ActiveSprite> ACTIVE_SPRITES;					///< Sprites to draw, in order
+			static std::deque<M22Sprite> LOADED_SPRITES;						///< Sprite sheets the current script has loaded, bound by name in \a M22AssetRegistry; a deque so \a ActiveSprite::sprite stays valid as more are loaded
+			static Mat3f SPRITE_TRANSFORM;										///< Transform applied to the sprites as they're drawn (identity by default)
+			static std::vector<SDL_Rect> SPRITE_RECTS;							///< Where \a ACTIVE_SPRITES are drawn this frame, after \a SPRITE_TRANSFORM
+
+			/// Transforms a batch of rects; see \a Matrix::TransformRects
+			///
+			/// \param _transform 2D homogeneous transform
+			/// \param _rects Rects to transform, in place
+			/// \param _count Number of rects
+			static void TransformRects(const Mat3f& _transform, SDL_Rect* _rects, size_t _count);
+
+			/// Loads a sprite sheet, or finds it if it already has been with the same number of frames
+			///
+			/// \param _name Name of the sprite
+			/// \param _frames Number of frames on the sheet
+			/// \return Index of the sheet in \a LOADED_SPRITES
+			static int LoadSprite(const std::string& _name, unsigned short int _frames = 1);
 
-			static SDL_Texture* textFrame;										///< Texture for the primary text frame
+			/// Puts a sprite on screen, over the others; it starts on its first frame
+			///
+			/// \param _sprite Index of the sheet in \a LOADED_SPRITES
+			/// \param _x Position on the X-axis
+			/// \param _y Position on the Y-axis
+			/// \param _mode How it plays through the frames
+			/// \param _frameTime Milliseconds each frame is shown for; 0 to not animate
+			static void ShowSprite(int _sprite, int _x, int _y, ANIMATION_MODES _mode = LOOP, Uint32 _frameTime = 0);
+
+			/// Draws every active sprite in one pass, moving their animations on by \a M22Engine::DELTA_TIME
+			static void DrawSprites(void);
+
+			static SDL_Texture* textFrame;										///< Texture for the primary text frame (an atlas page)
+			static SDL_Rect textFrameRect;										///< Where the text frame is on \a textFrame
 			static ArrowObj arrow;												///< The text arrow object
-			static std::vector<SDL_Texture*> characterFrameHeaders;				///< The array of sprites for character names when they talk
-			static std::vector<M22Engine::CharacterReference> activeCharacters;	///< Array of active characters to draw to the screen
+			static std::vector<M22Atlas::Region> characterFrameHeaders;			///< The array of sprites for character names when they talk
 			static std::vector<SDL_Texture*> mainMenuBackgrounds;				///< The possible backgrounds for the main menu to use, loaded into this array
 			static M22Engine::Background activeMenuBackground;					///< The active background for the main menu
 			static M22Engine::Background menuLogo;								///< The game's logo to draw onto the main menu
@@ -477,35 +866,29 @@ namespace March22
 			/// Updates background states/alpha
 			static void UpdateBackgrounds(void);
 
-			/// Update character states/alpha
-			static void UpdateCharacters(void);
-		
 			/// Draw the ingame screen (background, text box, interfaces, etc.)
 			static void DrawInGame(bool _draw_black = true);
 
 			/// Hijack the renderer and fade to black slowly
 			static void FadeToBlackFancy(void);
+
+			/// Draws the active transition over the current background; once it's finished, the next background becomes the current one and the script moves on
+			static void DrawTransition(void);
+
+			/// Finishes the queued background/character change as if its transition had run to the end, without advancing the script
+			static void CompleteTransition(void);
 		
-			/// Adds the specified character to the active characters to draw
-			///
-			/// \param _charindex Index of character to add to active
-			/// \param _outfitindex Index of character's outfit
-			/// \param _emotionindex Index of character's emotion
-			/// \param _xPosition Position on the X-axis
-			/// \param _brutal Fade-in or just insert?
-			static void AddActiveCharacter(int _charindex, int _outfitindex, int _emotionindex, int _xPosition, bool _brutal = false);
-		
-			/// Updates/resets the render target
+			/// Draws the active background into the next background's layer and starts the active transition to it
 			static void UpdateBackgroundRenderTarget(void);
-		
-			/// Adds the specified character to the background render target (hard-drawn to the background)
-			///
-			/// \param _charindex Index of character to add to active
-			/// \param _outfitindex Index of character's outfit
-			/// \param _emotionindex Index of character's emotion
-			/// \param _xPosition Position on the X-axis
-			/// \param _brutal Fade-in or just insert?
-			static void AddCharacterToBackgroundRenderTarget(int _charindex, int _outfitindex, int _emotionindex, int _xPosition, bool _brutal = false);
+
+			/// Draws the active background into both background layers again, after \a M22Compositor lost them
+			static void RedrawBackgroundLayers(void);
+
+			/// Makes the specified texture the active background, holding it in \a M22AssetLoader, and redraws the render target
+			///
+			/// \param _asset Handle of the background's texture
+			/// \param _name File path of the background
+			static void ShowBackground(int _asset, const std::string& _name);
 		
 			/// Draws the animated arrow at correct location, taking into account width/height of target
 			///
@@ -523,7 +906,6 @@ namespace March22
 
 			static TTF_Font *textFont;											///< The TTF font to use for speech/narrative text.
 
-			static SDL_Rect* wipePosition;										///< The current position of the active transition wipe
 			static SDL_Texture* wipeBlack;										///< A texture for wiping black; just \a BLACK_TEXTURE reference
 			static SDL_Rect wipeBlackRect;										///< The current position of the black wipe
 		
@@ -537,9 +919,42 @@ namespace March22
 				NUMBER_OF_TRANSITIONS
 			};
 
-			static const std::wstring TRANSITION_NAMES[NUMBER_OF_TRANSITIONS];	///< Name of transitions for scripts to use
+			/// Names of transitions for scripts to use (SetActiveTransition); sorted by name
+			static constexpr M22Keyword<TRANSITIONS> TRANSITION_KEYWORDS[] =
+			{
+				{ "Fade",					FADEIN },
+				{ "SwipeDown",				SWIPE_DOWN },
+				{ "SwipeToLeft",			SWIPE_TO_LEFT },
+				{ "SwipeToRight",			SWIPE_TO_RIGHT },
+			};
 
 			static Uint8 activeTransition;										///< Which transition to use, refering to \a TRANSITIONS enum
+
+			/// Draws part of the way through a transition, over the current background already on screen
+			///
+			/// \param _next The next background's layer
+			/// \param _t How far along the transition is, 0 to 1
+			typedef void (*TransitionDraw)(SDL_Texture* _next, float _t);
+
+			/// How a transition is drawn, and for how long
+			struct Transition
+			{
+				TransitionDraw draw;											///< Draws the next background over the current one
+				Uint32 duration;												///< How long it takes, in milliseconds
+			};
+
+			/// Every transition, in \a TRANSITIONS order; a new one needs its entry here, in the enum and in \a TRANSITION_KEYWORDS
+			static const Transition TRANSITION_TABLE[];
+
+			/// Copies part of the next background to the same part of the screen
+			///
+			/// \param _next The next background's layer
+			/// \param _left Left edge, as a fraction of the width
+			/// \param _top Top edge, as a fraction of the height
+			/// \param _right Right edge, as a fraction of the width
+			/// \param _bottom Bottom edge, as a fraction of the height
+			/// \param _alpha Alpha to draw it at
+			static void DrawNextBackground(SDL_Texture* _next, float _left, float _top, float _right, float _bottom, Uint8 _alpha = 255);
 	};
 
 	/// \class 		M22Sound M22Engine.h "include/M22Engine.h"
@@ -559,13 +974,20 @@ namespace March22
 				VOICE,											///< Voice (UNUSED CURRENTLY)
 				LOOPED_SFX										///< SFX that is to loop continuously
 			};
-			static std::vector<Mix_Chunk*> SOUND_FX;			///< Array of loaded SFX files
-			static std::vector<Mix_Music*> MUSIC;				///< Array of loaded music files
+			static std::vector<Mix_Chunk*> SOUND_FX;			///< Array of SFX files, NULL until decoded (use \a GetSting)
+			static std::vector<Mix_Music*> MUSIC;				///< Array of music streams, NULL until opened (use \a GetMusic)
+			static std::vector<bool> MUSIC_FAILED;				///< Tracks in \a MUSIC that couldn't be opened, so they aren't tried again
+			static std::vector<Uint32> SFX_LAST_USED;			///< SDL_GetTicks() each sting was last played or warmed, for LRU eviction
+			static size_t SFX_RESIDENT_BYTES;					///< Decoded audio currently held in \a SOUND_FX
+			static size_t SFX_BUDGET;							///< Most decoded audio \a SOUND_FX may hold, in bytes
+			static std::deque<int> SFX_WARM_QUEUE;				///< Stings coming up in the script, decoded one per \a UpdateSound
+			static int prefetchedTrack;							///< Music opened ahead of the NewMusic line that plays it, -1 if none
 			static std::vector<std::string> MUSIC_NAMES;		///< Array of loaded music file names (for scripts)
 			static std::vector<std::string> SFX_NAMES;			///< Array of loaded SFX file names (for scripts)
 			static float* MUSIC_VOLUME;							///< Current volume for music playback
 			static float* SFX_VOLUME;							///< Current volume for SFX playback
 			static int currentTrack;							///< The active track to play in \a MUSIC array. 0 = silence
+			static int currentLoopedSting;						///< The sting playing on a loop in the \a LOOPED_SFX mixer, -1 if none
 
 			/// Finds and returns the ID of the specified track
 			///
@@ -576,14 +998,7 @@ namespace March22
 					std::string tempPath = "sfx/music/";
 					tempPath += _name;
 					tempPath += ".OGG";
-					for(size_t i = 0; i < M22Sound::MUSIC.size(); i++)
-					{
-						if(tempPath == M22Sound::MUSIC_NAMES.at(i))
-						{
-							return i;
-						};
-					};
-					return -1;
+					return M22AssetRegistry::Lookup(M22AssetRegistry::MUSIC, tempPath);
 				};
 
 			/// Finds and returns the ID of the specified sting
@@ -595,14 +1010,7 @@ namespace March22
 					std::string tempPath = "sfx/stings/";
 					tempPath += _name;
 					tempPath += ".OGG";
-					for(size_t i = 0; i < M22Sound::SOUND_FX.size(); i++)
-					{
-						if(tempPath == M22Sound::SFX_NAMES.at(i))
-						{
-							return i;
-						};
-					};
-					return -1;
+					return M22AssetRegistry::Lookup(M22AssetRegistry::STING, tempPath);
 				};
 
 			/// Plays a SFX once, doesn't play if a SFX is already playing
@@ -659,9 +1067,36 @@ namespace March22
 			/// Resumes whatever is paused in the \a LOOPED_SFX mixer
 				static void ResumeMusic();
 
-			/// Updates the sound, checking whether to loop
+			/// Updates the sound, checking whether to loop, and decodes one of \a SFX_WARM_QUEUE
 				static void UpdateSound(void);
 
+			/// Returns the sting, decoding it first (and evicting old ones over \a SFX_BUDGET) if needed
+			///
+			/// \param _position Index of sound file from \a SOUND_FX array.
+			/// \return The sting, NULL if it doesn't exist or failed to load
+				static Mix_Chunk* GetSting(int _position);
+
+			/// Returns the music stream, opening it first if needed
+			///
+			/// \param _position Index of sound file in \a MUSIC array.
+			/// \return The music, NULL if it doesn't exist or failed to load
+				static Mix_Music* GetMusic(int _position);
+
+			/// Frees least recently used stings that aren't playing until \a _needed more bytes fit in \a SFX_BUDGET
+			///
+			/// \param _needed Bytes about to be added
+				static void EvictStings(size_t _needed);
+
+			/// Queues the specified stings to be decoded ahead of time, one per \a UpdateSound
+			///
+			/// \param _positions Indices of sound files in \a SOUND_FX array, soonest first
+				static void WarmStings(const std::vector<int>& _positions);
+
+			/// Opens the specified music track ahead of the line that plays it, closing any other prefetched track
+			///
+			/// \param _position Index of sound file in \a MUSIC array, -1 for none
+				static void PrefetchTrack(int _position);
+
 			/// Initializes music+SFX
 			/// \return -1 if music fails, -2 if SFX fails, 0 if fine
 				static short int InitializeSound(void);
@@ -720,15 +1155,55 @@ namespace March22
 				DRAW_SPRITE,					///< Draws the specified sprite file
 				DRAW_SPRITE_ANIMATED,			///< Draws the specified sprite file, animated
 				CLEAR_SPRITES,					///< Clears the ACTIVE_SPRITES array
-				NARRATIVE						///< Speech without chat box (thoughts of main character; narrative)
+				NARRATIVE,						///< Speech without chat box (thoughts of main character; narrative)
+				NUM_OF_LINETYPES				///< Number of line types; not a line type
+			};
+
+			/// Script command keywords; sorted by name, anything not in here is speech.
+			/// Adding a command only takes an entry here (plus its handler in M22ScriptCompiler::COMMAND_HANDLERS)
+			static constexpr M22Keyword<LINETYPE> LINETYPE_KEYWORDS[] =
+			{
+				{ "//",							COMMENT },
+				{ "BrightenScreen",				BRIGHT_SCREEN },
+				{ "ClearCharacters",			CLEAR_CHARACTERS },
+				{ "ClearCharactersBrutal",		CLEAR_CHARACTERS_BRUTAL },
+				{ "ClearSprites",				CLEAR_SPRITES },
+				{ "DarkenScreen",				DARK_SCREEN },
+				{ "DrawAnimSprite",				DRAW_SPRITE_ANIMATED },
+				{ "DrawBackground",				NEW_BACKGROUND },
+				{ "DrawBackgroundStealth",		NEW_BACKGROUND_STEALTH },
+				{ "DrawCharacter",				DRAW_CHARACTER },
+				{ "DrawCharacterBrutal",		DRAW_CHARACTER_BRUTAL },
+				{ "DrawSprite",					DRAW_SPRITE },
+				{ "ExitGame",					EXITGAME },
+				{ "FadeToBlack",				FADE_TO_BLACK },
+				{ "FadeToBlackFancy",			FADE_TO_BLACK_FANCY },
+				{ "Goto",						GOTO },
+				{ "Goto_debug",					GOTO_DEBUG },
+				{ "LoadScript",					LOAD_SCRIPT },
+				{ "LoadScriptGoto",				LOAD_SCRIPT_GOTO },
+				{ "MainMenu",					EXITTOMAINMENU },
+				{ "MakeDecision",				MAKE_DECISION },
+				{ "NewPage",					NEW_PAGE },
+				{ "PlayLoopedSting",			PLAY_STING_LOOPED },
+				{ "PlayMusic",					NEW_MUSIC },
+				{ "PlaySting",					PLAY_STING },
+				{ "RunLuaScript",				RUN_LUA_SCRIPT },
+				{ "SetActiveTransition",		SET_ACTIVE_TRANSITION },
+				{ "SetDecision",				SET_DECISION },
+				{ "StopLoopedStings",			STOP_STING_LOOPED },
+				{ "StopMusic",					STOP_MUSIC },
+				{ "Wait",						WAIT },
+				{ "m22IF",						IF_STATEMENT },
 			};
 
 			/// Data structure for decisions
 			struct Decision
 			{
-				std::wstring name;							///< Name of decision (for scripts)
+				std::string name;							///< Name of decision (for scripts)
 				short unsigned int num_of_choices;			///< Number of possible choices
-				std::vector<std::wstring> choices;			///< Array of choice names (for scripts)
+				std::vector<std::string> choices;			///< Array of choice names (for scripts); a choice's index is its ID, so it's only ever appended to
+				std::unordered_map<std::string, int> choiceLookup;	///< Maps choice names to their index in \a choices
 				short int selectedOption;					///< The index from \a choices of the choice that the player selected
 				Decision()
 				{
@@ -747,12 +1222,10 @@ namespace March22
 
 			static const unsigned short int DARKEN_SCREEN_OPACITY = 100;	///< Current opacity of the darken screen effect
 
-			static std::string currentLine;									///< Current line from script, loaded into string
-			static std::wstring currentLine_w;								///< Current line from script, loaded into wide string
-			static int currentLineIndex;									///< Current line index in \a currentScript
+			static std::string_view currentLine;							///< Text (UTF-8) of the current line; a view of its \a M22ScriptCompiler::line_c::m_lineContents
+			static int currentLineIndex;									///< Current line index in \a M22ScriptCompiler::currentScript_c
+			static Uint64 linesExecuted;									///< Number of script commands run since startup, for benchmarking
 			static LINETYPE currentLineType;
-			static std::vector<std::string> currentScript;					///< Active script, loaded each line as an array of strings
-			static std::vector<std::wstring> currentScript_w;				///< Active script, loaded each line as an array of wide strings
 			static std::string currentScriptFileName;						///< Active script's filename
 			static int activeSpeakerIndex;									///< The index of the active speaker, for chat box names
 			static SDL_Surface *currentLineSurface;							///< Current line surface, for drawing the text off-screen
@@ -764,10 +1237,30 @@ namespace March22
 
 			static float fontSize;											///< The size of the text font; not sure if still used?
 
-			static std::vector<Decision> gameDecisions;						///< Array of game decisions
+			static std::vector<Decision> gameDecisions;						///< Array of game decisions; a decision's index is its ID, so it's only ever appended to
+			static std::unordered_map<std::string, int> gameDecisionLookup;	///< Maps decision names to their index in \a gameDecisions
+			static int activeDecision;										///< Index in \a gameDecisions of the decision being made, -1 if none
+			static std::vector<int> activeChoices;							///< Choice IDs the active MakeDecision offers, in the order they're shown
 
-			static std::wstring typewriter_text;							///< Position the typewriter is currently at of the current line
-			static size_t typewriter_currPos;								///< Position the typewriter is currently at of the current line
+			/// A choice of the active decision, rendered once when the decision comes up
+			struct DecisionChoiceTexture
+			{
+				SDL_Texture* text;											///< The choice in white
+				SDL_Texture* shadow;										///< The choice in black
+				SDL_Rect rect;												///< Where the choice is drawn (the shadow is 1px down/right)
+			};
+			static std::vector<DecisionChoiceTexture> decisionTextures;		///< Cached choices of the active decision, in the order shown
+			static int decisionTexturesDecision;							///< Index in \a gameDecisions that \a decisionTextures were rendered for, -1 if none
+			static std::vector<int> decisionTexturesChoices;				///< \a activeChoices that \a decisionTextures were rendered for
+			static int decisionTexturesWidth;								///< Screen width \a decisionTextures were wrapped to
+
+			static std::string typewriter_text;								///< Text (UTF-8) the typewriter has revealed on the page so far
+			static size_t typewriter_currPos;								///< Byte offset the typewriter is currently at of the current line
+			static size_t typewriter_end;									///< Byte offset in \a currentLine where the page being typed out ends
+			static size_t typewriter_page;									///< Which of the current line's pages (\a M22TextLayer::LineLayout::pages) is being typed out
+			static Uint32 typewriter_elapsed;								///< Milliseconds since the typewriter started on the page
+			static size_t typewriter_revealed;								///< Characters typed out since then
+			static int pageRows;											///< Rows of text on the page before the line being typed out
 			static NFont* font;
 		
 			/// Loads the decisions file into \a gameDecisions array
@@ -776,6 +1269,19 @@ namespace March22
 			/// \return Error code if problem encountered, 0 if fine
 			static short int LoadGameDecisions(const char* _filename);
 		
+			/// Finds the decision with the specified name, adding it if it doesn't exist yet
+			///
+			/// \param _name Name of decision
+			/// \return Index of the decision in \a gameDecisions
+			static int FindOrAddDecision(const std::string& _name);
+
+			/// Finds the choice with the specified name in a decision, adding it if it doesn't exist yet
+			///
+			/// \param _decision Index of the decision in \a gameDecisions
+			/// \param _name Name of choice
+			/// \return Index of the choice in the decision's \a choices
+			static int FindOrAddChoice(int _decision, const std::string& _name);
+		
 			/// Loads the X and Y position for game text into \a currentLineTextureRect
 			/// 
 			/// \param _filename File path/name of text box position file
@@ -789,11 +1295,86 @@ namespace March22
 			static void DrawCurrentLine(int ScrW, int ScrH);
 
 			static bool updateCurrentLine;
+
+			/// Starts typing out the line that just came up; if it won't fit under what's on the page, the page is cleared first
+			static void BeginTypewriter(void);
+
+			/// Moves the typewriter on by however many characters the time allows, and finishes the page when it gets to the end
+			///
+			/// \param _ms Milliseconds since the last update
+			static void UpdateTypewriter(Uint32 _ms);
+
+			/// Types the rest of the current line's page out at once, as the typewriter would when it finishes
+			static void FinishTypewriter(void);
+
+			/// Types out every page left of the current line, as clicking through them would
+			static void FinishLine(void);
+
+			/// If the current line carries on over another page, clears the page and starts typing that out
+			///
+			/// \return true if there was another page
+			static bool NextTypewriterPage(void);
+
+			/// What the player clicking on does: finishes the page being typed, then the line's next page, then the next line
+			static void Advance(void);
+
+			/// Works out the typewriter's page (and how full the page is) from \a typewriter_text and \a typewriter_currPos,
+			/// for when they've been put back from a savegame
+			static void ResumeTypewriter(void);
+
+			/// Clears the page of text, for a NewPage or a line that doesn't fit
+			static void NewPage(void);
+
+			/// The lines of a script that have been shown, one bit per line
+			struct ReadLineSet
+			{
+				Uint32 lineCount;											///< Lines in the script when the set was made; if that changes, the set is dropped
+				std::vector<Uint64> bits;									///< Bit (n % 64) of word (n / 64) is set once line n has been shown
+			};
+			static std::unordered_map<std::string, ReadLineSet> readLines;	///< Lines shown so far, by script filename; kept across sessions in READLINES.SAV
+			static bool currentLineUnread;									///< Was the current line new when it came up?
+
+			/// Has the line of the current script been shown before?
+			///
+			/// \param _line Index of the line in \a M22ScriptCompiler::currentScript_c
+			static bool IsLineRead(int _line);
+
+			/// Records that the line of the current script has been shown
+			///
+			/// \param _line Index of the line in \a M22ScriptCompiler::currentScript_c
+			static void MarkLineRead(int _line);
+
+			/// Loads \a readLines
+			///
+			/// \param _filename File path/name of the read lines file
+			/// \return Error code if problem encountered, 0 if fine
+			static short int LoadReadLines(const char* _filename);
+
+			/// Saves \a readLines
+			///
+			/// \param _filename File path/name of the read lines file
+			/// \return Error code if problem encountered, 0 if fine
+			static short int SaveReadLines(const char* _filename);
 			
-			/// Draws the specified decision options to screen
+			/// Renders each of \a activeChoices of the decision into \a decisionTextures, replacing any already cached
 			///
 			/// \param _decision Specified decision
 			/// \param ScrW Screen width resolution
+			static void RenderDecisionTextures(M22Script::Decision* _decision, int ScrW);
+
+			/// Destroys \a decisionTextures; call once the decision has been made
+			static void ReleaseDecisionTextures(void);
+
+			/// Picks one of the active decision's choices and moves the script on
+			///
+			/// \param _slot Position of the choice as shown, from 0
+			/// \return Error code, if 0 then picked fine
+			static short int SelectChoice(int _slot);
+
+			/// Draws the specified decision options to screen, from \a decisionTextures once they've been rendered
+			///
+			/// \param _decision Specified decision; the choices drawn are \a activeChoices
+			/// \param ScrW Screen width resolution
 			/// \param ScrH Screen height resolution
 			static void DrawDecisions(M22Script::Decision* _decision,int ScrW, int ScrH);
 			
@@ -809,126 +1390,57 @@ namespace March22
 			/// \param ch Character to split between
 			static unsigned int SplitString(const std::string&, std::vector<std::string>&, char);
 		
-			/// Splits string into parts between specified character into an array
+			/// Splits string into parts between specified character, without copying them
 			///
-			/// \param txt Target string to split
-			/// \param strs Address of string array to split into
+			/// \param txt Target string to split; the parts are views of it, so it has to outlive them
+			/// \param strs Address of array of views to split into
 			/// \param ch Character to split between
-			static unsigned int SplitString(const std::wstring&, std::vector<std::wstring>&, char);
+			static unsigned int SplitString(std::string_view, std::vector<std::string_view>&, char);
 			
 			/// Checks and returns the type of the string from \a LINETYPE
 			///
 			/// \param _input String to check
 			/// \return Type of line as \a LINETYPE enumerator
-			static M22Script::LINETYPE CheckLineType(std::wstring);
+			static M22Script::LINETYPE CheckLineType(std::string_view);
 			
 			/// Checks and returns if the character is a colon ( : )
 			///
 			/// \param _char Character to check
 			static bool isColon(int _char);
 			
-			/// Clears active characters array
-			static void ClearCharacters(void);
+			/// Fades every character off the screen, and undarkens it
+			///
+			/// \param _brutal Remove them straight away rather than fading them out?
+			static void ClearCharacters(bool _brutal = false);
 			
 			/// Fades to screen black
 			static void FadeToBlack(void);
-		
-			/// Converts a wstring to a normal string.
-			///
-			/// \param _input wstring to convert
-			inline static std::string to_string(std::wstring _input)
+	};
+
+	/// \class 		M22ScriptCompiler M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for loading then compiling script files
+	///
+	class M22ScriptCompiler
+	{
+	private:
+
+	public:
+	
+		/// Structure for compiled lines of M22Script
+		struct line_c
+		{
+			M22Script::LINETYPE m_lineType;					///< The type of line
+			std::vector<int> m_parameters;					///< The parameters, if the linetype is not speech or narrative
+			std::vector<std::string> m_parameters_txt;		///< The parameters in string format, for loading Lua or M22Scripts
+			std::string m_lineContents;						///< The speech (UTF-8), if the linetype is speech or narrative
+			int m_speaker;									///< Who's speaking, if the linetype is speech
+			int m_ID;										///< ID of whatever the linetype is (e.g. if LINETYPE is DrawBackground, then it's the ID of the background)
+			int m_asset;									///< Handle from \a M22AssetLoader of the texture this line draws, -1 if none
+			std::vector<line_c> m_subLines;					///< The command an IF_STATEMENT runs when it's true, compiled with the line
+			line_c()
 			{
-				std::string output;
-				std::wstring input = _input;
-				output.assign(input.begin(), input.end());
-				return output;
-			};
-		
-			/// Converts a wstring to a Uint16 array (for SDL_TTF)
-			///
-			/// \param _wstr wstring to convert
-			/// \param _size Reference to size of array variable
-			inline static Uint16* to_Uint16(std::wstring _wstr, int &_size)
-			{
-				if(_wstr.length() != 0)
-				{
-					Uint16* stext = new Uint16[_wstr.length()+1];
-					_size = _wstr.length()+1;
-					for (size_t i = 0; i < _wstr.length(); ++i) {
-						stext[i] = _wstr.at(i); 
-					}
-					stext[_wstr.length()] = '\0';
-					return stext;
-				} 
-				else 
-				{
-					return NULL;
-				};
-			};
-		
-			/// Converts a wstring to a Uint16 array (for SDL_TTF)
-			///
-			/// \param _wstr wstring to convert
-			inline static Uint16* to_Uint16(std::wstring _wstr)
-			{
-				if(_wstr.length() != 0)
-				{
-					Uint16* stext = new Uint16[_wstr.length()+1];
-					for (size_t i = 0; i < _wstr.length(); ++i) {
-						stext[i] = _wstr.at(i); 
-					}
-					stext[_wstr.length()] = '\0';
-					return stext;
-				} 
-				else 
-				{
-					return NULL;
-				};
-			};
-		
-			/// Converts a c-string to a wstring.
-			///
-			/// \param _input c-string to convert
-			inline static std::wstring to_wstring(const char* _input)
-			{
-				std::wstring output;
-				std::string input = _input;
-				output.assign(input.begin(), input.end());
-				return output;
-			};
-		
-			/// Converts a string to a wstring.
-			///
-			/// \param _input string to convert
-			inline static std::wstring to_wstring(std::string _input)
-			{
-				std::wstring output;
-				output.assign(_input.begin(), _input.end());
-				return output;
-			};
-	};
-
-	/// \class 		M22ScriptCompiler M22Engine.h "include/M22Engine.h"
-	/// \brief 		Class for loading then compiling script files
-	///
-	class M22ScriptCompiler
-	{
-	private:
-
-	public:
-	
-		/// Structure for compiled lines of M22Script
-		struct line_c
-		{
-			M22Script::LINETYPE m_lineType;					///< The type of line
-			std::vector<int> m_parameters;					///< The parameters, if the linetype is not speech or narrative
-			std::vector<std::string> m_parameters_txt;		///< The parameters in string format, for loading Lua or M22Scripts
-			std::wstring m_lineContents;					///< The speech, if the linetype is speech or narrative
-			int m_speaker;									///< Who's speaking, if the linetype is speech
-			int m_ID;										///< ID of whatever the linetype is (e.g. if LINETYPE is DrawBackground, then it's the ID of the background)
-			line_c()
-			{
-				m_speaker,m_ID = 0;
+				m_speaker = m_ID = 0;
+				m_asset = -1;
 				m_lineType = M22Script::SPEECH;
 			};
 			~line_c()
@@ -957,11 +1469,111 @@ namespace March22
 		static std::vector<line_c> currentScript_c;																			///< The current script, compiled
 		static line_c* CURRENT_LINE;																						///< A pointer to the current line, for shorthand
 		static std::vector<script_checkpoint> currentScript_checkpoints;													///< Array of checkpoint positions
+		static std::unordered_map<std::string, int> currentScript_checkpointLookup;											///< Maps checkpoint names to their line, for linking Goto
+		static std::vector<int> currentScript_assets;																		///< \a M22AssetLoader handles the current script uses, in order of first use
+		static Uint64 currentScript_hash;																					///< \a HashScript of the current script, for telling whether a savegame was made with it
+
+		/// Header of a precompiled (.m22c) script
+		///
+		/// Followed by, in order: the line records, the int parameters, the text parameter string indices,
+		/// the checkpoints, the dependencies, the string offsets (m_numStrings+1) and the UTF-8 string data.
+		/// Everything is 4-byte aligned and stored in the byte order of the machine that compiled it.
+		struct m22c_header
+		{
+			char m_magic[4];								///< "M22C"
+			Uint32 m_version;								///< \a M22C_VERSION it was written with
+			Uint32 m_numLines;								///< Number of line records
+			Uint32 m_numParameters;							///< Number of int parameters, across all lines
+			Uint32 m_numTextParameters;						///< Number of text parameters, across all lines
+			Uint32 m_numCheckpoints;						///< Number of checkpoints
+			Uint32 m_numDependencies;						///< Number of textures the script uses
+			Uint32 m_numStrings;							///< Number of strings in the string table
+			Uint32 m_stringDataSize;						///< Size of the UTF-8 string data in bytes
+		};
+		/// A line record in a precompiled script
+		struct m22c_line
+		{
+			Sint32 m_lineType;								///< M22Script::LINETYPE
+			Sint32 m_speaker;								///< Speaker index, used as-is if \a m_speakerName is \a M22C_NO_STRING
+			Uint32 m_speakerName;							///< String index of the speaker's name, so it survives CHARACTERS.txt changing
+			Uint32 m_lineContents;							///< String index of the line's contents
+			Uint32 m_firstParameter;						///< Index of the first int parameter
+			Uint32 m_numParameters;							///< Number of int parameters
+			Uint32 m_firstTextParameter;					///< Index of the first text parameter
+			Uint32 m_numTextParameters;						///< Number of text parameters
+		};
+		/// A checkpoint in a precompiled script
+		struct m22c_checkpoint
+		{
+			Uint32 m_name;									///< String index of the name
+			Sint32 m_position;								///< Line the checkpoint points to
+		};
+		/// A texture a precompiled script uses, so it can be queued before any line is linked
+		struct m22c_dependency
+		{
+			Uint32 m_path;									///< String index of the file path
+			Uint32 m_alpha;									///< Alpha mod the texture is requested with
+			Uint32 m_blend;									///< 1 if requested with SDL_BLENDMODE_BLEND
+		};
 
-		static int CompileLoadScriptFile(std::string _filename);															///< Compiles the specified script file and loads it into currentScript_c
-		static int ExecuteCommand(M22ScriptCompiler::line_c _linec, int _line);												///< Runs the specified command
-		static int FindCheckpoint(std::string _chkpnt, int &_line);															///< Searches currentScript_checkpoints for the specified checkpoint
-		static int CompileLine(M22ScriptCompiler::line_c &tempLine_c, std::vector<std::wstring> CURRENT_LINE_SPLIT);		///< Compiles the parameterised line_c variable
+		static int CompileLoadScriptFile(std::string _filename, bool _allowCompiled = true);								///< Loads the specified script into currentScript_c, from its .m22c if that's up to date (and allowed), otherwise compiling the .txt
+		static int CompileTextScript(const std::string& _filename);														///< Compiles a .txt script into currentScript_c
+		static int LoadCompiledScript(const std::string& _filename);														///< Loads a memory-mapped .m22c script into currentScript_c
+		static int SaveCompiledScript(const std::string& _filename);														///< Writes currentScript_c (and its checkpoints/dependencies) out as a .m22c script
+		static int SaveCompiledScript(const std::string& _filename, const std::vector<line_c>& _lines, const std::vector<script_checkpoint>& _checkpoints, const std::vector<int>& _assets);	///< Writes the given lines, checkpoints and \a M22AssetLoader handles out as a .m22c script; the lines don't have to be linked
+		static int ReadCompiledDependencies(const std::string& _filename, size_t _max, std::vector<int>& _handles);		///< Registers the first _max textures a .m22c script uses (in order of first use) with M22AssetLoader, without loading it
+		static std::string GetCompiledFilename(const std::string& _filename);											///< Swaps the extension of a script filename for .m22c
+		static bool IsCompiledScriptCurrent(const std::string& _compiled, const std::string& _source);					///< Does the compiled script exist, and is it at least as new as its source (or the source is missing)?
+		static Uint64 HashScript(const std::vector<line_c>& _script);														///< Hashes the line types, text and names of a script (not the indices/handles they linked to, which depend on what was loaded before)
+		static void ResetScriptTables(void);																				///< Clears the script, checkpoints and per-script background/sprite tables
+		static int LinkLine(M22ScriptCompiler::line_c &tempLine_c);														///< Resolves the names in m_parameters_txt to indices/assets for the engine's current tables
+		/// What the interpreter loop in M22Script::ChangeLine does after a command
+		enum EXECUTE_RESULT
+		{
+			CONTINUE,										///< Carry on with the next line
+			JUMP,											///< Carry on from the line the command set
+			YIELD											///< Stop until something (input, a timer, a transition) calls ChangeLine again
+		};
+
+		/// A command handler; _nextLine comes in as the line after this one and may be changed for a \a JUMP
+		typedef EXECUTE_RESULT (*COMMAND_HANDLER)(const M22ScriptCompiler::line_c& _linec, int& _nextLine);
+		static COMMAND_HANDLER COMMAND_HANDLERS[];																			///< Handler for each M22Script::LINETYPE
+
+		static int ExecuteCommand(const M22ScriptCompiler::line_c& _linec, int _line);										///< Runs the specified command on its own (without moving the script on); returns an EXECUTE_RESULT
+
+		static EXECUTE_RESULT ExecuteNewBackground(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< NEW_BACKGROUND, NEW_BACKGROUND_STEALTH
+		static EXECUTE_RESULT ExecuteNewPage(const M22ScriptCompiler::line_c& _linec, int& _nextLine);						///< NEW_PAGE
+		static EXECUTE_RESULT ExecuteNewMusic(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< NEW_MUSIC
+		static EXECUTE_RESULT ExecuteStopMusic(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< STOP_MUSIC
+		static EXECUTE_RESULT ExecuteFadeToBlack(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< FADE_TO_BLACK
+		static EXECUTE_RESULT ExecuteFadeToBlackFancy(const M22ScriptCompiler::line_c& _linec, int& _nextLine);			///< FADE_TO_BLACK_FANCY
+		static EXECUTE_RESULT ExecutePlaySting(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< PLAY_STING
+		static EXECUTE_RESULT ExecutePlayStingLooped(const M22ScriptCompiler::line_c& _linec, int& _nextLine);			///< PLAY_STING_LOOPED
+		static EXECUTE_RESULT ExecuteStopStingLooped(const M22ScriptCompiler::line_c& _linec, int& _nextLine);			///< STOP_STING_LOOPED
+		static EXECUTE_RESULT ExecuteDrawCharacter(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< DRAW_CHARACTER, DRAW_CHARACTER_BRUTAL
+		static EXECUTE_RESULT ExecuteClearCharacters(const M22ScriptCompiler::line_c& _linec, int& _nextLine);			///< CLEAR_CHARACTERS, CLEAR_CHARACTERS_BRUTAL
+		static EXECUTE_RESULT ExecuteWait(const M22ScriptCompiler::line_c& _linec, int& _nextLine);						///< WAIT
+		static EXECUTE_RESULT ExecuteLoadScript(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< LOAD_SCRIPT, LOAD_SCRIPT_GOTO
+		static EXECUTE_RESULT ExecuteDarkScreen(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< DARK_SCREEN
+		static EXECUTE_RESULT ExecuteBrightScreen(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< BRIGHT_SCREEN
+		static EXECUTE_RESULT ExecuteGoto(const M22ScriptCompiler::line_c& _linec, int& _nextLine);						///< GOTO
+		static EXECUTE_RESULT ExecuteGotoDebug(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< GOTO_DEBUG
+		static EXECUTE_RESULT ExecuteExitGame(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< EXITGAME
+		static EXECUTE_RESULT ExecuteSetDecision(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< SET_DECISION
+		static EXECUTE_RESULT ExecuteExitToMainMenu(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< EXITTOMAINMENU
+		static EXECUTE_RESULT ExecuteIfStatement(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< IF_STATEMENT
+		static EXECUTE_RESULT ExecuteMakeDecision(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< MAKE_DECISION
+		static EXECUTE_RESULT ExecuteRunLuaScript(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< RUN_LUA_SCRIPT
+		static EXECUTE_RESULT ExecuteSetActiveTransition(const M22ScriptCompiler::line_c& _linec, int& _nextLine);		///< SET_ACTIVE_TRANSITION
+		static EXECUTE_RESULT ExecuteClearSprites(const M22ScriptCompiler::line_c& _linec, int& _nextLine);				///< CLEAR_SPRITES
+		static EXECUTE_RESULT ExecuteDrawSprite(const M22ScriptCompiler::line_c& _linec, int& _nextLine);					///< DRAW_SPRITE, DRAW_SPRITE_ANIMATED
+		static EXECUTE_RESULT ExecuteSpeech(const M22ScriptCompiler::line_c& _linec, int& _nextLine);						///< SPEECH, NARRATIVE, COMMENT
+		static int FindCheckpoint(const std::string& _chkpnt, int &_line);													///< Looks up the specified checkpoint's line in currentScript_checkpointLookup
+		static void AddCheckpoint(const std::string& _chkpnt, int _line);													///< Adds a checkpoint to the current script; the first of any duplicates wins
+		static int CompileLine(M22ScriptCompiler::line_c &tempLine_c, const std::vector<std::string_view>& CURRENT_LINE_SPLIT);	///< Compiles the parameterised line_c variable; -1 if it hasn't enough parameters
+		static int ParseTextScript(std::string_view _script, std::vector<line_c>& _lines, std::vector<script_checkpoint>& _checkpoints, std::vector<std::string>* _problems = NULL, std::vector<unsigned int>* _sourceLines = NULL);	///< Splits a .txt script into lines and parses them without linking; it only reads the character names, so several can be parsed on different threads at once; problems are printed unless _problems is given, and _sourceLines gets each line's line number in the file. Returns how many lines couldn't be parsed
+		static int ParseLine(M22ScriptCompiler::line_c &tempLine_c, const std::vector<std::string_view>& CURRENT_LINE_SPLIT, std::vector<std::string>* _problems = NULL);	///< Fills in a command line's m_parameters_txt/m_parameters from its tokens, without linking it; -1 if it hasn't enough parameters
+		static int ParseSubLine(M22ScriptCompiler::line_c& _ifStatement, std::vector<std::string>* _problems = NULL);	///< Parses the command on the end of an IF_STATEMENT into its m_subLines; -1 if it hasn't enough parameters
 	};
 
 	/// \class 		M22Interface M22Engine.h "include/M22Engine.h"
@@ -997,8 +1609,8 @@ namespace March22
 			{
 				std::string name;						///< Name of button
 				BUTTON_STATES state;					///< State of button
-				SDL_Texture* sheet;						///< Sprite sheet for button
-				SDL_Rect rectSrc[NUM_OF_BUTTON_STATES];	///< Where the current sprite is on the spritesheet
+				SDL_Texture* sheet;						///< Sprite sheet for button (an atlas page, shared with other buttons)
+				SDL_Rect rectSrc[NUM_OF_BUTTON_STATES];	///< Where each state's sprite is on \a sheet
 				SDL_Rect rectDst[NUM_OF_BUTTON_STATES];	///< Where to draw the sprite
 				Button()
 				{
@@ -1021,13 +1633,10 @@ namespace March22
 				};
 			
 				/// Fades in all buttons using \a Lerp and \a alpha, usually used for main menu
+				/// (the buttons share atlas pages, so they take \a alpha as they're drawn)
 				void Interface::FadeInAllButtons(void)
 				{
 					this->alpha = M22Graphics::Lerp( this->alpha, 255.0f, DEFAULT_LERP_SPEED/4 );
-					for(size_t i = 0; i < this->buttons.size(); i++)
-					{
-						SDL_SetTextureAlphaMod( this->buttons[i].sheet, Uint8(this->alpha) );
-					};
 				};
 			
 			};
@@ -1036,7 +1645,6 @@ namespace March22
 			static std::vector<Interface*> activeInterfaces;		///< Array of pointers to interfaces to draw/update
 			static M22Interface::BUTTON_STATES* skipButtonState;	///< Current state of skip button
 			static M22Interface::BUTTON_STATES* menuButtonState;	///< Current state of menu button
-			static SDL_Texture* ChatBoxRenderer;					///< Render target for drawing speech box off-screen
 
 			static bool menuOpen;									///< Is the menu open?
 
@@ -1081,6 +1689,15 @@ namespace March22
 			/// \param _type Type of interface from \a M22Interface::INTERFACES
 			/// \return Error code if problem encountered, 0 if fine
 			static short int InitializeInterface(M22Interface::Interface* _interface, int _num_of_buttons, int _startline = 0, const std::string _filename = "graphics/interface/GAME_BUTTONS.txt", bool _opaque = true, M22Interface::INTERFACES _type = M22Interface::INTERFACES::INGAME_INTRFC);
+
+			/// Decodes the images \a InitializeInterface uses from a buttons file, ready for it to upload
+			///
+			/// \details Doesn't touch the renderer, so it can be a \a M22Startup load step
+			/// \param _num_of_buttons Number of buttons in interface
+			/// \param _startline Line to start on in buttons file
+			/// \param _filename File path/name of buttons file
+			/// \return Error code if problem encountered, 0 if fine
+			static short int PreloadInterface(int _num_of_buttons, int _startline, const std::string _filename);
 	};
 
 	/// \class 		M22Renderer M22Engine.h "include/M22Engine.h"
@@ -1132,6 +1749,1040 @@ namespace March22
 			static void M22Renderer::Delay(unsigned int _delay);
 	};
 
+	/// \class 		M22Compositor M22Engine.h "include/M22Engine.h"
+	/// \brief 		Render targets for the cached layers, sized to the output
+	///
+	/// \details 	Everything is laid out at \a M22Engine::ScrSize and scaled to the window by SDL_RenderSetLogicalSize.
+	///				The layers worth caching (the background, the next background for transitions, and the page of text
+	///				in \a M22TextLayer) are render targets at the output resolution, capped at \a M22Engine::ScrSize, so a
+	///				720p window only holds 720p targets. They're only drawn into when they change or are lost; characters,
+	///				sprites, the text frame and interfaces are a few quads each and go straight to the screen over them.
+	///
+	class M22Compositor
+	{
+		public:
+			static int WIDTH;										///< Width of every layer
+			static int HEIGHT;										///< Height of every layer
+			static bool BACKGROUND_DIRTY;							///< Have the background layers lost what was drawn into them?
+
+			/// Scales the logical resolution to the window and creates the layers
+			///
+			/// \return Error code, if 0 then init'd fine
+			static short int Initialize(void);
+
+			/// Recreates the layers if the output has changed size (e.g. the window was resized); what was in them is redrawn
+			///
+			/// \return Error code, if 0 then resized fine
+			static short int Resize(void);
+
+			/// Creates a layer-sized render target that blends
+			///
+			/// \return The render target, NULL if it couldn't be created
+			static SDL_Texture* CreateLayer(void);
+
+			/// Starts drawing into a layer, in logical (\a M22Engine::ScrSize) coordinates
+			///
+			/// \param _layer The layer's render target
+			static void Begin(SDL_Texture* _layer);
+
+			/// Goes back to drawing to the screen
+			static void End(void);
+
+			/// Marks every layer as lost (e.g. after SDL_RENDER_TARGETS_RESET), so they're drawn into again
+			static void Invalidate(void);
+
+			/// Destroys the layers
+			static void Shutdown(void);
+	};
+
+	/// \class 		M22FrameScheduler M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for pacing the main loop
+	///
+	/// \details 	Measures how long each frame really takes and sleeps only for what's left of the frame. A frame is
+	///				only drawn if something marked the screen dirty, something on it is animating, or a wake-up time
+	///				has come; otherwise the loop waits on SDL_WaitEventTimeout until there's something to do.
+	///
+	class M22FrameScheduler
+	{
+		private:
+		public:
+			static Uint64 FRAME_START;								///< SDL_GetPerformanceCounter() at the start of the current frame
+			static double TARGET_FRAME_MS;							///< How long a frame should take
+			static double LAST_FRAME_MS;							///< How long the last drawn frame took, before sleeping
+			static bool VSYNC;										///< Does presenting wait for the display?
+			static bool DIRTY;										///< Does the screen need drawing again?
+			static bool DREW_FRAME;									///< Was the current frame drawn?
+			static Uint32 WAKE_AT;									///< SDL_GetTicks() when a frame has to be drawn regardless, 0 if none
+			static Uint32 WAKE_EVENT;								///< SDL event type pushed by \a Wake, (Uint32)-1 if not registered
+
+			/// Works out the frame time and whether the renderer is vsynced
+			///
+			/// \param _fps Target frame rate
+			/// \return Error code, if 0 then init'd fine
+			static short int Initialize(unsigned int _fps);
+
+			/// Marks the screen as needing to be drawn again
+			static inline void MarkDirty(void)
+			{
+				M22FrameScheduler::DIRTY = true;
+			};
+
+			/// Makes sure a frame is drawn at (or soon after) the specified time, e.g. for the next frame of a slow animation
+			///
+			/// \param _ticks SDL_GetTicks() time
+			static void WakeAt(Uint32 _ticks);
+
+			/// Wakes the main loop up from another thread, marking the screen dirty
+			static void Wake(void);
+
+			/// Is anything on screen moving on by itself (transitions, typewriter, sprites, fades, skipping...)?
+			static bool IsAnimating(void);
+
+			/// Waits, without spinning, until there's an event or something needs drawing; call at the top of the loop
+			static void WaitForWork(void);
+
+			/// Should this frame be drawn? Clears the dirty flag/wake-up time if so; call once, after updating
+			static bool BeginDraw(void);
+
+			/// Sleeps for whatever's left of the frame, if it was drawn; call at the bottom of the loop
+			static void EndFrame(void);
+	};
+
+	/// \class 		M22AssetLoader M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for asynchronous image loading
+	///
+	/// \details 	This class decodes image files into SDL_Surfaces on a pool of worker threads, then uploads them
+	///				to textures on the main thread under a per-frame time budget.
+	///
+	class M22AssetLoader
+	{
+		private:
+			/// Worker thread loop; pops queued handles and decodes them
+			static void WorkerLoop(void);
+
+			/// Uploads a decoded surface to a texture; must be called on the main thread with \a MUTEX held
+			///
+			/// \param _handle Handle of the asset to upload
+			static void UploadAsset(int _handle);
+
+			/// Destroys unreferenced textures, least recently used first, until under \a BUDGET; \a MUTEX must be held
+			static void EvictUnlocked(void);
+		public:
+			typedef int AssetHandle;								///< Index of an asset in \a ASSETS; -1 is invalid
+
+			/// Enumerator for the state of a texture asset
+			enum ASSET_STATES
+			{
+				UNLOADED,											///< Known, but not queued for decoding
+				QUEUED,												///< Waiting for a worker thread
+				DECODING,											///< A worker thread is decoding it
+				DECODED,											///< Decoded into a surface, waiting for upload
+				READY,												///< Uploaded to a texture
+				FAILED												///< File could not be decoded
+			};
+
+			/// Data structure for a texture asset
+			struct TextureAsset
+			{
+				std::string path;									///< File path of the image
+				ASSET_STATES state;									///< Current state of the asset
+				SDL_Surface* surface;								///< Decoded image, only valid while \a DECODED
+				SDL_Texture* texture;								///< Uploaded texture, only valid while \a READY
+				Uint8 alpha;										///< Alpha mod to apply when uploaded
+				bool blend;											///< Set SDL_BLENDMODE_BLEND when uploaded?
+				unsigned int generation;							///< Bumped on every unload, so stale worker results are discarded
+				int references;										///< Number of holders; only unreferenced assets can be evicted
+				size_t bytes;										///< Approximate texture memory used while \a READY
+				Uint32 lastUsed;									///< SDL_GetTicks() of the last request/use, for LRU eviction
+				TextureAsset()
+				{
+					generation = 0;
+					references = 0;
+					bytes = 0;
+					lastUsed = 0;
+					state = UNLOADED;
+					surface = NULL;
+					texture = NULL;
+					alpha = 255;
+					blend = false;
+				};
+			};
+
+			static std::deque<TextureAsset> ASSETS;					///< Every asset requested so far; a deque so references survive push_back
+			static std::unordered_map<std::string, AssetHandle> ASSET_LOOKUP;	///< File path to handle
+			static std::deque<AssetHandle> DECODE_QUEUE;			///< Handles waiting for a worker thread
+			static std::deque<AssetHandle> UPLOAD_QUEUE;			///< Handles decoded by a worker, waiting for upload
+			static std::vector<std::thread> WORKERS;				///< The decoding worker threads
+			static std::mutex MUTEX;								///< Guards \a ASSETS states/surfaces and both queues
+			static std::condition_variable QUEUE_CONDITION;			///< Signalled when a handle is queued (or on shutdown)
+			static std::condition_variable DECODED_CONDITION;		///< Signalled when a worker finishes decoding
+			static bool RUNNING;									///< Are the worker threads running?
+			static size_t BUDGET;									///< Texture memory budget in bytes
+			static size_t RESIDENT_BYTES;							///< Texture memory currently in use by \a READY assets
+
+			/// Starts the worker threads
+			///
+			/// \param _num_of_workers Number of threads to start; 0 picks one per core, minus the main thread
+			/// \return Error code, if 0 then init'd fine
+			static short int Initialize(unsigned int _num_of_workers = 0);
+
+			/// Stops the worker threads and destroys every surface/texture
+			static void Shutdown(void);
+
+			/// Records the specified image without queueing it, or returns the existing handle if already known
+			///
+			/// \param _path File path of the image
+			/// \param _alpha Alpha mod to apply when uploaded
+			/// \param _blend Set SDL_BLENDMODE_BLEND when uploaded?
+			/// \return Handle of the asset
+			static AssetHandle RegisterTexture(const std::string& _path, Uint8 _alpha = 255, bool _blend = false);
+
+			/// Queues a known asset for decoding if it isn't loaded (or on its way)
+			///
+			/// \param _handle Handle of the asset
+			static void QueueTexture(AssetHandle _handle);
+
+			/// Queues the specified image for decoding, or returns the existing handle if already requested
+			///
+			/// \param _path File path of the image
+			/// \param _alpha Alpha mod to apply when uploaded
+			/// \param _blend Set SDL_BLENDMODE_BLEND when uploaded?
+			/// \return Handle of the asset
+			static AssetHandle RequestTexture(const std::string& _path, Uint8 _alpha = 255, bool _blend = false);
+
+			/// Finds the handle of a previously requested image
+			///
+			/// \param _path File path of the image
+			/// \return Handle of the asset, -1 if never requested
+			static AssetHandle FindTexture(const std::string& _path);
+
+			/// Returns the texture if it has been uploaded, without blocking
+			///
+			/// \param _handle Handle of the asset
+			/// \return The texture, NULL if not ready (or invalid)
+			static SDL_Texture* GetTexture(AssetHandle _handle);
+
+			/// Returns the texture, decoding and uploading it on the spot if it isn't ready yet
+			///
+			/// \param _handle Handle of the asset
+			/// \return The texture, NULL if it failed to load (or invalid)
+			static SDL_Texture* WaitForTexture(AssetHandle _handle);
+
+			/// Is the texture uploaded and ready to draw?
+			///
+			/// \param _handle Handle of the asset
+			static bool IsReady(AssetHandle _handle);
+
+			/// Uploads decoded surfaces to textures until the time budget runs out; call once per frame
+			///
+			/// \param _budget Time budget in milliseconds
+			static void UpdateUploads(Uint32 _budget = ASSET_UPLOAD_BUDGET_MS);
+
+			/// Destroys every loaded texture/surface and discards queued decodes; handles stay valid and can be requested again
+			static void UnloadAll(void);
+
+			/// Adds a reference to the asset, keeping it resident until released
+			///
+			/// \param _handle Handle of the asset
+			static void Acquire(AssetHandle _handle);
+
+			/// Removes a reference; unreferenced assets stay cached until the budget needs the space
+			///
+			/// \param _handle Handle of the asset
+			static void Release(AssetHandle _handle);
+
+			/// Sets the texture memory budget, evicting straight away if already over it
+			///
+			/// \param _bytes Budget in bytes
+			static void SetBudget(size_t _bytes);
+
+			/// Evicts unreferenced textures until under the budget
+			static void TrimToBudget(void);
+	};
+
+	/// \class 		M22Prefetcher M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for loading what the script is about to use
+	///
+	/// \details 	Follows the compiled script on from the current line, down both sides of every If and through
+	///				Gotos, for up to \a WINDOW lines. The textures those lines draw are queued and held, stings are
+	///				decoded and the next music track is opened, so nothing has to load when the line is reached.
+	///				Scripts are no longer held in memory whole; anything that drops out of the window can be evicted.
+	///
+	class M22Prefetcher
+	{
+		private:
+			static std::vector<int> HELD;							///< \a M22AssetLoader handles currently acquired for the window
+			static std::unordered_map<std::string, std::vector<int>> SCRIPT_TEXTURES;	///< First textures of scripts a LoadScript leads to, by filename
+		public:
+			/// What a stretch of script is going to need, soonest first
+			struct Dependencies
+			{
+				std::vector<int> textures;							///< \a M22AssetLoader handles
+				std::vector<int> music;								///< Indices into \a M22Sound::MUSIC
+				std::vector<int> stings;							///< Indices into \a M22Sound::SOUND_FX
+				std::vector<std::string> scripts;					///< Scripts loaded by LoadScript lines
+			};
+
+			static int WINDOW;										///< How many lines ahead to look, counted across every branch
+
+			/// Walks the script's control flow from the specified line and lists what it uses; doesn't load anything
+			///
+			/// \param _script Compiled script to walk
+			/// \param _fromLine Index of the first line to look at
+			/// \param _window Maximum number of lines to look at
+			/// \param _out Filled with the dependencies, nearest lines first
+			static void ScanScriptDependencies(const std::vector<M22ScriptCompiler::line_c>& _script, int _fromLine, int _window, Dependencies& _out);
+
+			/// Loads (and holds) what \a M22ScriptCompiler::currentScript_c needs from the specified line, releasing the rest
+			///
+			/// \param _fromLine Index of the next line to be run
+			static void Update(int _fromLine);
+
+			/// Releases everything held, e.g. when leaving the game for the main menu
+			static void Reset(void);
+	};
+
+	/// \class 		M22Startup M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for running the startup work as a graph of tasks
+	///
+	/// \details 	Each task has a load step, run on a worker thread (file reads, parsing, image decoding), and an
+	///				upload step, run on the main thread (anything that touches SDL's window/renderer). Loads start as
+	///				soon as the tasks they depend on are done, so they overlap; uploads run one at a time, in the order
+	///				the tasks were added. Images decoded by \a DecodeImage are picked up by \a M22Atlas::Load and
+	///				\a M22Renderer::LoadTexture instead of being read again. Prints how long each task took when done.
+	///
+	class M22Startup
+	{
+		private:
+			/// Worker thread loop; pops tasks whose load step can run and runs it
+			static void WorkerLoop(void);
+
+			/// Queues the load step of every task whose load dependencies are done; \a MUTEX must be held
+			static void QueueReadyLoads(void);
+		public:
+			typedef std::function<short int(void)> TaskFunction;	///< A load/upload step; returns an error code, 0 if fine
+
+			/// Data structure for a startup task
+			struct Task
+			{
+				std::string name;									///< Name shown in the timing report
+				TaskFunction load;									///< Run on a worker thread; must not touch the renderer (may be empty)
+				TaskFunction upload;								///< Run on the main thread after \a load (may be empty)
+				std::vector<int> loadDependencies;					///< Tasks that must be done before \a load starts
+				std::vector<int> uploadDependencies;				///< Tasks that must also be done before \a upload starts
+				bool queued;										///< Has \a load been queued (or skipped)?
+				bool loaded;										///< Has \a load finished?
+				bool done;											///< Has \a upload finished?
+				short int result;									///< First non-zero error code of the two steps
+				double loadMs;										///< Time spent in \a load
+				double uploadMs;									///< Time spent in \a upload
+				double finishedAt;									///< Time since \a Run started when the task was done
+				Task()
+				{
+					queued = loaded = done = false;
+					result = 0;
+					loadMs = uploadMs = finishedAt = 0.0;
+				};
+			};
+
+			static std::vector<Task> TASKS;							///< Tasks added since the last \a Run
+			static std::deque<int> LOAD_QUEUE;						///< Tasks whose load step is waiting for a worker
+			static int LOADS_PENDING;								///< Load steps queued or running
+			static std::vector<std::thread> WORKERS;				///< The worker threads, while running
+			static std::mutex MUTEX;								///< Guards the task states and \a LOAD_QUEUE
+			static std::condition_variable QUEUE_CONDITION;			///< Signalled when a load is queued (or on finishing)
+			static std::condition_variable LOADED_CONDITION;		///< Signalled when a worker finishes a load
+			static bool RUNNING;									///< Are the worker threads running?
+			static std::unordered_map<std::string, SDL_Surface*> IMAGES;	///< Decoded images waiting to be uploaded, by file path
+			static std::mutex IMAGES_MUTEX;							///< Guards \a IMAGES
+			static Uint64 START;									///< SDL_GetPerformanceCounter() when \a Run started
+
+			/// Adds a task; dependencies are the indices returned for earlier tasks
+			///
+			/// \param _name Name shown in the timing report
+			/// \param _load Step to run on a worker thread (may be empty)
+			/// \param _upload Step to run on the main thread once loaded (may be empty)
+			/// \param _loadDependencies Tasks to finish before the load step
+			/// \param _uploadDependencies Tasks to finish before the upload step, as well as those
+			/// \return Index of the task
+			static int AddTask(const std::string& _name, TaskFunction _load, TaskFunction _upload, const std::vector<int>& _loadDependencies = std::vector<int>(), const std::vector<int>& _uploadDependencies = std::vector<int>());
+
+			/// Runs every task added, returning once they're all done, then prints the timing report and clears them
+			///
+			/// \param _num_of_workers Number of threads to start; 0 picks one per core, minus the main thread
+			/// \return Number of tasks that returned an error
+			static short int Run(unsigned int _num_of_workers = 0);
+
+			/// Prints how long each task took to load/upload, and when it was done
+			static void PrintReport(void);
+
+			/// Decodes an image for a later \a TakeImage; safe to call from a load step
+			///
+			/// \param _path File path of the image
+			/// \return Error code, if 0 then decoded fine
+			static short int DecodeImage(const std::string& _path);
+
+			/// Takes ownership of an image decoded by \a DecodeImage
+			///
+			/// \param _path File path of the image
+			/// \return The decoded surface, NULL if it wasn't decoded ahead of time
+			static SDL_Surface* TakeImage(const std::string& _path);
+	};
+
+	/// \class 		M22SaveState M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for saving/loading the game as a binary snapshot of the scene
+	///
+	/// \details 	A snapshot holds what's needed to put the game back as it was: the script (and a hash of it) and
+	///				line, the decisions made, the background and the characters/sprites on it, the page of text, and
+	///				what's playing. It's taken on the main thread, then encoded and written out on a background thread.
+	///				Loading into the script that's already compiled restores everything in place, without compiling,
+	///				re-executing lines or reloading anything that's still resident.
+	///
+	///				Files start with an \a m22save_header, followed by the snapshot's fields in the order they're
+	///				declared; strings are a Uint32 byte count then UTF-8, lists a Uint32 count then their items.
+	///
+	class M22SaveState
+	{
+		private:
+			static std::thread WRITER;								///< Thread writing the last save out, if it hasn't been joined
+		public:
+			/// Header of a savegame file
+			struct m22save_header
+			{
+				char m_magic[4];									///< "M22S"
+				Uint32 m_version;									///< \a M22SAVE_VERSION it was written with
+				Uint32 m_size;										///< Bytes of snapshot following the header
+			};
+
+			/// A decision and the choice made, by name
+			struct DecisionState
+			{
+				std::string decision;								///< Name of the decision
+				std::string choice;									///< Name of the choice made, empty if none
+			};
+
+			/// A character on screen, by name
+			struct CharacterState
+			{
+				std::string character;								///< Name of the character
+				std::string outfit;									///< Name of the outfit
+				std::string emotion;								///< Name of the emotion
+				Sint32 x;											///< Position on the X-axis
+			};
+
+			/// A sprite on screen, by name
+			struct SpriteState
+			{
+				std::string sprite;									///< Name of the sprite
+				Sint32 x;											///< Position on the X-axis
+				Sint32 y;											///< Position on the Y-axis
+				Uint16 frames;										///< Number of frames on its sheet
+				Uint8 mode;											///< \a M22Graphics::ANIMATION_MODES
+				Uint32 frameTime;									///< Milliseconds each frame is shown for, 0 if not animated
+			};
+
+			/// Everything a savegame restores
+			struct Snapshot
+			{
+				Uint32 gamestate;									///< \a M22Engine::GAMESTATES
+				std::string script;									///< \a M22Script::currentScriptFileName
+				Uint64 scriptHash;									///< \a M22ScriptCompiler::currentScript_hash
+				Sint32 line;										///< \a M22Script::currentLineIndex
+				std::vector<DecisionState> decisions;				///< Every decision that has been made
+				std::string background;								///< File path of the active background
+				std::vector<CharacterState> characters;				///< Characters drawn on the background, in order
+				std::vector<SpriteState> sprites;					///< Active sprites, in order; animations start over
+				std::string typewriterText;							///< \a M22Script::typewriter_text
+				Uint32 typewriterPosition;							///< \a M22Script::typewriter_currPos, in bytes
+				Uint8 typing;										///< \a M22Script::updateCurrentLine
+				Uint8 textArea;										///< \a M22Interface::DRAW_TEXT_AREA
+				Sint32 speaker;										///< \a M22Script::activeSpeakerIndex
+				Uint8 darken;										///< Alpha of \a M22Graphics::BLACK_TEXTURE
+				Uint8 transition;									///< \a M22Graphics::activeTransition
+				std::string music;									///< File path of the music playing, empty if none
+				std::string loopedSting;							///< File path of the sting on loop, empty if none
+				Snapshot()
+				{
+					gamestate = 0;
+					scriptHash = 0;
+					line = 0;
+					typewriterPosition = 0;
+					typing = textArea = 0;
+					speaker = 0;
+					darken = transition = 0;
+				};
+			};
+
+			/// Takes a snapshot of the game as it is
+			///
+			/// \param _snapshot Snapshot to fill in
+			static void Capture(Snapshot& _snapshot);
+
+			/// Puts the game back as it was when the snapshot was taken, compiling the script only if it isn't the current one
+			///
+			/// \param _snapshot Snapshot to restore
+			/// \return Error code, if 0 then restored fine
+			static short int Apply(const Snapshot& _snapshot);
+
+			/// Encodes a snapshot, header included
+			///
+			/// \param _snapshot Snapshot to encode
+			/// \param _output Buffer to write to
+			static void Encode(const Snapshot& _snapshot, std::vector<Uint8>& _output);
+
+			/// Decodes a snapshot, checking the header and that nothing runs past the end
+			///
+			/// \param _data Encoded snapshot, header included
+			/// \param _size Size of the data in bytes
+			/// \param _snapshot Snapshot to fill in
+			/// \return Error code, if 0 then decoded fine
+			static short int Decode(const Uint8* _data, size_t _size, Snapshot& _snapshot);
+
+			/// Parts of a snapshot a delta holds; the line is always there
+			enum DELTA_FIELDS
+			{
+				DELTA_GAMESTATE		= 1 << 0,						///< \a Snapshot::gamestate
+				DELTA_SCRIPT		= 1 << 1,						///< \a Snapshot::script and \a Snapshot::scriptHash
+				DELTA_DECISIONS		= 1 << 2,						///< The decisions that changed (an empty choice clears it)
+				DELTA_BACKGROUND	= 1 << 3,						///< \a Snapshot::background
+				DELTA_CHARACTERS	= 1 << 4,						///< \a Snapshot::characters, whole
+				DELTA_SPRITES		= 1 << 5,						///< \a Snapshot::sprites, whole
+				DELTA_TEXT_APPEND	= 1 << 6,						///< Text added to the end of \a Snapshot::typewriterText
+				DELTA_TEXT_REPLACE	= 1 << 7,						///< \a Snapshot::typewriterText, whole
+				DELTA_TYPEWRITER	= 1 << 8,						///< Typewriter position/state, text area and speaker
+				DELTA_EFFECTS		= 1 << 9,						///< Darken alpha and transition
+				DELTA_MUSIC			= 1 << 10,						///< \a Snapshot::music
+				DELTA_LOOPED_STING	= 1 << 11						///< \a Snapshot::loopedSting
+			};
+
+			/// Encodes what changed from one snapshot to the next, for \a M22History
+			///
+			/// \param _from Earlier snapshot
+			/// \param _to Later snapshot
+			/// \param _output Buffer to write to
+			static void EncodeDelta(const Snapshot& _from, const Snapshot& _to, std::vector<Uint8>& _output);
+
+			/// Applies a delta from \a EncodeDelta to the snapshot it was made from, turning it into the later one
+			///
+			/// \param _data Encoded delta
+			/// \param _size Size of the data in bytes
+			/// \param _snapshot Snapshot to update
+			/// \return Error code, if 0 then applied fine
+			static short int ApplyDelta(const Uint8* _data, size_t _size, Snapshot& _snapshot);
+
+			/// Takes a snapshot and writes it out on a background thread
+			///
+			/// \param _filename File path/name of the savegame
+			static void Save(const std::string& _filename);
+
+			/// Reads a savegame and restores it, waiting for a save still being written first
+			///
+			/// \param _filename File path/name of the savegame
+			/// \return Error code, if 0 then loaded fine
+			static short int Load(const std::string& _filename);
+
+			/// Waits for the last save to finish being written
+			static void Flush(void);
+	};
+
+	/// \class 		M22History M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for rewinding the script
+	///
+	/// \details 	Each line the player stops at (speech, narration, decisions) is recorded in a fixed ring of
+	///				\a HISTORY_LENGTH entries. Every \a HISTORY_KEYFRAME_INTERVAL entries is a full \a M22SaveState
+	///				snapshot; the rest are deltas from the entry before (\a M22SaveState::EncodeDelta), usually just
+	///				the line, the text it added and whatever the commands before it changed. Rewinding decodes the
+	///				nearest keyframe, rolls the deltas forward to the line wanted and restores that in place, so the
+	///				script never has to be run again from the start and memory doesn't grow with the session.
+	///
+	class M22History
+	{
+		private:
+			/// A recorded line
+			struct Entry
+			{
+				bool keyframe;										///< Is \a data a whole snapshot, rather than a delta?
+				std::vector<Uint8> data;							///< The encoded snapshot/delta
+			};
+
+			static std::vector<Entry> RING;							///< \a HISTORY_LENGTH entries, oldest at \a FIRST
+			static size_t FIRST;									///< Slot of the oldest entry; always a keyframe
+			static size_t COUNT;									///< Entries recorded
+			static size_t SINCE_KEYFRAME;							///< Entries since the last keyframe
+			static M22SaveState::Snapshot LAST;						///< The state the newest entry records, for working out the next delta
+
+			/// Slot in \a RING of the nth oldest entry
+			static inline size_t Slot(size_t _index)
+			{
+				return (M22History::FIRST + _index) % HISTORY_LENGTH;
+			};
+		public:
+			/// Records the line the script has stopped at; called by \a M22Script::ChangeLine
+			static void Record(void);
+
+			/// Goes back to an earlier line, forgetting the ones after it
+			///
+			/// \param _lines How many recorded lines to go back
+			/// \return Error code, if 0 then rewound fine
+			static short int Rewind(unsigned int _lines = 1);
+
+			/// How many lines back can be rewound to
+			static size_t Available(void);
+
+			/// Forgets every line recorded, e.g. on loading or going back to the main menu
+			static void Reset(void);
+	};
+
+#if M22_PROFILING
+	/// \class 		M22Profiler M22Engine.h "include/M22Engine.h"
+	/// \brief 		Class for timing what each frame spends its time on
+	///
+	/// \details 	Scopes marked with \a M22_PROFILE_SCOPE on the main thread are timed into a ring of the last
+	///				\a PROFILER_FRAMES frames. The overlay (\a PROFILER_OVERLAY_KEY) graphs the frame times and lists the
+	///				most expensive scopes; the ring can be written out as CSV, or as JSON for chrome://tracing.
+	///				Only built when \a M22_PROFILING is set.
+	///
+	class M22Profiler
+	{
+		public:
+			/// One timed scope
+			struct Sample
+			{
+				const char* name;									///< Name given to \a M22_PROFILE_SCOPE
+				Uint64 start;										///< SDL_GetPerformanceCounter() on entering
+				Uint64 end;											///< SDL_GetPerformanceCounter() on leaving
+				int depth;											///< Number of scopes it was nested in
+			};
+
+			/// Everything timed during one pass of the main loop
+			struct Frame
+			{
+				Uint64 start;										///< SDL_GetPerformanceCounter() at \a BeginFrame
+				Uint64 end;											///< SDL_GetPerformanceCounter() at \a EndFrame
+				std::vector<Sample> samples;						///< Scopes in the order they ended; kept allocated between uses
+			};
+
+			static std::vector<Frame> FRAMES;						///< Ring of the last \a PROFILER_FRAMES frames
+			static size_t CURRENT;									///< Index in \a FRAMES of the frame being recorded
+			static Uint64 FRAME_COUNT;								///< Frames finished since \a Initialize
+			static int DEPTH;										///< Number of scopes currently open
+			static bool VISIBLE;									///< Is the overlay shown?
+			static std::thread::id MAIN_THREAD;						///< Only scopes on this thread are recorded
+
+			/// Allocates the ring and picks the calling thread as the one to record
+			static void Initialize(void);
+
+			/// Starts recording a frame; call at the top of the main loop
+			static void BeginFrame(void);
+
+			/// Finishes the frame; call at the bottom of the main loop, before sleeping
+			static void EndFrame(void);
+
+			/// Adds a finished scope to the current frame; used by \a M22ProfileScope
+			static void Record(const char* _name, Uint64 _start, Uint64 _end, int _depth);
+
+			/// Draws the frame-time graph and the most expensive scopes over the top of the screen, if \a VISIBLE
+			static void DrawOverlay(void);
+
+			/// Writes every kept sample as CSV (frame, scope, depth, start and duration in milliseconds)
+			///
+			/// \param _filename File to write
+			/// \return Error code, if 0 then written fine
+			static short int DumpCSV(const std::string& _filename);
+
+			/// Writes every kept sample in the Chrome trace event format, for chrome://tracing or Perfetto
+			///
+			/// \param _filename File to write
+			/// \return Error code, if 0 then written fine
+			static short int DumpChromeTrace(const std::string& _filename);
+	};
+
+	/// Times the enclosing scope into \a M22Profiler; use through \a M22_PROFILE_SCOPE
+	class M22ProfileScope
+	{
+		private:
+			const char* m_name;										///< NULL if not on the main thread
+			Uint64 m_start;
+		public:
+			inline M22ProfileScope(const char* _name)
+			{
+				m_name = (std::this_thread::get_id() == M22Profiler::MAIN_THREAD ? _name : NULL);
+				if(m_name != NULL)
+				{
+					M22Profiler::DEPTH++;
+					m_start = SDL_GetPerformanceCounter();
+				};
+			};
+			inline ~M22ProfileScope()
+			{
+				if(m_name != NULL)
+				{
+					Uint64 end = SDL_GetPerformanceCounter();
+					M22Profiler::DEPTH--;
+					M22Profiler::Record(m_name, m_start, end, M22Profiler::DEPTH);
+				};
+			};
+	};
+
+	#define M22_PROFILE_CONCAT_INNER(a, b) a##b
+	#define M22_PROFILE_CONCAT(a, b) M22_PROFILE_CONCAT_INNER(a, b)
+	#define M22_PROFILE_SCOPE(_name) March22::M22ProfileScope M22_PROFILE_CONCAT(m22ProfileScope, __LINE__)(_name)
+		/*!< Times from here to the end of the enclosing scope, under the specified name (a string literal) */
+#else
+	#define M22_PROFILE_SCOPE(_name) ((void)0)
+		/*!< Profiling is compiled out */
+#endif
+
+	/// \class 		M22TextLayer M22Engine.h "include/M22Engine.h"
+	/// \brief 		Cached render target for the page of script text
+	///
+	/// \details 	Each speech/narrative line of the script is wrapped the first time it's shown (\a SCRIPT_LAYOUT), and a
+	///				line too long for one page is split into pages there. A page takes its rows from that, then only the
+	///				glyphs the typewriter has revealed since the last frame are drawn into \a LAYER. A frame where the
+	///				text hasn't changed just copies the layer.
+	///
+	class M22TextLayer
+	{
+		public:
+			/// A wrapped line of text
+			struct LayoutLine
+			{
+				size_t start;									///< Byte offset of the first character in \a PAGE (in the script line, for a \a LineLayout)
+				size_t length;									///< Number of bytes, not counting the space/newline it broke on
+				float y;										///< Offset from the top of the column
+			};
+
+			/// A script line laid out on its own, and split into pages if it's too long for one
+			struct LineLayout
+			{
+				std::vector<LayoutLine> rows;					///< The line's rows, with y from 0
+				std::vector<size_t> pages;						///< Index in \a rows of the first row of each page; always starts with 0
+				bool laidOut;									///< Has the line been wrapped yet? (false when \a SCRIPT_LAYOUT is resized)
+			};
+		private:
+			/// Word-wraps some text, from the start of one of its paragraphs to the end
+			///
+			/// \param _text Text to wrap
+			/// \param _start Byte offset of the paragraph to start at
+			/// \param _columnWidth Width of the column in pixels
+			/// \param _y Offset of the first row; moved on past the last
+			/// \param _rows Rows to append to
+			static void WrapText(std::string_view _text, size_t _start, int _columnWidth, float& _y, std::vector<LayoutLine>& _rows);
+
+			/// Word-wraps \a PAGE into \a LINES; paragraphs it shares with the old page keep their rows, and the
+			/// line's page takes its rows from \a SCRIPT_LAYOUT, so normally nothing has to be measured
+			///
+			/// \param _columnWidth Width of the column in pixels
+			/// \param _oldPage \a PAGE before it changed
+			/// \param _oldLines \a LINES for \a _oldPage, empty if they were laid out for another column
+			/// \param _line The page of the line being typed out
+			/// \param _layout Layout of the line, NULL if there isn't one
+			/// \param _page Index of \a _line in \a _layout's pages
+			static void Layout(int _columnWidth, const std::string& _oldPage, const std::vector<LayoutLine>& _oldLines, std::string_view _line, const LineLayout* _layout, size_t _page);
+
+			/// Draws bytes [_from, _to) of \a PAGE into \a LAYER; the layer must be the render target
+			static void DrawRange(size_t _from, size_t _to);
+
+			/// Width in pixels of bytes [_from, _to) of some text
+			static float MeasureRange(std::string_view _text, size_t _from, size_t _to);
+		public:
+			static SDL_Texture* LAYER;								///< Holds the revealed glyphs in white, NULL if render targets aren't available; an \a M22Compositor layer
+			static int LAYER_WIDTH;									///< Width of \a LAYER, in pixels
+			static int LAYER_HEIGHT;								///< Height of \a LAYER, in pixels
+			static std::string PAGE;								///< The whole page (UTF-8) as laid out, including text the typewriter hasn't reached yet
+			static std::vector<LayoutLine> LINES;					///< \a PAGE word-wrapped
+			static size_t DRAWN;									///< Number of bytes of \a PAGE already in \a LAYER
+			static bool VALID;										///< Is the content of \a LAYER up to date with \a DRAWN?
+			static float COLUMN_X;									///< Position of the column the page is laid out in
+			static float COLUMN_Y;
+			static int COLUMN_WIDTH;
+			static std::vector<LineLayout> SCRIPT_LAYOUT;			///< Each line of \a M22ScriptCompiler::currentScript_c, laid out once it's been asked for; no rows if it isn't speech/narrative
+			static const NFont* SCRIPT_LAYOUT_FONT;				///< Font \a SCRIPT_LAYOUT was laid out with, NULL if it hasn't been
+			static int SCRIPT_LAYOUT_WIDTH;						///< Column width \a SCRIPT_LAYOUT was laid out for
+			static int SCRIPT_LAYOUT_ROWS;							///< Rows per page \a SCRIPT_LAYOUT was split for
+
+			/// Width of the script text column, in logical pixels
+			static int ColumnWidth(void);
+
+			/// How many rows of script text fit on a page; 1 if there's no font yet
+			static int RowsPerPage(void);
+
+			/// Makes \a SCRIPT_LAYOUT an empty entry for each line of the current script, for the current font and column;
+			/// nothing is measured until \a GetLineLayout asks for a line
+			static void LayoutScript(void);
+
+			/// Gets the layout of a line of the current script, wrapping it the first time it's asked for; every
+			/// line is laid out again if the font or column has changed since
+			///
+			/// \param _line Index of the line in \a M22ScriptCompiler::currentScript_c
+			/// \return The layout, NULL if the line isn't speech/narrative or there's no font
+			static const LineLayout* GetLineLayout(int _line);
+
+			/// Byte offset in the line where one of its pages starts
+			static size_t PageStart(const LineLayout& _layout, size_t _page);
+
+			/// Byte offset in the line where one of its pages ends (the space/newline it broke on isn't included)
+			static size_t PageEnd(const LineLayout& _layout, size_t _page);
+
+			/// How many rows some text takes up word-wrapped
+			///
+			/// \param _text Text to wrap
+			/// \param _columnWidth Width of the column in pixels
+			static int CountRows(std::string_view _text, int _columnWidth);
+
+			/// Draws the page, typing out any newly revealed characters into the layer first
+			///
+			/// \param _revealed The text revealed so far
+			/// \param _line The line being typed out; its characters after \a _revealedInLine are laid out but not drawn
+			/// \param _revealedInLine How many bytes of \a _line are already in \a _revealed
+			/// \param _x X position of the column
+			/// \param _y Y position of the column
+			/// \param _columnWidth Width of the column
+			/// \param ScrW Screen width resolution
+			/// \param ScrH Screen height resolution
+			/// \param _layout Layout of the line \a _line is a page of, NULL to lay it out here
+			/// \param _page Index of \a _line in \a _layout's pages
+			static void Draw(const std::string& _revealed, std::string_view _line, size_t _revealedInLine, float _x, float _y, int _columnWidth, int ScrW, int ScrH, const LineLayout* _layout = NULL, size_t _page = 0);
+
+			/// Marks the layer as lost (e.g. after SDL_RENDER_TARGETS_RESET), so the revealed text is drawn into it again
+			static void Invalidate(void);
+
+			/// Destroys the layer
+			static void Shutdown(void);
+	};
+
+	/// \class 		M22Tween M22Engine.h "include/M22Engine.h"
+	/// \brief 		Time-based tweens of float values
+	///
+	/// \details 	Moves floats (alphas, positions, scales...) to a target over a number of milliseconds, eased,
+	///				all from one fixed pool moved on by \a Update once a frame. A value has at most one tween; starting
+	///				another on it picks up from wherever it's got to. Finished tweens are swapped out of the pool, so
+	///				nothing is allocated or shifted while they run.
+	///
+	class M22Tween
+	{
+		public:
+			/// How a tween gets from its start to its target
+			enum EASINGS
+			{
+				LINEAR,													///< Constant speed
+				EASE_OUT,												///< Fast, then slowing to a stop (like the old per-frame lerps)
+				EASE_IN_OUT,											///< Slow at both ends
+				NUMBER_OF_EASINGS
+			};
+
+			/// A running tween
+			struct Tween
+			{
+				float* value;											///< The value being moved
+				float from;												///< Where it started
+				float to;												///< Where it ends up
+				Uint32 duration;										///< How long it takes, in milliseconds
+				Uint32 elapsed;											///< How long it's been running, in milliseconds
+				EASINGS easing;											///< How it gets there
+			};
+
+			static Tween TWEENS[TWEEN_SLOTS];							///< The running tweens, packed at the front
+			static size_t COUNT;										///< Number of running tweens
+
+			/// How far along an eased tween is
+			///
+			/// \param _easing Easing to use
+			/// \param _t How far along in time, 0 to 1
+			/// \return How far along in value, 0 to 1
+			static float Ease(EASINGS _easing, float _t);
+
+			/// Starts moving a value to a target, replacing whatever tween it already had
+			///
+			/// \param _value The value to move; has to stay where it is until the tween is done or stopped
+			/// \param _to Target value
+			/// \param _ms How long to take; 0 sets it straight away
+			/// \param _easing How to get there
+			/// \return Error code, if 0 then started fine; -1 if the pool is full, in which case the value is set straight away
+			static short int Start(float* _value, float _to, Uint32 _ms, EASINGS _easing = EASE_OUT);
+
+			/// Stops the tween on a value, leaving it where it's got to
+			///
+			/// \param _value The value the tween is moving
+			static void Stop(const float* _value);
+
+			/// Is a tween moving this value?
+			///
+			/// \param _value The value to check
+			static bool IsRunning(const float* _value);
+
+			/// Where a value is headed
+			///
+			/// \param _value The value to check
+			/// \return The target of its tween, or the value itself if it doesn't have one
+			static float Target(const float* _value);
+
+			/// Are any tweens running?
+			static inline bool Active(void)
+			{
+				return M22Tween::COUNT > 0;
+			};
+
+			/// Moves every tween on, finishing the ones whose time is up
+			///
+			/// \param _ms Milliseconds since the last update (\a M22Engine::DELTA_TIME)
+			static void Update(Uint32 _ms);
+
+			/// Puts every value at its target and stops the tweens (e.g. for skipping)
+			static void Finish(void);
+
+			/// Stops every tween where it is
+			static void Reset(void);
+	};
+
+	/// \class 		M22CharacterLayer M22Engine.h "include/M22Engine.h"
+	/// \brief 		The characters on screen, drawn over the background
+	///
+	/// \details 	A fixed pool of \a CHARACTER_SLOTS slots, each a character drawn as its own quad over
+	///				\a M22Graphics::BACKGROUND_RENDER_TARGET, in order of depth. Fades, slides and scales are
+	///				\a M22Tween tweens on the slot, so showing, hiding or changing the expression of a character
+	///				doesn't redraw the background. A character shown again while it's on screen keeps its slot.
+	///
+	class M22CharacterLayer
+	{
+		private:
+			/// Frees a slot and lets go of its sprite
+			static void Release(int _slot);
+
+			/// Re-sorts \a DRAW_ORDER by depth, then by when they were shown
+			static void SortDrawOrder(void);
+		public:
+			/// A character on screen
+			struct Slot
+			{
+				bool used;												///< Is this slot taken?
+				bool clearing;											///< Is it fading out, to be freed once it's gone?
+				int character;											///< Index in \a M22Engine::CHARACTERS_ARRAY
+				int outfit;												///< Index of the character's outfit
+				int emotion;											///< Index of the character's emotion
+				int asset;												///< \a M22AssetLoader handle of the sprite, held while it's shown
+				SDL_Texture* sprite;									///< The sprite
+				int width;												///< Width of \a sprite
+				int height;												///< Height of \a sprite
+				float alpha;											///< 0-255
+				float x;												///< Position on the X-axis
+				float y;												///< Position on the Y-axis
+				float scale;											///< Scale, about the bottom middle of the sprite
+				int z;													///< Depth; higher is drawn over lower
+				Uint32 order;											///< When it was shown, so the same depth draws in the order they came
+			};
+
+			static Slot SLOTS[CHARACTER_SLOTS];							///< The pool
+			static int DRAW_ORDER[CHARACTER_SLOTS];						///< Indices of the used slots, back to front
+			static size_t COUNT;										///< Number of used slots
+			static Uint32 NEXT_ORDER;									///< \a Slot::order for the next character shown
+			static SDL_Rect RECTS[CHARACTER_SLOTS];						///< Where each slot in \a DRAW_ORDER is drawn, rebuilt every draw
+			static Mat3f TRANSFORM;										///< Transform applied to the characters as they're drawn (identity by default)
+
+			/// Shows a character, or changes the one already on screen to this outfit/emotion/position
+			///
+			/// \param _character Index in \a M22Engine::CHARACTERS_ARRAY
+			/// \param _outfit Index of the character's outfit
+			/// \param _emotion Index of the character's emotion
+			/// \param _asset \a M22AssetLoader handle of the sprite
+			/// \param _x Position on the X-axis
+			/// \param _brutal Show it straight away, rather than fading/sliding it in?
+			/// \param _z Depth; higher is drawn over lower
+			/// \return The slot, -1 if they're all taken
+			static short int Show(int _character, int _outfit, int _emotion, int _asset, int _x, bool _brutal = false, int _z = 0);
+
+			/// Takes a character off the screen
+			///
+			/// \param _slot The slot
+			/// \param _brutal Remove it straight away rather than fading it out?
+			static void Hide(int _slot, bool _brutal = false);
+
+			/// Takes every character off the screen
+			///
+			/// \param _brutal Remove them straight away rather than fading them out?
+			static void Clear(bool _brutal = false);
+
+			/// Slides a character somewhere else
+			///
+			/// \param _slot The slot
+			/// \param _x Position on the X-axis
+			/// \param _y Position on the Y-axis
+			/// \param _ms How long to take; 0 moves it straight away
+			static void Move(int _slot, float _x, float _y, Uint32 _ms = CHARACTER_MOVE_MS);
+
+			/// Scales a character about the bottom middle of its sprite
+			///
+			/// \param _slot The slot
+			/// \param _scale Target scale
+			/// \param _ms How long to take; 0 scales it straight away
+			static void Scale(int _slot, float _scale, Uint32 _ms = CHARACTER_MOVE_MS);
+
+			/// Moves a character in front of/behind the others
+			///
+			/// \param _slot The slot
+			/// \param _z Depth; higher is drawn over lower
+			static void SetDepth(int _slot, int _z);
+
+			/// Finds the slot a character is shown in (not counting ones fading out)
+			///
+			/// \param _character Index in \a M22Engine::CHARACTERS_ARRAY
+			/// \return The slot, -1 if the character isn't on screen
+			static int Find(int _character);
+
+			/// Frees the slots of characters that have finished fading out; call once a frame, after \a M22Tween::Update
+			static void Update(void);
+
+			/// Draws the characters, back to front
+			static void Draw(void);
+
+			/// Frees every slot straight away, e.g. before the renderer goes
+			static void Reset(void);
+	};
+
+	/// \class 		M22GlyphCache M22Engine.h "include/M22Engine.h"
+	/// \brief 		Renders a script's glyphs into \a M22Script::font's cache before the typewriter gets to them
+	///
+	/// \details 	NFont only renders a glyph the first time it's drawn, which hitches the typewriter whenever a new
+	///				character turns up (constantly, with CJK scripts). Compiling a script collects every code point its
+	///				text uses, in the order they first appear; \a Update then has the font render the ones it hasn't
+	///				seen yet, a few milliseconds a frame. SDL_ttf and the font's cache textures are main-thread only,
+	///				so that's where the rendering happens; the loop wakes up to do it even when nothing's being drawn.
+	///
+	class M22GlyphCache
+	{
+		public:
+			static std::vector<Uint32> PENDING;						///< Code points waiting to be rendered, in the order they're needed
+			static size_t NEXT;										///< Index in \a PENDING of the next one to render
+			static std::unordered_set<Uint32> SEEN;					///< Every code point already queued or rendered, so each is only done once
+			static size_t WARMED;									///< Number of glyphs rendered ahead of time
+
+			/// Queues every code point in some script text that the font hasn't been asked for yet
+			///
+			/// \param _text Text (UTF-8) of a script line
+			static void Collect(std::string_view _text);
+
+			/// Renders queued glyphs until the budget runs out, and reports the cache's size when the queue empties
+			///
+			/// \param _budget Milliseconds to spend
+			static void Update(Uint32 _budget = GLYPH_PREWARM_BUDGET_MS);
+
+			/// Are there glyphs still waiting to be rendered?
+			static inline bool Pending(void)
+			{
+				return M22GlyphCache::NEXT < M22GlyphCache::PENDING.size();
+			};
+
+			/// How much texture memory a font's glyph cache is using
+			///
+			/// \param _font The font
+			/// \param _pages Set to the number of cache textures, if not NULL
+			/// \return Size in bytes
+			static size_t CacheBytes(NFont* _font, size_t* _pages = NULL);
+
+			/// Forgets what's been queued/rendered, e.g. when the font is replaced
+			static void Reset(void);
+	};
+
 	/// \class 		M22Lua M22Engine.h "include/M22Engine.h"
 	/// \brief 		Class for Lua engine
 	///
@@ -1140,11 +2791,74 @@ namespace March22
 	class M22Lua
 	{
 		private:
+			/// A Lua script compiled into a function, kept in the registry
+			struct Chunk
+			{
+				std::string filename;										///< Path the chunk was loaded from, for error messages
+				int reference;												///< luaL_ref of the compiled function in the registry
+			};
+			static std::vector<Chunk> CHUNKS;								///< Every script compiled so far; a chunk's index is its ID
+			static std::unordered_map<std::string, int> CHUNK_LOOKUP;		///< Script filename to index in \a CHUNKS
+
+			static std::deque<M22ScriptCompiler::line_c> COMMANDS;			///< Commands linked once for the \a m22 table, for the loaded script's tables
+			static std::unordered_map<std::string, int> COMMAND_LOOKUP;		///< Line type and names to index in \a COMMANDS
+			static int COMMAND_BASE;										///< ID of the first command in \a COMMANDS; IDs below it were linked against tables since cleared
+
+			/// Links a command once, so the \a m22 functions can run it again by index without parsing anything
+			///
+			/// \param _type Type of command
+			/// \param _names Names of the assets it uses, as they'd be written in a script
+			/// \return ID of the command (\a COMMAND_BASE plus its index in \a COMMANDS), -1 if an asset couldn't be found
+			static int PrepareCommand(M22Script::LINETYPE _type, const std::vector<std::string>& _names);
+
+			/// Gets the prepared command passed as an argument, raising a Lua error if it isn't one of \a _type or is from before the script's tables were last cleared
+			///
+			/// \param L Lua state
+			/// \param _arg Index of the argument on the stack
+			/// \param _type Type of command expected
+			/// \param _altType Other type of command accepted, if any
+			/// \return The command
+			static M22ScriptCompiler::line_c* CheckCommand(lua_State* L, int _arg, M22Script::LINETYPE _type, M22Script::LINETYPE _altType);
+
+			/// Runs the command like ChangeLine would, and pushes the \a EXECUTE_RESULT
+			static int PushExecute(lua_State* L, M22ScriptCompiler::line_c* _command);
+
+			/// \name The m22 table
+			/// Resolvers take names and return IDs; call them once, and pass the IDs to the rest each time
+			/// \{
+			static int FindBackground(lua_State* L);						///< m22.background(name) -> id
+			static int FindMusic(lua_State* L);							///< m22.music(name) -> id
+			static int FindSting(lua_State* L);							///< m22.sting(name) -> id
+			static int FindCharacter(lua_State* L);						///< m22.character(name, outfit, emotion) -> id
+			static int DrawBackground(lua_State* L);						///< m22.draw_background(id)
+			static int PlayMusic(lua_State* L);							///< m22.play_music(id)
+			static int StopMusic(lua_State* L);							///< m22.stop_music()
+			static int PlaySting(lua_State* L);							///< m22.play_sting(id)
+			static int DrawCharacter(lua_State* L);						///< m22.draw_character(id, x [, brutal])
+			static int ClearCharacters(lua_State* L);						///< m22.clear_characters()
+			/// \}
 		public:
 			static lua_State *STATE;
-			static int M22Lua::Initialize();
-			static void M22Lua::Shutdown();
-			static int M22Lua::ExecuteM22ScriptCommand(lua_State*);
+			static int Initialize();
+			static void Shutdown();
+
+			/// Forgets the commands prepared for the \a m22 table, after the background/character tables they index are cleared; the IDs already handed out stop working
+			static void ClearCommands(void);
+
+			/// M22_ExecuteCommand(...); parses and links its arguments as a script line on every call, so prefer the \a m22 table
+			static int ExecuteM22ScriptCommand(lua_State*);
+
+			/// Compiles the Lua script, or returns the chunk already compiled from it
+			///
+			/// \param _filename Filename of the script, relative to scripts/lua/
+			/// \return ID of the chunk, -1 if it failed to compile (or there's no Lua state)
+			static int LoadChunk(const std::string& _filename);
+
+			/// Runs a chunk from \a LoadChunk
+			///
+			/// \param _chunk ID of the chunk
+			/// \return Error code if problem encountered, 0 if fine
+			static short int RunChunk(int _chunk);
 	};
 
 };
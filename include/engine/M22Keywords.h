@@ -0,0 +1,85 @@
+/*
+	M22Keywords.h
+	Sorted keyword tables for mapping script tokens to enums.
+*/
+
+#pragma once
+
+#include <string_view>
+#include <cctype>
+
+namespace March22
+{
+	/// An entry in a keyword table; tables must be sorted by \a name (checked with \a M22KeywordsSorted)
+	template<typename T>
+	struct M22Keyword
+	{
+		std::string_view name;			///< The keyword as written in scripts
+		T value;						///< What it maps to
+	};
+
+	/// Strips leading/trailing whitespace (including the delimiter SplitString leaves on) from a token, without copying it
+	///
+	/// \param _token Token to trim
+	/// \return View of the trimmed token
+	inline std::string_view M22TrimToken(std::string_view _token)
+	{
+		while(!_token.empty() && std::isspace((unsigned char)_token.front()))
+		{
+			_token.remove_prefix(1);
+		};
+		while(!_token.empty() && std::isspace((unsigned char)_token.back()))
+		{
+			_token.remove_suffix(1);
+		};
+		return _token;
+	};
+
+	/// Is the keyword table sorted, with no duplicates? For use in a static_assert next to the table
+	///
+	/// \param _table The keyword table
+	template<typename T, size_t N>
+	constexpr bool M22KeywordsSorted(const M22Keyword<T> (&_table)[N])
+	{
+		for(size_t i = 1; i < N; i++)
+		{
+			if(!(_table[i-1].name < _table[i].name))
+			{
+				return false;
+			};
+		};
+		return true;
+	};
+
+	/// Binary searches a keyword table for the (trimmed) token
+	///
+	/// \param _table The keyword table
+	/// \param _token Token to look up
+	/// \param _notFound Value to return if the token isn't a keyword
+	/// \return The keyword's value, or _notFound
+	template<typename T, size_t N>
+	inline T M22FindKeyword(const M22Keyword<T> (&_table)[N], std::string_view _token, T _notFound)
+	{
+		_token = M22TrimToken(_token);
+		size_t low = 0;
+		size_t high = N;
+		while(low < high)
+		{
+			size_t middle = (low + high) / 2;
+			int comparison = _table[middle].name.compare(_token);
+			if(comparison == 0)
+			{
+				return _table[middle].value;
+			}
+			else if(comparison < 0)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			};
+		};
+		return _notFound;
+	};
+}
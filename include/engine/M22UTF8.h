@@ -0,0 +1,125 @@
+/*
+	M22UTF8.h
+	Stepping through UTF-8 text a code point at a time, without converting it.
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace March22
+{
+	static const uint32_t M22_REPLACEMENT_CHARACTER = 0xFFFD;	///< What malformed UTF-8 decodes to
+
+	/// Decodes the code point at \a _pos, and moves \a _pos past it; a malformed sequence decodes to
+	/// \a M22_REPLACEMENT_CHARACTER and only skips its first byte
+	///
+	/// \param _text Text to decode; \a _pos must be before the end
+	/// \param _pos Byte offset of the code point
+	/// \param _valid Set to false if the sequence was malformed, if not NULL
+	/// \return The code point
+	inline uint32_t M22DecodeUTF8(std::string_view _text, size_t& _pos, bool* _valid = NULL)
+	{
+		const unsigned char lead = (unsigned char)_text[_pos];
+		if(lead < 0x80)
+		{
+			_pos++;
+			return lead;
+		};
+
+		size_t length = 0;
+		uint32_t codepoint = 0;
+		uint32_t minimum = 0;
+		if((lead & 0xE0) == 0xC0)
+		{
+			length = 2;
+			codepoint = lead & 0x1F;
+			minimum = 0x80;
+		}
+		else if((lead & 0xF0) == 0xE0)
+		{
+			length = 3;
+			codepoint = lead & 0x0F;
+			minimum = 0x800;
+		}
+		else if((lead & 0xF8) == 0xF0)
+		{
+			length = 4;
+			codepoint = lead & 0x07;
+			minimum = 0x10000;
+		};
+
+		bool valid = (length != 0 && _pos + length <= _text.size());
+		for(size_t i = 1; valid && i < length; i++)
+		{
+			const unsigned char continuation = (unsigned char)_text[_pos + i];
+			valid = ((continuation & 0xC0) == 0x80);
+			codepoint = (codepoint << 6) | (continuation & 0x3F);
+		};
+		// Overlong forms, surrogates and anything past U+10FFFF aren't allowed either
+		valid = valid && codepoint >= minimum && codepoint <= 0x10FFFF && (codepoint < 0xD800 || codepoint > 0xDFFF);
+		if(_valid != NULL && !valid)
+		{
+			*_valid = false;
+		};
+		_pos += (valid ? length : 1);
+		return (valid ? codepoint : M22_REPLACEMENT_CHARACTER);
+	};
+
+	/// Byte offset of the code point after the one at \a _pos
+	///
+	/// \param _text Text to step through
+	/// \param _pos Byte offset of a code point, before the end of \a _text
+	inline size_t M22NextUTF8(std::string_view _text, size_t _pos)
+	{
+		M22DecodeUTF8(_text, _pos);
+		return _pos;
+	};
+
+	/// Is the whole of the text well-formed UTF-8?
+	///
+	/// \param _text Text to check
+	inline bool M22IsValidUTF8(std::string_view _text)
+	{
+		bool valid = true;
+		size_t pos = 0;
+		while(valid && pos < _text.size())
+		{
+			M22DecodeUTF8(_text, pos, &valid);
+		};
+		return valid;
+	};
+
+	/// Appends a code point to a string as UTF-8
+	///
+	/// \param _codepoint Code point to encode, up to U+10FFFF
+	/// \param _output String to append to
+	inline void M22EncodeUTF8(uint32_t _codepoint, std::string& _output)
+	{
+		if(_codepoint < 0x80)
+		{
+			_output += char(_codepoint);
+		}
+		else if(_codepoint < 0x800)
+		{
+			_output += char(0xC0 | (_codepoint >> 6));
+			_output += char(0x80 | (_codepoint & 0x3F));
+		}
+		else if(_codepoint < 0x10000)
+		{
+			_output += char(0xE0 | (_codepoint >> 12));
+			_output += char(0x80 | ((_codepoint >> 6) & 0x3F));
+			_output += char(0x80 | (_codepoint & 0x3F));
+		}
+		else
+		{
+			_output += char(0xF0 | (_codepoint >> 18));
+			_output += char(0x80 | ((_codepoint >> 12) & 0x3F));
+			_output += char(0x80 | ((_codepoint >> 6) & 0x3F));
+			_output += char(0x80 | (_codepoint & 0x3F));
+		};
+		return;
+	};
+}
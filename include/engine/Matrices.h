@@ -8,60 +8,222 @@
 #pragma once
 
 #include "Vectors.h"
-#include <vector>
 #include <iostream>
 
-// Forward declarations
-class Vec2;
-class Vec3;
-class Vec4;
-
-class Matrix
+/// Fixed-size R x C matrix, held by value
+///
+/// Stored as columns, so multiplying a vector is a sum of scaled columns; that's what the SIMD paths
+/// in Matrices.cpp want. Everything but the rotations is constexpr.
+template<size_t R, size_t C, typename T>
+class Mat
 {
 private:
-	int x_;
-	int y_;
-	std::vector<std::vector<double>> matrix_;
+	Vec<R, T> c_[C];
 public:
-	Matrix(){}
-	Matrix(int _x, int _y)
+	constexpr Mat() : c_{} {}
+
+	static inline constexpr Mat Identity()
 	{
-		matrix_.resize(_y);
-		for (size_t i=0; i < matrix_.size(); i++) {
-			matrix_[i].resize(_x);
-		};
+		static_assert(R == C, "Only square matrices have an identity");
+		Mat result;
+		for(size_t i = 0; i < R; i++) result.c_[i][i] = T(1);
+		return result;
+	};
+
+	inline constexpr T& operator()(size_t _row, size_t _col) { return c_[_col][_row]; }
+	inline constexpr const T& operator()(size_t _row, size_t _col) const { return c_[_col][_row]; }
+	inline constexpr Vec<R, T>& column(size_t _col) { return c_[_col]; }
+	inline constexpr const Vec<R, T>& column(size_t _col) const { return c_[_col]; }
+	inline constexpr Vec<C, T> row(size_t _row) const
+	{
+		Vec<C, T> result;
+		for(size_t i = 0; i < C; i++) result[i] = c_[i][_row];
+		return result;
 	}
 
-	inline double GetValue(int _x, int _y)
+	inline constexpr Mat operator+(const Mat& _mat) const
 	{
-		return matrix_[_y][_x];
-	};
+		Mat result = *this;
+		for(size_t i = 0; i < C; i++) result.c_[i] += _mat.c_[i];
+		return result;
+	}
+	inline constexpr Mat operator-(const Mat& _mat) const
+	{
+		Mat result = *this;
+		for(size_t i = 0; i < C; i++) result.c_[i] -= _mat.c_[i];
+		return result;
+	}
+	inline constexpr Mat operator*(const T _scalar) const
+	{
+		Mat result = *this;
+		for(size_t i = 0; i < C; i++) result.c_[i] *= _scalar;
+		return result;
+	}
+	inline constexpr Vec<R, T> operator*(const Vec<C, T>& _vec) const
+	{
+		Vec<R, T> result;
+		for(size_t i = 0; i < C; i++) result += c_[i] * _vec[i];
+		return result;
+	}
+	template<size_t K>
+	inline constexpr Mat<R, K, T> operator*(const Mat<C, K, T>& _mat) const
+	{
+		Mat<R, K, T> result;
+		for(size_t i = 0; i < K; i++) result.column(i) = (*this) * _mat.column(i);
+		return result;
+	}
+	inline constexpr Mat<C, R, T> Transposed() const
+	{
+		Mat<C, R, T> result;
+		for(size_t i = 0; i < C; i++)
+			for(size_t k = 0; k < R; k++)
+				result(i, k) = c_[i][k];
+		return result;
+	}
+	inline constexpr bool operator==(const Mat& _mat) const
+	{
+		for(size_t i = 0; i < C; i++)
+		{
+			if(c_[i] != _mat.c_[i]) return false;
+		};
+		return true;
+	}
+	inline constexpr bool operator!=(const Mat& _mat) const
+	{
+		return !(*this == _mat);
+	}
 
-	inline void SetValue(int _y, int _x, double value)
+	friend std::ostream &operator<<( std::ostream &out, const Mat &matrix )
 	{
-		matrix_[_y][_x] = value;
-	};
-	friend std::ostream &operator<<( std::ostream &out, const Matrix &matrix )
-    { 
-		for(size_t y = 0; y < matrix.matrix_.size(); y++)
+		for(size_t y = 0; y < R; y++)
 		{
-			for(size_t x = 0; x < matrix.matrix_.size(); x++)
+			for(size_t x = 0; x < C; x++)
 			{
-				out << matrix.matrix_[y][x] << ',';
+				out << matrix(y, x) << ',';
 			};
 			out << '\n';
 		};
-        return out;            
-    }
-
-	static Matrix Matrix::Sum ( Matrix* _mat1, Matrix* _mat2);
-	
-	static Vec3* Matrix::Multiply( Matrix* _mat1, Vec3* _vec);
-	static Vec4* Matrix::Multiply ( Matrix* _mat1, Vec4* _vec);
-	static Vec2* Matrix::Rotate ( Vec2* _vector, float _angle );
-	static Vec3* Matrix::RotateX ( Vec3* _vector, float _angle);
-	static Vec3* Matrix::RotateY ( Vec3* _vector, float _angle);
-	static Vec3* Matrix::RotateZ ( Vec3* _vector, float _angle);
-
-//	static 
-};
\ No newline at end of file
+		return out;
+	}
+};
+
+typedef Mat<3, 3, double> Mat3;
+typedef Mat<4, 4, double> Mat4;
+typedef Mat<3, 3, float> Mat3f;
+typedef Mat<4, 4, float> Mat4f;
+
+class Matrix
+{
+public:
+	template<size_t R, size_t C, typename T>
+	static inline constexpr Mat<R, C, T> Sum(const Mat<R, C, T>& _mat1, const Mat<R, C, T>& _mat2)
+	{
+		return _mat1 + _mat2;
+	};
+
+	template<size_t R, size_t C, typename T>
+	static inline constexpr Vec<R, T> Multiply(const Mat<R, C, T>& _mat1, const Vec<C, T>& _vec)
+	{
+		return _mat1 * _vec;
+	};
+
+	/// Same as the template, with SSE2/NEON where there is some
+	static Vec4f Multiply(const Mat4f& _mat1, const Vec4f& _vec);
+
+	/// 2D rotation (anticlockwise, in radians) for homogeneous coordinates
+	template<typename T>
+	static inline Mat<3, 3, T> Rotation(double _angle)
+	{
+		Mat<3, 3, T> result = Mat<3, 3, T>::Identity();
+		result(0, 0) = T(std::cos(_angle));	result(0, 1) = T(-std::sin(_angle));
+		result(1, 0) = T(std::sin(_angle));	result(1, 1) = T(std::cos(_angle));
+		return result;
+	};
+
+	/// 2D translation for homogeneous coordinates
+	template<typename T>
+	static inline constexpr Mat<3, 3, T> Translation(T _x, T _y)
+	{
+		Mat<3, 3, T> result = Mat<3, 3, T>::Identity();
+		result(0, 2) = _x;
+		result(1, 2) = _y;
+		return result;
+	};
+
+	/// 2D scale for homogeneous coordinates
+	template<typename T>
+	static inline constexpr Mat<3, 3, T> Scale(T _x, T _y)
+	{
+		Mat<3, 3, T> result = Mat<3, 3, T>::Identity();
+		result(0, 0) = _x;
+		result(1, 1) = _y;
+		return result;
+	};
+
+	template<typename T>
+	static inline Mat<4, 4, T> RotationX(double _angle)
+	{
+		Mat<4, 4, T> result = Mat<4, 4, T>::Identity();
+		result(1, 1) = T(std::cos(_angle));	result(1, 2) = T(-std::sin(_angle));
+		result(2, 1) = T(std::sin(_angle));	result(2, 2) = T(std::cos(_angle));
+		return result;
+	};
+
+	template<typename T>
+	static inline Mat<4, 4, T> RotationY(double _angle)
+	{
+		Mat<4, 4, T> result = Mat<4, 4, T>::Identity();
+		result(0, 0) = T(std::cos(_angle));	result(0, 2) = T(std::sin(_angle));
+		result(2, 0) = T(-std::sin(_angle));	result(2, 2) = T(std::cos(_angle));
+		return result;
+	};
+
+	template<typename T>
+	static inline Mat<4, 4, T> RotationZ(double _angle)
+	{
+		Mat<4, 4, T> result = Mat<4, 4, T>::Identity();
+		result(0, 0) = T(std::cos(_angle));	result(0, 1) = T(-std::sin(_angle));
+		result(1, 0) = T(std::sin(_angle));	result(1, 1) = T(std::cos(_angle));
+		return result;
+	};
+
+	template<typename T>
+	static inline Vec<2, T> Rotate(const Vec<2, T>& _vector, double _angle)
+	{
+		Vec<3, T> rotated = Matrix::Rotation<T>(_angle) * Vec<3, T>(_vector.x(), _vector.y(), T(1));
+		return Vec<2, T>(rotated.x(), rotated.y());
+	};
+
+	template<typename T>
+	static inline Vec<3, T> RotateX(const Vec<3, T>& _vector, double _angle)
+	{
+		Vec<4, T> rotated = Matrix::RotationX<T>(_angle) * Vec<4, T>(_vector.x(), _vector.y(), _vector.z(), T(1));
+		return Vec<3, T>(rotated.x(), rotated.y(), rotated.z());
+	};
+
+	template<typename T>
+	static inline Vec<3, T> RotateY(const Vec<3, T>& _vector, double _angle)
+	{
+		Vec<4, T> rotated = Matrix::RotationY<T>(_angle) * Vec<4, T>(_vector.x(), _vector.y(), _vector.z(), T(1));
+		return Vec<3, T>(rotated.x(), rotated.y(), rotated.z());
+	};
+
+	template<typename T>
+	static inline Vec<3, T> RotateZ(const Vec<3, T>& _vector, double _angle)
+	{
+		Vec<4, T> rotated = Matrix::RotationZ<T>(_angle) * Vec<4, T>(_vector.x(), _vector.y(), _vector.z(), T(1));
+		return Vec<3, T>(rotated.x(), rotated.y(), rotated.z());
+	};
+
+	/// Transforms a batch of rects, 4 at a time with SSE2/NEON where there is some
+	///
+	/// Each rect is 4 ints, x/y/w/h, laid out like an SDL_Rect. The output is the (rounded) bounding box of
+	/// the transformed rect, so it's exact for translations, scales and flips; the bottom row of the
+	/// transform is taken to be 0,0,1.
+	///
+	/// \param _transform	2D homogeneous transform
+	/// \param _rects		_count rects to transform
+	/// \param _out			Where to write the _count transformed rects; can be _rects
+	/// \param _count		Number of rects
+	static void TransformRects(const Mat3f& _transform, const int* _rects, int* _out, size_t _count);
+};
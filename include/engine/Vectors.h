@@ -7,355 +7,155 @@
 
 #pragma once
 
-#include "Matrices.h"
-#include <string>
+#include <cstddef>
+#include <cmath>
 #include <ostream>
 
-class Vec2;
-class Vec3;
-class Vec4;
-
-class Vector
+/// Fixed-size vector of N components, held by value
+///
+/// Everything but the square roots is constexpr. Vectors that come to 16 bytes (4 floats, 2 doubles) are
+/// 16-byte aligned, so the SIMD paths in Matrices.cpp can load them directly.
+template<size_t N, typename T>
+class Vec
 {
+	static_assert(N > 0, "A Vec needs at least one component");
 private:
-
+	alignas(sizeof(T) * N == 16 ? 16 : alignof(T)) T v_[N];
 public:
-	static Vec2 Sum(Vec2*, Vec2*);
-	static Vec3 Sum(Vec3*, Vec3*);
-	static double Magnitude(Vec2*);
-	static double Magnitude(Vec3*);
-	static double DotProd(Vec2*, Vec2*);
-	static double DotProd(Vec3*, Vec3*);
-	static double DotProd(Vec4*, Vec4*);
-	static Vec2 Lerp(Vec2*,Vec2*, double);
-};
+	constexpr Vec() : v_{} {};
 
-class Vec2 : public Vector
-{
-private:
-	double x_;
-	double y_;
-public:
-	Vec2()
-	{
-		Vec2::x_ = 0.0;
-		Vec2::y_ = 0.0;
-	};
-	Vec2(double _x)
-	{
-		Vec2::x_ = _x;
-		Vec2::y_ = 0.0;
-	};
-	Vec2(double _x,double _y)
+	/// Components not given are 0, like the old Vec2(x) etc.
+	template<typename... A>
+	constexpr Vec(T _first, A... _rest) : v_{ _first, T(_rest)... }
 	{
-		Vec2::x_ = _x;
-		Vec2::y_ = _y;
+		static_assert(sizeof...(A) < N, "Too many components for this Vec");
 	};
 
-	inline double x() { return x_; }
-	inline double y() { return y_; }
-	inline void x(double _x) { x_ = _x; }
-	inline void y(double _y) { y_ = _y; }
-	inline void Vec2::operator/=(const double _scalar)
+	inline constexpr T& operator[](size_t _i) { return v_[_i]; }
+	inline constexpr const T& operator[](size_t _i) const { return v_[_i]; }
+	inline constexpr T* data() { return v_; }
+	inline constexpr const T* data() const { return v_; }
+
+	inline constexpr T x() const { return v_[0]; }
+	inline constexpr T y() const { static_assert(N >= 2, "No y component"); return v_[1]; }
+	inline constexpr T z() const { static_assert(N >= 3, "No z component"); return v_[2]; }
+	inline constexpr T w() const { static_assert(N >= 4, "No w component"); return v_[3]; }
+	inline constexpr void x(T _x) { v_[0] = _x; }
+	inline constexpr void y(T _y) { static_assert(N >= 2, "No y component"); v_[1] = _y; }
+	inline constexpr void z(T _z) { static_assert(N >= 3, "No z component"); v_[2] = _z; }
+	inline constexpr void w(T _w) { static_assert(N >= 4, "No w component"); v_[3] = _w; }
+
+	inline constexpr void operator/=(const T _scalar)
 	{
-		(*this).x_ /= _scalar;
-		(*this).y_ /= _scalar;
+		for(size_t i = 0; i < N; i++) v_[i] /= _scalar;
 		return;
 	}
-	inline Vec2 Vec2::operator/(const double _scalar)
+	inline constexpr Vec operator/(const T _scalar) const
 	{
-		Vec2 newVec;
-		newVec.x_ = this->x_ / _scalar;
-		newVec.y_ = this->y_ / _scalar;
+		Vec newVec = *this;
+		newVec /= _scalar;
 		return newVec;
 	}
-	inline void Vec2::operator*=(const double _scalar)
+	inline constexpr void operator*=(const T _scalar)
 	{
-		(*this).x_ *= _scalar;
-		(*this).y_ *= _scalar;
+		for(size_t i = 0; i < N; i++) v_[i] *= _scalar;
 		return;
 	}
-	inline Vec2 Vec2::operator*(const double _scalar)
+	inline constexpr Vec operator*(const T _scalar) const
 	{
-		Vec2 newVec;
-		newVec.x_ = this->x_ * _scalar;
-		newVec.y_ = this->y_ * _scalar;
+		Vec newVec = *this;
+		newVec *= _scalar;
 		return newVec;
 	}
-/*	inline void Vec2::operator*=(const Vec2& _vec)
-	{
-		(*this).x_ *= _vec.x_;
-		(*this).y_ *= _vec.y_;
-		return;
-	}
-	inline Vec2 Vec2::operator*(const Vec2& _vec)
-	{
-		Vec2 newVec;
-		newVec.x_ = this->x_ * _vec.x_;
-		newVec.y_ = this->y_ * _vec.y_;
-		return newVec;
-	}*/
-	inline void Vec2::operator+=(const Vec2& _vec)
+	inline constexpr void operator+=(const Vec& _vec)
 	{
-		(*this).x_ += _vec.x_;
-		(*this).y_ += _vec.y_;
+		for(size_t i = 0; i < N; i++) v_[i] += _vec.v_[i];
 		return;
 	}
-	inline Vec2 Vec2::operator+(const Vec2& _vec)
+	inline constexpr Vec operator+(const Vec& _vec) const
 	{
-		Vec2 newVec;
-		newVec.x_ = this->x_ + _vec.x_;
-		newVec.y_ = this->y_ + _vec.y_;
+		Vec newVec = *this;
+		newVec += _vec;
 		return newVec;
 	}
-	inline void Vec2::operator-=(const Vec2& _vec)
+	inline constexpr void operator-=(const Vec& _vec)
 	{
-		(*this).x_ -= _vec.x_;
-		(*this).y_ -= _vec.y_;
+		for(size_t i = 0; i < N; i++) v_[i] -= _vec.v_[i];
 		return;
 	}
-	inline Vec2 Vec2::operator-(const Vec2& _vec)
+	inline constexpr Vec operator-(const Vec& _vec) const
 	{
-		Vec2 newVec;
-		newVec.x_ = this->x_ - _vec.x_;
-		newVec.y_ = this->y_ - _vec.y_;
+		Vec newVec = *this;
+		newVec -= _vec;
 		return newVec;
 	}
-	friend std::ostream &operator<<( std::ostream &out, const Vec2 &vec )
-    { 
-        out << "(" << vec.x_ << ", " << vec.y_ << ")";
-        return out;            
-    }
-};
-
-class Vec3 : public Vector
-{
-private:
-	double x_;
-	double y_;
-	double z_;
-public:
-	Vec3()
-	{
-		Vec3::x_ = 0.0;
-		Vec3::y_ = 0.0;
-		Vec3::z_ = 0.0;
-	};
-	Vec3(double _x)
-	{
-		Vec3::x_ = _x;
-		Vec3::y_ = 0.0;
-		Vec3::z_ = 0.0;
-	};
-	Vec3(double _x,double _y)
-	{
-		Vec3::x_ = _x;
-		Vec3::y_ = _y;
-		Vec3::z_ = 0.0;
-	};
-	Vec3(double _x,double _y,double _z)
-	{
-		Vec3::x_ = _x;
-		Vec3::y_ = _y;
-		Vec3::z_ = _z;
-	};
-	inline void Vec3::operator/=(const double _scalar)
-	{
-		(*this).x_ /= _scalar;
-		(*this).y_ /= _scalar;
-		(*this).z_ /= _scalar;
-		return;
-	}
-	inline Vec3 Vec3::operator/(const double _scalar)
+	inline constexpr Vec operator-() const
 	{
-		Vec3 newVec;
-		newVec.x_ = this->x_ / _scalar;
-		newVec.y_ = this->y_ / _scalar;
-		newVec.z_ = this->z_ / _scalar;
+		Vec newVec;
+		for(size_t i = 0; i < N; i++) newVec.v_[i] = -v_[i];
 		return newVec;
 	}
-	inline void Vec3::operator*=(const double _scalar)
+	inline constexpr bool operator==(const Vec& _vec) const
 	{
-		(*this).x_ *= _scalar;
-		(*this).y_ *= _scalar;
-		(*this).z_ *= _scalar;
-		return;
+		for(size_t i = 0; i < N; i++)
+		{
+			if(v_[i] != _vec.v_[i]) return false;
+		};
+		return true;
 	}
-	inline Vec3 Vec3::operator*(const double _scalar)
+	inline constexpr bool operator!=(const Vec& _vec) const
 	{
-		Vec3 newVec;
-		newVec.x_ = this->x_ * _scalar;
-		newVec.y_ = this->y_ * _scalar;
-		newVec.z_ = this->z_ * _scalar;
-		return newVec;
+		return !(*this == _vec);
 	}
-	inline void Vec3::operator+=(const Vec3& _vec)
+	friend inline constexpr Vec operator*(const T _scalar, const Vec& _vec)
 	{
-		(*this).x_ += _vec.x_;
-		(*this).y_ += _vec.y_;
-		(*this).z_ += _vec.z_;
-		return;
+		return _vec * _scalar;
 	}
-	inline Vec3 Vec3::operator+(const Vec3& _vec)
+	friend std::ostream &operator<<( std::ostream &out, const Vec &vec )
 	{
-		Vec3 newVec;
-		newVec.x_ = this->x_ + _vec.x_;
-		newVec.y_ = this->y_ + _vec.y_;
-		newVec.z_ = this->z_ + _vec.z_;
-		return newVec;
+		out << "(";
+		for(size_t i = 0; i < N; i++)
+		{
+			out << (i > 0 ? ", " : "") << vec.v_[i];
+		};
+		out << ")";
+		return out;
 	}
-	inline void Vec3::operator-=(const Vec3& _vec)
-	{
-		(*this).x_ -= _vec.x_;
-		(*this).y_ -= _vec.y_;
-		(*this).z_ -= _vec.z_;
-		return;
-	}
-	inline Vec3 Vec3::operator-(const Vec3& _vec)
-	{
-		Vec3 newVec;
-		newVec.x_ = this->x_ - _vec.x_;
-		newVec.y_ = this->y_ - _vec.y_;
-		newVec.z_ = this->z_ - _vec.z_;
-		return newVec;
-	}
-	friend std::ostream &operator<<( std::ostream &out, const Vec3 &vec )
-    { 
-        out << "(" << vec.x_ << ", " << vec.y_ << ", " << vec.z_ << ")";
-        return out;            
-    }
-
-	inline double x() { return x_; }
-	inline double y() { return y_; }
-	inline double z() { return z_; }
-	inline void x(double _x) { x_ = _x; }
-	inline void y(double _y) { y_ = _y; }
-	inline void z(double _z) { z_ = _z; }
 };
 
-class Vec4 : public Vector
+typedef Vec<2, double> Vec2;
+typedef Vec<3, double> Vec3;
+typedef Vec<4, double> Vec4;
+typedef Vec<2, float> Vec2f;
+typedef Vec<3, float> Vec3f;
+typedef Vec<4, float> Vec4f;
+
+class Vector
 {
-private:
-	double x_;
-	double y_;
-	double z_;
-	double w_;
 public:
-	Vec4()
-	{
-		Vec4::x_ = 0.0;
-		Vec4::y_ = 0.0;
-		Vec4::z_ = 0.0;
-		Vec4::w_ = 0.0;
-	};
-	Vec4(double _x)
+	template<size_t N, typename T>
+	static inline constexpr Vec<N, T> Sum(const Vec<N, T>& _param1, const Vec<N, T>& _param2)
 	{
-		Vec4::x_ = _x;
-		Vec4::y_ = 0.0;
-		Vec4::z_ = 0.0;
-		Vec4::w_ = 0.0;
+		return _param1 + _param2;
 	};
-	Vec4(double _x,double _y)
+
+	template<size_t N, typename T>
+	static inline constexpr T DotProd(const Vec<N, T>& _param1, const Vec<N, T>& _param2)
 	{
-		Vec4::x_ = _x;
-		Vec4::y_ = _y;
-		Vec4::z_ = 0.0;
-		Vec4::w_ = 0.0;
+		T result = T(0);
+		for(size_t i = 0; i < N; i++) result += _param1[i] * _param2[i];
+		return result;
 	};
-	Vec4(double _x,double _y,double _z)
+
+	template<size_t N, typename T>
+	static inline T Magnitude(const Vec<N, T>& _param1)
 	{
-		Vec4::x_ = _x;
-		Vec4::y_ = _y;
-		Vec4::z_ = _z;
-		Vec4::w_ = 0.0;
+		return T(std::sqrt(Vector::DotProd(_param1, _param1)));
 	};
-	Vec4(double _x,double _y,double _z,double _w)
+
+	template<size_t N, typename T>
+	static inline constexpr Vec<N, T> Lerp(const Vec<N, T>& _param1, const Vec<N, T>& _param2, T _t)
 	{
-		Vec4::x_ = _x;
-		Vec4::y_ = _y;
-		Vec4::z_ = _z;
-		Vec4::w_ = _w;
+		return _param1 * (T(1) - _t) + _param2 * _t;
 	};
-	inline Vec4 Vec4::operator+(const Vec4& _vec)
-	{
-		Vec4 newVec;
-		newVec.x_ = this->x_ + _vec.x_;
-		newVec.y_ = this->y_ + _vec.y_;
-		newVec.z_ = this->z_ + _vec.z_;
-		newVec.w_ = this->w_ + _vec.w_;
-		return newVec;
-	}
-	inline void Vec4::operator+=(const Vec4& _vec)
-	{
-		(*this).x_ += _vec.x_;
-		(*this).y_ += _vec.y_;
-		(*this).z_ += _vec.z_;
-		(*this).w_ += _vec.w_;
-		return;
-	}
-	inline Vec4 Vec4::operator-(const Vec4& _vec)
-	{
-		Vec4 newVec;
-		newVec.x_ = this->x_ - _vec.x_;
-		newVec.y_ = this->y_ - _vec.y_;
-		newVec.z_ = this->z_ - _vec.z_;
-		newVec.w_ = this->w_ - _vec.w_;
-		return newVec;
-	}
-	inline void Vec4::operator-=(const Vec4& _vec)
-	{
-		(*this).x_ -= _vec.x_;
-		(*this).y_ -= _vec.y_;
-		(*this).z_ -= _vec.z_;
-		(*this).w_ -= _vec.w_;
-		return;
-	}
-	inline Vec4 Vec4::operator*(const double _scalar)
-	{
-		Vec4 newVec;
-		newVec.x_ = this->x_ * _scalar;
-		newVec.y_ = this->y_ * _scalar;
-		newVec.z_ = this->z_ * _scalar;
-		newVec.w_ = this->w_ * _scalar;
-		return newVec;
-	}
-	inline void Vec4::operator*=(const double _scalar)
-	{
-		(*this).x_ *= _scalar;
-		(*this).y_ *= _scalar;
-		(*this).z_ *= _scalar;
-		(*this).w_ *= _scalar;
-		return;
-	}
-	inline Vec4 Vec4::operator/(const double _scalar)
-	{
-		Vec4 newVec;
-		newVec.x_ = this->x_ / _scalar;
-		newVec.y_ = this->y_ / _scalar;
-		newVec.z_ = this->z_ / _scalar;
-		newVec.w_ = this->w_ / _scalar;
-		return newVec;
-	}
-	inline void Vec4::operator/=(const double _scalar)
-	{
-		(*this).x_ /= _scalar;
-		(*this).y_ /= _scalar;
-		(*this).z_ /= _scalar;
-		(*this).w_ /= _scalar;
-		return;
-	}
-	friend std::ostream &operator<<( std::ostream &out, const Vec4 &vec )
-    { 
-        out << "(" << vec.x_ << ", " << vec.y_ << ", " << vec.z_ << ", " << vec.w_ << ")";
-        return out;            
-    }
-
-	inline double x() { return x_; }
-	inline double y() { return y_; }
-	inline double z() { return z_; }
-	inline double w() { return w_; }
-	inline void x(double _x) { x_ = _x; }
-	inline void y(double _y) { y_ = _y; }
-	inline void z(double _z) { z_ = _z; }
-	inline void w(double _w) { w_ = _w; }
-};
\ No newline at end of file
+};
@@ -1,4 +1,9 @@
 print("[M22Lua*] This is a Lua print, as indicated by the asterisk!");
 
 --M22_ChangeBackground("BLACK");
-M22_ExecuteCommand("DrawBackground", "mystery_girl_s");
\ No newline at end of file
+--M22_ExecuteCommand("DrawBackground", "mystery_girl_s");
+
+-- Resolve names to IDs, then the m22 functions take the IDs without parsing anything;
+-- IDs only last until the next script loads, and resolving the same name again is a lookup
+local sample_background = m22.background("mystery_girl_s");
+m22.draw_background(sample_background);
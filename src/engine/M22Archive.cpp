@@ -0,0 +1,154 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::deque<M22Archive::MountedArchive> M22Archive::ARCHIVES;
+
+std::string M22Archive::NormalisePath(const std::string& _path)
+{
+	std::string path = _path;
+	std::replace(path.begin(), path.end(), '\\', '/');
+	while(path.compare(0, 2, "./") == 0)
+	{
+		path.erase(0, 2);
+	};
+	return path;
+};
+
+Uint64 M22Archive::HashPath(const std::string& _path)
+{
+	Uint64 hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < _path.size(); i++)
+	{
+		hash ^= Uint8(_path[i]);
+		hash *= 1099511628211ULL;
+	};
+	return hash;
+};
+
+short int M22Archive::Mount(const std::string& _filename)
+{
+	M22Archive::ARCHIVES.emplace_back();
+	MountedArchive& archive = M22Archive::ARCHIVES.back();
+	if(!archive.file.Open(_filename))
+	{
+		M22Archive::ARCHIVES.pop_back();
+		return -1;
+	};
+
+	m22pak_header header;
+	bool valid = (archive.file.GetSize() >= sizeof(m22pak_header));
+	if(valid)
+	{
+		memcpy(&header, archive.file.GetData(), sizeof(m22pak_header));
+		valid = (memcmp(header.m_magic, "M22P", 4) == 0 && header.m_version == M22PAK_VERSION);
+	};
+	Uint64 pathsOffset = sizeof(m22pak_header) + (valid ? Uint64(header.m_numEntries) * sizeof(m22pak_entry) : 0);
+	valid = valid && (pathsOffset + header.m_pathDataSize <= archive.file.GetSize());
+	if(!valid)
+	{
+		printf("[M22Archive] %s is not a version %i archive!\n", _filename.c_str(), M22PAK_VERSION);
+		M22Archive::ARCHIVES.pop_back();
+		return -1;
+	};
+
+	archive.entries = reinterpret_cast<const m22pak_entry*>(archive.file.GetData() + sizeof(m22pak_header));
+	archive.numEntries = header.m_numEntries;
+	archive.paths = reinterpret_cast<const char*>(archive.file.GetData() + pathsOffset);
+	archive.pathDataSize = header.m_pathDataSize;
+
+	// Check every entry now, so Find can trust them
+	for(Uint32 i = 0; valid && i < archive.numEntries; i++)
+	{
+		const m22pak_entry& entry = archive.entries[i];
+		valid = (i == 0 || archive.entries[i-1].m_hash <= entry.m_hash) &&
+			(Uint64(entry.m_path) + entry.m_pathLength <= archive.pathDataSize) &&
+			(entry.m_offset <= archive.file.GetSize() && entry.m_size <= archive.file.GetSize() - entry.m_offset);
+	};
+	if(!valid)
+	{
+		printf("[M22Archive] %s is corrupt!\n", _filename.c_str());
+		M22Archive::ARCHIVES.pop_back();
+		return -1;
+	};
+	printf("[M22Archive] Mounted %s (%u files)\n", _filename.c_str(), archive.numEntries);
+	return 0;
+};
+
+void M22Archive::Shutdown(void)
+{
+	M22Archive::ARCHIVES.clear();
+	return;
+};
+
+bool M22Archive::Find(const std::string& _path, const Uint8*& _data, size_t& _size)
+{
+	if(M22Archive::ARCHIVES.empty())
+	{
+		return false;
+	};
+	std::string path = M22Archive::NormalisePath(_path);
+	Uint64 hash = M22Archive::HashPath(path);
+	for(size_t i = M22Archive::ARCHIVES.size(); i-- > 0;)
+	{
+		const MountedArchive& archive = M22Archive::ARCHIVES.at(i);
+		const m22pak_entry* found = std::lower_bound(archive.entries, archive.entries + archive.numEntries, hash,
+			[](const m22pak_entry& _entry, Uint64 _hash) { return _entry.m_hash < _hash; });
+
+		// Walk any entries sharing the hash, comparing the paths themselves
+		for(; found != archive.entries + archive.numEntries && found->m_hash == hash; found++)
+		{
+			if(path.compare(0, std::string::npos, archive.paths + found->m_path, found->m_pathLength) == 0)
+			{
+				_data = archive.file.GetData() + found->m_offset;
+				_size = size_t(found->m_size);
+				return true;
+			};
+		};
+	};
+	return false;
+};
+
+SDL_RWops* M22Archive::OpenRW(const std::string& _path)
+{
+	const Uint8* data;
+	size_t size;
+	if(M22Archive::Find(_path, data, size))
+	{
+		return SDL_RWFromConstMem(data, int(size));
+	};
+	return SDL_RWFromFile(_path.c_str(), "rb");
+};
+
+bool M22Archive::ReadText(const std::string& _path, std::string& _text)
+{
+	const Uint8* data;
+	size_t size;
+	if(M22Archive::Find(_path, data, size))
+	{
+		_text.assign(reinterpret_cast<const char*>(data), size);
+	}
+	else
+	{
+		std::ifstream input(_path, std::ios::binary | std::ios::in);
+		if(!input)
+		{
+			return false;
+		};
+		_text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	};
+	// Archives hold the files byte for byte, so do what a text-mode stream does on Windows
+	_text.erase(std::remove(_text.begin(), _text.end(), '\r'), _text.end());
+	return true;
+};
+
+bool M22Archive::OpenStream(const std::string& _path, std::stringstream& _stream)
+{
+	std::string text;
+	if(!M22Archive::ReadText(_path, text))
+	{
+		return false;
+	};
+	_stream.str(text);
+	return true;
+};
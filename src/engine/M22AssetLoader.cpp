@@ -0,0 +1,387 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::deque<M22AssetLoader::TextureAsset> M22AssetLoader::ASSETS;
+std::unordered_map<std::string, M22AssetLoader::AssetHandle> M22AssetLoader::ASSET_LOOKUP;
+std::deque<M22AssetLoader::AssetHandle> M22AssetLoader::DECODE_QUEUE;
+std::deque<M22AssetLoader::AssetHandle> M22AssetLoader::UPLOAD_QUEUE;
+std::vector<std::thread> M22AssetLoader::WORKERS;
+std::mutex M22AssetLoader::MUTEX;
+std::condition_variable M22AssetLoader::QUEUE_CONDITION;
+std::condition_variable M22AssetLoader::DECODED_CONDITION;
+bool M22AssetLoader::RUNNING = false;
+size_t M22AssetLoader::BUDGET = size_t(TEXTURE_CACHE_BUDGET_MB) * 1024 * 1024;
+size_t M22AssetLoader::RESIDENT_BYTES = 0;
+
+short int M22AssetLoader::Initialize(unsigned int _num_of_workers)
+{
+	if(M22AssetLoader::RUNNING == true)
+	{
+		return 0;
+	};
+
+	// Load the decoder libraries up-front, so the workers never race to do it
+	IMG_Init(IMG_INIT_PNG | IMG_INIT_WEBP);
+
+	if(_num_of_workers == 0)
+	{
+		_num_of_workers = std::thread::hardware_concurrency();
+		if(_num_of_workers > 1) _num_of_workers--;
+		if(_num_of_workers == 0) _num_of_workers = 1;
+	};
+
+	printf("[M22AssetLoader] Starting %u decoding thread(s)...\n", _num_of_workers);
+	M22AssetLoader::RUNNING = true;
+	for(unsigned int i = 0; i < _num_of_workers; i++)
+	{
+		M22AssetLoader::WORKERS.push_back(std::thread(M22AssetLoader::WorkerLoop));
+	};
+	return 0;
+};
+
+void M22AssetLoader::Shutdown(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+		M22AssetLoader::RUNNING = false;
+		M22AssetLoader::DECODE_QUEUE.clear();
+	}
+	M22AssetLoader::QUEUE_CONDITION.notify_all();
+	for(size_t i = 0; i < M22AssetLoader::WORKERS.size(); i++)
+	{
+		M22AssetLoader::WORKERS.at(i).join();
+	};
+	M22AssetLoader::WORKERS.clear();
+
+	M22AssetLoader::UnloadAll();
+	M22AssetLoader::ASSETS.clear();
+	M22AssetLoader::ASSET_LOOKUP.clear();
+	return;
+};
+
+void M22AssetLoader::WorkerLoop(void)
+{
+	std::unique_lock<std::mutex> lock(M22AssetLoader::MUTEX);
+	while(true)
+	{
+		M22AssetLoader::QUEUE_CONDITION.wait(lock, []{ return !M22AssetLoader::RUNNING || !M22AssetLoader::DECODE_QUEUE.empty(); });
+		if(M22AssetLoader::RUNNING == false)
+		{
+			return;
+		};
+
+		AssetHandle handle = M22AssetLoader::DECODE_QUEUE.front();
+		M22AssetLoader::DECODE_QUEUE.pop_front();
+		TextureAsset& asset = M22AssetLoader::ASSETS.at(handle);
+		asset.state = DECODING;
+		unsigned int generation = asset.generation;
+		std::string path = asset.path;
+
+		// Decode without holding the lock; this is the slow part
+		lock.unlock();
+		SDL_Surface* surface = IMG_Load_RW(M22Archive::OpenRW(path), 1);
+		lock.lock();
+
+		if(asset.generation != generation)
+		{
+			// Unloaded while we were decoding; throw it away
+			if(surface) SDL_FreeSurface(surface);
+		}
+		else if(!surface)
+		{
+			printf("[M22AssetLoader] Failed to decode %s!\n", path.c_str());
+			asset.state = FAILED;
+		}
+		else
+		{
+			asset.surface = surface;
+			asset.state = DECODED;
+			M22AssetLoader::UPLOAD_QUEUE.push_back(handle);
+			M22FrameScheduler::Wake();
+		};
+		M22AssetLoader::DECODED_CONDITION.notify_all();
+	};
+};
+
+void M22AssetLoader::UploadAsset(int _handle)
+{
+	TextureAsset& asset = M22AssetLoader::ASSETS.at(_handle);
+	asset.texture = SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, asset.surface);
+	// Drivers store these as 32bpp regardless of the source format
+	asset.bytes = size_t(asset.surface->w) * size_t(asset.surface->h) * 4;
+	SDL_FreeSurface(asset.surface);
+	asset.surface = NULL;
+	if(!asset.texture)
+	{
+		printf("[M22AssetLoader] Failed to upload %s!\n", asset.path.c_str());
+		asset.state = FAILED;
+		return;
+	};
+	if(asset.blend) SDL_SetTextureBlendMode(asset.texture, SDL_BLENDMODE_BLEND);
+	SDL_SetTextureAlphaMod(asset.texture, asset.alpha);
+	asset.state = READY;
+	asset.lastUsed = SDL_GetTicks();
+	M22AssetLoader::RESIDENT_BYTES += asset.bytes;
+	if(M22AssetLoader::RESIDENT_BYTES > M22AssetLoader::BUDGET)
+	{
+		M22AssetLoader::EvictUnlocked();
+	};
+	return;
+};
+
+void M22AssetLoader::EvictUnlocked(void)
+{
+	while(M22AssetLoader::RESIDENT_BYTES > M22AssetLoader::BUDGET)
+	{
+		// Find the least recently used texture nobody is holding on to
+		int oldest = -1;
+		for(size_t i = 0; i < M22AssetLoader::ASSETS.size(); i++)
+		{
+			const TextureAsset& asset = M22AssetLoader::ASSETS.at(i);
+			if(asset.state == READY && asset.references <= 0)
+			{
+				if(oldest == -1 || asset.lastUsed < M22AssetLoader::ASSETS.at(oldest).lastUsed)
+				{
+					oldest = int(i);
+				};
+			};
+		};
+		if(oldest == -1)
+		{
+			printf("[M22AssetLoader] Over texture budget (%u KB resident), but everything is in use!\n", unsigned(M22AssetLoader::RESIDENT_BYTES / 1024));
+			return;
+		};
+
+		TextureAsset& asset = M22AssetLoader::ASSETS.at(oldest);
+		SDL_DestroyTexture(asset.texture);
+		asset.texture = NULL;
+		asset.state = UNLOADED;
+		asset.generation++;
+		M22AssetLoader::RESIDENT_BYTES -= asset.bytes;
+		asset.bytes = 0;
+	};
+	return;
+};
+
+M22AssetLoader::AssetHandle M22AssetLoader::RegisterTexture(const std::string& _path, Uint8 _alpha, bool _blend)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	AssetHandle handle;
+	std::unordered_map<std::string, AssetHandle>::iterator found = M22AssetLoader::ASSET_LOOKUP.find(_path);
+	if(found != M22AssetLoader::ASSET_LOOKUP.end())
+	{
+		handle = found->second;
+	}
+	else
+	{
+		TextureAsset tempAsset;
+		tempAsset.path = _path;
+		tempAsset.alpha = _alpha;
+		tempAsset.blend = _blend;
+		M22AssetLoader::ASSETS.push_back(tempAsset);
+		handle = AssetHandle(M22AssetLoader::ASSETS.size()-1);
+		M22AssetLoader::ASSET_LOOKUP[_path] = handle;
+	};
+	return handle;
+};
+
+void M22AssetLoader::QueueTexture(AssetHandle _handle)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	if(_handle < 0 || size_t(_handle) >= M22AssetLoader::ASSETS.size())
+	{
+		return;
+	};
+	M22AssetLoader::ASSETS.at(_handle).lastUsed = SDL_GetTicks();
+
+	// Without workers (e.g. headless tools) the asset is only recorded, and decoded on demand
+	if(M22AssetLoader::ASSETS.at(_handle).state == UNLOADED && M22AssetLoader::RUNNING == true)
+	{
+		M22AssetLoader::ASSETS.at(_handle).state = QUEUED;
+		M22AssetLoader::DECODE_QUEUE.push_back(_handle);
+		M22AssetLoader::QUEUE_CONDITION.notify_one();
+	};
+	return;
+};
+
+M22AssetLoader::AssetHandle M22AssetLoader::RequestTexture(const std::string& _path, Uint8 _alpha, bool _blend)
+{
+	AssetHandle handle = M22AssetLoader::RegisterTexture(_path, _alpha, _blend);
+	M22AssetLoader::QueueTexture(handle);
+	return handle;
+};
+
+M22AssetLoader::AssetHandle M22AssetLoader::FindTexture(const std::string& _path)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	std::unordered_map<std::string, AssetHandle>::iterator found = M22AssetLoader::ASSET_LOOKUP.find(_path);
+	if(found == M22AssetLoader::ASSET_LOOKUP.end())
+	{
+		return -1;
+	};
+	return found->second;
+};
+
+SDL_Texture* M22AssetLoader::GetTexture(AssetHandle _handle)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	if(_handle < 0 || size_t(_handle) >= M22AssetLoader::ASSETS.size())
+	{
+		return NULL;
+	};
+	return M22AssetLoader::ASSETS.at(_handle).texture;
+};
+
+bool M22AssetLoader::IsReady(AssetHandle _handle)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	if(_handle < 0 || size_t(_handle) >= M22AssetLoader::ASSETS.size())
+	{
+		return false;
+	};
+	return (M22AssetLoader::ASSETS.at(_handle).state == READY);
+};
+
+SDL_Texture* M22AssetLoader::WaitForTexture(AssetHandle _handle)
+{
+	std::unique_lock<std::mutex> lock(M22AssetLoader::MUTEX);
+	if(_handle < 0 || size_t(_handle) >= M22AssetLoader::ASSETS.size())
+	{
+		return NULL;
+	};
+	TextureAsset& asset = M22AssetLoader::ASSETS.at(_handle);
+
+	if(asset.state == UNLOADED || asset.state == QUEUED)
+	{
+		// Nobody has started on it yet, so it's quicker to decode it here than wait behind the queue
+		if(asset.state == QUEUED)
+		{
+			M22AssetLoader::DECODE_QUEUE.erase(std::find(M22AssetLoader::DECODE_QUEUE.begin(), M22AssetLoader::DECODE_QUEUE.end(), _handle));
+		};
+		asset.state = DECODING;
+		unsigned int generation = asset.generation;
+		std::string path = asset.path;
+		lock.unlock();
+		SDL_Surface* surface = IMG_Load_RW(M22Archive::OpenRW(path), 1);
+		lock.lock();
+		if(asset.generation != generation)
+		{
+			// Unloaded while we were decoding, like the workers check; the slot isn't this image any more
+			if(surface) SDL_FreeSurface(surface);
+			return NULL;
+		};
+		if(!surface)
+		{
+			printf("[M22AssetLoader] Failed to decode %s!\n", path.c_str());
+			asset.state = FAILED;
+			return NULL;
+		};
+		asset.surface = surface;
+		asset.state = DECODED;
+	}
+	else if(asset.state == DECODING)
+	{
+		M22AssetLoader::DECODED_CONDITION.wait(lock, [&asset]{ return asset.state != DECODING; });
+	};
+
+	if(asset.state == DECODED)
+	{
+		M22AssetLoader::UploadAsset(_handle);
+	};
+	asset.lastUsed = SDL_GetTicks();
+	return asset.texture;
+};
+
+void M22AssetLoader::UpdateUploads(Uint32 _budget)
+{
+	Uint32 start = SDL_GetTicks();
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	while(!M22AssetLoader::UPLOAD_QUEUE.empty())
+	{
+		AssetHandle handle = M22AssetLoader::UPLOAD_QUEUE.front();
+		M22AssetLoader::UPLOAD_QUEUE.pop_front();
+
+		// Skip anything already uploaded by WaitForTexture, or unloaded since
+		if(M22AssetLoader::ASSETS.at(handle).state == DECODED)
+		{
+			M22AssetLoader::UploadAsset(handle);
+			M22FrameScheduler::MarkDirty();
+			if((SDL_GetTicks() - start) >= _budget)
+			{
+				break;
+			};
+		};
+	};
+	return;
+};
+
+void M22AssetLoader::UnloadAll(void)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	M22AssetLoader::DECODE_QUEUE.clear();
+	M22AssetLoader::UPLOAD_QUEUE.clear();
+	for(size_t i = 0; i < M22AssetLoader::ASSETS.size(); i++)
+	{
+		TextureAsset& asset = M22AssetLoader::ASSETS.at(i);
+		if(asset.texture) SDL_DestroyTexture(asset.texture);
+		if(asset.surface) SDL_FreeSurface(asset.surface);
+		asset.texture = NULL;
+		asset.surface = NULL;
+		// A worker still decoding this will see the new generation and discard its result
+		asset.state = UNLOADED;
+		asset.generation++;
+		asset.bytes = 0;
+	};
+	M22AssetLoader::RESIDENT_BYTES = 0;
+	return;
+};
+
+void M22AssetLoader::Acquire(AssetHandle _handle)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	if(_handle < 0 || size_t(_handle) >= M22AssetLoader::ASSETS.size())
+	{
+		return;
+	};
+	M22AssetLoader::ASSETS.at(_handle).references++;
+	return;
+};
+
+void M22AssetLoader::Release(AssetHandle _handle)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	if(_handle < 0 || size_t(_handle) >= M22AssetLoader::ASSETS.size())
+	{
+		return;
+	};
+	TextureAsset& asset = M22AssetLoader::ASSETS.at(_handle);
+	if(asset.references <= 0)
+	{
+		printf("[M22AssetLoader] Released %s more times than it was acquired!\n", asset.path.c_str());
+		return;
+	};
+	asset.references--;
+	if(asset.references == 0 && asset.state == QUEUED)
+	{
+		// Nobody wants it any more, so don't bother decoding it
+		M22AssetLoader::DECODE_QUEUE.erase(std::find(M22AssetLoader::DECODE_QUEUE.begin(), M22AssetLoader::DECODE_QUEUE.end(), _handle));
+		asset.state = UNLOADED;
+	};
+	return;
+};
+
+void M22AssetLoader::SetBudget(size_t _bytes)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	M22AssetLoader::BUDGET = _bytes;
+	M22AssetLoader::EvictUnlocked();
+	return;
+};
+
+void M22AssetLoader::TrimToBudget(void)
+{
+	std::lock_guard<std::mutex> lock(M22AssetLoader::MUTEX);
+	M22AssetLoader::EvictUnlocked();
+	return;
+};
@@ -0,0 +1,67 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::deque<std::string> M22AssetRegistry::NAMES;
+std::unordered_map<std::string_view, M22AssetRegistry::AssetID> M22AssetRegistry::IDS;
+std::unordered_map<Uint64, int> M22AssetRegistry::BINDINGS[M22AssetRegistry::NUMBER_OF_KINDS];
+std::mutex M22AssetRegistry::MUTEX;
+
+M22AssetRegistry::AssetID M22AssetRegistry::Intern(std::string_view _name)
+{
+	std::lock_guard<std::mutex> lock(M22AssetRegistry::MUTEX);
+	std::unordered_map<std::string_view, AssetID>::const_iterator found = M22AssetRegistry::IDS.find(_name);
+	if(found != M22AssetRegistry::IDS.end())
+	{
+		return found->second;
+	};
+	AssetID id = AssetID(M22AssetRegistry::NAMES.size());
+	M22AssetRegistry::NAMES.emplace_back(_name);
+	M22AssetRegistry::IDS.emplace(std::string_view(M22AssetRegistry::NAMES.back()), id);
+	return id;
+};
+
+M22AssetRegistry::AssetID M22AssetRegistry::Find(std::string_view _name)
+{
+	std::lock_guard<std::mutex> lock(M22AssetRegistry::MUTEX);
+	std::unordered_map<std::string_view, AssetID>::const_iterator found = M22AssetRegistry::IDS.find(_name);
+	return (found != M22AssetRegistry::IDS.end() ? found->second : INVALID);
+};
+
+std::string M22AssetRegistry::Name(M22AssetRegistry::AssetID _id)
+{
+	std::lock_guard<std::mutex> lock(M22AssetRegistry::MUTEX);
+	return (_id < M22AssetRegistry::NAMES.size() ? M22AssetRegistry::NAMES.at(_id) : std::string());
+};
+
+void M22AssetRegistry::Bind(M22AssetRegistry::KINDS _kind, std::string_view _name, int _index, int _owner)
+{
+	AssetID id = M22AssetRegistry::Intern(_name);
+	std::lock_guard<std::mutex> lock(M22AssetRegistry::MUTEX);
+	M22AssetRegistry::BINDINGS[_kind].emplace(M22AssetRegistry::Key(id, _owner), _index);
+	return;
+};
+
+int M22AssetRegistry::Lookup(M22AssetRegistry::KINDS _kind, std::string_view _name, int _owner)
+{
+	AssetID id = M22AssetRegistry::Find(_name);
+	if(id == INVALID)
+	{
+		return -1;
+	};
+	return M22AssetRegistry::Lookup(_kind, id, _owner);
+};
+
+int M22AssetRegistry::Lookup(M22AssetRegistry::KINDS _kind, M22AssetRegistry::AssetID _id, int _owner)
+{
+	std::lock_guard<std::mutex> lock(M22AssetRegistry::MUTEX);
+	std::unordered_map<Uint64, int>::const_iterator found = M22AssetRegistry::BINDINGS[_kind].find(M22AssetRegistry::Key(_id, _owner));
+	return (found != M22AssetRegistry::BINDINGS[_kind].end() ? found->second : -1);
+};
+
+void M22AssetRegistry::Unbind(M22AssetRegistry::KINDS _kind)
+{
+	std::lock_guard<std::mutex> lock(M22AssetRegistry::MUTEX);
+	M22AssetRegistry::BINDINGS[_kind].clear();
+	return;
+};
@@ -0,0 +1,143 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::vector<M22Atlas::Page> M22Atlas::PAGES;
+std::unordered_map<std::string, M22Atlas::Region> M22Atlas::LOOKUP;
+int M22Atlas::PAGE_SIZE = 0;
+
+int M22Atlas::Pack(int _w, int _h, SDL_Rect& _rect)
+{
+	for(size_t i = 0; i < M22Atlas::PAGES.size(); i++)
+	{
+		Page& page = M22Atlas::PAGES.at(i);
+		if(!page.shared)
+		{
+			continue;
+		};
+		if(page.shelfX + _w <= M22Atlas::PAGE_SIZE && page.shelfY + _h <= M22Atlas::PAGE_SIZE)
+		{
+			// Fits on the end of the current shelf
+			_rect.x = page.shelfX;
+			_rect.y = page.shelfY;
+			page.shelfX += _w;
+			page.shelfHeight = std::max(page.shelfHeight, _h);
+			return int(i);
+		};
+		if(page.shelfY + page.shelfHeight + _h <= M22Atlas::PAGE_SIZE)
+		{
+			// Start a new shelf under the current one
+			page.shelfY += page.shelfHeight;
+			page.shelfX = _w;
+			page.shelfHeight = _h;
+			_rect.x = 0;
+			_rect.y = page.shelfY;
+			return int(i);
+		};
+	};
+
+	Page page;
+	page.texture = SDL_CreateTexture(M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, M22Atlas::PAGE_SIZE, M22Atlas::PAGE_SIZE);
+	if(page.texture == NULL)
+	{
+		printf("[M22Atlas] Failed to create a %ix%i page: %s\n", M22Atlas::PAGE_SIZE, M22Atlas::PAGE_SIZE, SDL_GetError());
+		return -1;
+	};
+	// Static textures start out undefined, and the padding has to be transparent
+	std::vector<Uint32> blank(size_t(M22Atlas::PAGE_SIZE) * size_t(M22Atlas::PAGE_SIZE), 0);
+	SDL_UpdateTexture(page.texture, NULL, blank.data(), M22Atlas::PAGE_SIZE * int(sizeof(Uint32)));
+	SDL_SetTextureBlendMode(page.texture, SDL_BLENDMODE_BLEND);
+	page.shelfX = _w;
+	page.shelfY = 0;
+	page.shelfHeight = _h;
+	page.shared = true;
+	M22Atlas::PAGES.push_back(page);
+	_rect.x = 0;
+	_rect.y = 0;
+	return int(M22Atlas::PAGES.size() - 1);
+};
+
+M22Atlas::Region M22Atlas::Load(const std::string& _path)
+{
+	std::unordered_map<std::string, Region>::iterator found = M22Atlas::LOOKUP.find(_path);
+	if(found != M22Atlas::LOOKUP.end())
+	{
+		return found->second;
+	};
+
+	if(M22Atlas::PAGE_SIZE == 0)
+	{
+		M22Atlas::PAGE_SIZE = ATLAS_PAGE_SIZE;
+		SDL_RendererInfo info;
+		if(SDL_GetRendererInfo(M22Renderer::SDL_RENDERER, &info) == 0)
+		{
+			// Some drivers report 0 for "no limit"
+			if(info.max_texture_width > 0) M22Atlas::PAGE_SIZE = std::min(M22Atlas::PAGE_SIZE, info.max_texture_width);
+			if(info.max_texture_height > 0) M22Atlas::PAGE_SIZE = std::min(M22Atlas::PAGE_SIZE, info.max_texture_height);
+		};
+		printf("[M22Atlas] Packing interface images into %ix%i pages\n", M22Atlas::PAGE_SIZE, M22Atlas::PAGE_SIZE);
+	};
+
+	Region region;
+	SDL_Surface* loaded = M22Startup::TakeImage(_path);
+	if(loaded == NULL)
+	{
+		loaded = IMG_Load_RW(M22Archive::OpenRW(_path), 1);
+	};
+	if(loaded == NULL)
+	{
+		printf("[M22Atlas] Failed to load %s: %s\n", _path.c_str(), IMG_GetError());
+		return region;
+	};
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+	SDL_FreeSurface(loaded);
+	if(converted == NULL)
+	{
+		printf("[M22Atlas] Failed to convert %s: %s\n", _path.c_str(), SDL_GetError());
+		return region;
+	};
+
+	region.rect.w = converted->w;
+	region.rect.h = converted->h;
+	if(converted->w + ATLAS_PADDING > M22Atlas::PAGE_SIZE || converted->h + ATLAS_PADDING > M22Atlas::PAGE_SIZE)
+	{
+		// Too big to share a page, so it gets one of its own
+		Page page;
+		page.texture = SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, converted);
+		page.shelfX = page.shelfY = page.shelfHeight = 0;
+		page.shared = false;
+		if(page.texture != NULL)
+		{
+			SDL_SetTextureBlendMode(page.texture, SDL_BLENDMODE_BLEND);
+			M22Atlas::PAGES.push_back(page);
+			region.texture = page.texture;
+		};
+	}
+	else
+	{
+		int pageIndex = M22Atlas::Pack(converted->w + ATLAS_PADDING, converted->h + ATLAS_PADDING, region.rect);
+		if(pageIndex != -1)
+		{
+			region.texture = M22Atlas::PAGES.at(pageIndex).texture;
+			SDL_UpdateTexture(region.texture, &region.rect, converted->pixels, converted->pitch);
+		};
+	};
+	SDL_FreeSurface(converted);
+
+	if(region.texture != NULL)
+	{
+		M22Atlas::LOOKUP[_path] = region;
+	};
+	return region;
+};
+
+void M22Atlas::Shutdown(void)
+{
+	for(size_t i = 0; i < M22Atlas::PAGES.size(); i++)
+	{
+		SDL_DestroyTexture(M22Atlas::PAGES.at(i).texture);
+	};
+	M22Atlas::PAGES.clear();
+	M22Atlas::LOOKUP.clear();
+	return;
+};
@@ -0,0 +1,262 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+M22CharacterLayer::Slot M22CharacterLayer::SLOTS[CHARACTER_SLOTS] = {};
+int M22CharacterLayer::DRAW_ORDER[CHARACTER_SLOTS] = {};
+size_t M22CharacterLayer::COUNT = 0;
+Uint32 M22CharacterLayer::NEXT_ORDER = 0;
+SDL_Rect M22CharacterLayer::RECTS[CHARACTER_SLOTS];
+Mat3f M22CharacterLayer::TRANSFORM = Mat3f::Identity();
+
+short int M22CharacterLayer::Show(int _character, int _outfit, int _emotion, int _asset, int _x, bool _brutal, int _z)
+{
+	int slot = M22CharacterLayer::Find(_character);
+	if(slot == -1)
+	{
+		slot = 0;
+		while(slot < CHARACTER_SLOTS && M22CharacterLayer::SLOTS[slot].used)
+		{
+			slot++;
+		};
+		if(slot == CHARACTER_SLOTS)
+		{
+			printf("[M22CharacterLayer] All %i character slots are taken!\n", CHARACTER_SLOTS);
+			return -1;
+		};
+		Slot& added = M22CharacterLayer::SLOTS[slot];
+		added.used = true;
+		added.clearing = false;
+		added.character = _character;
+		added.asset = -1;
+		added.alpha = (_brutal ? 255.0f : 0.0f);
+		added.x = float(_x);
+		added.y = 0.0f;
+		added.scale = 1.0f;
+		added.z = _z;
+		added.order = M22CharacterLayer::NEXT_ORDER++;
+		M22CharacterLayer::DRAW_ORDER[M22CharacterLayer::COUNT++] = slot;
+		M22CharacterLayer::SortDrawOrder();
+		if(!_brutal)
+		{
+			M22Tween::Start(&added.alpha, 255.0f, CHARACTER_FADE_MS);
+		};
+	}
+	else
+	{
+		// Already on screen: the new expression just replaces the sprite, and it slides over if it's moved
+		Slot& shown = M22CharacterLayer::SLOTS[slot];
+		M22CharacterLayer::Move(slot, float(_x), shown.y, (_brutal ? 0 : CHARACTER_MOVE_MS));
+		if(shown.z != _z)
+		{
+			M22CharacterLayer::SetDepth(slot, _z);
+		};
+		if(_brutal)
+		{
+			M22Tween::Start(&shown.alpha, 255.0f, 0);
+		};
+	};
+
+	Slot& target = M22CharacterLayer::SLOTS[slot];
+	// Hold the new sprite before letting go of the old one, in case they're the same
+	M22AssetLoader::Acquire(_asset);
+	M22AssetLoader::Release(target.asset);
+	target.asset = _asset;
+	target.outfit = _outfit;
+	target.emotion = _emotion;
+	target.sprite = M22AssetLoader::WaitForTexture(_asset);
+	target.width = target.height = 0;
+	if(target.sprite)
+	{
+		SDL_QueryTexture(target.sprite, NULL, NULL, &target.width, &target.height);
+		SDL_SetTextureBlendMode(target.sprite, SDL_BLENDMODE_BLEND);
+	};
+	M22FrameScheduler::MarkDirty();
+	return short(slot);
+};
+
+void M22CharacterLayer::Hide(int _slot, bool _brutal)
+{
+	if(_slot < 0 || _slot >= CHARACTER_SLOTS || !M22CharacterLayer::SLOTS[_slot].used)
+	{
+		return;
+	};
+	if(_brutal)
+	{
+		M22CharacterLayer::Release(_slot);
+		return;
+	};
+	// Update frees it once it's faded out
+	M22CharacterLayer::SLOTS[_slot].clearing = true;
+	M22Tween::Start(&M22CharacterLayer::SLOTS[_slot].alpha, 0.0f, CHARACTER_FADE_MS);
+	return;
+};
+
+void M22CharacterLayer::Clear(bool _brutal)
+{
+	// Back to front, as releasing one shifts the ones after it down
+	for(size_t i = M22CharacterLayer::COUNT; i > 0; i--)
+	{
+		M22CharacterLayer::Hide(M22CharacterLayer::DRAW_ORDER[i - 1], _brutal);
+	};
+	return;
+};
+
+void M22CharacterLayer::Move(int _slot, float _x, float _y, Uint32 _ms)
+{
+	if(_slot < 0 || _slot >= CHARACTER_SLOTS || !M22CharacterLayer::SLOTS[_slot].used)
+	{
+		return;
+	};
+	Slot& slot = M22CharacterLayer::SLOTS[_slot];
+	if(slot.x != _x || M22Tween::IsRunning(&slot.x))
+	{
+		M22Tween::Start(&slot.x, _x, _ms, M22Tween::EASE_IN_OUT);
+	};
+	if(slot.y != _y || M22Tween::IsRunning(&slot.y))
+	{
+		M22Tween::Start(&slot.y, _y, _ms, M22Tween::EASE_IN_OUT);
+	};
+	M22FrameScheduler::MarkDirty();
+	return;
+};
+
+void M22CharacterLayer::Scale(int _slot, float _scale, Uint32 _ms)
+{
+	if(_slot < 0 || _slot >= CHARACTER_SLOTS || !M22CharacterLayer::SLOTS[_slot].used)
+	{
+		return;
+	};
+	M22Tween::Start(&M22CharacterLayer::SLOTS[_slot].scale, _scale, _ms, M22Tween::EASE_IN_OUT);
+	M22FrameScheduler::MarkDirty();
+	return;
+};
+
+void M22CharacterLayer::SetDepth(int _slot, int _z)
+{
+	if(_slot < 0 || _slot >= CHARACTER_SLOTS || !M22CharacterLayer::SLOTS[_slot].used)
+	{
+		return;
+	};
+	M22CharacterLayer::SLOTS[_slot].z = _z;
+	M22CharacterLayer::SortDrawOrder();
+	M22FrameScheduler::MarkDirty();
+	return;
+};
+
+int M22CharacterLayer::Find(int _character)
+{
+	for(size_t i = 0; i < M22CharacterLayer::COUNT; i++)
+	{
+		const Slot& slot = M22CharacterLayer::SLOTS[M22CharacterLayer::DRAW_ORDER[i]];
+		if(!slot.clearing && slot.character == _character)
+		{
+			return M22CharacterLayer::DRAW_ORDER[i];
+		};
+	};
+	return -1;
+};
+
+void M22CharacterLayer::Update(void)
+{
+	for(size_t i = M22CharacterLayer::COUNT; i > 0; i--)
+	{
+		int slot = M22CharacterLayer::DRAW_ORDER[i - 1];
+		if(M22CharacterLayer::SLOTS[slot].clearing && !M22Tween::IsRunning(&M22CharacterLayer::SLOTS[slot].alpha))
+		{
+			M22CharacterLayer::Release(slot);
+		};
+	};
+	return;
+};
+
+void M22CharacterLayer::Draw(void)
+{
+	M22_PROFILE_SCOPE("M22CharacterLayer::Draw");
+	for(size_t i = 0; i < M22CharacterLayer::COUNT; i++)
+	{
+		const Slot& slot = M22CharacterLayer::SLOTS[M22CharacterLayer::DRAW_ORDER[i]];
+		float width = float(slot.width) * slot.scale;
+		float height = float(slot.height) * slot.scale;
+		SDL_Rect& rect = M22CharacterLayer::RECTS[i];
+		rect.x = int(std::lround(slot.x + (float(slot.width) - width) * 0.5f));
+		rect.y = int(std::lround(slot.y + (float(slot.height) - height)));
+		rect.w = int(std::lround(width));
+		rect.h = int(std::lround(height));
+	};
+	M22Graphics::TransformRects(M22CharacterLayer::TRANSFORM, M22CharacterLayer::RECTS, M22CharacterLayer::COUNT);
+	for(size_t i = 0; i < M22CharacterLayer::COUNT; i++)
+	{
+		const Slot& slot = M22CharacterLayer::SLOTS[M22CharacterLayer::DRAW_ORDER[i]];
+		if(!slot.sprite || slot.alpha < 0.5f)
+		{
+			continue;
+		};
+		// Slots can share a sprite (one fading out as the same expression comes back), so set it every time
+		SDL_SetTextureAlphaMod(slot.sprite, Uint8(std::min(slot.alpha, 255.0f)));
+		SDL_RenderCopy(M22Renderer::SDL_RENDERER, slot.sprite, NULL, &M22CharacterLayer::RECTS[i]);
+	};
+	return;
+};
+
+void M22CharacterLayer::Reset(void)
+{
+	for(size_t i = M22CharacterLayer::COUNT; i > 0; i--)
+	{
+		M22CharacterLayer::Release(M22CharacterLayer::DRAW_ORDER[i - 1]);
+	};
+	return;
+};
+
+void M22CharacterLayer::Release(int _slot)
+{
+	Slot& slot = M22CharacterLayer::SLOTS[_slot];
+	M22Tween::Stop(&slot.alpha);
+	M22Tween::Stop(&slot.x);
+	M22Tween::Stop(&slot.y);
+	M22Tween::Stop(&slot.scale);
+	M22AssetLoader::Release(slot.asset);
+	slot.asset = -1;
+	slot.sprite = NULL;
+	slot.used = false;
+	slot.clearing = false;
+
+	size_t i = 0;
+	while(i < M22CharacterLayer::COUNT && M22CharacterLayer::DRAW_ORDER[i] != _slot)
+	{
+		i++;
+	};
+	if(i < M22CharacterLayer::COUNT)
+	{
+		for(; i + 1 < M22CharacterLayer::COUNT; i++)
+		{
+			M22CharacterLayer::DRAW_ORDER[i] = M22CharacterLayer::DRAW_ORDER[i + 1];
+		};
+		M22CharacterLayer::COUNT--;
+	};
+	M22FrameScheduler::MarkDirty();
+	return;
+};
+
+void M22CharacterLayer::SortDrawOrder(void)
+{
+	// Never more than CHARACTER_SLOTS, and nearly always sorted already
+	for(size_t i = 1; i < M22CharacterLayer::COUNT; i++)
+	{
+		int slot = M22CharacterLayer::DRAW_ORDER[i];
+		const Slot& moving = M22CharacterLayer::SLOTS[slot];
+		size_t k = i;
+		while(k > 0)
+		{
+			const Slot& before = M22CharacterLayer::SLOTS[M22CharacterLayer::DRAW_ORDER[k - 1]];
+			if(before.z < moving.z || (before.z == moving.z && before.order < moving.order))
+			{
+				break;
+			};
+			M22CharacterLayer::DRAW_ORDER[k] = M22CharacterLayer::DRAW_ORDER[k - 1];
+			k--;
+		};
+		M22CharacterLayer::DRAW_ORDER[k] = slot;
+	};
+	return;
+};
@@ -0,0 +1,104 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+int M22Compositor::WIDTH = 0;
+int M22Compositor::HEIGHT = 0;
+bool M22Compositor::BACKGROUND_DIRTY = true;
+
+short int M22Compositor::Initialize(void)
+{
+	// Mouse events come back in logical coordinates too, so the interfaces' hit tests don't need scaling
+	if(SDL_RenderSetLogicalSize(M22Renderer::SDL_RENDERER, int(M22Engine::ScrSize.x()), int(M22Engine::ScrSize.y())) != 0)
+	{
+		printf("[M22Compositor] Failed to set the logical size: %s\n", SDL_GetError());
+	};
+	return M22Compositor::Resize();
+};
+
+short int M22Compositor::Resize(void)
+{
+	int logicalW = int(M22Engine::ScrSize.x()), logicalH = int(M22Engine::ScrSize.y());
+	int outputW = 0, outputH = 0;
+	if(SDL_GetRendererOutputSize(M22Renderer::SDL_RENDERER, &outputW, &outputH) != 0 || outputW <= 0 || outputH <= 0)
+	{
+		outputW = logicalW;
+		outputH = logicalH;
+	};
+	// The art is authored at the logical size, so a bigger window gets nothing from bigger layers
+	float scale = std::min(1.0f, std::min(float(outputW) / float(logicalW), float(outputH) / float(logicalH)));
+	int width = std::max(1, int(std::lround(float(logicalW) * scale)));
+	int height = std::max(1, int(std::lround(float(logicalH) * scale)));
+	if(width == M22Compositor::WIDTH && height == M22Compositor::HEIGHT && M22Graphics::BACKGROUND_RENDER_TARGET != NULL && M22Graphics::NEXT_BACKGROUND_RENDER_TARGET != NULL)
+	{
+		return 0;
+	};
+
+	M22Compositor::Shutdown();
+	M22Compositor::WIDTH = width;
+	M22Compositor::HEIGHT = height;
+	M22Graphics::BACKGROUND_RENDER_TARGET = M22Compositor::CreateLayer();
+	M22Graphics::NEXT_BACKGROUND_RENDER_TARGET = M22Compositor::CreateLayer();
+	if(M22Graphics::BACKGROUND_RENDER_TARGET == NULL || M22Graphics::NEXT_BACKGROUND_RENDER_TARGET == NULL)
+	{
+		printf("[M22Compositor] Failed to create the %ix%i background layers: %s\n", width, height, SDL_GetError());
+		return -1;
+	};
+	printf("[M22Compositor] Layers are %ix%i for a %ix%i output\n", width, height, outputW, outputH);
+	M22Compositor::Invalidate();
+	return 0;
+};
+
+SDL_Texture* M22Compositor::CreateLayer(void)
+{
+	SDL_Texture* layer = SDL_CreateTexture(M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, M22Compositor::WIDTH, M22Compositor::HEIGHT);
+	if(layer != NULL)
+	{
+		SDL_SetTextureBlendMode(layer, SDL_BLENDMODE_BLEND);
+	};
+	return layer;
+};
+
+void M22Compositor::Begin(SDL_Texture* _layer)
+{
+	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, _layer);
+	if(_layer != NULL)
+	{
+		// Targets start at a scale of 1; setting the screen back to NULL puts its logical scaling back too
+		SDL_RenderSetScale(M22Renderer::SDL_RENDERER, float(M22Compositor::WIDTH) / float(M22Engine::ScrSize.x()), float(M22Compositor::HEIGHT) / float(M22Engine::ScrSize.y()));
+	};
+	return;
+};
+
+void M22Compositor::End(void)
+{
+	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
+	return;
+};
+
+void M22Compositor::Invalidate(void)
+{
+	M22Compositor::BACKGROUND_DIRTY = true;
+	M22TextLayer::Invalidate();
+	M22FrameScheduler::MarkDirty();
+	return;
+};
+
+void M22Compositor::Shutdown(void)
+{
+	if(M22Graphics::BACKGROUND_RENDER_TARGET != NULL)
+	{
+		SDL_DestroyTexture(M22Graphics::BACKGROUND_RENDER_TARGET);
+		M22Graphics::BACKGROUND_RENDER_TARGET = NULL;
+	};
+	if(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET != NULL)
+	{
+		SDL_DestroyTexture(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
+		M22Graphics::NEXT_BACKGROUND_RENDER_TARGET = NULL;
+	};
+	// M22TextLayer makes its layer again at the new size the next time it draws
+	M22TextLayer::Shutdown();
+	M22Compositor::WIDTH = 0;
+	M22Compositor::HEIGHT = 0;
+	return;
+};
@@ -54,20 +54,22 @@ void M22Engine::StartGame(void)
 			M22Engine::ACTIVE_BACKGROUNDS[0].name = "graphics/backgrounds/BLACK.webp";
 			M22Engine::ACTIVE_BACKGROUNDS[1].name = "graphics/backgrounds/BLACK.webp";
 
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
+			M22Compositor::Begin(M22Graphics::BACKGROUND_RENDER_TARGET);
 			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUNDS[i], NULL, NULL);
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
+			M22Compositor::End();
 
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
+			M22Compositor::Begin(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
 			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUNDS[i], NULL, NULL);
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
+			M22Compositor::End();
 
 			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
 			break;
 		};
 	};
 	M22Engine::LMB_Pressed = false;
+	M22History::Reset();
 	M22ScriptCompiler::CompileLoadScriptFile("START_SCRIPT.txt");
+	M22Prefetcher::Update(0);
 	M22Script::ChangeLine(0);
 	M22Interface::activeInterfaces.push_back(&M22Interface::storedInterfaces[0]);
 	return;
@@ -75,20 +77,13 @@ void M22Engine::StartGame(void)
 
 int M22Engine::GetBackgroundIDFromName(std::string _name)
 {
-	for(size_t i = 0; i < M22Graphics::backgroundIndex.size(); i++)
+	std::string tempPath = "graphics/backgrounds/";
+	tempPath += _name;
+	if (_name.size() >= 5 && _name.at(_name.size() - 5) != '.')
 	{
-		std::string tempPath = "graphics/backgrounds/";
-		tempPath += _name;
-		if (_name.size() >= 5 && _name.at(_name.size() - 5) != '.')
-		{
-			tempPath += ".png";
-		};
-		if(tempPath == M22Graphics::backgroundIndex.at(i))
-		{
-			return i;
-		};
+		tempPath += ".png";
 	};
-	return -1;
+	return M22AssetRegistry::Lookup(M22AssetRegistry::BACKGROUND, tempPath);
 };
 
 void M22Engine::DestroySDLTextureVector(std::vector<SDL_Texture*>& _vector)
@@ -129,6 +124,23 @@ void M22Engine::FreeMusicVector(std::vector<Mix_Music*>& _vector)
 
 void M22Engine::Shutdown()
 {
+	// Stop the decoding threads before SDL goes away; this also frees the script textures
+	M22Script::SaveReadLines("READLINES.SAV");
+	M22SaveState::Flush();
+	M22Prefetcher::Reset();
+	// Let go of the character sprites while the loader can still take them back
+	M22CharacterLayer::Reset();
+	M22Tween::Reset();
+	M22GlyphCache::Reset();
+	M22AssetLoader::Shutdown();
+	M22Compositor::Shutdown();
+	M22Script::ReleaseDecisionTextures();
+	// The text frame, arrow, buttons and character frames are all on atlas pages
+	M22Atlas::Shutdown();
+	// The sprite sheets go with their M22Sprite
+	M22Graphics::ACTIVE_SPRITES.clear();
+	M22Graphics::LOADED_SPRITES.clear();
+
 	SDL_Quit();
 
 	// M22Renderer
@@ -138,11 +150,11 @@ void M22Engine::Shutdown()
 	M22Renderer::SDL_SCREEN = NULL;
 
 	// M22Graphics
-	M22Engine::DestroySDLTextureVector(M22Graphics::BACKGROUNDS);
-	M22Engine::DestroySDLTextureVector(M22Graphics::characterFrameHeaders);
+	M22Graphics::BACKGROUNDS.clear();
+	M22Graphics::characterFrameHeaders.clear();
 	M22Engine::DestroySDLTextureVector(M22Graphics::mainMenuBackgrounds);
-	SDL_DestroyTexture(M22Graphics::textFrame);
-		M22Graphics::textFrame = NULL;
+	M22Graphics::textFrame = NULL;
+	M22Graphics::arrow.sprite = NULL;
 	SDL_DestroyTexture(M22Graphics::activeMenuBackground.sprite);
 		M22Graphics::activeMenuBackground.sprite = NULL;
 	SDL_DestroyTexture(M22Graphics::menuLogo.sprite);
@@ -167,17 +179,21 @@ void M22Engine::Shutdown()
 	{
 		M22Engine::CHARACTERS_ARRAY.at(i).emotions.clear();
 		M22Engine::CHARACTERS_ARRAY.at(i).outfits.clear();
-		for(size_t spr = 0; spr < M22Engine::CHARACTERS_ARRAY.at(i).sprites.size(); spr++)
-		{
-			M22Engine::DestroySDLTextureVector(M22Engine::CHARACTERS_ARRAY.at(i).sprites.at(spr));
-		};
+		M22Engine::CHARACTERS_ARRAY.at(i).sprites.clear();
 	};
 	M22Engine::CHARACTERS_ARRAY.clear();
+	for(int i = 0; i < M22AssetRegistry::NUMBER_OF_KINDS; i++)
+	{
+		M22AssetRegistry::Unbind(M22AssetRegistry::KINDS(i));
+	};
 
 	M22Lua::Shutdown();
 	TTF_Quit();
 	Mix_Quit();
 	IMG_Quit();
+
+	// Nothing read out of the archives is left open by now
+	M22Archive::Shutdown();
 	return;
 };
 
@@ -207,6 +223,11 @@ short int M22Engine::InitializeSDL(const std::string _windowTitle, Vec2 ScrPos)
 	srand((unsigned int)time(NULL));
 	SDL_Init( SDL_INIT_EVERYTHING );
 	SDL_SetHint (SDL_HINT_RENDER_DRIVER, RENDERING_API);
+	// Asking for a driver turns SDL's render batching off unless it's asked for too; sprites sharing a sheet rely on it
+	SDL_SetHint (SDL_HINT_RENDER_BATCHING, "1");
+	// Prefer vsync, as SDL_RENDERER_PRESENTVSYNC below does; some drivers only go by the hint. M22FrameScheduler
+	// paces frames with the timer if the renderer still comes back without it
+	SDL_SetHint (SDL_HINT_RENDER_VSYNC, "1");
 	std::string tempTitle = _windowTitle;
 	tempTitle += M22Engine::M22VERSION;
 
@@ -225,7 +246,6 @@ short int M22Engine::InitializeSDL(const std::string _windowTitle, Vec2 ScrPos)
 	};
 
     M22Renderer::SDL_RENDERER = SDL_CreateRenderer(M22Renderer::SDL_SCREEN, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
-	//SDL_RenderSetLogicalSize(M22Renderer::SDL_RENDERER, (int)M22Engine::ScrSize.x(), (int)M22Engine::ScrSize.y());
 	if( Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 4096 ) < 0 )
 	{
 		printf( "SDL_mixer failed to init! Error: %s\n", Mix_GetError() );
@@ -258,13 +278,26 @@ short int M22Engine::InitializeSDL(const std::string _windowTitle, Vec2 ScrPos)
 
 void M22Engine::UpdateEvents(void)
 {
+	M22_PROFILE_SCOPE("UpdateEvents");
 	while( SDL_PollEvent( &M22Engine::SDL_EVENTS ) )
 	{
+		// Any input might change what's on screen (hover states, key presses...), so draw the next frame
+		M22FrameScheduler::MarkDirty();
 		switch( M22Engine::SDL_EVENTS.type )
 		{
 			case SDL_QUIT:
 				M22Engine::QUIT = true;
 				break;
+			case SDL_RENDER_TARGETS_RESET:
+			case SDL_RENDER_DEVICE_RESET:
+				M22Compositor::Invalidate();
+				break;
+			case SDL_WINDOWEVENT:
+				if(M22Engine::SDL_EVENTS.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+				{
+					M22Compositor::Resize();
+				};
+				break;
 			case SDL_MOUSEMOTION:
 				M22Engine::MousePos.x(M22Engine::SDL_EVENTS.motion.x);
 				M22Engine::MousePos.y(M22Engine::SDL_EVENTS.motion.y);
@@ -281,7 +314,46 @@ void M22Engine::UpdateEvents(void)
 					M22Engine::LMB_Pressed = false;
 				};
 				break;
+			case SDL_MOUSEWHEEL:
+				if(M22Engine::SDL_EVENTS.wheel.y > 0 && M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME && !M22Interface::menuOpen)
+				{
+					M22History::Rewind(1);
+				};
+				break;
 			case SDL_KEYDOWN:
+#if M22_PROFILING
+				if(M22Engine::SDL_EVENTS.key.keysym.scancode == PROFILER_OVERLAY_KEY)
+				{
+					if(M22Engine::SDL_EVENTS.key.repeat == 0) M22Profiler::VISIBLE = !M22Profiler::VISIBLE;
+					break;
+				}
+				else if(M22Engine::SDL_EVENTS.key.keysym.scancode == PROFILER_DUMP_KEY)
+				{
+					if(M22Engine::SDL_EVENTS.key.repeat == 0)
+					{
+						M22Profiler::DumpCSV("profile.csv");
+						M22Profiler::DumpChromeTrace("profile.json");
+					};
+					break;
+				};
+#endif
+				if((M22Engine::SDL_EVENTS.key.keysym.scancode == QUICKSAVE_KEY || M22Engine::SDL_EVENTS.key.keysym.scancode == QUICKLOAD_KEY) && M22Engine::SDL_EVENTS.key.repeat == 0)
+				{
+					if(M22Engine::SDL_EVENTS.key.keysym.scancode == QUICKLOAD_KEY)
+					{
+						M22Engine::LoadGame(QUICKSAVE_FILENAME);
+					}
+					else if(M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME)
+					{
+						M22Engine::SaveGame(QUICKSAVE_FILENAME);
+					};
+					break;
+				};
+				if(M22Engine::SDL_EVENTS.key.keysym.scancode == HISTORY_REWIND_KEY)
+				{
+					if(M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME && !M22Interface::menuOpen) M22History::Rewind(1);
+					break;
+				};
 				if(M22Engine::SDL_EVENTS.key.keysym.scancode == SDL_SCANCODE_RSHIFT && M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME && M22Graphics::changeQueued == M22Graphics::BACKGROUND_UPDATE_TYPES::NONE && M22Script::currentLineType != M22Script::LINETYPE::MAKE_DECISION)
 				{
 					M22Engine::skipping = true;
@@ -319,60 +391,72 @@ void M22Engine::UpdateKeyboard()
 	if(M22Engine::SDL_KEYBOARDSTATE[SDL_SCANCODE_RETURN] && M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME && M22Script::currentLineType != M22Script::LINETYPE::MAKE_DECISION)
 	{
 		M22Interface::DRAW_TEXT_AREA = true;
-		if (M22Script::updateCurrentLine == true)
-		{
-			for (size_t i = M22Script::typewriter_currPos; i < M22Script::currentLine_w.size(); i++)
-			{
-				M22Script::typewriter_text += M22Script::currentLine_w.at(i);
-			}
-			M22Script::typewriter_currPos = M22Script::currentLine_w.size();
-		}
-		else
-		{
-			M22Script::ChangeLine(++M22Script::currentLineIndex);
-		}
+		M22Script::Advance();
 	};
 
-	if(M22Script::currentLineType == M22Script::LINETYPE::MAKE_DECISION)
+	if(M22Script::currentLineType == M22Script::LINETYPE::MAKE_DECISION && M22Script::activeDecision != -1)
 	{
-		bool inputmade = false;
+		// The keys pick by position; activeChoices maps that to the choice's ID
+		int selectedSlot = -1;
 
 		if(M22Engine::SDL_KEYBOARDSTATE[SDL_SCANCODE_1])
 		{
-			M22Script::gameDecisions.back().selectedOption = 0;
-			inputmade = true;
-			M22Sound::PlaySting("sfx/stings/SE001.OGG", true);
+			selectedSlot = 0;
 		}
 		else if(M22Engine::SDL_KEYBOARDSTATE[SDL_SCANCODE_2])
 		{
-			M22Script::gameDecisions.back().selectedOption = 1;
-			inputmade = true;
-			M22Sound::PlaySting("sfx/stings/SE001.OGG", true);
+			selectedSlot = 1;
 		}
 		else if(M22Engine::SDL_KEYBOARDSTATE[SDL_SCANCODE_3])
 		{
-			if(M22Script::gameDecisions.back().num_of_choices < 3)
-			{
-				printf("[M22Script] Option 3 selected but less than two available!\n");
-				return;
-			}
-			else
-			{
-				M22Script::gameDecisions.back().selectedOption = 2;
-				inputmade = true;
-			};
-			M22Sound::PlaySting("sfx/stings/SE001.OGG", true);
+			selectedSlot = 2;
 		};
 		
-		if(inputmade == true)
+		if(selectedSlot != -1)
 		{
-			M22Script::ChangeLine(++M22Script::currentLineIndex);
+			M22Script::SelectChoice(selectedSlot);
 		};
 	};
 
 	return;
 };
 
+void M22Engine::FastForward(Uint32 _budgetMs)
+{
+	// Always at least one line, so skipping never stalls on a slow frame
+	Uint32 start = SDL_GetTicks();
+	do
+	{
+		if(M22Script::currentLineType == M22Script::LINETYPE::MAKE_DECISION || (size_t)(M22Script::currentLineIndex + 1) >= M22ScriptCompiler::currentScript_c.size())
+		{
+			M22Engine::skipping = false;
+			break;
+		};
+
+		// Whatever the current line was waiting on is done with
+		M22Graphics::CompleteTransition();
+		M22Engine::TIMER_CURR = 0;
+		M22Engine::TIMER_TARGET = 0;
+		M22Script::FinishLine();
+		M22Script::ChangeLine(++M22Script::currentLineIndex);
+
+		// Backgrounds and characters the new line brought up go straight to their final state
+		M22Graphics::CompleteTransition();
+
+		if(M22Engine::OPTIONS.SKIP_UNREAD == 0 && M22Script::currentLineUnread)
+		{
+			printf("[M22Engine] Stopped skipping at unread line %i of %s\n", M22Script::currentLineIndex, M22Script::currentScriptFileName.c_str());
+			M22Engine::skipping = false;
+		};
+	} while(M22Engine::skipping && !M22Engine::QUIT && M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME && (SDL_GetTicks() - start) < _budgetMs);
+	// ChangeLine leaves the prefetching alone while skipping, so look ahead from wherever this frame got to
+	if(M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME)
+	{
+		M22Prefetcher::Update(M22Script::currentLineIndex + 1);
+	};
+	return;
+};
+
 void M22Engine::UpdateDeltaTime(void)
 {
 	Uint32 now = SDL_GetTicks();  
@@ -388,36 +472,44 @@ M22Engine::Character M22Engine::CreateCharacter(std::string _name)
 	return tempChar;
 };
 
-short int M22Engine::InitializeM22(int ScrW, int ScrH)
+short int M22Engine::LoadCharacterNames(const char* _filename)
 {
-	printf("[M22Engine] Initializing M22...\n");
-
-	std::fstream input("scripts/CHARACTER_NAMES.txt");
-	int length;
+	printf("[M22Engine] Loading \"%s\"...\n", _filename);
+	std::stringstream input;
 	std::string temp;
-	
-	printf("[M22Engine] Loading \"graphics/characters/CHARACTERS.txt\"...\n");
-	input.open("graphics/characters/CHARACTERS.txt");
-	if(input)
+	if(M22Archive::OpenStream(_filename, input))
 	{
-		length=int(std::count(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>(), '\n'));
+		int length=int(std::count(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>(), '\n'));
 		length++; // Linecount is number of '\n' + 1
 		input.seekg(0, std::ios::beg);
 		M22Engine::CHARACTERS_ARRAY.clear();
+		M22AssetRegistry::Unbind(M22AssetRegistry::CHARACTER);
 		for(int i = 0; i < length; i++)
 		{
 			getline(input,temp);
 			M22Engine::Character tempChar;
 			tempChar.name = temp;
 			M22Engine::CHARACTERS_ARRAY.push_back(tempChar);
+			M22AssetRegistry::Bind(M22AssetRegistry::CHARACTER, tempChar.name, i);
 		};
 	}
 	else
 	{
-		printf("[M22Engine] Failed to load: \"graphics/characters/CHARACTERS.txt\" \n ");
+		printf("[M22Engine] Failed to load: \"%s\" \n ", _filename);
 		return -1;
 	};
-	input.close();
+	return 0;
+};
+
+short int M22Engine::InitializeM22(int ScrW, int ScrH)
+{
+	printf("[M22Engine] Initializing M22...\n");
+
+	std::stringstream input;
+	int length;
+	std::string temp;
+	
+	length = int(M22Engine::CHARACTERS_ARRAY.size());
 	//
 	printf("[M22Engine] Loading character text frames...\n");
 	for(int i = 0; i < length; i++)
@@ -426,14 +518,12 @@ short int M22Engine::InitializeM22(int ScrW, int ScrH)
 		temp = "graphics/text_frames/";
 		temp += M22Engine::CHARACTERS_ARRAY.at(i).name;
 		temp += ".png";
-		SDL_Texture* tempTexture = IMG_LoadTexture(M22Renderer::SDL_RENDERER, temp.c_str());
-		M22Graphics::characterFrameHeaders.push_back(tempTexture);
+		M22Graphics::characterFrameHeaders.push_back(M22Atlas::Load(temp));
 		temp.clear();
 	};
 	
 	printf("[M22Engine] Loading main menu backgrounds...\n");
-	input.open("graphics/mainmenu/BACKGROUNDS.txt");
-	if(input)
+	if(M22Archive::OpenStream("graphics/mainmenu/BACKGROUNDS.txt", input))
 	{
 		input >> length;
 		getline(input,temp);
@@ -443,7 +533,7 @@ short int M22Engine::InitializeM22(int ScrW, int ScrH)
 			std::string tempStr = "graphics/mainmenu/";
 			tempStr += std::to_string(i);
 			tempStr += ".webp";
-			SDL_Texture* tempBackground = IMG_LoadTexture(M22Renderer::SDL_RENDERER, tempStr.c_str());
+			SDL_Texture* tempBackground = M22Renderer::LoadTexture(tempStr);
 			SDL_SetTextureAlphaMod( tempBackground, 0 );
 			SDL_SetTextureBlendMode(tempBackground, SDL_BLENDMODE_BLEND);
 			M22Graphics::mainMenuBackgrounds.push_back(tempBackground);
@@ -454,10 +544,9 @@ short int M22Engine::InitializeM22(int ScrW, int ScrH)
 		std::cout << "Failed to load script file: " << "graphics/mainmenu/BACKGROUNDS.txt" << std::endl;
 		return -1;
 	};
-	input.close();
 	
 	M22Graphics::activeMenuBackground.sprite = M22Graphics::mainMenuBackgrounds[rand()%M22Graphics::mainMenuBackgrounds.size()];
-	M22Graphics::menuLogo.sprite = IMG_LoadTexture(M22Renderer::SDL_RENDERER, "graphics/mainmenu/LOGO.webp");
+	M22Graphics::menuLogo.sprite = M22Renderer::LoadTexture("graphics/mainmenu/LOGO.webp");
 	SDL_SetTextureAlphaMod( M22Graphics::menuLogo.sprite, 0 );
 	SDL_SetTextureBlendMode(M22Graphics::menuLogo.sprite, SDL_BLENDMODE_BLEND);
 	if(!M22Graphics::menuLogo.sprite) printf("Failed to load LOGO.png\n");
@@ -465,90 +554,92 @@ short int M22Engine::InitializeM22(int ScrW, int ScrH)
 	M22Script::fontSize = (((float(ScrW) / 1920.0f) + (float(ScrH) / 1080.0f)) / 2.0f);
 
 	M22Engine::ACTIVE_BACKGROUNDS.resize(2);
-	M22Graphics::arrow.sprite = IMG_LoadTexture(M22Renderer::SDL_RENDERER, "graphics/arrow.png");
-	M22Graphics::OPTION_BAR = IMG_LoadTexture(M22Renderer::SDL_RENDERER, "graphics/optionsmenu/bar.png");
+	M22Atlas::Region arrowRegion = M22Atlas::Load("graphics/arrow.png");
+	M22Graphics::arrow.sprite = arrowRegion.texture;
+	M22Graphics::arrow.rect = arrowRegion.rect;
+	M22Graphics::OPTION_BAR = M22Renderer::LoadTexture("graphics/optionsmenu/bar.png");
 	return 0;
 };
 
-int M22Engine::GetCharacterIndexFromName(std::wstring _input, bool _dialogue)
+short int M22Engine::PreloadM22(void)
 {
-	std::string temp = M22Script::to_string(_input);
-	temp.erase(std::remove_if(temp.begin(), temp.end(), isspace));
-	_input = M22Script::to_wstring(temp.c_str());
-	int size = _input.size();
-	_input.erase(std::remove_if(_input.begin(), _input.end(), M22Script::isColon));
-	if(size == _input.size() && _dialogue == true)
+	if(M22Engine::LoadCharacterNames() != 0)
 	{
-		// colon was not found, so must be narrative, not dialogue
-		return 0;
+		return -1;
 	};
+	// Anything that fails to decode here is tried again (and reported) by InitializeM22
 	for(size_t i = 0; i < M22Engine::CHARACTERS_ARRAY.size(); i++)
 	{
-		if(M22Script::to_wstring(M22Engine::CHARACTERS_ARRAY[i].name.c_str()) == _input)
-		{
-			return i;
-		};
+		M22Startup::DecodeImage("graphics/text_frames/" + M22Engine::CHARACTERS_ARRAY.at(i).name + ".png");
+	};
+	std::stringstream input;
+	int length = 0;
+	if(M22Archive::OpenStream("graphics/mainmenu/BACKGROUNDS.txt", input))
+	{
+		input >> length;
+	};
+	for(int i = 0; i < length; i++)
+	{
+		M22Startup::DecodeImage("graphics/mainmenu/" + std::to_string(i) + ".webp");
 	};
-	return -1;
+	M22Startup::DecodeImage("graphics/mainmenu/LOGO.webp");
+	M22Startup::DecodeImage("graphics/arrow.png");
+	M22Startup::DecodeImage("graphics/optionsmenu/bar.png");
+	return 0;
 };
 
-int M22Engine::GetCharacterIndexFromName(std::string _input, bool _dialogue)
+int M22Engine::GetCharacterIndexFromName(std::string_view _input, bool _dialogue)
 {
-	if(M22Engine::CHARACTERS_ARRAY.size() == 0) return -1;
-	_input.erase(std::remove_if(_input.begin(), _input.end(), isspace));
-	int size = _input.size();
-	_input.erase(std::remove_if(_input.begin(), _input.end(), M22Script::isColon));
-	if(size == _input.size() && _dialogue == true)
-	{
-		// colon was not found, so must be narrative, not dialogue
-		return 0;
-	};
-	for(size_t i = 0; i < M22Engine::CHARACTERS_ARRAY.size(); i++)
+	// Whitespace and the colon after a speaker's name aren't part of it
+	std::string name;
+	name.reserve(_input.size());
+	bool colon = false;
+	for(size_t i = 0; i < _input.size(); i++)
 	{
-		if(M22Engine::CHARACTERS_ARRAY[i].name == _input)
+		if(M22Script::isColon(_input[i]))
 		{
-			return i;
+			colon = true;
+		}
+		else if(!isspace((unsigned char)_input[i]))
+		{
+			name += _input[i];
 		};
 	};
-	return -1;
+	if(!colon && _dialogue == true)
+	{
+		// colon was not found, so must be narrative, not dialogue
+		return 0;
+	};
+	if(M22Engine::CHARACTERS_ARRAY.size() == 0) return -1;
+	return M22AssetRegistry::Lookup(M22AssetRegistry::CHARACTER, name);
 };
 
 int M22Engine::GetOutfitIndexFromName(std::string _input, int _charIndex)
 {
 	if(M22Engine::CHARACTERS_ARRAY.size() == 0 || _charIndex == -1) return -1;
 	_input.erase(std::remove_if(_input.begin(), _input.end(), isspace));
-	for(size_t i = 0; i < M22Engine::CHARACTERS_ARRAY.at(_charIndex).outfits.size(); i++)
-	{
-		if(M22Engine::CHARACTERS_ARRAY.at(_charIndex).outfits[i] == _input)
-		{
-			return i;
-		};
-	};
-	return -1;
+	return M22AssetRegistry::Lookup(M22AssetRegistry::OUTFIT, _input, _charIndex);
 };
 
 int M22Engine::GetEmotionIndexFromName(std::string _input, int _charIndex)
 {
 	if(M22Engine::CHARACTERS_ARRAY.size() == 0 || _charIndex == -1) return -1;
 	_input.erase(std::remove_if(_input.begin(), _input.end(), isspace));
-	for(size_t i = 0; i < M22Engine::CHARACTERS_ARRAY.at(_charIndex).emotions.size(); i++)
-	{
-		if(M22Engine::CHARACTERS_ARRAY[_charIndex].emotions[i] == _input)
-		{
-			return i;
-		};
-	};
-	return -1;
+	return M22AssetRegistry::Lookup(M22AssetRegistry::EMOTION, _input, _charIndex);
 };
 
 void M22Engine::ResetGame(void)
 {
+	M22Script::ReleaseDecisionTextures();
+	M22Prefetcher::Reset();
+	M22History::Reset();
 	M22Interface::activeInterfaces.clear();
 	std::string tempPath = "sfx/music/MENU.OGG";
 	M22Sound::ChangeMusicTrack(tempPath);
 	M22Interface::ResetStoredInterfaces();
 	M22Interface::menuOpen = false;
 	M22Engine::skipping = false;
+	M22Script::SaveReadLines("READLINES.SAV");
 	if(M22Interface::skipButtonState) *M22Interface::skipButtonState = M22Interface::BUTTON_STATES::RESTING;
 	if(M22Interface::menuButtonState) *M22Interface::menuButtonState = M22Interface::BUTTON_STATES::RESTING;
 	SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
@@ -608,70 +699,12 @@ void M22Engine::SaveOptions(void)
 
 void M22Engine::SaveGame(const char* _filename)
 {
-	printf("[M22Engine] Saving game to %s...\n", _filename);
-	std::ofstream savegame(_filename, std::ios::binary | std::ios::out);
-	if(savegame)
-	{
-
-		struct SAVEGAME_STRUCTURE savegameObject;
-		savegameObject.GAMESTATE = M22Engine::GAMESTATE;
-		savegameObject.CURRENTBACKGROUND = M22Engine::ACTIVE_BACKGROUNDS.at(0).name;
-		savegameObject.CURRENTMUSIC = M22Sound::MUSIC_NAMES.at(M22Sound::currentTrack);
-		savegameObject.CURRENTLOOPINGSFX = "sfx/music/SILENCE.OGG";
-		savegameObject.CURRENTSCRIPTFILE = M22Script::currentScriptFileName;
-		savegameObject.CURRENTLINEPOSITION = M22Script::currentLineIndex;
-
-		// save characters on screen?
-
-		savegame << savegameObject.GAMESTATE << '\n' << savegameObject.CURRENTBACKGROUND << '\n' << savegameObject.CURRENTMUSIC << '\n' << savegameObject.CURRENTLOOPINGSFX << '\n' << savegameObject.CURRENTSCRIPTFILE << '\n' << savegameObject.CURRENTLINEPOSITION << '\n';
-
-		savegame.close();
-	};
+	M22SaveState::Save(_filename);
 	return;
 };
 
 void M22Engine::LoadGame(const char* _filename)
 {
-	printf("[M22Engine] Loading game from %s...\n", _filename);
-	std::ifstream savegame(_filename, std::ios::binary | std::ios::in);
-	if(savegame)
-	{
-		//savegame.write( reinterpret_cast <const char*> (&M22Engine::OPTIONS), sizeof(M22Engine::OPTIONS_STRUCTURE) );
-		struct SAVEGAME_STRUCTURE savegameObject;
-		
-		int tempint = 0;
-
-		savegame >> tempint;
-		savegameObject.GAMESTATE = M22Engine::GAMESTATES(tempint);
-		savegame >> savegameObject.CURRENTBACKGROUND;
-		savegame >> savegameObject.CURRENTMUSIC;
-		savegame >> savegameObject.CURRENTLOOPINGSFX;
-		savegame >> savegameObject.CURRENTSCRIPTFILE;
-		savegame >> savegameObject.CURRENTLINEPOSITION;
-
-		savegame.close();
-
-		M22Engine::GAMESTATE = savegameObject.GAMESTATE;
-		M22Script::currentLineIndex = savegameObject.CURRENTLINEPOSITION;
-		M22Sound::ChangeMusicTrack(savegameObject.CURRENTMUSIC);
-		M22Sound::StopLoopedStings();
-		M22Sound::PlayLoopedSting(savegameObject.CURRENTLOOPINGSFX);
-
-		M22ScriptCompiler::CompileLoadScriptFile(savegameObject.CURRENTSCRIPTFILE);
-
-		std::vector<std::wstring> temp;
-		std::wstring backgroundname;
-		M22Script::SplitString(M22Script::to_wstring(savegameObject.CURRENTBACKGROUND.c_str()), temp, '/');
-		backgroundname = temp.back();
-		backgroundname.erase(backgroundname.end()-5,backgroundname.end());
-
-		M22ScriptCompiler::line_c temporaryLineC;
-		temporaryLineC.m_lineType = M22Script::NEW_BACKGROUND;
-		temporaryLineC.m_parameters_txt.push_back(M22Script::to_string(backgroundname));
-		temporaryLineC.m_parameters.push_back(M22Engine::GetBackgroundIDFromName(M22Script::to_string(backgroundname)));
-		M22ScriptCompiler::ExecuteCommand(temporaryLineC, savegameObject.CURRENTLINEPOSITION);
-
-
-	};
+	M22SaveState::Load(_filename);
 	return;
 };
\ No newline at end of file
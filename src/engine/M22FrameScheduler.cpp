@@ -0,0 +1,163 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+Uint64 M22FrameScheduler::FRAME_START = 0;
+double M22FrameScheduler::TARGET_FRAME_MS = 1000.0 / 60.0;
+double M22FrameScheduler::LAST_FRAME_MS = 0.0;
+bool M22FrameScheduler::VSYNC = false;
+bool M22FrameScheduler::DIRTY = true;
+bool M22FrameScheduler::DREW_FRAME = false;
+Uint32 M22FrameScheduler::WAKE_AT = 0;
+Uint32 M22FrameScheduler::WAKE_EVENT = (Uint32)-1;
+
+short int M22FrameScheduler::Initialize(unsigned int _fps)
+{
+	if(_fps == 0)
+	{
+		_fps = 60;
+	};
+	M22FrameScheduler::TARGET_FRAME_MS = 1000.0 / double(_fps);
+	M22FrameScheduler::FRAME_START = SDL_GetPerformanceCounter();
+	M22FrameScheduler::DIRTY = true;
+
+	// M22Engine::InitializeSDL asks for vsync; whether the driver gave it decides if presenting or the timer paces frames
+	SDL_RendererInfo info;
+	if(M22Renderer::SDL_RENDERER != NULL && SDL_GetRendererInfo(M22Renderer::SDL_RENDERER, &info) == 0)
+	{
+		M22FrameScheduler::VSYNC = ((info.flags & SDL_RENDERER_PRESENTVSYNC) != 0);
+	};
+	M22FrameScheduler::WAKE_EVENT = SDL_RegisterEvents(1);
+	printf("[M22FrameScheduler] Targeting %u FPS, vsync %s\n", _fps, (M22FrameScheduler::VSYNC ? "on" : "off"));
+	return 0;
+};
+
+void M22FrameScheduler::WakeAt(Uint32 _ticks)
+{
+	if(M22FrameScheduler::WAKE_AT == 0 || SDL_TICKS_PASSED(M22FrameScheduler::WAKE_AT, _ticks))
+	{
+		M22FrameScheduler::WAKE_AT = (_ticks == 0 ? 1 : _ticks);
+	};
+	return;
+};
+
+void M22FrameScheduler::Wake(void)
+{
+	// SDL_PushEvent is thread-safe; the event itself is ignored, it just ends SDL_WaitEventTimeout
+	if(M22FrameScheduler::WAKE_EVENT != (Uint32)-1)
+	{
+		SDL_Event wake;
+		SDL_memset(&wake, 0, sizeof(wake));
+		wake.type = M22FrameScheduler::WAKE_EVENT;
+		SDL_PushEvent(&wake);
+	};
+	return;
+};
+
+bool M22FrameScheduler::IsAnimating(void)
+{
+	if(M22Engine::skipping || M22Graphics::changeQueued != M22Graphics::BACKGROUND_UPDATE_TYPES::NONE)
+	{
+		return true;
+	};
+
+	if(M22Engine::GAMESTATE == M22Engine::GAMESTATES::MAIN_MENU)
+	{
+		if(M22Graphics::activeMenuBackground.alpha < 255.0f || M22Graphics::menuLogo.alpha < 255.0f)
+		{
+			return true;
+		};
+	}
+	else if(M22Engine::GAMESTATE == M22Engine::GAMESTATES::INGAME)
+	{
+		// The typewriter moves on with time
+		if(M22Interface::DRAW_TEXT_AREA && M22Script::updateCurrentLine)
+		{
+			return true;
+		};
+		for(size_t i = 0; i < M22Graphics::ACTIVE_SPRITES.size(); i++)
+		{
+			if(M22Graphics::ACTIVE_SPRITES.at(i).IsAnimated())
+			{
+				return true;
+			};
+		};
+	};
+
+	// Character fades/slides, and anything else moved by a tween
+	if(M22Tween::Active())
+	{
+		return true;
+	};
+
+	// FadeInAllButtons lerps, so it only ever gets close to 255
+	for(size_t i = 0; i < M22Interface::activeInterfaces.size(); i++)
+	{
+		if(M22Interface::activeInterfaces.at(i)->alpha < 254.5f)
+		{
+			return true;
+		};
+	};
+	return false;
+};
+
+void M22FrameScheduler::WaitForWork(void)
+{
+	if(!M22FrameScheduler::DIRTY && !M22FrameScheduler::IsAnimating())
+	{
+		int timeout = MAX_IDLE_WAIT_MS;
+		if(M22Engine::TIMER_TARGET != 0)
+		{
+			timeout = (M22Engine::TIMER_CURR < M22Engine::TIMER_TARGET ? std::min(timeout, int(M22Engine::TIMER_TARGET - M22Engine::TIMER_CURR)) : 0);
+		};
+		if(M22FrameScheduler::WAKE_AT != 0)
+		{
+			Uint32 now = SDL_GetTicks();
+			timeout = (SDL_TICKS_PASSED(now, M22FrameScheduler::WAKE_AT) ? 0 : std::min(timeout, int(M22FrameScheduler::WAKE_AT - now)));
+		};
+		if(M22GlyphCache::Pending())
+		{
+			// Keep ticking so the glyphs get rendered while nothing else is happening
+			timeout = std::min(timeout, int(M22FrameScheduler::TARGET_FRAME_MS));
+		};
+		if(timeout > 0)
+		{
+			// Leaves the event in the queue for M22Engine::UpdateEvents
+			SDL_WaitEventTimeout(NULL, timeout);
+		};
+	};
+	M22FrameScheduler::FRAME_START = SDL_GetPerformanceCounter();
+	M22FrameScheduler::DREW_FRAME = false;
+	return;
+};
+
+bool M22FrameScheduler::BeginDraw(void)
+{
+	bool wake = (M22FrameScheduler::WAKE_AT != 0 && SDL_TICKS_PASSED(SDL_GetTicks(), M22FrameScheduler::WAKE_AT));
+	if(!M22FrameScheduler::DIRTY && !wake && !M22FrameScheduler::IsAnimating())
+	{
+		return false;
+	};
+	// Anything drawn that wants another frame later asks for it again while drawing
+	M22FrameScheduler::DIRTY = false;
+	M22FrameScheduler::WAKE_AT = 0;
+	M22FrameScheduler::DREW_FRAME = true;
+	return true;
+};
+
+void M22FrameScheduler::EndFrame(void)
+{
+	if(!M22FrameScheduler::DREW_FRAME)
+	{
+		return;
+	};
+
+	// Animations still step once per frame, so hold the target rate even when vsync would present faster
+	double elapsed = double(SDL_GetPerformanceCounter() - M22FrameScheduler::FRAME_START) * 1000.0 / double(SDL_GetPerformanceFrequency());
+	M22FrameScheduler::LAST_FRAME_MS = elapsed;
+	if(elapsed < M22FrameScheduler::TARGET_FRAME_MS)
+	{
+		M22Renderer::Delay((unsigned int)(M22FrameScheduler::TARGET_FRAME_MS - elapsed));
+	};
+	return;
+};
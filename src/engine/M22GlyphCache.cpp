@@ -0,0 +1,89 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::vector<Uint32> M22GlyphCache::PENDING;
+size_t M22GlyphCache::NEXT = 0;
+std::unordered_set<Uint32> M22GlyphCache::SEEN;
+size_t M22GlyphCache::WARMED = 0;
+
+void M22GlyphCache::Collect(std::string_view _text)
+{
+	size_t pos = 0;
+	while(pos < _text.size())
+	{
+		Uint32 codepoint = M22DecodeUTF8(_text, pos);
+		// Whitespace/control characters don't have glyphs worth rendering
+		if(codepoint <= 0x20)
+		{
+			continue;
+		};
+		if(M22GlyphCache::SEEN.insert(codepoint).second)
+		{
+			M22GlyphCache::PENDING.push_back(codepoint);
+		};
+	};
+	return;
+};
+
+void M22GlyphCache::Update(Uint32 _budget)
+{
+	if(!M22GlyphCache::Pending() || M22Script::font == NULL)
+	{
+		return;
+	};
+	M22_PROFILE_SCOPE("M22GlyphCache::Update");
+	Uint32 start = SDL_GetTicks();
+	do
+	{
+		// Measuring a glyph has the font render it into its cache, the same as drawing it would
+		std::string glyph;
+		M22EncodeUTF8(M22GlyphCache::PENDING.at(M22GlyphCache::NEXT++), glyph);
+		M22Script::font->getWidth("%s", glyph.c_str());
+		M22GlyphCache::WARMED++;
+	} while(M22GlyphCache::Pending() && (SDL_GetTicks() - start) < _budget);
+
+	if(!M22GlyphCache::Pending())
+	{
+		size_t pages = 0;
+		size_t bytes = M22GlyphCache::CacheBytes(M22Script::font, &pages);
+		printf("[M22GlyphCache] Rendered %u glyphs ahead of time; the font's cache is %u texture(s), %.1f KB\n", (unsigned int)M22GlyphCache::WARMED, (unsigned int)pages, double(bytes) / 1024.0);
+		M22GlyphCache::PENDING.clear();
+		M22GlyphCache::NEXT = 0;
+	};
+	return;
+};
+
+size_t M22GlyphCache::CacheBytes(NFont* _font, size_t* _pages)
+{
+	size_t bytes = 0, pages = 0;
+	FC_Font* font = (_font != NULL ? _font->getFont() : NULL);
+	if(font != NULL)
+	{
+		for(int i = 0; i < int(FC_GetNumCacheLevels(font)); i++)
+		{
+			int width = 0, height = 0;
+			SDL_Texture* level = FC_GetGlyphCacheLevel(font, i);
+			if(level != NULL && SDL_QueryTexture(level, NULL, NULL, &width, &height) == 0)
+			{
+				// The cache textures are 32-bit RGBA
+				bytes += size_t(width) * size_t(height) * 4;
+				pages++;
+			};
+		};
+	};
+	if(_pages != NULL)
+	{
+		*_pages = pages;
+	};
+	return bytes;
+};
+
+void M22GlyphCache::Reset(void)
+{
+	M22GlyphCache::PENDING.clear();
+	M22GlyphCache::NEXT = 0;
+	M22GlyphCache::SEEN.clear();
+	M22GlyphCache::WARMED = 0;
+	return;
+};
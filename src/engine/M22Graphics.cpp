@@ -4,11 +4,11 @@ using namespace March22;
 
 std::vector<SDL_Texture*> M22Graphics::BACKGROUNDS;
 SDL_Texture* M22Graphics::textFrame;
+SDL_Rect M22Graphics::textFrameRect = {0, 0, 0, 0};
 M22Graphics::ArrowObj M22Graphics::arrow;
-std::vector<SDL_Texture*> M22Graphics::characterFrameHeaders;
+std::vector<M22Atlas::Region> M22Graphics::characterFrameHeaders;
 TTF_Font* M22Graphics::textFont = NULL;
 std::vector<std::string> M22Graphics::backgroundIndex;
-std::vector<M22Engine::CharacterReference> M22Graphics::activeCharacters;
 std::vector<SDL_Texture*> M22Graphics::mainMenuBackgrounds;
 M22Engine::Background M22Graphics::activeMenuBackground;
 M22Engine::Background M22Graphics::menuLogo;
@@ -17,14 +17,55 @@ SDL_Texture* M22Graphics::OPTION_BAR = NULL;
 SDL_Texture* M22Graphics::BACKGROUND_RENDER_TARGET = NULL;
 SDL_Texture* M22Graphics::NEXT_BACKGROUND_RENDER_TARGET = NULL;
 M22Graphics::BACKGROUND_UPDATE_TYPES M22Graphics::changeQueued = M22Graphics::BACKGROUND_UPDATE_TYPES::NONE;
-float M22Graphics::NEXT_BACKGROUND_ALPHA = 0.0f;
-SDL_Rect* M22Graphics::wipePosition;
+float M22Graphics::TRANSITION_PROGRESS = 0.0f;
 SDL_Texture* M22Graphics::wipeBlack;
 SDL_Rect M22Graphics::wipeBlackRect;
 Uint8 M22Graphics::activeTransition = M22Graphics::TRANSITIONS::SWIPE_TO_RIGHT;
-const std::wstring M22Graphics::TRANSITION_NAMES[M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS] = { M22Script::to_wstring("SwipeToRight"), M22Script::to_wstring("SwipeDown"), M22Script::to_wstring("SwipeToLeft"), M22Script::to_wstring("Fade") };
-std::vector<M22Graphics::M22Sprite*> M22Graphics::ACTIVE_SPRITES;
-std::vector<M22Graphics::M22Sprite> M22Graphics::LOADED_SPRITES;
+static_assert(M22KeywordsSorted(M22Graphics::TRANSITION_KEYWORDS), "M22Graphics::TRANSITION_KEYWORDS must be sorted by name");
+static_assert(sizeof(M22Graphics::TRANSITION_KEYWORDS) / sizeof(M22Graphics::TRANSITION_KEYWORDS[0]) == M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS, "Every transition needs a name in M22Graphics::TRANSITION_KEYWORDS");
+
+namespace
+{
+	// The swipes uncover the next background from one edge, the fade brings all of it in at once
+	void DrawSwipeToRight(SDL_Texture* _next, float _t)
+	{
+		M22Graphics::DrawNextBackground(_next, 0.0f, 0.0f, _t, 1.0f);
+		return;
+	};
+
+	void DrawSwipeDown(SDL_Texture* _next, float _t)
+	{
+		M22Graphics::DrawNextBackground(_next, 0.0f, 0.0f, 1.0f, _t);
+		return;
+	};
+
+	void DrawSwipeToLeft(SDL_Texture* _next, float _t)
+	{
+		M22Graphics::DrawNextBackground(_next, 1.0f - _t, 0.0f, 1.0f, 1.0f);
+		return;
+	};
+
+	void DrawFadeIn(SDL_Texture* _next, float _t)
+	{
+		M22Graphics::DrawNextBackground(_next, 0.0f, 0.0f, 1.0f, 1.0f, Uint8(_t * 255.0f));
+		return;
+	};
+}
+
+const M22Graphics::Transition M22Graphics::TRANSITION_TABLE[] =
+{
+	{ DrawSwipeToRight,		TRANSITION_SWIPE_MS },		// SWIPE_TO_RIGHT
+	{ DrawSwipeDown,		TRANSITION_SWIPE_MS },		// SWIPE_DOWN
+	{ DrawSwipeToLeft,		TRANSITION_SWIPE_MS },		// SWIPE_TO_LEFT
+	{ DrawFadeIn,			TRANSITION_FADE_MS },		// FADEIN
+};
+static_assert(sizeof(M22Graphics::TRANSITION_TABLE) / sizeof(M22Graphics::TRANSITION_TABLE[0]) == M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS, "M22Graphics::TRANSITION_TABLE needs an entry for every transition");
+std::vector<M22Graphics::ActiveSprite> M22Graphics::ACTIVE_SPRITES;
+std::deque<M22Graphics::M22Sprite> M22Graphics::LOADED_SPRITES;
+static_assert(M22KeywordsSorted(M22Graphics::ANIMATION_MODE_KEYWORDS), "M22Graphics::ANIMATION_MODE_KEYWORDS must be sorted by name");
+Mat3f M22Graphics::SPRITE_TRANSFORM = Mat3f::Identity();
+std::vector<SDL_Rect> M22Graphics::SPRITE_RECTS;
+static_assert(sizeof(SDL_Rect) == 4 * sizeof(int), "M22Graphics::TransformRects needs SDL_Rects to be 4 ints");
 
 void M22Graphics::FadeToBlackFancy(void)
 {
@@ -33,11 +74,12 @@ void M22Graphics::FadeToBlackFancy(void)
 	bool fadeout = false;
 	if (M22Graphics::BLACK_TEXTURE == NULL)
 	{
-		M22Graphics::BLACK_TEXTURE = IMG_LoadTexture(M22Renderer::SDL_RENDERER, "./graphics/backgrounds/BLACK.webp");
+		M22Graphics::BLACK_TEXTURE = M22Renderer::LoadTexture("./graphics/backgrounds/BLACK.webp");
 		SDL_SetTextureBlendMode(M22Graphics::BLACK_TEXTURE, SDL_BLENDMODE_BLEND);
 		SDL_SetTextureAlphaMod(M22Graphics::BLACK_TEXTURE, 0);
 	}
-	while(fade_to_black_alpha < 255.0f || Mix_PlayingMusic())
+	// Skipping goes straight to black
+	while(!M22Engine::skipping && (fade_to_black_alpha < 255.0f || Mix_PlayingMusic()))
 	{
 		//fade_to_black_alpha = M22Graphics::Lerp( fade_to_black_alpha, 255.0f, DEFAULT_LERP_SPEED / 8);
 		fade_to_black_alpha += 2.0f;
@@ -71,13 +113,13 @@ void M22Graphics::FadeToBlackFancy(void)
 			M22Engine::ACTIVE_BACKGROUNDS[0].sprite = M22Graphics::BACKGROUNDS[i];
 			M22Engine::ACTIVE_BACKGROUNDS[1].sprite = M22Graphics::BACKGROUNDS[i];
 
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
+			M22Compositor::Begin(M22Graphics::BACKGROUND_RENDER_TARGET);
 			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUNDS[i], NULL, NULL);
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
+			M22Compositor::End();
 
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
+			M22Compositor::Begin(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
 			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUNDS[i], NULL, NULL);
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
+			M22Compositor::End();
 
 			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
 			break;
@@ -89,192 +131,362 @@ void M22Graphics::FadeToBlackFancy(void)
 
 void M22Graphics::DrawInGame(bool _draw_black)
 {
-	switch(M22Graphics::changeQueued)
+	M22_PROFILE_SCOPE("DrawInGame");
+	if(M22Compositor::BACKGROUND_DIRTY)
 	{
-		case NONE:
-			break;
-		case BACKGROUND:
-			switch(M22Graphics::activeTransition)
+		M22Graphics::RedrawBackgroundLayers();
+	};
+	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
+	if(M22Graphics::changeQueued == BACKGROUND)
+	{
+		M22Graphics::DrawTransition();
+	};
+	// The characters are their own quads over the background, so the background only changes with the background
+	M22CharacterLayer::Draw();
+
+	M22Graphics::DrawSprites();
+
+	if(_draw_black) SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BLACK_TEXTURE, NULL, NULL);
+	//if(M22Graphics::changeQueued == M22Graphics::BACKGROUND_UPDATE_TYPES::NONE || M22ScriptCompiler::CURRENT_LINE->m_lineType == M22Script::LINETYPE::NEW_BACKGROUND_STEALTH) 
+		M22Interface::DrawTextArea((int)M22Engine::ScrSize.x(), (int)M22Engine::ScrSize.y());
+	return;
+};
+
+void M22Graphics::DrawTransition(void)
+{
+	// Drawn straight to the screen over the current background; the layers are only touched once it's done
+	M22Graphics::TRANSITION_TABLE[M22Graphics::activeTransition].draw(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, M22Graphics::TRANSITION_PROGRESS);
+	if(M22Tween::IsRunning(&M22Graphics::TRANSITION_PROGRESS))
+	{
+		return;
+	};
+
+	M22Compositor::Begin(M22Graphics::BACKGROUND_RENDER_TARGET);
+	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
+	M22Compositor::End();
+	M22Graphics::changeQueued = NONE;
+	M22Script::ChangeLine(++M22Script::currentLineIndex);
+	return;
+};
+
+void M22Graphics::DrawNextBackground(SDL_Texture* _next, float _left, float _top, float _right, float _bottom, Uint8 _alpha)
+{
+	if(_next == NULL || _right <= _left || _bottom <= _top || _alpha == 0)
+	{
+		return;
+	};
+	// The layer is the size of the output, the screen is in logical coordinates
+	const float scrW = M22Engine::ScrSize.x(), scrH = M22Engine::ScrSize.y();
+	const float layerW = float(M22Compositor::WIDTH), layerH = float(M22Compositor::HEIGHT);
+	SDL_Rect src = { int(_left * layerW), int(_top * layerH), int(_right * layerW) - int(_left * layerW), int(_bottom * layerH) - int(_top * layerH) };
+	SDL_Rect dst = { int(_left * scrW), int(_top * scrH), int(_right * scrW) - int(_left * scrW), int(_bottom * scrH) - int(_top * scrH) };
+	if(src.w <= 0 || src.h <= 0 || dst.w <= 0 || dst.h <= 0)
+	{
+		return;
+	};
+	SDL_SetTextureAlphaMod(_next, _alpha);
+	SDL_RenderCopy(M22Renderer::SDL_RENDERER, _next, &src, &dst);
+	SDL_SetTextureAlphaMod(_next, 255);
+	return;
+};
+
+void M22Graphics::TransformRects(const Mat3f& _transform, SDL_Rect* _rects, size_t _count)
+{
+	if(_count == 0 || _transform == Mat3f::Identity())
+	{
+		return;
+	};
+	Matrix::TransformRects(_transform, &_rects[0].x, &_rects[0].x, _count);
+	return;
+};
+
+M22Graphics::M22Sprite::M22Sprite(const std::string& _file, SDL_Renderer* _renderer, unsigned short int _num_of_frames)
+{
+	m_name = _file;
+	m_texture = NULL;
+	if(_num_of_frames == 0)
+	{
+		_num_of_frames = 1;
+	};
+
+	std::string tempStr = "./graphics/sprites/" + _file + SPRITE_DEFAULT_FORMAT;
+	SDL_Surface* sheet = IMG_Load_RW(M22Archive::OpenRW(tempStr), 1);
+	if(sheet)
+	{
+		// Frames side by side, all the same width
+		int frameWidth = sheet->w / _num_of_frames;
+		if(sheet->w % _num_of_frames != 0)
+		{
+			printf("[M22Sprite] %s is %ipx wide, which doesn't split into %i frames!\n", tempStr.c_str(), sheet->w, int(_num_of_frames));
+		};
+		for(unsigned short int i = 0; i < _num_of_frames; i++)
+		{
+			SDL_Rect frame = { i * frameWidth, 0, frameWidth, sheet->h };
+			m_frames.push_back(frame);
+		};
+	}
+	else if(_num_of_frames > 1)
+	{
+		// No sheet, so put one together from the separate frames
+		std::vector<SDL_Surface*> loaded(_num_of_frames, NULL);
+		int width = 0, height = 0;
+		for(unsigned short int i = 0; i < _num_of_frames; i++)
+		{
+			tempStr = "./graphics/sprites/" + _file + "_" + std::to_string(i) + SPRITE_DEFAULT_FORMAT;
+			SDL_Surface* frame = IMG_Load_RW(M22Archive::OpenRW(tempStr), 1);
+			if(frame)
 			{
-				case M22Graphics::TRANSITIONS::SWIPE_TO_RIGHT:
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
-					M22Graphics::wipePosition->x += 32;
-					M22Graphics::wipeBlackRect.x = ( ( M22Graphics::wipePosition->x + 1920 ) - (M22Graphics::wipeBlackRect.w/2) );
-
-					SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
-
-					SDL_RenderFillRect(M22Renderer::SDL_RENDERER, M22Graphics::wipePosition);
-			
-					SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
-
-					//SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::wipeBlack, NULL, &M22Graphics::wipeBlackRect);
-
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-
-					if(M22Graphics::wipePosition->x > 56)
-					{
-						M22Graphics::changeQueued = NONE;
-						M22Graphics::wipePosition->x = (0 - 1230);
-						//M22Graphics::wipePosition->y = (0 - 521);
-						SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-						SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-						SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-
-						M22Script::ChangeLine(++M22Script::currentLineIndex);
-					};
-					break;
-				case M22Graphics::TRANSITIONS::SWIPE_TO_LEFT:
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
-					if(M22Graphics::wipePosition->x == -658) M22Graphics::wipePosition->x = 658; // odd number so it can never == 0
-					M22Graphics::wipePosition->x -= 24;
-
-					SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
-
-					SDL_RenderFillRect(M22Renderer::SDL_RENDERER, M22Graphics::wipePosition);
-			
-					SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
-
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-
-					if(M22Graphics::wipePosition->x < -28)
-					{
-						M22Graphics::changeQueued = NONE;
-						M22Graphics::wipePosition->x = (0 - 1938);
-						SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-						SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-						SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-						if(M22ScriptCompiler::CURRENT_LINE->m_lineType != M22Script::LINETYPE::NEW_BACKGROUND_STEALTH)
-							M22Script::ChangeLine(++M22Script::currentLineIndex);
-					};
-					break;
-				case M22Graphics::TRANSITIONS::SWIPE_DOWN:
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
-					M22Graphics::wipePosition->x = 0;
-					if(M22Graphics::wipePosition->y == 0) M22Graphics::wipePosition->y -= 521; // odd number so it can never == 0
-					M22Graphics::wipePosition->y += 8;
-
-					SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
-
-					SDL_RenderFillRect(M22Renderer::SDL_RENDERER, M22Graphics::wipePosition);
-			
-					SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
-
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-
-					if(M22Graphics::wipePosition->y > 28)
-					{
-						M22Graphics::changeQueued = NONE;
-						//M22Graphics::wipePosition->x = (0 - 658);
-						M22Graphics::wipePosition->y = (0 - 521);
-						SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-						SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-						SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-						M22Script::ChangeLine(++M22Script::currentLineIndex);
-					};
-					break;
-				case M22Graphics::TRANSITIONS::FADEIN:
-					M22Graphics::NEXT_BACKGROUND_ALPHA += 3.33f;
-					SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, Uint8(M22Graphics::NEXT_BACKGROUND_ALPHA));
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-					SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-					SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-					if(M22Graphics::NEXT_BACKGROUND_ALPHA > 255.0f)
-					{
-						M22Graphics::changeQueued = NONE;
-						M22Graphics::NEXT_BACKGROUND_ALPHA = 0.0f;
-						M22Script::ChangeLine(++M22Script::currentLineIndex);
-					};
-					break;
-				default:
-					break;
+				loaded.at(i) = SDL_ConvertSurfaceFormat(frame, SDL_PIXELFORMAT_ARGB8888, 0);
+				SDL_FreeSurface(frame);
 			};
-			break;
-		case CHARACTER:
-			M22Graphics::NEXT_BACKGROUND_ALPHA += 8.0f;
-			SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, Uint8(M22Graphics::NEXT_BACKGROUND_ALPHA));
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET);
-			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
-			SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-			if(M22Graphics::NEXT_BACKGROUND_ALPHA > 255.0f)
+			if(!loaded.at(i))
 			{
-				M22Graphics::changeQueued = NONE;
-				M22Graphics::NEXT_BACKGROUND_ALPHA = 0.0f;
+				printf("[M22Sprite] Failed to load sprite file %s!\n", tempStr.c_str());
+				continue;
 			};
-			break;
+			width += loaded.at(i)->w;
+			height = std::max(height, loaded.at(i)->h);
+		};
+		if(width > 0)
+		{
+			sheet = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+		};
+		int x = 0;
+		for(size_t i = 0; i < loaded.size(); i++)
+		{
+			SDL_Rect frame = { x, 0, 0, 0 };
+			if(loaded.at(i))
+			{
+				frame.w = loaded.at(i)->w;
+				frame.h = loaded.at(i)->h;
+				if(sheet)
+				{
+					// Copy the alpha over as it is, rather than blending it onto the blank sheet
+					SDL_SetSurfaceBlendMode(loaded.at(i), SDL_BLENDMODE_NONE);
+					SDL_BlitSurface(loaded.at(i), NULL, sheet, &frame);
+				};
+				SDL_FreeSurface(loaded.at(i));
+			};
+			m_frames.push_back(frame);
+			x += frame.w;
+		};
+	};
+
+	if(sheet)
+	{
+		m_texture = SDL_CreateTextureFromSurface(_renderer, sheet);
+		SDL_FreeSurface(sheet);
+	};
+	if(!m_texture)
+	{
+		printf("[M22Sprite] Failed to load sprite %s!\n", _file.c_str());
+	};
+	if(m_frames.empty())
+	{
+		SDL_Rect frame = { 0, 0, 0, 0 };
+		m_frames.push_back(frame);
+	};
+};
+
+M22Graphics::M22Sprite::~M22Sprite()
+{
+	if(m_texture)
+	{
+		SDL_DestroyTexture(m_texture);
+		m_texture = NULL;
+	};
+};
+
+void M22Graphics::ActiveSprite::Update(Uint32 _ms)
+{
+	if(!IsAnimated())
+	{
+		return;
+	};
+	elapsed += _ms;
+	// Keep looping animations to within one cycle, so they never overflow
+	Uint32 frames = Uint32(sprite->frames());
+	if(mode == LOOP)
+	{
+		elapsed %= frames * frameTime;
+	}
+	else if(mode == PING_PONG)
+	{
+		elapsed %= (2 * frames - 2) * frameTime;
+	};
+	return;
+};
+
+size_t M22Graphics::ActiveSprite::Frame() const
+{
+	size_t frames = sprite->frames();
+	if(frameTime == 0 || frames < 2)
+	{
+		return 0;
+	};
+	size_t step = elapsed / frameTime;
+	switch(mode)
+	{
+		case PING_PONG:
+			step %= (2 * frames - 2);
+			return (step < frames ? step : (2 * frames - 2) - step);
+		case ONCE:
+			return std::min(step, frames - 1);
+		case LOOP:
 		default:
-			break;
+			return step % frames;
 	};
+};
 
-	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BACKGROUND_RENDER_TARGET, NULL, NULL);
+int M22Graphics::LoadSprite(const std::string& _name, unsigned short int _frames)
+{
+	// The same file split into a different number of frames is a different sheet
+	std::string key = _name + ":" + std::to_string(std::max(1, int(_frames)));
+	int index = M22AssetRegistry::Lookup(M22AssetRegistry::SPRITE, key);
+	if(index != -1)
+	{
+		return index;
+	};
+	// Kept even if it failed to load, so it's only tried once and draws as nothing
+	M22Graphics::LOADED_SPRITES.emplace_back(_name, M22Renderer::SDL_RENDERER, _frames);
+	index = int(M22Graphics::LOADED_SPRITES.size() - 1);
+	M22AssetRegistry::Bind(M22AssetRegistry::SPRITE, key, index);
+	return index;
+};
+
+void M22Graphics::ShowSprite(int _sprite, int _x, int _y, M22Graphics::ANIMATION_MODES _mode, Uint32 _frameTime)
+{
+	if(_sprite < 0 || size_t(_sprite) >= M22Graphics::LOADED_SPRITES.size())
+	{
+		return;
+	};
+	ActiveSprite active;
+	active.sprite = &M22Graphics::LOADED_SPRITES.at(_sprite);
+	active.rect.x = _x;
+	active.rect.y = _y;
+	active.rect.w = active.sprite->frame(0).w;
+	active.rect.h = active.sprite->frame(0).h;
+	active.mode = (_mode < NUMBER_OF_ANIMATION_MODES ? _mode : LOOP);
+	active.frameTime = _frameTime;
+	active.elapsed = 0;
+	M22Graphics::ACTIVE_SPRITES.push_back(active);
+	M22FrameScheduler::MarkDirty();
+	return;
+};
 
-	for (size_t i = 0; i < M22Graphics::ACTIVE_SPRITES.size(); i++)
+void M22Graphics::DrawSprites(void)
+{
+	// Move every animation on and transform every rect in one go, then draw them back to back;
+	// sprites sharing a sheet draw with the same texture, so the renderer can batch them
+	M22Graphics::SPRITE_RECTS.resize(M22Graphics::ACTIVE_SPRITES.size());
+	for(size_t i = 0; i < M22Graphics::ACTIVE_SPRITES.size(); i++)
 	{
-		if (M22Graphics::ACTIVE_SPRITES.at(i)->IsAnimated())
+		M22Graphics::ACTIVE_SPRITES.at(i).Update(M22Engine::DELTA_TIME);
+		M22Graphics::SPRITE_RECTS.at(i) = M22Graphics::ACTIVE_SPRITES.at(i).rect;
+	};
+	M22Graphics::TransformRects(M22Graphics::SPRITE_TRANSFORM, M22Graphics::SPRITE_RECTS.data(), M22Graphics::SPRITE_RECTS.size());
+	for(size_t i = 0; i < M22Graphics::ACTIVE_SPRITES.size(); i++)
+	{
+		const ActiveSprite& active = M22Graphics::ACTIVE_SPRITES.at(i);
+		if(active.sprite->texture())
 		{
-			M22Graphics::ACTIVE_SPRITES.at(i)->Update();
+			SDL_RenderCopy(M22Renderer::SDL_RENDERER, active.sprite->texture(), &active.sprite->frame(active.Frame()), &M22Graphics::SPRITE_RECTS.at(i));
 		};
-		M22Graphics::ACTIVE_SPRITES.at(i)->Draw(M22Renderer::SDL_RENDERER);
-	}
+	};
+	return;
+};
 
-	if(_draw_black) SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::BLACK_TEXTURE, NULL, NULL);
-	//if(M22Graphics::changeQueued == M22Graphics::BACKGROUND_UPDATE_TYPES::NONE || M22ScriptCompiler::CURRENT_LINE->m_lineType == M22Script::LINETYPE::NEW_BACKGROUND_STEALTH) 
-		M22Interface::DrawTextArea((int)M22Engine::ScrSize.x(), (int)M22Engine::ScrSize.y());
+void M22Graphics::CompleteTransition(void)
+{
+	// Characters fading/sliding in or out get there straight away too
+	M22Tween::Finish();
+	M22CharacterLayer::Update();
+	if(M22Graphics::changeQueued == NONE)
+	{
+		return;
+	};
+
+	// Every transition ends with the next background copied over the current one
+	SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, 255);
+	M22Compositor::Begin(M22Graphics::BACKGROUND_RENDER_TARGET);
+	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, NULL, NULL);
+	M22Compositor::End();
+	M22Graphics::TRANSITION_PROGRESS = 1.0f;
+	M22Graphics::changeQueued = NONE;
+	M22FrameScheduler::MarkDirty();
 	return;
 };
 
 void M22Graphics::UpdateBackgroundRenderTarget(void)
 {
-	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
+	M22Compositor::Begin(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
 	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
 	SDL_RenderClear(M22Renderer::SDL_RENDERER);
 	
 	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Engine::ACTIVE_BACKGROUNDS[0].sprite, NULL, NULL);
 	SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
 
-	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
+	M22Compositor::End();
 	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
 
+	// A new background takes the characters with it; they fade out as it comes in
+	M22CharacterLayer::Clear();
 	M22Graphics::changeQueued = BACKGROUND;
+	// Timed rather than stepped per frame, so it takes as long at any frame rate
+	M22Graphics::TRANSITION_PROGRESS = 0.0f;
+	M22Tween::Start(&M22Graphics::TRANSITION_PROGRESS, 1.0f, M22Graphics::TRANSITION_TABLE[M22Graphics::activeTransition].duration, M22Tween::LINEAR);
 
 	return;
 };
 
-void M22Graphics::AddCharacterToBackgroundRenderTarget(int _charindex, int _outfitindex, int _emotionindex, int _xPosition, bool _brutal)
+void M22Graphics::RedrawBackgroundLayers(void)
 {
-	int width = 1920, height = 1080;
-
-	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
-	
-	SDL_Rect* tempRect = new SDL_Rect();
-	SDL_QueryTexture(M22Engine::CHARACTERS_ARRAY.at(_charindex).sprites.at(_outfitindex).at(_emotionindex), NULL, NULL, &tempRect->w, &tempRect->h);
-	tempRect->x = _xPosition;
-	tempRect->y = 0;
-	SDL_SetTextureBlendMode(M22Engine::CHARACTERS_ARRAY[_charindex].sprites[_outfitindex][_emotionindex], SDL_BLENDMODE_BLEND);
-	SDL_SetTextureAlphaMod( M22Engine::CHARACTERS_ARRAY[_charindex].sprites[_outfitindex][_emotionindex], 255 );
-	SDL_RenderCopyEx(M22Renderer::SDL_RENDERER, M22Engine::CHARACTERS_ARRAY[_charindex].sprites[_outfitindex][_emotionindex], NULL, tempRect, NULL, NULL, SDL_FLIP_NONE);
-
-	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-	M22Graphics::changeQueued = CHARACTER;
-	delete tempRect;
+	// Both get the new background; a transition that was running carries on from there
+	SDL_Texture* layers[] = { M22Graphics::BACKGROUND_RENDER_TARGET, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET };
+	for(size_t i = 0; i < sizeof(layers) / sizeof(layers[0]); i++)
+	{
+		if(layers[i] == NULL)
+		{
+			continue;
+		};
+		M22Compositor::Begin(layers[i]);
+		SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
+		SDL_RenderClear(M22Renderer::SDL_RENDERER);
+		if(!M22Engine::ACTIVE_BACKGROUNDS.empty() && M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite != NULL)
+		{
+			SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite, NULL, NULL);
+		};
+		M22Compositor::End();
+	};
+	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
+	M22Compositor::BACKGROUND_DIRTY = false;
+	return;
+};
 
+void M22Graphics::ShowBackground(int _asset, const std::string& _name)
+{
+	// Keep the displayed background resident even if the script that drew it gets unloaded
+	M22AssetLoader::Acquire(_asset);
+	M22AssetLoader::Release(M22Engine::ACTIVE_BACKGROUNDS.at(0).asset);
+	M22Engine::ACTIVE_BACKGROUNDS.at(0).asset = _asset;
+	M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite = M22AssetLoader::WaitForTexture(_asset);
+	M22Engine::ACTIVE_BACKGROUNDS.at(0).name = _name;
+	SDL_SetTextureAlphaMod(M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite, 255);
+	SDL_SetTextureAlphaMod(M22Engine::ACTIVE_BACKGROUNDS.at(1).sprite, 255);
+	SDL_SetTextureAlphaMod(M22Graphics::BACKGROUND_RENDER_TARGET, 255);
+	SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, 255);
+	M22Graphics::UpdateBackgroundRenderTarget();
+	SDL_SetTextureAlphaMod(M22Graphics::BACKGROUND_RENDER_TARGET, 255);
+	SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, 255);
 	return;
 };
 
 short int M22Graphics::LoadBackgroundsFromIndex(const char* _filename)
 {
-	M22Graphics::BACKGROUND_RENDER_TARGET = SDL_CreateTexture( M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET , 1920, 1080 );
-	SDL_SetTextureBlendMode(M22Graphics::BACKGROUND_RENDER_TARGET, SDL_BLENDMODE_BLEND);
-	M22Graphics::NEXT_BACKGROUND_RENDER_TARGET = SDL_CreateTexture( M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET , 1920, 1080 );
-	SDL_SetTextureBlendMode(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, SDL_BLENDMODE_BLEND);
-	std::fstream input(_filename);
+	// The render targets are M22Compositor's
+	std::stringstream input;
 	int length;
-	if(input)
+	if(M22Archive::OpenStream(_filename, input))
 	{
 		length=int(std::count(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>(), '\n'));
 		length++; // Linecount is number of '\n' + 1
@@ -284,7 +496,8 @@ short int M22Graphics::LoadBackgroundsFromIndex(const char* _filename)
 			std::string currentfile;
 			input >> currentfile;
 			M22Graphics::backgroundIndex.push_back(currentfile);
-			SDL_Texture *temp = IMG_LoadTexture(M22Renderer::SDL_RENDERER, currentfile.c_str());
+			M22AssetRegistry::Bind(M22AssetRegistry::BACKGROUND, currentfile, int(M22Graphics::backgroundIndex.size() - 1));
+			SDL_Texture *temp = M22Renderer::LoadTexture(currentfile);
 			if(!temp)
 			{
 				std::cout << "Failed to load file: " << currentfile << std::endl;
@@ -296,7 +509,7 @@ short int M22Graphics::LoadBackgroundsFromIndex(const char* _filename)
 			if(currentfile == "graphics/backgrounds/BLACK.webp") 
 			{
 				temp = NULL;
-				temp = IMG_LoadTexture(M22Renderer::SDL_RENDERER, currentfile.c_str());
+				temp = M22Renderer::LoadTexture(currentfile);
 				M22Graphics::BLACK_TEXTURE = temp;
 				SDL_SetTextureBlendMode(M22Graphics::BLACK_TEXTURE, SDL_BLENDMODE_BLEND);
 				SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
@@ -309,7 +522,6 @@ short int M22Graphics::LoadBackgroundsFromIndex(const char* _filename)
 		std::cout << "Failed to load index file: " << _filename << std::endl;
 		return -1;
 	};
-	input.close();
 	return 0;
 };
 
@@ -353,59 +565,6 @@ void M22Graphics::UpdateBackgrounds(void)
 	return;
 };
 
-void M22Graphics::AddActiveCharacter(int _charindex, int _outfitindex, int _emotionindex, int _xPosition, bool _brutal)
-{
-	M22Engine::CharacterReference tempChar;
-	tempChar.sprite = M22Engine::CHARACTERS_ARRAY[_charindex].sprites[_outfitindex][_emotionindex];
-	SDL_QueryTexture(tempChar.sprite, NULL, NULL, &tempChar.rect.w, &tempChar.rect.h);
-	tempChar.rect.x = _xPosition;
-	tempChar.rect.y = 0;
-	if(_brutal)
-	{
-		tempChar.alpha = 255.0f;
-	};
-	M22Graphics::activeCharacters.push_back(tempChar);
-	return;
-};
-
-void M22Graphics::UpdateCharacters(void)
-{
-	if(M22Graphics::activeCharacters.size() == 0)
-	{
-		return;
-	};
-	for(size_t i = 0; i < M22Graphics::activeCharacters.size(); i++)
-	{
-		//int i = k-1;
-		if(M22Graphics::activeCharacters[i].clearing == false)
-		{
-			if(M22Graphics::activeCharacters[i].alpha < 254.5f)
-			{
-				M22Graphics::activeCharacters[i].alpha = M22Graphics::Lerp(M22Graphics::activeCharacters[i].alpha, 255.0f, DEFAULT_LERP_SPEED);
-				SDL_SetTextureAlphaMod(M22Graphics::activeCharacters[i].sprite, Uint8(M22Graphics::activeCharacters[i].alpha) );
-			}
-			else
-			{
-				M22Graphics::activeCharacters[i].alpha = 255.0f;
-				SDL_SetTextureAlphaMod(M22Graphics::activeCharacters[i].sprite, Uint8(M22Graphics::activeCharacters[i].alpha) );
-			};
-		}
-		else
-		{
-			if(M22Graphics::activeCharacters[i].alpha > 0.5f)
-			{
-				M22Graphics::activeCharacters[i].alpha = M22Graphics::Lerp(M22Graphics::activeCharacters[i].alpha, 0.0f, DEFAULT_LERP_SPEED);
-				SDL_SetTextureAlphaMod(M22Graphics::activeCharacters[i].sprite, Uint8(M22Graphics::activeCharacters[i].alpha) );
-			}
-			else
-			{
-				M22Graphics::activeCharacters.erase(M22Graphics::activeCharacters.begin()+i);
-				M22Graphics::activeCharacters.shrink_to_fit();
-			};
-		};
-	};
-};
-
 float M22Graphics::Lerp(float _var1, float _var2, float _t)
 {
 	float tempfl = _var1*(1-_t) + _var2*_t;
@@ -414,22 +573,21 @@ float M22Graphics::Lerp(float _var1, float _var2, float _t)
 
 void M22Graphics::DrawArrow(int ScrW, int ScrH)
 {
-	M22Graphics::arrow.frame = M22Graphics::arrow.frame + ( 1.0f / 10.0f );
-	if(M22Graphics::arrow.frame >= 6.0f)
-	{
-		M22Graphics::arrow.frame = 0.0f;
-	};
+	// Stepped by the clock rather than per frame, so it doesn't keep the frame scheduler awake
+	Uint32 now = SDL_GetTicks();
+	M22Graphics::arrow.frame = float((now / ARROW_FRAME_MS) % 6);
+	M22FrameScheduler::WakeAt(((now / ARROW_FRAME_MS) + 1) * ARROW_FRAME_MS);
 
 	/*
 		These beautiful magic numbers are the ratio of the desired value at the desired aspect ratio.
 		By multiplying by the new resolution, we can get the scale/size/position at any scale (but not aspect)
 	*/
-	SDL_Rect tempSrc = { 22*((int)std::floor(M22Graphics::arrow.frame)+1), 0, 22, 22};
-	SDL_Rect tempDst = { 1920 - 92, 1080 - 92, 0, 0};
-	SDL_QueryTexture(M22Graphics::arrow.sprite, NULL, NULL, &tempDst.w, &tempDst.h);
+	SDL_Rect tempSrc = { M22Graphics::arrow.rect.x + 22*((int)std::floor(M22Graphics::arrow.frame)+1), M22Graphics::arrow.rect.y, 22, 22};
+	SDL_Rect tempDst = { ScrW - 92, ScrH - 92, M22Graphics::arrow.rect.w, M22Graphics::arrow.rect.h};
 
 	tempDst.w /= 7;
 
+	SDL_SetTextureAlphaMod(M22Graphics::arrow.sprite, 255);
 	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::arrow.sprite, &tempSrc, &tempDst);
 	return;
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::vector<M22History::Entry> M22History::RING(HISTORY_LENGTH);
+size_t M22History::FIRST = 0;
+size_t M22History::COUNT = 0;
+size_t M22History::SINCE_KEYFRAME = 0;
+M22SaveState::Snapshot M22History::LAST;
+
+void M22History::Record(void)
+{
+	M22SaveState::Snapshot current;
+	M22SaveState::Capture(current);
+
+	if(M22History::COUNT == HISTORY_LENGTH)
+	{
+		// Full; drop the oldest keyframe, and the deltas that needed it
+		do
+		{
+			M22History::RING.at(M22History::FIRST).data.clear();
+			M22History::FIRST = (M22History::FIRST + 1) % HISTORY_LENGTH;
+			M22History::COUNT--;
+		} while(M22History::COUNT > 0 && !M22History::RING.at(M22History::FIRST).keyframe);
+	};
+
+	Entry& entry = M22History::RING.at(M22History::Slot(M22History::COUNT));
+	entry.keyframe = (M22History::COUNT == 0 || M22History::SINCE_KEYFRAME + 1 >= HISTORY_KEYFRAME_INTERVAL);
+	if(entry.keyframe)
+	{
+		M22SaveState::Encode(current, entry.data);
+		M22History::SINCE_KEYFRAME = 0;
+	}
+	else
+	{
+		M22SaveState::EncodeDelta(M22History::LAST, current, entry.data);
+		M22History::SINCE_KEYFRAME++;
+	};
+	// Slots get reused, so don't let one long page keep its memory forever
+	if(entry.data.capacity() > 2 * entry.data.size())
+	{
+		entry.data.shrink_to_fit();
+	};
+	M22History::COUNT++;
+	M22History::LAST = current;
+	return;
+};
+
+short int M22History::Rewind(unsigned int _lines)
+{
+	if(_lines == 0 || M22History::COUNT < 2)
+	{
+		return -1;
+	};
+	// The newest entry is the line being shown
+	size_t target = (size_t(_lines) < M22History::COUNT ? M22History::COUNT - 1 - _lines : 0);
+	size_t keyframe = target;
+	while(!M22History::RING.at(M22History::Slot(keyframe)).keyframe)
+	{
+		keyframe--;
+	};
+
+	M22SaveState::Snapshot snapshot;
+	const Entry& start = M22History::RING.at(M22History::Slot(keyframe));
+	if(M22SaveState::Decode(start.data.data(), start.data.size(), snapshot) != 0)
+	{
+		printf("[M22History] Failed to decode the snapshot for line %i!\n", int(keyframe));
+		M22History::Reset();
+		return -1;
+	};
+	for(size_t i = keyframe + 1; i <= target; i++)
+	{
+		const Entry& delta = M22History::RING.at(M22History::Slot(i));
+		if(M22SaveState::ApplyDelta(delta.data.data(), delta.data.size(), snapshot) != 0)
+		{
+			printf("[M22History] Failed to decode the delta for line %i!\n", int(i));
+			M22History::Reset();
+			return -1;
+		};
+	};
+
+	// Whatever happens from here on replaces what came after
+	for(size_t i = target + 1; i < M22History::COUNT; i++)
+	{
+		M22History::RING.at(M22History::Slot(i)).data.clear();
+	};
+	M22History::COUNT = target + 1;
+	M22History::SINCE_KEYFRAME = target - keyframe;
+	M22History::LAST = snapshot;
+	return M22SaveState::Apply(snapshot);
+};
+
+size_t M22History::Available(void)
+{
+	return (M22History::COUNT > 0 ? M22History::COUNT - 1 : 0);
+};
+
+void M22History::Reset(void)
+{
+	for(size_t i = 0; i < M22History::RING.size(); i++)
+	{
+		M22History::RING.at(i).data.clear();
+		M22History::RING.at(i).data.shrink_to_fit();
+	};
+	M22History::FIRST = 0;
+	M22History::COUNT = 0;
+	M22History::SINCE_KEYFRAME = 0;
+	M22History::LAST = M22SaveState::Snapshot();
+	return;
+};
@@ -8,7 +8,6 @@ bool M22Interface::DRAW_TEXT_AREA = true;
 M22Interface::BUTTON_STATES* M22Interface::skipButtonState;
 M22Interface::BUTTON_STATES* M22Interface::menuButtonState;
 bool M22Interface::menuOpen = false;
-SDL_Texture* M22Interface::ChatBoxRenderer = NULL;
 
 #define INTERFACE_FADEIN_SPEED 5.0f
 
@@ -24,7 +23,12 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 		_interface->alpha = 255.0f;
 	};
 	_interface->type = _type;
-	std::fstream input(_filename);
+	std::stringstream input;
+	if(!M22Archive::OpenStream(_filename, input))
+	{
+		printf("Failed to load script file: %s\n", _filename.c_str());
+		return -1;
+	};
 	std::string temp;
 	std::vector<std::string> tempStr;
 
@@ -32,7 +36,7 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 	M22Script::SplitString(temp, tempStr, ' ');
 	if(tempStr[1] == "BLANK")
 	{
-		_interface->spriteSheet = IMG_LoadTexture(M22Renderer::SDL_RENDERER, "graphics/BLANK.png");
+		_interface->spriteSheet = M22Renderer::LoadTexture("graphics/BLANK.png");
 	}
 	else
 	{
@@ -42,7 +46,7 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 			temp += directory[i];
 		};
 		temp += tempStr[1];
-		_interface->spriteSheet = IMG_LoadTexture(M22Renderer::SDL_RENDERER, temp.c_str());
+		_interface->spriteSheet = M22Renderer::LoadTexture(temp);
 	};
 
 	if(input)
@@ -71,9 +75,9 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 			tempStr[1].erase(std::remove_if(tempStr[1].begin(), tempStr[1].end(), isspace));
 
 			_interface->buttons.resize(_num_of_buttons);
-			_interface->buttons[k-_startline].sheet = IMG_LoadTexture(M22Renderer::SDL_RENDERER, fileName.c_str());
-			SDL_SetTextureBlendMode(_interface->buttons[k-_startline].sheet, SDL_BLENDMODE_BLEND);
-			SDL_SetTextureAlphaMod( _interface->buttons[k-_startline].sheet, Uint8(_interface->alpha) );
+			// Buttons share atlas pages; the pages are blended, and the alpha is applied as each button is drawn
+			M22Atlas::Region region = M22Atlas::Load(fileName);
+			_interface->buttons[k-_startline].sheet = region.texture;
 			_interface->buttons[k-_startline].name = tempStr[0];
 			if(!_interface->buttons[k-_startline].sheet)
 			{
@@ -90,7 +94,7 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 				_PosY = std::stoi(tempStr[5]);
 				for( int i = 0; i < M22Interface::BUTTON_STATES::NUM_OF_BUTTON_STATES; i++ )
 				{
-					SDL_Rect tempSrc = { 0 , 0 + ( _Y * i ) , _X , _Y };
+					SDL_Rect tempSrc = { region.rect.x , region.rect.y + ( _Y * i ) , _X , _Y };
 					SDL_Rect tempDst = { _PosX , _PosY , _X , _Y };
 					_interface->buttons[k-_startline].rectSrc[i] = tempSrc;
 					_interface->buttons[k-_startline].rectDst[i] = tempDst;
@@ -105,7 +109,7 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 				_PosY = std::stoi(tempStr[5]);
 				for( int i = 0; i < M22Interface::BUTTON_STATES::NUM_OF_BUTTON_STATES; i++ )
 				{
-					SDL_Rect tempSrc = { 0 + ( _X * i ) , 0 , _X , _Y };
+					SDL_Rect tempSrc = { region.rect.x + ( _X * i ) , region.rect.y , _X , _Y };
 					SDL_Rect tempDst = { _PosX , _PosY , _X , _Y };
 					_interface->buttons[k-_startline].rectSrc[i] = tempSrc;
 					_interface->buttons[k-_startline].rectDst[i] = tempDst;
@@ -127,7 +131,6 @@ short int M22Interface::InitializeInterface(M22Interface::Interface* _interface,
 		printf("Failed to load script file: %s", _filename.c_str());
 		return -1;
 	};
-	input.close();
 	return 0;	
 };
 
@@ -169,6 +172,7 @@ void M22Interface::DrawActiveInterfaces(void)
 		};
 		for(size_t k = 0; k < M22Interface::activeInterfaces[i]->buttons.size(); k++)
 		{
+			SDL_SetTextureAlphaMod(M22Interface::activeInterfaces[i]->buttons[k].sheet, Uint8(M22Interface::activeInterfaces[i]->alpha));
 			SDL_RenderCopyEx(
 				M22Renderer::SDL_RENDERER, M22Interface::activeInterfaces[i]->buttons[k].sheet, 
 				&M22Interface::activeInterfaces[i]->buttons[k].rectSrc[M22Interface::activeInterfaces[i]->buttons[k].state], 
@@ -181,36 +185,69 @@ void M22Interface::DrawActiveInterfaces(void)
 	return;
 };
 
-void M22Interface::InitTextBox(void)
+short int M22Interface::PreloadInterface(int _num_of_buttons, int _startline, const std::string _filename)
 {
-	// load texture
-	M22Graphics::textFrame = IMG_LoadTexture(M22Renderer::SDL_RENDERER, "graphics/frame.png");
-
-	// init the render target texture
-	M22Interface::ChatBoxRenderer = SDL_CreateTexture( M22Renderer::SDL_RENDERER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET , 1920, 1080 );
+	std::vector<std::string> directory;
+	M22Script::SplitString(_filename, directory, '/');
+	std::string path;
+	for(size_t i = 0; i < (directory.size()-1); i++)
+	{
+		path += directory[i];
+	};
 
-	// allow alpha channels
-	SDL_SetTextureBlendMode(M22Graphics::textFrame, SDL_BLENDMODE_BLEND);
-	SDL_SetTextureBlendMode(M22Interface::ChatBoxRenderer, SDL_BLENDMODE_BLEND);
+	std::stringstream input;
+	if(!M22Archive::OpenStream(_filename, input))
+	{
+		// InitializeInterface reports it
+		return -1;
+	};
+	std::string temp;
+	std::vector<std::string> tempStr;
+	getline(input,temp);
+	M22Script::SplitString(temp, tempStr, ' ');
+	if(tempStr.size() > 1)
+	{
+		M22Startup::DecodeImage(tempStr[1] == "BLANK" ? std::string("graphics/BLANK.png") : path + tempStr[1]);
+	};
+	for( int i = 0; i < _startline; i++)
+	{
+		getline(input,temp);
+	};
+	for( int k = 0; k < _num_of_buttons && getline(input,temp); k++ )
+	{
+		tempStr.clear();
+		M22Script::SplitString(temp, tempStr, ' ');
+		if(tempStr.empty())
+		{
+			continue;
+		};
+		tempStr[0].erase(std::remove_if(tempStr[0].begin(), tempStr[0].end(), isspace), tempStr[0].end());
+		M22Startup::DecodeImage(path + tempStr[0] + ".webp");
+	};
+	return 0;
+};
 
+void M22Interface::InitTextBox(void)
+{
+	// load texture
+	M22Atlas::Region region = M22Atlas::Load("graphics/frame.png");
+	M22Graphics::textFrame = region.texture;
+	M22Graphics::textFrameRect = region.rect;
 	return;
 };
 
 void M22Interface::DrawTextArea(int _ScrSizeX, int _ScrSizeY)
 {
+	M22_PROFILE_SCOPE("DrawTextArea");
 	if(M22Interface::DRAW_TEXT_AREA == true)
 	{
-		int width = 1920, height = 1080;
-
-		SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Interface::ChatBoxRenderer);
+		// Drawn straight to the screen in logical coordinates; the text itself is cached in M22TextLayer
+		int width = int(M22Engine::ScrSize.x()), height = int(M22Engine::ScrSize.y());
 
-		SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
-		SDL_RenderClear(M22Renderer::SDL_RENDERER);
-		
-		SDL_Rect textbox = {0, 1080, 0, 0};
-		SDL_QueryTexture(M22Graphics::textFrame, NULL, NULL, &textbox.w, &textbox.h);
-		textbox.y = 1080 - textbox.h;
-		SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::textFrame, NULL, &textbox);
+		SDL_Rect textbox = {0, height, M22Graphics::textFrameRect.w, M22Graphics::textFrameRect.h};
+		textbox.y = height - textbox.h;
+		SDL_SetTextureAlphaMod(M22Graphics::textFrame, 255);
+		SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Graphics::textFrame, &M22Graphics::textFrameRect, &textbox);
 
 		//SDL_Rect characterName = {0,552,0,0};
 		//SDL_QueryTexture(M22Graphics::characterFrameHeaders.at(M22Script::activeSpeakerIndex), NULL, NULL, &characterName.w, &characterName.h);
@@ -218,9 +255,9 @@ void M22Interface::DrawTextArea(int _ScrSizeX, int _ScrSizeY)
 
 		M22Graphics::DrawArrow(width, height);
 		
-		if(M22Script::currentLineType == M22Script::LINETYPE::MAKE_DECISION)
+		if(M22Script::currentLineType == M22Script::LINETYPE::MAKE_DECISION && M22Script::activeDecision != -1)
 		{
-			M22Script::DrawDecisions(&M22Script::gameDecisions.back(), _ScrSizeX, _ScrSizeY);
+			M22Script::DrawDecisions(&M22Script::gameDecisions.at(M22Script::activeDecision), _ScrSizeX, _ScrSizeY);
 		}
 		else
 		{
@@ -246,9 +283,6 @@ void M22Interface::DrawTextArea(int _ScrSizeX, int _ScrSizeY)
 		};
 		//M22Interface::DrawActiveInterfacesButtons();
 
-		SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-
-		SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Interface::ChatBoxRenderer, NULL, NULL);
 		SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
 	};
 	return;
@@ -268,19 +302,12 @@ void M22Interface::UpdateActiveInterfaces(int _ScrSizeX, int _ScrSizeY)
 
 		for(size_t k = 0; k < M22Interface::activeInterfaces[i]->buttons.size(); k++)
 		{
-			Vec2* tempButtonPos = new Vec2(0.0,0.0);
-			tempButtonPos->x(M22Interface::activeInterfaces[i]->buttons[k].rectDst[M22Interface::activeInterfaces[i]->buttons[k].state].x);
-			tempButtonPos->y(M22Interface::activeInterfaces[i]->buttons[k].rectDst[M22Interface::activeInterfaces[i]->buttons[k].state].y);
-			Vec2* tempButtonSize = new Vec2(M22Interface::activeInterfaces[i]->buttons[k].rectDst[M22Interface::activeInterfaces[i]->buttons[k].state].w,
-											M22Interface::activeInterfaces[i]->buttons[k].rectDst[M22Interface::activeInterfaces[i]->buttons[k].state].h
-											);
+			const SDL_Rect& buttonRect = M22Interface::activeInterfaces[i]->buttons[k].rectDst[M22Interface::activeInterfaces[i]->buttons[k].state];
 			if(M22Interface::CheckOverlap(	M22Engine::MousePos, 
-											*tempButtonPos, 
-											*tempButtonSize
+											Vec2(buttonRect.x, buttonRect.y), 
+											Vec2(buttonRect.w, buttonRect.h)
 										 ) == true)
 			{	
-				delete tempButtonPos;
-				delete tempButtonSize;
 				// mouseover
 				if(M22Engine::LMB_Pressed)
 				{
@@ -386,8 +413,6 @@ void M22Interface::UpdateActiveInterfaces(int _ScrSizeX, int _ScrSizeY)
 			else
 			{
 				M22Interface::activeInterfaces[i]->buttons[k].state = M22Interface::BUTTON_STATES::RESTING;
-				delete tempButtonPos;
-				delete tempButtonSize;
 			};
 		};
 	};
@@ -461,9 +486,5 @@ void M22Interface::ResetStoredInterfaces(void)
 	{
 		M22Interface::storedInterfaces[i].alpha = 255.0f;
 	};
-	for(size_t i = 0; i < M22Interface::storedInterfaces[MAIN_MENU_INTRFC].buttons.size(); i++)
-	{
-		SDL_SetTextureAlphaMod( M22Interface::storedInterfaces[MAIN_MENU_INTRFC].buttons[i].sheet, 0 );
-	};
 	return;
 };
\ No newline at end of file
@@ -3,6 +3,11 @@
 using namespace March22;
 
 lua_State *M22Lua::STATE;
+std::vector<M22Lua::Chunk> M22Lua::CHUNKS;
+std::unordered_map<std::string, int> M22Lua::CHUNK_LOOKUP;
+std::deque<M22ScriptCompiler::line_c> M22Lua::COMMANDS;
+std::unordered_map<std::string, int> M22Lua::COMMAND_LOOKUP;
+int M22Lua::COMMAND_BASE = 0;
 
 int M22Lua::Initialize()
 {
@@ -12,6 +17,25 @@ int M22Lua::Initialize()
 	luaL_openlibs(M22Lua::STATE);
 
 	lua_register(M22Lua::STATE, "M22_ExecuteCommand", ExecuteM22ScriptCommand);
+
+	const luaL_Reg functions[] =
+	{
+		{ "background",			M22Lua::FindBackground },
+		{ "music",				M22Lua::FindMusic },
+		{ "sting",				M22Lua::FindSting },
+		{ "character",			M22Lua::FindCharacter },
+		{ "draw_background",	M22Lua::DrawBackground },
+		{ "play_music",			M22Lua::PlayMusic },
+		{ "stop_music",			M22Lua::StopMusic },
+		{ "play_sting",			M22Lua::PlaySting },
+		{ "draw_character",		M22Lua::DrawCharacter },
+		{ "clear_characters",	M22Lua::ClearCharacters },
+		{ NULL, NULL }
+	};
+	lua_newtable(M22Lua::STATE);
+	luaL_setfuncs(M22Lua::STATE, functions, 0);
+	lua_setglobal(M22Lua::STATE, "m22");
+
 	luaL_loadbuffer(M22Lua::STATE, buff, strlen(buff), "line");
 	lua_pcall(M22Lua::STATE, 0, 0, 0);
 	return 0;
@@ -19,25 +43,219 @@ int M22Lua::Initialize()
 
 void M22Lua::Shutdown()
 {
+	// Closing the state frees the chunks' registry references too
 	lua_close(M22Lua::STATE);
+	M22Lua::STATE = NULL;
+	M22Lua::CHUNKS.clear();
+	M22Lua::CHUNK_LOOKUP.clear();
+	M22Lua::ClearCommands();
 	return;
 };
 
+void M22Lua::ClearCommands(void)
+{
+	// IDs carry on from where they got to, so one kept from before can't pick up a new command
+	M22Lua::COMMAND_BASE += int(M22Lua::COMMANDS.size());
+	M22Lua::COMMANDS.clear();
+	M22Lua::COMMAND_LOOKUP.clear();
+	return;
+};
+
+int M22Lua::LoadChunk(const std::string& _filename)
+{
+	std::unordered_map<std::string, int>::iterator found = M22Lua::CHUNK_LOOKUP.find(_filename);
+	if(found != M22Lua::CHUNK_LOOKUP.end())
+	{
+		return found->second;
+	};
+	// The offline compiler has no Lua state; the engine compiles the chunk when it links the line
+	if(M22Lua::STATE == NULL)
+	{
+		return -1;
+	};
+
+	std::string tempPath = "./scripts/lua/";
+	tempPath += _filename;
+	// Chunks in a packed archive are compiled straight out of the mapping
+	const Uint8* data;
+	size_t size;
+	std::string chunkName = "@" + tempPath;
+	int result = (M22Archive::Find(tempPath, data, size) ?
+		luaL_loadbuffer(M22Lua::STATE, reinterpret_cast<const char*>(data), size, chunkName.c_str()) :
+		luaL_loadfile(M22Lua::STATE, tempPath.c_str()));
+	if(result != LUA_OK)
+	{
+		printf("[M22Lua] Failed to compile %s: %s\n", tempPath.c_str(), lua_tostring(M22Lua::STATE, -1));
+		lua_pop(M22Lua::STATE, 1);
+		return -1;
+	};
+	Chunk chunk;
+	chunk.filename = tempPath;
+	chunk.reference = luaL_ref(M22Lua::STATE, LUA_REGISTRYINDEX);
+	M22Lua::CHUNKS.push_back(chunk);
+	M22Lua::CHUNK_LOOKUP[_filename] = int(M22Lua::CHUNKS.size() - 1);
+	return int(M22Lua::CHUNKS.size() - 1);
+};
+
+short int M22Lua::RunChunk(int _chunk)
+{
+	if(M22Lua::STATE == NULL || _chunk < 0 || size_t(_chunk) >= M22Lua::CHUNKS.size())
+	{
+		return -1;
+	};
+	lua_rawgeti(M22Lua::STATE, LUA_REGISTRYINDEX, M22Lua::CHUNKS.at(_chunk).reference);
+	if(lua_pcall(M22Lua::STATE, 0, 0, 0) != LUA_OK)
+	{
+		printf("[M22Lua] Error running %s: %s\n", M22Lua::CHUNKS.at(_chunk).filename.c_str(), lua_tostring(M22Lua::STATE, -1));
+		lua_pop(M22Lua::STATE, 1);
+		return -1;
+	};
+	return 0;
+};
+
+int M22Lua::PrepareCommand(M22Script::LINETYPE _type, const std::vector<std::string>& _names)
+{
+	std::string key = std::to_string(int(_type));
+	for(size_t i = 0; i < _names.size(); i++)
+	{
+		key += '/';
+		key += _names.at(i);
+	};
+	std::unordered_map<std::string, int>::iterator found = M22Lua::COMMAND_LOOKUP.find(key);
+	if(found != M22Lua::COMMAND_LOOKUP.end())
+	{
+		return M22Lua::COMMAND_BASE + found->second;
+	};
+
+	// Linked exactly as a script line would be, then kept
+	M22ScriptCompiler::line_c command;
+	command.m_lineType = _type;
+	command.m_parameters_txt = _names;
+	command.m_parameters.assign((_type == M22Script::DRAW_CHARACTER ? 4 : 1), -1);
+	command.m_parameters.back() = (_type == M22Script::DRAW_CHARACTER ? 0 : -1);
+	M22ScriptCompiler::LinkLine(command);
+	if(command.m_parameters.at(0) == -1)
+	{
+		return -1;
+	};
+	M22Lua::COMMANDS.push_back(command);
+	M22Lua::COMMAND_LOOKUP[key] = int(M22Lua::COMMANDS.size() - 1);
+	return M22Lua::COMMAND_BASE + int(M22Lua::COMMANDS.size() - 1);
+};
+
+M22ScriptCompiler::line_c* M22Lua::CheckCommand(lua_State* L, int _arg, M22Script::LINETYPE _type, M22Script::LINETYPE _altType)
+{
+	lua_Integer id = luaL_checkinteger(L, _arg);
+	if(id >= 0 && id < M22Lua::COMMAND_BASE)
+	{
+		luaL_error(L, "m22: %d was resolved for a script that's since been unloaded; resolve it again", int(id));
+		return NULL;
+	};
+	lua_Integer index = id - M22Lua::COMMAND_BASE;
+	if(id < 0 || size_t(index) >= M22Lua::COMMANDS.size() || (M22Lua::COMMANDS.at(size_t(index)).m_lineType != _type && M22Lua::COMMANDS.at(size_t(index)).m_lineType != _altType))
+	{
+		luaL_error(L, "m22: %d isn't an ID from the matching m22 resolver", int(id));
+		return NULL;
+	};
+	return &M22Lua::COMMANDS.at(size_t(index));
+};
+
+int M22Lua::PushExecute(lua_State* L, M22ScriptCompiler::line_c* _command)
+{
+	lua_pushinteger(L, M22ScriptCompiler::ExecuteCommand(*_command, M22Script::currentLineIndex));
+	return 1;
+};
+
+int M22Lua::FindBackground(lua_State* L)
+{
+	lua_pushinteger(L, M22Lua::PrepareCommand(M22Script::NEW_BACKGROUND, std::vector<std::string>(1, luaL_checkstring(L, 1))));
+	return 1;
+};
+
+int M22Lua::FindMusic(lua_State* L)
+{
+	lua_pushinteger(L, M22Lua::PrepareCommand(M22Script::NEW_MUSIC, std::vector<std::string>(1, luaL_checkstring(L, 1))));
+	return 1;
+};
+
+int M22Lua::FindSting(lua_State* L)
+{
+	lua_pushinteger(L, M22Lua::PrepareCommand(M22Script::PLAY_STING, std::vector<std::string>(1, luaL_checkstring(L, 1))));
+	return 1;
+};
+
+int M22Lua::FindCharacter(lua_State* L)
+{
+	const char* name = luaL_checkstring(L, 1);
+	const char* outfit = luaL_checkstring(L, 2);
+	const char* emotion = luaL_checkstring(L, 3);
+	std::vector<std::string> names;
+	names.push_back(name);
+	names.push_back(outfit);
+	names.push_back(emotion);
+	lua_pushinteger(L, M22Lua::PrepareCommand(M22Script::DRAW_CHARACTER, names));
+	return 1;
+};
+
+int M22Lua::DrawBackground(lua_State* L)
+{
+	return M22Lua::PushExecute(L, M22Lua::CheckCommand(L, 1, M22Script::NEW_BACKGROUND, M22Script::NEW_BACKGROUND));
+};
+
+int M22Lua::PlayMusic(lua_State* L)
+{
+	return M22Lua::PushExecute(L, M22Lua::CheckCommand(L, 1, M22Script::NEW_MUSIC, M22Script::NEW_MUSIC));
+};
+
+int M22Lua::StopMusic(lua_State*)
+{
+	M22Sound::StopMusic();
+	return 0;
+};
+
+int M22Lua::PlaySting(lua_State* L)
+{
+	return M22Lua::PushExecute(L, M22Lua::CheckCommand(L, 1, M22Script::PLAY_STING, M22Script::PLAY_STING));
+};
+
+int M22Lua::DrawCharacter(lua_State* L)
+{
+	// Position and brutality are per call, so they go on a copy rather than the shared command
+	M22ScriptCompiler::line_c command = *M22Lua::CheckCommand(L, 1, M22Script::DRAW_CHARACTER, M22Script::DRAW_CHARACTER_BRUTAL);
+	command.m_parameters.at(3) = int(luaL_checkinteger(L, 2));
+	command.m_lineType = (lua_toboolean(L, 3) ? M22Script::DRAW_CHARACTER_BRUTAL : M22Script::DRAW_CHARACTER);
+	return M22Lua::PushExecute(L, &command);
+};
+
+int M22Lua::ClearCharacters(lua_State*)
+{
+	M22Script::ClearCharacters();
+	return 0;
+};
+
 int M22Lua::ExecuteM22ScriptCommand(lua_State* L)
 {
-	std::vector<std::wstring> temp;
+	// Views of the strings on the Lua stack, which stay put until this returns
+	std::vector<std::string_view> temp;
 	int num_of_arg = lua_gettop (L);
 	M22Script::LINETYPE command_type;
 	for(int i = 1; i <= num_of_arg; i++)
 	{
-		temp.push_back(M22Script::to_wstring(lua_tostring(L, i)));
+		size_t length = 0;
+		const char* arg = lua_tolstring(L, i, &length);
+		temp.push_back(std::string_view(arg != NULL ? arg : "", length));
 	};
 
 	command_type = M22Script::CheckLineType(temp.at(0));
 
 	M22ScriptCompiler::line_c templineC;
 	templineC.m_lineType = command_type;
-	M22ScriptCompiler::CompileLine(templineC, temp);
+	if(M22ScriptCompiler::CompileLine(templineC, temp) != 0)
+	{
+		// Not enough parameters for the command, so there's nothing to run
+		lua_pushinteger(L, -1);
+		return 1;
+	};
 
 	// Push the results of the script command
 	lua_pushinteger(L, M22ScriptCompiler::ExecuteCommand( templineC, M22Script::currentLineIndex));
@@ -0,0 +1,101 @@
+#include <engine/M22Engine.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace March22;
+
+M22MappedFile::M22MappedFile()
+{
+	m_data = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	m_file = -1;
+#endif
+};
+
+M22MappedFile::~M22MappedFile()
+{
+	this->Close();
+};
+
+bool M22MappedFile::Open(const std::string& _filename)
+{
+	this->Close();
+#ifdef _WIN32
+	m_file = CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	};
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		this->Close();
+		return false;
+	};
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_mapping == NULL)
+	{
+		this->Close();
+		return false;
+	};
+	m_data = (const Uint8*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if(m_data == NULL)
+	{
+		this->Close();
+		return false;
+	};
+	m_size = size_t(fileSize.QuadPart);
+#else
+	m_file = open(_filename.c_str(), O_RDONLY);
+	if(m_file == -1)
+	{
+		return false;
+	};
+	struct stat fileInfo;
+	if(fstat(m_file, &fileInfo) != 0 || fileInfo.st_size == 0)
+	{
+		this->Close();
+		return false;
+	};
+	void* mapped = mmap(NULL, size_t(fileInfo.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+	if(mapped == MAP_FAILED)
+	{
+		this->Close();
+		return false;
+	};
+	m_data = (const Uint8*)mapped;
+	m_size = size_t(fileInfo.st_size);
+#endif
+	return true;
+};
+
+void M22MappedFile::Close(void)
+{
+#ifdef _WIN32
+	if(m_data != NULL) UnmapViewOfFile(m_data);
+	if(m_mapping != NULL) CloseHandle(m_mapping);
+	if(m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+	m_mapping = NULL;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if(m_data != NULL) munmap((void*)m_data, m_size);
+	if(m_file != -1) close(m_file);
+	m_file = -1;
+#endif
+	m_data = NULL;
+	m_size = 0;
+	return;
+};
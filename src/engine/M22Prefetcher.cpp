@@ -0,0 +1,172 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::vector<int> M22Prefetcher::HELD;
+std::unordered_map<std::string, std::vector<int>> M22Prefetcher::SCRIPT_TEXTURES;
+int M22Prefetcher::WINDOW = PREFETCH_WINDOW_LINES;
+
+namespace
+{
+	// What's already in each list of the Dependencies being filled, so adding to them stays linear
+	struct Seen
+	{
+		std::unordered_set<int> textures;
+		std::unordered_set<int> music;
+		std::unordered_set<int> stings;
+	};
+
+	void AddUnique(std::vector<int>& _list, std::unordered_set<int>& _seen, int _value)
+	{
+		if(_value != -1 && _seen.insert(_value).second)
+		{
+			_list.push_back(_value);
+		};
+		return;
+	};
+
+	// Records what the line uses and queues any line it jumps to; returns false if the script doesn't carry on to the next line
+	bool AddLine(const M22ScriptCompiler::line_c& _line, M22Prefetcher::Dependencies& _out, Seen& _seen, std::deque<int>& _pending)
+	{
+		AddUnique(_out.textures, _seen.textures, _line.m_asset);
+		switch(_line.m_lineType)
+		{
+			case M22Script::NEW_MUSIC:
+				AddUnique(_out.music, _seen.music, _line.m_parameters.at(0));
+				return true;
+			case M22Script::PLAY_STING:
+			case M22Script::PLAY_STING_LOOPED:
+				AddUnique(_out.stings, _seen.stings, _line.m_parameters.at(0));
+				return true;
+			case M22Script::GOTO:
+				// Missing checkpoints carry on to the next line, like ExecuteGoto
+				if(_line.m_parameters.at(0) == -1)
+				{
+					return true;
+				};
+				_pending.push_back(_line.m_parameters.at(0));
+				return false;
+			case M22Script::GOTO_DEBUG:
+				_pending.push_back(_line.m_parameters.at(0));
+				return false;
+			case M22Script::LOAD_SCRIPT:
+			case M22Script::LOAD_SCRIPT_GOTO:
+				if(std::find(_out.scripts.begin(), _out.scripts.end(), _line.m_parameters_txt.at(0)) == _out.scripts.end())
+				{
+					_out.scripts.push_back(_line.m_parameters_txt.at(0));
+				};
+				return false;
+			case M22Script::EXITGAME:
+			case M22Script::EXITTOMAINMENU:
+				return false;
+			case M22Script::IF_STATEMENT:
+				// Whichever way it goes: the command it runs when true, and the next line when false
+				if(!_line.m_subLines.empty())
+				{
+					AddLine(_line.m_subLines.front(), _out, _seen, _pending);
+				};
+				return true;
+			default:
+				return true;
+		};
+	};
+}
+
+void M22Prefetcher::ScanScriptDependencies(const std::vector<M22ScriptCompiler::line_c>& _script, int _fromLine, int _window, Dependencies& _out)
+{
+	// Breadth first, so both sides of a branch get looked at equally far ahead
+	std::vector<bool> visited(_script.size(), false);
+	std::deque<int> pending;
+	Seen seen;
+	seen.textures.insert(_out.textures.begin(), _out.textures.end());
+	seen.music.insert(_out.music.begin(), _out.music.end());
+	seen.stings.insert(_out.stings.begin(), _out.stings.end());
+	pending.push_back(_fromLine);
+	int looked = 0;
+	while(!pending.empty() && looked < _window)
+	{
+		int line = pending.front();
+		pending.pop_front();
+		if(line < 0 || size_t(line) >= _script.size() || visited.at(line))
+		{
+			continue;
+		};
+		visited.at(line) = true;
+		looked++;
+		if(AddLine(_script.at(line), _out, seen, pending))
+		{
+			pending.push_back(line + 1);
+		};
+	};
+	return;
+};
+
+void M22Prefetcher::Update(int _fromLine)
+{
+	Dependencies upcoming;
+	M22Prefetcher::ScanScriptDependencies(M22ScriptCompiler::currentScript_c, _fromLine, M22Prefetcher::WINDOW, upcoming);
+	std::unordered_set<int> wanted(upcoming.textures.begin(), upcoming.textures.end());
+
+	// Another script can't be linked without replacing this one, so just take the first textures out of its .m22c
+	for(size_t i = 0; i < upcoming.scripts.size(); i++)
+	{
+		std::unordered_map<std::string, std::vector<int>>::iterator found = M22Prefetcher::SCRIPT_TEXTURES.find(upcoming.scripts.at(i));
+		if(found == M22Prefetcher::SCRIPT_TEXTURES.end())
+		{
+			std::vector<int> handles;
+			std::string source = "scripts/" + upcoming.scripts.at(i);
+			std::string compiled = M22ScriptCompiler::GetCompiledFilename(source);
+			if(M22ScriptCompiler::IsCompiledScriptCurrent(compiled, source))
+			{
+				M22ScriptCompiler::ReadCompiledDependencies(compiled, size_t(M22Prefetcher::WINDOW), handles);
+			};
+			found = M22Prefetcher::SCRIPT_TEXTURES.insert(std::make_pair(upcoming.scripts.at(i), handles)).first;
+		};
+		for(size_t k = 0; k < found->second.size(); k++)
+		{
+			AddUnique(upcoming.textures, wanted, found->second.at(k));
+		};
+	};
+
+	// Hold the new ones before letting go of the old, so anything in both stays resident
+	std::unordered_set<int> held(M22Prefetcher::HELD.begin(), M22Prefetcher::HELD.end());
+	for(size_t i = 0; i < upcoming.textures.size(); i++)
+	{
+		if(held.count(upcoming.textures.at(i)) == 0)
+		{
+			M22AssetLoader::Acquire(upcoming.textures.at(i));
+		};
+		M22AssetLoader::QueueTexture(upcoming.textures.at(i));
+	};
+	bool released = false;
+	for(size_t i = 0; i < M22Prefetcher::HELD.size(); i++)
+	{
+		if(wanted.count(M22Prefetcher::HELD.at(i)) == 0)
+		{
+			M22AssetLoader::Release(M22Prefetcher::HELD.at(i));
+			released = true;
+		};
+	};
+	M22Prefetcher::HELD.swap(upcoming.textures);
+	if(released)
+	{
+		M22AssetLoader::TrimToBudget();
+	};
+
+	M22Sound::WarmStings(upcoming.stings);
+	M22Sound::PrefetchTrack(upcoming.music.empty() ? -1 : upcoming.music.front());
+	return;
+};
+
+void M22Prefetcher::Reset(void)
+{
+	for(size_t i = 0; i < M22Prefetcher::HELD.size(); i++)
+	{
+		M22AssetLoader::Release(M22Prefetcher::HELD.at(i));
+	};
+	M22Prefetcher::HELD.clear();
+	M22Prefetcher::SCRIPT_TEXTURES.clear();
+	M22Sound::WarmStings(std::vector<int>());
+	M22Sound::PrefetchTrack(-1);
+	return;
+};
@@ -0,0 +1,247 @@
+#include <engine/M22Engine.h>
+
+#if M22_PROFILING
+
+using namespace March22;
+
+std::vector<M22Profiler::Frame> M22Profiler::FRAMES;
+size_t M22Profiler::CURRENT = 0;
+Uint64 M22Profiler::FRAME_COUNT = 0;
+int M22Profiler::DEPTH = 0;
+bool M22Profiler::VISIBLE = false;
+std::thread::id M22Profiler::MAIN_THREAD;
+
+namespace
+{
+	// Totals for one scope name across the kept frames
+	struct ScopeTotal
+	{
+		std::string name;
+		double totalMs;
+		double maxMs;
+	};
+
+	double ToMilliseconds(Uint64 _ticks)
+	{
+		return double(_ticks) * 1000.0 / double(SDL_GetPerformanceFrequency());
+	};
+
+	// Calls _visit(frameNumber, frame) for each finished frame, oldest first
+	template<typename T> void ForEachFrame(T _visit)
+	{
+		size_t kept = size_t(std::min<Uint64>(M22Profiler::FRAME_COUNT, M22Profiler::FRAMES.size()));
+		size_t oldest = (M22Profiler::CURRENT + M22Profiler::FRAMES.size() - kept) % M22Profiler::FRAMES.size();
+		for(size_t i = 0; i < kept; i++)
+		{
+			_visit(M22Profiler::FRAME_COUNT - kept + i, M22Profiler::FRAMES.at((oldest + i) % M22Profiler::FRAMES.size()));
+		};
+		return;
+	};
+
+	std::string EscapeJSON(const char* _text)
+	{
+		std::string escaped;
+		for(; *_text != '\0'; _text++)
+		{
+			if(*_text == '"' || *_text == '\\') escaped += '\\';
+			escaped += *_text;
+		};
+		return escaped;
+	};
+}
+
+void M22Profiler::Initialize(void)
+{
+	M22Profiler::FRAMES.resize(PROFILER_FRAMES);
+	M22Profiler::CURRENT = 0;
+	M22Profiler::FRAME_COUNT = 0;
+	M22Profiler::DEPTH = 0;
+	M22Profiler::FRAMES.at(0).start = SDL_GetPerformanceCounter();
+	M22Profiler::MAIN_THREAD = std::this_thread::get_id();
+	return;
+};
+
+void M22Profiler::BeginFrame(void)
+{
+	Frame& frame = M22Profiler::FRAMES.at(M22Profiler::CURRENT);
+	frame.start = SDL_GetPerformanceCounter();
+	return;
+};
+
+void M22Profiler::EndFrame(void)
+{
+	M22Profiler::FRAMES.at(M22Profiler::CURRENT).end = SDL_GetPerformanceCounter();
+	M22Profiler::FRAME_COUNT++;
+	M22Profiler::CURRENT = (M22Profiler::CURRENT + 1) % M22Profiler::FRAMES.size();
+
+	// clear() keeps the capacity, so recording doesn't allocate once the ring has warmed up
+	Frame& next = M22Profiler::FRAMES.at(M22Profiler::CURRENT);
+	next.samples.clear();
+	next.start = next.end = M22Profiler::FRAMES.at((M22Profiler::CURRENT + M22Profiler::FRAMES.size() - 1) % M22Profiler::FRAMES.size()).end;
+	return;
+};
+
+void M22Profiler::Record(const char* _name, Uint64 _start, Uint64 _end, int _depth)
+{
+	Sample sample;
+	sample.name = _name;
+	sample.start = _start;
+	sample.end = _end;
+	sample.depth = _depth;
+	M22Profiler::FRAMES.at(M22Profiler::CURRENT).samples.push_back(sample);
+	return;
+};
+
+void M22Profiler::DrawOverlay(void)
+{
+	if(!M22Profiler::VISIBLE || M22Profiler::FRAME_COUNT == 0)
+	{
+		return;
+	};
+	// Keep the numbers moving while it's up, without drawing every frame just for it
+	M22FrameScheduler::WakeAt(SDL_GetTicks() + 250);
+
+	const int graphX = 10, graphY = 10, graphH = 200, barW = 2;
+	const double pixelsPerMs = double(graphH) / (M22FrameScheduler::TARGET_FRAME_MS * 2.0);
+	int graphW = int(M22Profiler::FRAMES.size()) * barW;
+
+	std::vector<ScopeTotal> totals;
+	size_t frames = 0;
+	double frameTotalMs = 0.0, frameMaxMs = 0.0;
+	SDL_SetRenderDrawBlendMode(M22Renderer::SDL_RENDERER, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0, 0, 0, 192);
+	SDL_Rect background = { graphX - 5, graphY - 5, graphW + 10, graphH + 10 };
+	SDL_RenderFillRect(M22Renderer::SDL_RENDERER, &background);
+
+	ForEachFrame([&](Uint64, const Frame& _frame)
+	{
+		double ms = ToMilliseconds(_frame.end - _frame.start);
+		frameTotalMs += ms;
+		frameMaxMs = std::max(frameMaxMs, ms);
+		int height = std::min(graphH, int(ms * pixelsPerMs) + 1);
+		if(ms > M22FrameScheduler::TARGET_FRAME_MS)
+		{
+			SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255, 64, 64, 255);
+		}
+		else
+		{
+			SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 64, 255, 64, 255);
+		};
+		SDL_Rect bar = { graphX + int(frames) * barW, graphY + graphH - height, barW, height };
+		SDL_RenderFillRect(M22Renderer::SDL_RENDERER, &bar);
+		frames++;
+
+		for(size_t i = 0; i < _frame.samples.size(); i++)
+		{
+			const Sample& sample = _frame.samples.at(i);
+			double sampleMs = ToMilliseconds(sample.end - sample.start);
+			std::vector<ScopeTotal>::iterator found = std::find_if(totals.begin(), totals.end(), [&](const ScopeTotal& _total) { return _total.name == sample.name; });
+			if(found == totals.end())
+			{
+				ScopeTotal total = { sample.name, 0.0, 0.0 };
+				totals.push_back(total);
+				found = totals.end() - 1;
+			};
+			found->totalMs += sampleMs;
+			found->maxMs = std::max(found->maxMs, sampleMs);
+		};
+	});
+
+	// The frame budget sits half way up the graph
+	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255, 255, 255, 255);
+	SDL_RenderDrawLine(M22Renderer::SDL_RENDERER, graphX, graphY + graphH / 2, graphX + graphW, graphY + graphH / 2);
+
+	std::sort(totals.begin(), totals.end(), [](const ScopeTotal& _a, const ScopeTotal& _b) { return _a.totalMs > _b.totalMs; });
+	const int lineHeight = 32;
+	int lines = 2 + int(std::min<size_t>(totals.size(), 8));
+	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0, 0, 0, 192);
+	SDL_Rect textBackground = { graphX - 5, graphY + graphH + 10, graphW + 10, lines * lineHeight + 10 };
+	SDL_RenderFillRect(M22Renderer::SDL_RENDERER, &textBackground);
+
+	int y = graphY + graphH + 15;
+	M22Script::font->draw(M22Renderer::SDL_RENDERER, float(graphX), float(y), "frame  avg %.2f ms  max %.2f ms", frameTotalMs / double(frames), frameMaxMs);
+	size_t glyphPages = 0;
+	size_t glyphBytes = M22GlyphCache::CacheBytes(M22Script::font, &glyphPages);
+	y += lineHeight;
+	M22Script::font->draw(M22Renderer::SDL_RENDERER, float(graphX), float(y), "glyph cache  %u page(s)  %.1f KB  %u queued", (unsigned int)glyphPages, double(glyphBytes) / 1024.0, (unsigned int)(M22GlyphCache::PENDING.size() - M22GlyphCache::NEXT));
+	for(size_t i = 0; i < totals.size() && i < 8; i++)
+	{
+		y += lineHeight;
+		M22Script::font->draw(M22Renderer::SDL_RENDERER, float(graphX), float(y), "%s  avg %.2f ms  max %.2f ms", totals.at(i).name.c_str(), totals.at(i).totalMs / double(frames), totals.at(i).maxMs);
+	};
+	M22Renderer::SetDrawColor(255, 255, 255, 255);
+	return;
+};
+
+short int M22Profiler::DumpCSV(const std::string& _filename)
+{
+	std::ofstream output(_filename, std::ios::out | std::ios::trunc);
+	if(!output)
+	{
+		printf("[M22Profiler] Failed to open %s for writing!\n", _filename.c_str());
+		return -1;
+	};
+	Uint64 origin = 0;
+	bool first = true;
+	char row[256];
+	output << "frame,scope,depth,start_ms,duration_ms\n";
+	ForEachFrame([&](Uint64 _number, const Frame& _frame)
+	{
+		if(first)
+		{
+			origin = _frame.start;
+			first = false;
+		};
+		snprintf(row, sizeof(row), "%llu,(frame),-1,%.4f,%.4f\n", (unsigned long long)_number, ToMilliseconds(_frame.start - origin), ToMilliseconds(_frame.end - _frame.start));
+		output << row;
+		for(size_t i = 0; i < _frame.samples.size(); i++)
+		{
+			const Sample& sample = _frame.samples.at(i);
+			// Anything timed before the frame began (e.g. at startup) is clamped to its start
+			Uint64 start = std::max(sample.start, origin);
+			snprintf(row, sizeof(row), "%llu,%s,%i,%.4f,%.4f\n", (unsigned long long)_number, sample.name, sample.depth, ToMilliseconds(start - origin), ToMilliseconds(sample.end - sample.start));
+			output << row;
+		};
+	});
+	printf("[M22Profiler] Wrote %s\n", _filename.c_str());
+	return 0;
+};
+
+short int M22Profiler::DumpChromeTrace(const std::string& _filename)
+{
+	std::ofstream output(_filename, std::ios::out | std::ios::trunc);
+	if(!output)
+	{
+		printf("[M22Profiler] Failed to open %s for writing!\n", _filename.c_str());
+		return -1;
+	};
+	Uint64 origin = 0;
+	bool first = true;
+	char event[512];
+	output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	ForEachFrame([&](Uint64 _number, const Frame& _frame)
+	{
+		if(first)
+		{
+			origin = _frame.start;
+		};
+		// Complete ("X") events, in microseconds; nesting is worked out from the times
+		snprintf(event, sizeof(event), "%s\n{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			(first ? "" : ","), (unsigned long long)_number, ToMilliseconds(_frame.start - origin) * 1000.0, ToMilliseconds(_frame.end - _frame.start) * 1000.0);
+		output << event;
+		first = false;
+		for(size_t i = 0; i < _frame.samples.size(); i++)
+		{
+			const Sample& sample = _frame.samples.at(i);
+			Uint64 start = std::max(sample.start, origin);
+			snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				EscapeJSON(sample.name).c_str(), ToMilliseconds(start - origin) * 1000.0, ToMilliseconds(sample.end - sample.start) * 1000.0);
+			output << event;
+		};
+	});
+	output << "\n]}\n";
+	printf("[M22Profiler] Wrote %s\n", _filename.c_str());
+	return 0;
+};
+
+#endif
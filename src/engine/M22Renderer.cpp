@@ -14,6 +14,7 @@ SDL_Renderer *M22Renderer::SDL_RENDERER = NULL;
 
 void M22Renderer::RenderPresent(void)
 {
+	M22_PROFILE_SCOPE("RenderPresent");
 	SDL_RenderPresent(M22Renderer::SDL_RENDERER);
 	return;
 };
@@ -38,7 +39,15 @@ void M22Renderer::GetTextureInfo(SDL_Texture* _txtr, int& _w, int& _h)
 
 SDL_Texture* M22Renderer::LoadTexture(std::string _filepath)
 {
-	return IMG_LoadTexture(M22Renderer::SDL_RENDERER, _filepath.c_str());
+	// Decoded ahead of time during startup?
+	SDL_Surface* decoded = M22Startup::TakeImage(_filepath);
+	if(decoded != NULL)
+	{
+		SDL_Texture* texture = SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, decoded);
+		SDL_FreeSurface(decoded);
+		return texture;
+	};
+	return IMG_LoadTexture_RW(M22Renderer::SDL_RENDERER, M22Archive::OpenRW(_filepath), 1);
 };
 
 void M22Renderer::SetDrawColor(unsigned char _r, unsigned char _g, unsigned char _b, unsigned char _a)
@@ -0,0 +1,750 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::thread M22SaveState::WRITER;
+
+namespace
+{
+	void Put(std::vector<Uint8>& _output, const void* _data, size_t _size)
+	{
+		const Uint8* bytes = static_cast<const Uint8*>(_data);
+		_output.insert(_output.end(), bytes, bytes + _size);
+		return;
+	};
+
+	template <typename T>
+	void PutValue(std::vector<Uint8>& _output, T _value)
+	{
+		Put(_output, &_value, sizeof(T));
+		return;
+	};
+
+	void PutString(std::vector<Uint8>& _output, const std::string& _string)
+	{
+		PutValue(_output, Uint32(_string.size()));
+		Put(_output, _string.data(), _string.size());
+		return;
+	};
+
+	// Reads the fields back, failing (and staying failed) rather than running off the end
+	struct Reader
+	{
+		const Uint8* data;
+		size_t size;
+		size_t position;
+		bool failed;
+
+		bool Get(void* _out, size_t _size)
+		{
+			if(failed || _size > size - position)
+			{
+				failed = true;
+				return false;
+			};
+			memcpy(_out, data + position, _size);
+			position += _size;
+			return true;
+		};
+
+		template <typename T>
+		T GetValue(void)
+		{
+			T value = T();
+			Get(&value, sizeof(T));
+			return value;
+		};
+
+		std::string GetString(void)
+		{
+			Uint32 length = GetValue<Uint32>();
+			if(failed || length > size - position)
+			{
+				failed = true;
+				return std::string();
+			};
+			std::string output(reinterpret_cast<const char*>(data + position), length);
+			position += length;
+			return output;
+		};
+
+		// Counts come from the file, so don't let a corrupt one reserve gigabytes
+		Uint32 GetCount(size_t _minimumItemSize)
+		{
+			Uint32 count = GetValue<Uint32>();
+			if(!failed && count > (size - position) / _minimumItemSize)
+			{
+				failed = true;
+			};
+			return (failed ? 0 : count);
+		};
+	};
+
+	bool SameCharacters(const std::vector<M22SaveState::CharacterState>& _a, const std::vector<M22SaveState::CharacterState>& _b)
+	{
+		if(_a.size() != _b.size())
+		{
+			return false;
+		};
+		for(size_t i = 0; i < _a.size(); i++)
+		{
+			if(_a.at(i).character != _b.at(i).character || _a.at(i).outfit != _b.at(i).outfit || _a.at(i).emotion != _b.at(i).emotion || _a.at(i).x != _b.at(i).x)
+			{
+				return false;
+			};
+		};
+		return true;
+	};
+
+	bool SameSprites(const std::vector<M22SaveState::SpriteState>& _a, const std::vector<M22SaveState::SpriteState>& _b)
+	{
+		if(_a.size() != _b.size())
+		{
+			return false;
+		};
+		for(size_t i = 0; i < _a.size(); i++)
+		{
+			if(_a.at(i).sprite != _b.at(i).sprite || _a.at(i).x != _b.at(i).x || _a.at(i).y != _b.at(i).y || _a.at(i).frames != _b.at(i).frames || _a.at(i).mode != _b.at(i).mode || _a.at(i).frameTime != _b.at(i).frameTime)
+			{
+				return false;
+			};
+		};
+		return true;
+	};
+
+	const size_t SPRITE_STATE_SIZE = sizeof(Uint32) + 2 * sizeof(Sint32) + sizeof(Uint16) + sizeof(Uint8) + sizeof(Uint32);
+
+	void PutSprite(std::vector<Uint8>& _output, const M22SaveState::SpriteState& _sprite)
+	{
+		PutString(_output, _sprite.sprite);
+		PutValue(_output, _sprite.x);
+		PutValue(_output, _sprite.y);
+		PutValue(_output, _sprite.frames);
+		PutValue(_output, _sprite.mode);
+		PutValue(_output, _sprite.frameTime);
+		return;
+	};
+
+	void GetSprite(Reader& _input, M22SaveState::SpriteState& _sprite)
+	{
+		_sprite.sprite = _input.GetString();
+		_sprite.x = _input.GetValue<Sint32>();
+		_sprite.y = _input.GetValue<Sint32>();
+		_sprite.frames = _input.GetValue<Uint16>();
+		_sprite.mode = _input.GetValue<Uint8>();
+		_sprite.frameTime = _input.GetValue<Uint32>();
+		return;
+	};
+
+	const M22SaveState::DecisionState* FindDecision(const std::vector<M22SaveState::DecisionState>& _decisions, const std::string& _name)
+	{
+		for(size_t i = 0; i < _decisions.size(); i++)
+		{
+			if(_decisions.at(i).decision == _name)
+			{
+				return &_decisions.at(i);
+			};
+		};
+		return NULL;
+	};
+}
+
+void M22SaveState::Capture(M22SaveState::Snapshot& _snapshot)
+{
+	_snapshot.gamestate = Uint32(M22Engine::GAMESTATE);
+	_snapshot.script = M22Script::currentScriptFileName;
+	_snapshot.scriptHash = M22ScriptCompiler::currentScript_hash;
+	_snapshot.line = M22Script::currentLineIndex;
+
+	_snapshot.decisions.clear();
+	for(size_t i = 0; i < M22Script::gameDecisions.size(); i++)
+	{
+		const M22Script::Decision& decision = M22Script::gameDecisions.at(i);
+		if(decision.selectedOption < 0 || size_t(decision.selectedOption) >= decision.choices.size())
+		{
+			continue;
+		};
+		DecisionState state;
+		state.decision = decision.name;
+		state.choice = decision.choices.at(decision.selectedOption);
+		_snapshot.decisions.push_back(state);
+	};
+
+	_snapshot.background = M22Engine::ACTIVE_BACKGROUNDS.at(0).name;
+	_snapshot.characters.clear();
+	for(size_t i = 0; i < M22CharacterLayer::COUNT; i++)
+	{
+		// Ones fading out are already gone as far as the script is concerned
+		const M22CharacterLayer::Slot& drawn = M22CharacterLayer::SLOTS[M22CharacterLayer::DRAW_ORDER[i]];
+		if(drawn.clearing)
+		{
+			continue;
+		};
+		const M22Engine::Character& character = M22Engine::CHARACTERS_ARRAY.at(drawn.character);
+		CharacterState state;
+		state.character = character.name;
+		state.outfit = character.outfits.at(drawn.outfit);
+		state.emotion = character.emotions.at(drawn.emotion);
+		state.x = int(std::lround(M22Tween::Target(&drawn.x)));
+		_snapshot.characters.push_back(state);
+	};
+	_snapshot.sprites.clear();
+	for(size_t i = 0; i < M22Graphics::ACTIVE_SPRITES.size(); i++)
+	{
+		const M22Graphics::ActiveSprite& active = M22Graphics::ACTIVE_SPRITES.at(i);
+		SpriteState state;
+		state.sprite = active.sprite->name();
+		state.x = active.rect.x;
+		state.y = active.rect.y;
+		state.frames = Uint16(active.sprite->frames());
+		state.mode = Uint8(active.mode);
+		state.frameTime = active.frameTime;
+		_snapshot.sprites.push_back(state);
+	};
+
+	_snapshot.typewriterText = M22Script::typewriter_text;
+	_snapshot.typewriterPosition = Uint32(M22Script::typewriter_currPos);
+	_snapshot.typing = (M22Script::updateCurrentLine ? 1 : 0);
+	_snapshot.textArea = (M22Interface::DRAW_TEXT_AREA ? 1 : 0);
+	_snapshot.speaker = M22Script::activeSpeakerIndex;
+	_snapshot.darken = 0;
+	SDL_GetTextureAlphaMod(M22Graphics::BLACK_TEXTURE, &_snapshot.darken);
+	_snapshot.transition = M22Graphics::activeTransition;
+
+	_snapshot.music.clear();
+	if(M22Sound::currentTrack > 0 && size_t(M22Sound::currentTrack) < M22Sound::MUSIC_NAMES.size())
+	{
+		_snapshot.music = M22Sound::MUSIC_NAMES.at(M22Sound::currentTrack);
+	};
+	_snapshot.loopedSting.clear();
+	if(M22Sound::currentLoopedSting >= 0 && size_t(M22Sound::currentLoopedSting) < M22Sound::SFX_NAMES.size())
+	{
+		_snapshot.loopedSting = M22Sound::SFX_NAMES.at(M22Sound::currentLoopedSting);
+	};
+	return;
+};
+
+short int M22SaveState::Apply(const M22SaveState::Snapshot& _snapshot)
+{
+	// Same script, same contents: everything it linked is still there, so just pick up where the snapshot was
+	bool inPlace = (_snapshot.script == M22Script::currentScriptFileName && !M22ScriptCompiler::currentScript_c.empty() && _snapshot.scriptHash == M22ScriptCompiler::currentScript_hash);
+	if(!inPlace)
+	{
+		// The running script is only replaced once the saved one has compiled, so a failed load leaves it as it was
+		if(M22ScriptCompiler::CompileLoadScriptFile(_snapshot.script) != 0)
+		{
+			printf("[M22SaveState] Failed to load %s for the savegame!\n", _snapshot.script.c_str());
+			return -1;
+		};
+		M22Script::ClearCharacters(true);
+		if(M22ScriptCompiler::currentScript_hash != _snapshot.scriptHash)
+		{
+			printf("[M22SaveState] %s has changed since the game was saved; line %i may not be where it was\n", _snapshot.script.c_str(), _snapshot.line);
+		};
+	};
+	if(_snapshot.line < 0 || size_t(_snapshot.line) >= M22ScriptCompiler::currentScript_c.size())
+	{
+		printf("[M22SaveState] Line %i is past the end of %s!\n", _snapshot.line, _snapshot.script.c_str());
+		return -1;
+	};
+
+	if(M22Engine::GAMESTATE == M22Engine::GAMESTATES::MAIN_MENU && _snapshot.gamestate == M22Engine::GAMESTATES::INGAME)
+	{
+		// What StartGame does, without the fade
+		SDL_SetTextureAlphaMod(M22Graphics::activeMenuBackground.sprite, 0);
+		SDL_SetTextureAlphaMod(M22Graphics::menuLogo.sprite, 0);
+		M22Interface::activeInterfaces.clear();
+		M22Interface::activeInterfaces.push_back(&M22Interface::storedInterfaces[0]);
+	};
+	M22Engine::GAMESTATE = M22Engine::GAMESTATES(_snapshot.gamestate);
+	M22Engine::skipping = false;
+	M22Engine::TIMER_CURR = 0;
+	M22Engine::TIMER_TARGET = 0;
+	M22Script::ReleaseDecisionTextures();
+	M22Script::activeDecision = -1;
+	M22Script::activeChoices.clear();
+
+	for(size_t i = 0; i < M22Script::gameDecisions.size(); i++)
+	{
+		M22Script::gameDecisions.at(i).selectedOption = -1;
+	};
+	for(size_t i = 0; i < _snapshot.decisions.size(); i++)
+	{
+		int decision = M22Script::FindOrAddDecision(_snapshot.decisions.at(i).decision);
+		M22Script::gameDecisions.at(decision).selectedOption = (short int)M22Script::FindOrAddChoice(decision, _snapshot.decisions.at(i).choice);
+	};
+
+	// Rebuild the scene the way the script drew it, then finish the change straight away
+	M22CharacterLayer::Clear(true);
+	M22AssetLoader::AssetHandle background = M22AssetLoader::RequestTexture(_snapshot.background);
+	if(M22AssetLoader::WaitForTexture(background) != NULL)
+	{
+		M22Graphics::ShowBackground(background, _snapshot.background);
+	}
+	else
+	{
+		printf("[M22SaveState] Failed to load background %s!\n", _snapshot.background.c_str());
+	};
+	for(size_t i = 0; i < _snapshot.characters.size(); i++)
+	{
+		M22ScriptCompiler::line_c drawCharacter;
+		drawCharacter.m_lineType = M22Script::DRAW_CHARACTER_BRUTAL;
+		drawCharacter.m_parameters_txt.push_back(_snapshot.characters.at(i).character);
+		drawCharacter.m_parameters_txt.push_back(_snapshot.characters.at(i).outfit);
+		drawCharacter.m_parameters_txt.push_back(_snapshot.characters.at(i).emotion);
+		drawCharacter.m_parameters.assign(3, -1);
+		drawCharacter.m_parameters.push_back(_snapshot.characters.at(i).x);
+		M22ScriptCompiler::LinkLine(drawCharacter);
+		M22ScriptCompiler::ExecuteCommand(drawCharacter, _snapshot.line);
+	};
+	M22Graphics::ACTIVE_SPRITES.clear();
+	for(size_t i = 0; i < _snapshot.sprites.size(); i++)
+	{
+		const SpriteState& state = _snapshot.sprites.at(i);
+		int sprite = M22Graphics::LoadSprite(state.sprite, std::max(Uint16(1), state.frames));
+		M22Graphics::ShowSprite(sprite, state.x, state.y, M22Graphics::ANIMATION_MODES(state.mode), state.frameTime);
+	};
+	if(_snapshot.transition < M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS)
+	{
+		M22Graphics::activeTransition = _snapshot.transition;
+	};
+	M22Graphics::CompleteTransition();
+	SDL_SetTextureAlphaMod(M22Graphics::BLACK_TEXTURE, _snapshot.darken);
+
+	// Put the line and the page of text back as they were, without running the line again
+	M22Script::currentLineIndex = _snapshot.line;
+	M22ScriptCompiler::CURRENT_LINE = &M22ScriptCompiler::currentScript_c.at(_snapshot.line);
+	M22Script::currentLineType = M22ScriptCompiler::CURRENT_LINE->m_lineType;
+	M22Script::currentLine = M22ScriptCompiler::CURRENT_LINE->m_lineContents;
+	M22Script::currentLineUnread = !M22Script::IsLineRead(_snapshot.line);
+	M22Script::typewriter_text = _snapshot.typewriterText;
+	M22Script::typewriter_currPos = std::min(size_t(_snapshot.typewriterPosition), M22Script::currentLine.size());
+	// Never part way through a character
+	while(M22Script::typewriter_currPos > 0 && M22Script::typewriter_currPos < M22Script::currentLine.size() && (M22Script::currentLine[M22Script::typewriter_currPos] & 0xC0) == 0x80)
+	{
+		M22Script::typewriter_currPos--;
+	};
+	M22Script::updateCurrentLine = (_snapshot.typing != 0);
+	M22Script::ResumeTypewriter();
+	M22Script::activeSpeakerIndex = _snapshot.speaker;
+	M22Interface::DRAW_TEXT_AREA = (_snapshot.textArea != 0);
+
+	if(_snapshot.music.empty())
+	{
+		M22Sound::StopMusic();
+	}
+	else if(M22Sound::currentTrack <= 0 || size_t(M22Sound::currentTrack) >= M22Sound::MUSIC_NAMES.size() || M22Sound::MUSIC_NAMES.at(M22Sound::currentTrack) != _snapshot.music)
+	{
+		M22Sound::ChangeMusicTrack(_snapshot.music);
+	};
+	if(M22Sound::currentLoopedSting < 0 || M22Sound::SFX_NAMES.at(M22Sound::currentLoopedSting) != _snapshot.loopedSting)
+	{
+		M22Sound::StopLoopedStings();
+		if(!_snapshot.loopedSting.empty())
+		{
+			M22Sound::PlayLoopedSting(_snapshot.loopedSting);
+		};
+	};
+	M22Prefetcher::Update(_snapshot.line + 1);
+
+	// Lines that were waiting on a timer/choice start waiting again; one waiting on its transition carries on, since that's done
+	switch(M22Script::currentLineType)
+	{
+		case M22Script::WAIT:
+		case M22Script::MAKE_DECISION:
+			M22ScriptCompiler::ExecuteCommand(*M22ScriptCompiler::CURRENT_LINE, _snapshot.line);
+			break;
+		case M22Script::NEW_BACKGROUND:
+			M22Script::ChangeLine(++M22Script::currentLineIndex);
+			break;
+		default:
+			break;
+	};
+	M22FrameScheduler::MarkDirty();
+	return 0;
+};
+
+void M22SaveState::Encode(const M22SaveState::Snapshot& _snapshot, std::vector<Uint8>& _output)
+{
+	_output.clear();
+	_output.resize(sizeof(m22save_header));
+
+	PutValue(_output, _snapshot.gamestate);
+	PutString(_output, _snapshot.script);
+	PutValue(_output, _snapshot.scriptHash);
+	PutValue(_output, _snapshot.line);
+	PutValue(_output, Uint32(_snapshot.decisions.size()));
+	for(size_t i = 0; i < _snapshot.decisions.size(); i++)
+	{
+		PutString(_output, _snapshot.decisions.at(i).decision);
+		PutString(_output, _snapshot.decisions.at(i).choice);
+	};
+	PutString(_output, _snapshot.background);
+	PutValue(_output, Uint32(_snapshot.characters.size()));
+	for(size_t i = 0; i < _snapshot.characters.size(); i++)
+	{
+		PutString(_output, _snapshot.characters.at(i).character);
+		PutString(_output, _snapshot.characters.at(i).outfit);
+		PutString(_output, _snapshot.characters.at(i).emotion);
+		PutValue(_output, _snapshot.characters.at(i).x);
+	};
+	PutValue(_output, Uint32(_snapshot.sprites.size()));
+	for(size_t i = 0; i < _snapshot.sprites.size(); i++)
+	{
+		PutSprite(_output, _snapshot.sprites.at(i));
+	};
+	PutString(_output, _snapshot.typewriterText);
+	PutValue(_output, _snapshot.typewriterPosition);
+	PutValue(_output, _snapshot.typing);
+	PutValue(_output, _snapshot.textArea);
+	PutValue(_output, _snapshot.speaker);
+	PutValue(_output, _snapshot.darken);
+	PutValue(_output, _snapshot.transition);
+	PutString(_output, _snapshot.music);
+	PutString(_output, _snapshot.loopedSting);
+
+	m22save_header header;
+	memcpy(header.m_magic, "M22S", 4);
+	header.m_version = M22SAVE_VERSION;
+	header.m_size = Uint32(_output.size() - sizeof(m22save_header));
+	memcpy(&_output[0], &header, sizeof(m22save_header));
+	return;
+};
+
+short int M22SaveState::Decode(const Uint8* _data, size_t _size, M22SaveState::Snapshot& _snapshot)
+{
+	m22save_header header;
+	if(_size < sizeof(m22save_header))
+	{
+		return -1;
+	};
+	memcpy(&header, _data, sizeof(m22save_header));
+	if(memcmp(header.m_magic, "M22S", 4) != 0 || header.m_version != M22SAVE_VERSION || header.m_size != _size - sizeof(m22save_header))
+	{
+		return -1;
+	};
+
+	Reader input = { _data + sizeof(m22save_header), header.m_size, 0, false };
+	_snapshot.gamestate = input.GetValue<Uint32>();
+	_snapshot.script = input.GetString();
+	_snapshot.scriptHash = input.GetValue<Uint64>();
+	_snapshot.line = input.GetValue<Sint32>();
+	_snapshot.decisions.resize(input.GetCount(2 * sizeof(Uint32)));
+	for(size_t i = 0; i < _snapshot.decisions.size(); i++)
+	{
+		_snapshot.decisions.at(i).decision = input.GetString();
+		_snapshot.decisions.at(i).choice = input.GetString();
+	};
+	_snapshot.background = input.GetString();
+	_snapshot.characters.resize(input.GetCount(3 * sizeof(Uint32) + sizeof(Sint32)));
+	for(size_t i = 0; i < _snapshot.characters.size(); i++)
+	{
+		_snapshot.characters.at(i).character = input.GetString();
+		_snapshot.characters.at(i).outfit = input.GetString();
+		_snapshot.characters.at(i).emotion = input.GetString();
+		_snapshot.characters.at(i).x = input.GetValue<Sint32>();
+	};
+	_snapshot.sprites.resize(input.GetCount(SPRITE_STATE_SIZE));
+	for(size_t i = 0; i < _snapshot.sprites.size(); i++)
+	{
+		GetSprite(input, _snapshot.sprites.at(i));
+	};
+	_snapshot.typewriterText = input.GetString();
+	_snapshot.typewriterPosition = input.GetValue<Uint32>();
+	_snapshot.typing = input.GetValue<Uint8>();
+	_snapshot.textArea = input.GetValue<Uint8>();
+	_snapshot.speaker = input.GetValue<Sint32>();
+	_snapshot.darken = input.GetValue<Uint8>();
+	_snapshot.transition = input.GetValue<Uint8>();
+	_snapshot.music = input.GetString();
+	_snapshot.loopedSting = input.GetString();
+
+	if(input.failed || input.position != input.size || _snapshot.gamestate > M22Engine::GAMESTATES::INGAME)
+	{
+		return -1;
+	};
+	return 0;
+};
+
+void M22SaveState::EncodeDelta(const M22SaveState::Snapshot& _from, const M22SaveState::Snapshot& _to, std::vector<Uint8>& _output)
+{
+	std::vector<DecisionState> decisions;
+	for(size_t i = 0; i < _to.decisions.size(); i++)
+	{
+		const DecisionState* before = FindDecision(_from.decisions, _to.decisions.at(i).decision);
+		if(before == NULL || before->choice != _to.decisions.at(i).choice)
+		{
+			decisions.push_back(_to.decisions.at(i));
+		};
+	};
+	for(size_t i = 0; i < _from.decisions.size(); i++)
+	{
+		if(FindDecision(_to.decisions, _from.decisions.at(i).decision) == NULL)
+		{
+			DecisionState cleared;
+			cleared.decision = _from.decisions.at(i).decision;
+			decisions.push_back(cleared);
+		};
+	};
+	// Text is only ever added to the page until the next NewPage, so usually only the new line needs keeping
+	bool appended = (_to.typewriterText.size() >= _from.typewriterText.size() && _to.typewriterText.compare(0, _from.typewriterText.size(), _from.typewriterText) == 0);
+
+	Uint16 fields = 0;
+	if(_to.gamestate != _from.gamestate) fields |= DELTA_GAMESTATE;
+	if(_to.script != _from.script || _to.scriptHash != _from.scriptHash) fields |= DELTA_SCRIPT;
+	if(!decisions.empty()) fields |= DELTA_DECISIONS;
+	if(_to.background != _from.background) fields |= DELTA_BACKGROUND;
+	if(!SameCharacters(_to.characters, _from.characters)) fields |= DELTA_CHARACTERS;
+	if(!SameSprites(_to.sprites, _from.sprites)) fields |= DELTA_SPRITES;
+	if(_to.typewriterText != _from.typewriterText) fields |= (appended ? DELTA_TEXT_APPEND : DELTA_TEXT_REPLACE);
+	if(_to.typewriterPosition != _from.typewriterPosition || _to.typing != _from.typing || _to.textArea != _from.textArea || _to.speaker != _from.speaker) fields |= DELTA_TYPEWRITER;
+	if(_to.darken != _from.darken || _to.transition != _from.transition) fields |= DELTA_EFFECTS;
+	if(_to.music != _from.music) fields |= DELTA_MUSIC;
+	if(_to.loopedSting != _from.loopedSting) fields |= DELTA_LOOPED_STING;
+
+	_output.clear();
+	PutValue(_output, fields);
+	PutValue(_output, _to.line);
+	if(fields & DELTA_GAMESTATE)
+	{
+		PutValue(_output, _to.gamestate);
+	};
+	if(fields & DELTA_SCRIPT)
+	{
+		PutString(_output, _to.script);
+		PutValue(_output, _to.scriptHash);
+	};
+	if(fields & DELTA_DECISIONS)
+	{
+		PutValue(_output, Uint32(decisions.size()));
+		for(size_t i = 0; i < decisions.size(); i++)
+		{
+			PutString(_output, decisions.at(i).decision);
+			PutString(_output, decisions.at(i).choice);
+		};
+	};
+	if(fields & DELTA_BACKGROUND)
+	{
+		PutString(_output, _to.background);
+	};
+	if(fields & DELTA_CHARACTERS)
+	{
+		PutValue(_output, Uint32(_to.characters.size()));
+		for(size_t i = 0; i < _to.characters.size(); i++)
+		{
+			PutString(_output, _to.characters.at(i).character);
+			PutString(_output, _to.characters.at(i).outfit);
+			PutString(_output, _to.characters.at(i).emotion);
+			PutValue(_output, _to.characters.at(i).x);
+		};
+	};
+	if(fields & DELTA_SPRITES)
+	{
+		PutValue(_output, Uint32(_to.sprites.size()));
+		for(size_t i = 0; i < _to.sprites.size(); i++)
+		{
+			PutSprite(_output, _to.sprites.at(i));
+		};
+	};
+	if(fields & DELTA_TEXT_APPEND)
+	{
+		PutString(_output, _to.typewriterText.substr(_from.typewriterText.size()));
+	};
+	if(fields & DELTA_TEXT_REPLACE)
+	{
+		PutString(_output, _to.typewriterText);
+	};
+	if(fields & DELTA_TYPEWRITER)
+	{
+		PutValue(_output, _to.typewriterPosition);
+		PutValue(_output, _to.typing);
+		PutValue(_output, _to.textArea);
+		PutValue(_output, _to.speaker);
+	};
+	if(fields & DELTA_EFFECTS)
+	{
+		PutValue(_output, _to.darken);
+		PutValue(_output, _to.transition);
+	};
+	if(fields & DELTA_MUSIC)
+	{
+		PutString(_output, _to.music);
+	};
+	if(fields & DELTA_LOOPED_STING)
+	{
+		PutString(_output, _to.loopedSting);
+	};
+	return;
+};
+
+short int M22SaveState::ApplyDelta(const Uint8* _data, size_t _size, M22SaveState::Snapshot& _snapshot)
+{
+	Reader input = { _data, _size, 0, false };
+	Uint16 fields = input.GetValue<Uint16>();
+	_snapshot.line = input.GetValue<Sint32>();
+	if(fields & DELTA_GAMESTATE)
+	{
+		_snapshot.gamestate = input.GetValue<Uint32>();
+	};
+	if(fields & DELTA_SCRIPT)
+	{
+		_snapshot.script = input.GetString();
+		_snapshot.scriptHash = input.GetValue<Uint64>();
+	};
+	if(fields & DELTA_DECISIONS)
+	{
+		Uint32 count = input.GetCount(2 * sizeof(Uint32));
+		for(Uint32 i = 0; i < count; i++)
+		{
+			DecisionState changed;
+			changed.decision = input.GetString();
+			changed.choice = input.GetString();
+			std::vector<DecisionState>::iterator found = std::find_if(_snapshot.decisions.begin(), _snapshot.decisions.end(), [&changed](const DecisionState& _state) { return _state.decision == changed.decision; });
+			if(changed.choice.empty())
+			{
+				if(found != _snapshot.decisions.end()) _snapshot.decisions.erase(found);
+			}
+			else if(found != _snapshot.decisions.end())
+			{
+				found->choice = changed.choice;
+			}
+			else
+			{
+				_snapshot.decisions.push_back(changed);
+			};
+		};
+	};
+	if(fields & DELTA_BACKGROUND)
+	{
+		_snapshot.background = input.GetString();
+	};
+	if(fields & DELTA_CHARACTERS)
+	{
+		_snapshot.characters.resize(input.GetCount(3 * sizeof(Uint32) + sizeof(Sint32)));
+		for(size_t i = 0; i < _snapshot.characters.size(); i++)
+		{
+			_snapshot.characters.at(i).character = input.GetString();
+			_snapshot.characters.at(i).outfit = input.GetString();
+			_snapshot.characters.at(i).emotion = input.GetString();
+			_snapshot.characters.at(i).x = input.GetValue<Sint32>();
+		};
+	};
+	if(fields & DELTA_SPRITES)
+	{
+		_snapshot.sprites.resize(input.GetCount(SPRITE_STATE_SIZE));
+		for(size_t i = 0; i < _snapshot.sprites.size(); i++)
+		{
+			GetSprite(input, _snapshot.sprites.at(i));
+		};
+	};
+	if(fields & DELTA_TEXT_APPEND)
+	{
+		_snapshot.typewriterText += input.GetString();
+	};
+	if(fields & DELTA_TEXT_REPLACE)
+	{
+		_snapshot.typewriterText = input.GetString();
+	};
+	if(fields & DELTA_TYPEWRITER)
+	{
+		_snapshot.typewriterPosition = input.GetValue<Uint32>();
+		_snapshot.typing = input.GetValue<Uint8>();
+		_snapshot.textArea = input.GetValue<Uint8>();
+		_snapshot.speaker = input.GetValue<Sint32>();
+	};
+	if(fields & DELTA_EFFECTS)
+	{
+		_snapshot.darken = input.GetValue<Uint8>();
+		_snapshot.transition = input.GetValue<Uint8>();
+	};
+	if(fields & DELTA_MUSIC)
+	{
+		_snapshot.music = input.GetString();
+	};
+	if(fields & DELTA_LOOPED_STING)
+	{
+		_snapshot.loopedSting = input.GetString();
+	};
+	return ((input.failed || input.position != input.size) ? -1 : 0);
+};
+
+void M22SaveState::Save(const std::string& _filename)
+{
+	printf("[M22SaveState] Saving game to %s...\n", _filename.c_str());
+	Snapshot snapshot;
+	M22SaveState::Capture(snapshot);
+
+	// Only the copy above has to happen on the main thread; one save at a time, so they land in order
+	M22SaveState::Flush();
+	M22SaveState::WRITER = std::thread([snapshot, _filename]()
+	{
+		std::vector<Uint8> encoded;
+		M22SaveState::Encode(snapshot, encoded);
+
+		// Written alongside then swapped in, so a crash mid-save leaves the old one intact
+		std::string temporary = _filename + ".tmp";
+		std::ofstream output(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+		if(!output)
+		{
+			printf("[M22SaveState] Failed to open %s for writing!\n", temporary.c_str());
+			return;
+		};
+		output.write(reinterpret_cast<const char*>(encoded.data()), std::streamsize(encoded.size()));
+		output.close();
+		if(!output)
+		{
+			printf("[M22SaveState] Failed writing %s!\n", temporary.c_str());
+			std::remove(temporary.c_str());
+			return;
+		};
+		std::remove(_filename.c_str());
+		if(std::rename(temporary.c_str(), _filename.c_str()) != 0)
+		{
+			printf("[M22SaveState] Failed to replace %s!\n", _filename.c_str());
+		};
+	});
+	return;
+};
+
+short int M22SaveState::Load(const std::string& _filename)
+{
+	printf("[M22SaveState] Loading game from %s...\n", _filename.c_str());
+	M22SaveState::Flush();
+
+	std::ifstream input(_filename, std::ios::binary | std::ios::in);
+	if(!input)
+	{
+		printf("[M22SaveState] %s doesn't exist!\n", _filename.c_str());
+		return -1;
+	};
+	std::vector<Uint8> encoded((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	input.close();
+
+	Snapshot snapshot;
+	if(encoded.empty() || M22SaveState::Decode(encoded.data(), encoded.size(), snapshot) != 0)
+	{
+		printf("[M22SaveState] %s is not a version %i savegame!\n", _filename.c_str(), M22SAVE_VERSION);
+		return -1;
+	};
+	// Rewinding from here shouldn't lead back into the game that was being played before
+	M22History::Reset();
+	if(M22SaveState::Apply(snapshot) != 0)
+	{
+		return -1;
+	};
+	// If Apply moved the script on (past a finished transition), the line it stopped at has been recorded already
+	if(M22Script::currentLineIndex == snapshot.line)
+	{
+		M22History::Record();
+	};
+	return 0;
+};
+
+void M22SaveState::Flush(void)
+{
+	if(M22SaveState::WRITER.joinable())
+	{
+		M22SaveState::WRITER.join();
+	};
+	return;
+};
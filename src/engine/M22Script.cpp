@@ -2,11 +2,9 @@
 
 using namespace March22;
 
-std::string M22Script::currentLine;
-std::wstring M22Script::currentLine_w;
+std::string_view M22Script::currentLine;
 int M22Script::currentLineIndex = NULL;
-std::vector<std::string> M22Script::currentScript;
-std::vector<std::wstring> M22Script::currentScript_w;
+Uint64 M22Script::linesExecuted = 0;
 int M22Script::activeSpeakerIndex = 1;
 SDL_Surface* M22Script::currentLineSurface = NULL;
 SDL_Surface* M22Script::currentLineSurfaceShadow = NULL;
@@ -14,20 +12,34 @@ SDL_Texture* M22Script::currentLineTexture = NULL;
 SDL_Texture* M22Script::currentLineTextureShadow = NULL;
 float M22Script::fontSize;
 std::vector<M22Script::Decision> M22Script::gameDecisions;
+std::unordered_map<std::string, int> M22Script::gameDecisionLookup;
+int M22Script::activeDecision = -1;
+std::vector<int> M22Script::activeChoices;
+std::vector<M22Script::DecisionChoiceTexture> M22Script::decisionTextures;
+int M22Script::decisionTexturesDecision = -1;
+std::vector<int> M22Script::decisionTexturesChoices;
+int M22Script::decisionTexturesWidth = 0;
 M22Script::LINETYPE M22Script::currentLineType;
 std::string M22Script::currentScriptFileName;
 bool M22Script::updateCurrentLine = false;
 SDL_Rect M22Script::currentLineTextureShadowRect = {8+1,404+1,0,0};
 SDL_Rect M22Script::currentLineTextureRect = {8,404,0,0};
-std::wstring M22Script::typewriter_text;
+std::string M22Script::typewriter_text;
 size_t M22Script::typewriter_currPos;
+size_t M22Script::typewriter_end = 0;
+size_t M22Script::typewriter_page = 0;
+Uint32 M22Script::typewriter_elapsed = 0;
+size_t M22Script::typewriter_revealed = 0;
+int M22Script::pageRows = 0;
 NFont* M22Script::font;
+std::unordered_map<std::string, M22Script::ReadLineSet> M22Script::readLines;
+bool M22Script::currentLineUnread = false;
 
 short int M22Script::LoadTextBoxPosition(const char* _filename)
 {
 	printf("[M22Script] Loading \"%s\" \n", _filename);
-	std::ifstream input(_filename);
-	if(input)
+	std::stringstream input;
+	if(M22Archive::OpenStream(_filename, input))
 	{
 		input >> currentLineTextureRect.x;
 		input >> currentLineTextureRect.y;
@@ -39,21 +51,22 @@ short int M22Script::LoadTextBoxPosition(const char* _filename)
 		printf("Failed to load decisions file: %s \n", _filename);
 		return -1;
 	};
-	input.close();
 	return 0;
 };
 
 short int M22Script::LoadGameDecisions(const char* _filename)
 {
 	printf("[M22Script] Loading \"%s\" \n", _filename);
-	std::wifstream input(_filename);
+	std::stringstream input;
 	int length;
-	std::wstring temp;
-	std::vector<std::wstring> tempArr;
-	if(input)
+	std::string temp;
+	std::vector<std::string> tempArr;
+	if(M22Archive::OpenStream(_filename, input))
 	{
 		getline(input,temp);
-		length = atoi(M22Script::to_string(temp).c_str());
+		length = atoi(temp.c_str());
+		M22Script::gameDecisions.clear();
+		M22Script::gameDecisionLookup.clear();
 		M22Script::gameDecisions.resize(length);
 
 		for(int i = 0; i < length; i++)
@@ -68,15 +81,16 @@ short int M22Script::LoadGameDecisions(const char* _filename)
 
 			//Push back the name of the decision to array
 			M22Script::gameDecisions.at(i).name = tempArr.at(0);
+			M22Script::gameDecisionLookup.emplace(tempArr.at(0), i);
 
 			//Get number of decisions for upcoming for loop
-			M22Script::gameDecisions.at(i).num_of_choices = atoi(M22Script::to_string(tempArr.at(1)).c_str());
+			int num_of_choices = atoi(tempArr.at(1).c_str());
 
 			//For number of decisions, push back the decision
-			for(int k = 0; k < M22Script::gameDecisions.at(i).num_of_choices; k++)
+			for(int k = 0; k < num_of_choices; k++)
 			{
 				getline(input,temp);
-				M22Script::gameDecisions.at(i).choices.push_back(temp);
+				M22Script::FindOrAddChoice(i, temp);
 			};
 		};
 	}
@@ -85,108 +99,365 @@ short int M22Script::LoadGameDecisions(const char* _filename)
 		printf("Failed to load decisions file: %s \n", _filename);
 		return -1;
 	};
-	input.close();
 	return 0;
 };
 
-void M22Script::DrawDecisions(M22Script::Decision* _decision,int ScrW, int ScrH)
+int M22Script::FindOrAddDecision(const std::string& _name)
+{
+	std::unordered_map<std::string, int>::iterator found = M22Script::gameDecisionLookup.find(_name);
+	if(found != M22Script::gameDecisionLookup.end())
+	{
+		return found->second;
+	};
+	M22Script::gameDecisions.push_back(M22Script::Decision());
+	M22Script::gameDecisions.back().name = _name;
+	int index = int(M22Script::gameDecisions.size()-1);
+	M22Script::gameDecisionLookup.emplace(_name, index);
+	return index;
+};
+
+int M22Script::FindOrAddChoice(int _decision, const std::string& _name)
+{
+	M22Script::Decision& decision = M22Script::gameDecisions.at(_decision);
+	std::unordered_map<std::string, int>::iterator found = decision.choiceLookup.find(_name);
+	if(found != decision.choiceLookup.end())
+	{
+		return found->second;
+	};
+	decision.choices.push_back(_name);
+	decision.num_of_choices = (short unsigned int)decision.choices.size();
+	int index = int(decision.choices.size()-1);
+	decision.choiceLookup.emplace(_name, index);
+	return index;
+};
+
+void M22Script::RenderDecisionTextures(M22Script::Decision* _decision, int ScrW)
 {
 	SDL_Color tempCol = {255,255,255,255};
 	SDL_Color tempCol2 = {0,0,0,255};
-	std::wstring choiceTextTemp;
-	for(int i = 0; i < _decision->num_of_choices; i++)
+	M22Script::ReleaseDecisionTextures();
+
+	int y = M22Script::currentLineTextureRect.y;
+	for(size_t i = 0; i < M22Script::activeChoices.size(); i++)
 	{
-		choiceTextTemp += (_decision->choices.at(i) + to_wstring("\n"));
+		std::string choiceTextTemp = _decision->choices.at(M22Script::activeChoices.at(i));
+		std::replace( choiceTextTemp.begin(), choiceTextTemp.end(), '_', ' ');
+
+		SDL_Surface* tempSurfShadow =	TTF_RenderUTF8_Blended_Wrapped( M22Graphics::textFont, choiceTextTemp.c_str(), tempCol2,	ScrW-12 );
+		SDL_Surface* tempSurf =			TTF_RenderUTF8_Blended_Wrapped( M22Graphics::textFont, choiceTextTemp.c_str(), tempCol,	ScrW-12 );
+
+		M22Script::DecisionChoiceTexture choice;
+		choice.text = NULL;
+		choice.shadow = NULL;
+		choice.rect.x = M22Script::currentLineTextureRect.x;
+		choice.rect.y = y;
+		choice.rect.w = choice.rect.h = 0;
+		if(tempSurfShadow == NULL || tempSurf == NULL)
+		{
+			printf("[M22Script] Failed to draw decision choice!\n");
+		}
+		else
+		{
+			choice.shadow =	SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, tempSurfShadow);
+			choice.text =	SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, tempSurf);
+			choice.rect.w = tempSurf->w;
+			choice.rect.h = tempSurf->h;
+		};
+		SDL_FreeSurface(tempSurfShadow);
+		SDL_FreeSurface(tempSurf);
+
+		// Keep a blank line's worth of space for choices that failed, so the rest stay where the keys say they are
+		y += (choice.rect.h > 0 ? choice.rect.h : TTF_FontLineSkip(M22Graphics::textFont));
+		M22Script::decisionTextures.push_back(choice);
+	};
+
+	M22Script::decisionTexturesDecision = int(_decision - &M22Script::gameDecisions[0]);
+	M22Script::decisionTexturesChoices = M22Script::activeChoices;
+	M22Script::decisionTexturesWidth = ScrW;
+	return;
+};
+
+void M22Script::ReleaseDecisionTextures(void)
+{
+	for(size_t i = 0; i < M22Script::decisionTextures.size(); i++)
+	{
+		if(M22Script::decisionTextures.at(i).text != NULL) SDL_DestroyTexture(M22Script::decisionTextures.at(i).text);
+		if(M22Script::decisionTextures.at(i).shadow != NULL) SDL_DestroyTexture(M22Script::decisionTextures.at(i).shadow);
 	};
-	std::replace( choiceTextTemp.begin(), choiceTextTemp.end(), '_', ' ');
+	M22Script::decisionTextures.clear();
+	M22Script::decisionTexturesChoices.clear();
+	M22Script::decisionTexturesDecision = -1;
+	M22Script::decisionTexturesWidth = 0;
+	return;
+};
 
-	SDL_Surface* tempSurfShadow;
-	SDL_Surface* tempSurf;
-	
-	Uint16* UNICODETEXT = M22Script::to_Uint16(choiceTextTemp);
-	tempSurfShadow =	TTF_RenderUNICODE_Blended_Wrapped( M22Graphics::textFont, UNICODETEXT, tempCol2,	ScrW-12 );
-	tempSurf =			TTF_RenderUNICODE_Blended_Wrapped( M22Graphics::textFont, UNICODETEXT, tempCol,	ScrW-12 );
-	delete [] UNICODETEXT;
+short int M22Script::SelectChoice(int _slot)
+{
+	if(M22Script::currentLineType != M22Script::LINETYPE::MAKE_DECISION || M22Script::activeDecision == -1)
+	{
+		return -1;
+	};
+	if(_slot < 0 || _slot >= int(M22Script::activeChoices.size()))
+	{
+		printf("[M22Script] Option %i selected but only %i available!\n", _slot+1, int(M22Script::activeChoices.size()));
+		return -1;
+	};
+	M22Script::gameDecisions.at(M22Script::activeDecision).selectedOption = (short int)M22Script::activeChoices.at(_slot);
+	M22Script::ReleaseDecisionTextures();
+	M22Sound::PlaySting("sfx/stings/SE001.OGG", true);
+	M22Script::ChangeLine(++M22Script::currentLineIndex);
+	return 0;
+};
+
+void M22Script::DrawDecisions(M22Script::Decision* _decision,int ScrW, int ScrH)
+{
+	// Only rasterize the choices when a different decision comes up
+	if(M22Script::decisionTexturesDecision != int(_decision - &M22Script::gameDecisions[0]) ||
+		M22Script::decisionTexturesChoices != M22Script::activeChoices ||
+		M22Script::decisionTexturesWidth != ScrW)
+	{
+		M22Script::RenderDecisionTextures(_decision, ScrW);
+	};
+
+	int mouseX = int(M22Engine::MousePos.x());
+	int mouseY = int(M22Engine::MousePos.y());
+	for(size_t i = 0; i < M22Script::decisionTextures.size(); i++)
+	{
+		const M22Script::DecisionChoiceTexture& choice = M22Script::decisionTextures.at(i);
+		if(choice.text == NULL)
+		{
+			continue;
+		};
+
+		// Highlighting the choice under the mouse is just a colour mod on its cached texture
+		bool hovered = (mouseX >= choice.rect.x && mouseX < choice.rect.x + choice.rect.w && mouseY >= choice.rect.y && mouseY < choice.rect.y + choice.rect.h);
+		SDL_SetTextureColorMod(choice.text, 255, (hovered ? 220 : 255), (hovered ? 140 : 255));
+
+		SDL_Rect shadowRect = { choice.rect.x + 1, choice.rect.y + 1, choice.rect.w, choice.rect.h };
+		SDL_RenderCopy(M22Renderer::SDL_RENDERER, choice.shadow, NULL, &shadowRect);
+		SDL_RenderCopy(M22Renderer::SDL_RENDERER, choice.text, NULL, &choice.rect);
+	};
+	return;
+};
+
+/*
+	Draws the page (with a "shadow" 2px adjacent) through M22TextLayer; UpdateTypewriter is what types it out.
+*/
+void M22Script::DrawCurrentLine(int ScrW, int ScrH)
+{
+	const M22TextLayer::LineLayout* layout = M22TextLayer::GetLineLayout(M22Script::currentLineIndex);
+	size_t page = (layout != NULL ? std::min(M22Script::typewriter_page, layout->pages.size() - 1) : 0);
+	size_t pageStart = (layout != NULL ? M22TextLayer::PageStart(*layout, page) : 0);
+	size_t pageEnd = (layout != NULL ? M22TextLayer::PageEnd(*layout, page) : M22Script::currentLine.size());
+	std::string_view line = M22Script::currentLine.substr(pageStart, pageEnd - pageStart);
+	size_t revealedInLine = line.size();
+	if(M22Script::updateCurrentLine)
+	{
+		revealedInLine = std::min(std::max(M22Script::typewriter_currPos, pageStart) - pageStart, line.size());
+	}
+	else if(M22Script::typewriter_currPos == 0)
+	{
+		// The whole line's been typed out, so it's all in typewriter_text already
+		line = std::string_view();
+		revealedInLine = 0;
+		layout = NULL;
+	};
+
+	// The rest of the page is laid out too, so words don't jump to the next line as they're typed out
+	M22TextLayer::Draw(
+		M22Script::typewriter_text, 
+		line, 
+		revealedInLine, 
+		TEXT_COLUMN_X, 
+		TEXT_COLUMN_Y, 
+		ScrW - TEXT_COLUMN_MARGIN, 
+		ScrW, 
+		ScrH,
+		layout,
+		page
+	);
+	return;
+};
+
+void M22Script::BeginTypewriter(void)
+{
+	M22Script::updateCurrentLine = true;
+	M22Script::typewriter_currPos = 0;
+	M22Script::typewriter_page = 0;
+	M22Script::typewriter_elapsed = 0;
+	M22Script::typewriter_revealed = 0;
+	M22Script::typewriter_end = M22Script::currentLine.size();
+
+	const M22TextLayer::LineLayout* layout = M22TextLayer::GetLineLayout(M22Script::currentLineIndex);
+	if(layout != NULL)
+	{
+		M22Script::typewriter_end = M22TextLayer::PageEnd(*layout, 0);
+		int rows = int(layout->pages.size() > 1 ? layout->pages.at(1) : layout->rows.size());
+		// Doesn't fit under what's already on the page, so it starts a new one
+		if(M22Script::pageRows > 0 && M22Script::pageRows + rows > M22TextLayer::RowsPerPage())
+		{
+			M22Script::NewPage();
+		};
+	};
+	return;
+};
 
-	if(tempSurfShadow == NULL)
+void M22Script::UpdateTypewriter(Uint32 _ms)
+{
+	if(M22Script::updateCurrentLine == false || M22Interface::DRAW_TEXT_AREA == false || M22Engine::GAMESTATE != M22Engine::GAMESTATES::INGAME)
 	{
-		printf("[M22Script] Failed to draw message shadow!\n");
 		return;
 	};
-	if(tempSurf == NULL)
+	M22Script::typewriter_elapsed += _ms;
+
+	// The first character straight away, then however many the time since the page started allows
+	size_t due = size_t(M22Script::typewriter_elapsed) * TYPEWRITER_CHARS_PER_SECOND / 1000 + 1;
+	size_t before = M22Script::typewriter_currPos;
+	while(M22Script::typewriter_revealed < due && M22Script::typewriter_currPos < M22Script::typewriter_end)
+	{
+		// One character at a time, however many bytes it takes
+		size_t next = M22NextUTF8(M22Script::currentLine, M22Script::typewriter_currPos);
+		M22Script::typewriter_text.append(M22Script::currentLine.substr(M22Script::typewriter_currPos, next - M22Script::typewriter_currPos));
+		M22Script::typewriter_currPos = next;
+		M22Script::typewriter_revealed++;
+	};
+	if(M22Script::typewriter_currPos != before)
+	{
+		M22FrameScheduler::MarkDirty();
+	};
+	if(M22Script::typewriter_currPos >= M22Script::typewriter_end)
+	{
+		M22Script::FinishTypewriter();
+	};
+	return;
+};
+
+void M22Script::FinishTypewriter(void)
+{
+	if(M22Script::updateCurrentLine == false)
 	{
-		printf("[M22Script] Failed to draw message!\n");
 		return;
 	};
+	if(M22Script::typewriter_currPos < M22Script::typewriter_end)
+	{
+		M22Script::typewriter_text.append(M22Script::currentLine.substr(M22Script::typewriter_currPos, M22Script::typewriter_end - M22Script::typewriter_currPos));
+		M22Script::typewriter_currPos = M22Script::typewriter_end;
+	};
+	M22Script::updateCurrentLine = false;
+	M22FrameScheduler::MarkDirty();
 
-	SDL_Texture* temp2 =	SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, tempSurfShadow);
-	SDL_Texture* temp =		SDL_CreateTextureFromSurface(M22Renderer::SDL_RENDERER, tempSurf);
-	
-	SDL_Rect tempDst2 = {8+1,404+1,0,0};
-	SDL_Rect tempDst = {8,404,0,0};
-		
-	//SDL_QueryTexture(temp2, NULL, NULL, &tempDst2.w, &tempDst2.h);
-	//SDL_QueryTexture(temp, NULL, NULL, &tempDst.w, &tempDst.h);
-		
-	SDL_QueryTexture(temp2, NULL, NULL, &M22Script::currentLineTextureShadowRect.w, &M22Script::currentLineTextureShadowRect.h);
-	SDL_QueryTexture(temp, NULL, NULL, &M22Script::currentLineTextureRect.w, &M22Script::currentLineTextureRect.h);
-		
-	SDL_RenderCopy(M22Renderer::SDL_RENDERER, temp2, NULL, &currentLineTextureShadowRect);
-	SDL_RenderCopy(M22Renderer::SDL_RENDERER, temp, NULL, &currentLineTextureRect);
-	
-
-	SDL_DestroyTexture(temp2);
-	SDL_DestroyTexture(temp);
-	SDL_FreeSurface(tempSurfShadow);
-	SDL_FreeSurface(tempSurf);
-	//delete tempSurf;
+	// Part way through a line, the position stays at the end of the page for NextTypewriterPage to carry on from
+	const M22TextLayer::LineLayout* layout = M22TextLayer::GetLineLayout(M22Script::currentLineIndex);
+	if(layout != NULL && M22Script::typewriter_page + 1 < layout->pages.size())
+	{
+		return;
+	};
+	M22Script::typewriter_currPos = 0;
+	if (M22Script::currentLineType == March22::M22Script::LINETYPE::NARRATIVE ||
+		M22Script::currentLineType == March22::M22Script::LINETYPE::SPEECH)
+	{
+		typewriter_text += "\n\n";
+		if(layout != NULL)
+		{
+			// Its rows and the blank one after
+			size_t page = std::min(M22Script::typewriter_page, layout->pages.size() - 1);
+			M22Script::pageRows += int(layout->rows.size() - layout->pages.at(page)) + 1;
+		};
+	};
+	return;
+};
 
+void M22Script::FinishLine(void)
+{
+	M22Script::FinishTypewriter();
+	while(M22Script::NextTypewriterPage())
+	{
+		M22Script::FinishTypewriter();
+	};
 	return;
 };
 
-std::string wstring_to_utf8(const std::wstring& str)
+bool M22Script::NextTypewriterPage(void)
 {
-	std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-	return myconv.to_bytes(str);
-}
+	if(M22Script::updateCurrentLine == true)
+	{
+		return false;
+	};
+	const M22TextLayer::LineLayout* layout = M22TextLayer::GetLineLayout(M22Script::currentLineIndex);
+	if(layout == NULL || M22Script::typewriter_page + 1 >= layout->pages.size())
+	{
+		return false;
+	};
+	M22Script::NewPage();
+	M22Script::typewriter_page++;
+	M22Script::typewriter_currPos = M22TextLayer::PageStart(*layout, M22Script::typewriter_page);
+	M22Script::typewriter_end = M22TextLayer::PageEnd(*layout, M22Script::typewriter_page);
+	M22Script::typewriter_elapsed = 0;
+	M22Script::typewriter_revealed = 0;
+	M22Script::updateCurrentLine = true;
+	return true;
+};
 
-/*
-	An extremely slow function (comparitively) for drawing decent-looking text.
-	Draws text then a "shadow" 1px adjacent @ 640x480
-*/
-void M22Script::DrawCurrentLine(int ScrW, int ScrH)
+void M22Script::Advance(void)
 {
-	bool finished = false;
 	if(M22Script::updateCurrentLine == true)
 	{
-		SDL_Color tempCol2 = {0,0,0,255};       // Black
-		SDL_Color tempCol = {255,255,255,255};  // White
+		M22Script::FinishTypewriter();
+	}
+	else if(M22Script::NextTypewriterPage() == false)
+	{
+		M22Script::ChangeLine(++M22Script::currentLineIndex);
+	};
+	return;
+};
+
+void M22Script::ResumeTypewriter(void)
+{
+	M22Script::typewriter_page = 0;
+	M22Script::typewriter_elapsed = 0;
+	M22Script::typewriter_revealed = 0;
+	M22Script::typewriter_end = M22Script::currentLine.size();
+	bool lineDone = (M22Script::updateCurrentLine == false && M22Script::typewriter_currPos == 0);
 
-		try
+	size_t pageStart = 0;
+	const M22TextLayer::LineLayout* layout = M22TextLayer::GetLineLayout(M22Script::currentLineIndex);
+	if(layout != NULL)
+	{
+		if(lineDone)
 		{
-			//if (M22Script::currentLine_w.at(typewriter_currPos) == 0x2019)
-			//{
-			//	M22Script::typewriter_text += M22Script::currentLine_w.at(typewriter_currPos++);
-			//}
-			M22Script::typewriter_text += M22Script::currentLine_w.at(typewriter_currPos++);
+			M22Script::typewriter_page = layout->pages.size() - 1;
 		}
-		catch (std::exception& e)
+		else
 		{
-			M22Script::updateCurrentLine = false;
-			M22Script::typewriter_currPos = 0;
-			finished = true;
-		}
+			while(M22Script::typewriter_page + 1 < layout->pages.size() && M22TextLayer::PageStart(*layout, M22Script::typewriter_page + 1) <= M22Script::typewriter_currPos)
+			{
+				M22Script::typewriter_page++;
+			};
+		};
+		pageStart = M22TextLayer::PageStart(*layout, M22Script::typewriter_page);
+		M22Script::typewriter_end = M22TextLayer::PageEnd(*layout, M22Script::typewriter_page);
 	};
 
-	(*font).drawColumn(M22Renderer::SDL_RENDERER, 55 + 2, 50 + 2, ScrW - 90, NFont::Color(0, 0, 0, 255), wstring_to_utf8(M22Script::typewriter_text).c_str());
-	(*font).drawColumn(M22Renderer::SDL_RENDERER, 55, 50, ScrW - 90, wstring_to_utf8(M22Script::typewriter_text).c_str());
-
-
-	if(finished==true)
-		if (M22Script::currentLineType == March22::M22Script::LINETYPE::NARRATIVE ||
-			M22Script::currentLineType == March22::M22Script::LINETYPE::SPEECH)
-				typewriter_text += L"\n\n";
+	// Whatever's on the page before the part of this line that's been typed out
+	size_t typed = 0;
+	if(!lineDone)
+	{
+		M22Script::typewriter_currPos = std::min(std::max(M22Script::typewriter_currPos, pageStart), M22Script::typewriter_end);
+		typed = std::min(M22Script::typewriter_currPos - pageStart, M22Script::typewriter_text.size());
+	};
+	std::string_view before = std::string_view(M22Script::typewriter_text).substr(0, M22Script::typewriter_text.size() - typed);
+	// Each line on the page ends in a blank row, and the text ends with the blank one after that
+	M22Script::pageRows = std::max(0, M22TextLayer::CountRows(before, M22TextLayer::ColumnWidth()) - 1);
+	M22FrameScheduler::MarkDirty();
+	return;
+};
 
+void M22Script::NewPage(void)
+{
+	M22Script::typewriter_currPos = 0;
+	M22Script::typewriter_text.clear();
+	M22Script::pageRows = 0;
+	M22FrameScheduler::MarkDirty();
 	return;
 };
 
@@ -195,8 +466,8 @@ void M22Script::DrawCurrentLine(int ScrW, int ScrH)
 */
 unsigned int M22Script::SplitString(const std::string &txt, std::vector<std::string> &strs, char ch)
 {
-    unsigned int pos = txt.find( ch );
-    unsigned int initialPos = 0;
+    size_t pos = txt.find( ch );
+    size_t initialPos = 0;
     strs.clear();
 
     // Decompose statement
@@ -213,14 +484,14 @@ unsigned int M22Script::SplitString(const std::string &txt, std::vector<std::str
     return strs.size();
 };
 
-unsigned int M22Script::SplitString(const std::wstring &txt, std::vector<std::wstring> &strs, char ch)
+unsigned int M22Script::SplitString(std::string_view txt, std::vector<std::string_view> &strs, char ch)
 {
-    unsigned int pos = txt.find( ch );
-    unsigned int initialPos = 0;
+    size_t pos = txt.find( ch );
+    size_t initialPos = 0;
     strs.clear();
 
-    // Decompose statement
-    while( pos != std::string::npos ) {
+    // Same as above, but the parts are views of txt rather than copies
+    while( pos != std::string_view::npos ) {
         strs.push_back( txt.substr( initialPos, pos - initialPos + 1 ) );
         initialPos = pos + 1;
 
@@ -228,48 +499,197 @@ unsigned int M22Script::SplitString(const std::wstring &txt, std::vector<std::ws
     }
 
     // Add the last one
-    strs.push_back( txt.substr( initialPos, std::min( pos, txt.size() ) - initialPos + 1 ) );
+    strs.push_back( txt.substr( initialPos ) );
 
     return strs.size();
 };
 
-void M22Script::ClearCharacters(void)
+void M22Script::ClearCharacters(bool _brutal)
 {
-	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, M22Graphics::NEXT_BACKGROUND_RENDER_TARGET);
-	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 0,0,0,0);
-	SDL_RenderClear(M22Renderer::SDL_RENDERER);
-	
-	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite, NULL, NULL);
+	M22CharacterLayer::Clear(_brutal);
 	SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
+	M22FrameScheduler::MarkDirty();
+	return;
+};
 
-	SDL_SetRenderTarget(M22Renderer::SDL_RENDERER, NULL);
-	SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255,255,255,255);
+void M22Script::ChangeLine(int _newLine)
+{
+	// Runs commands back to back until one has to wait (speech, Wait, transitions, decisions...)
+	int line = _newLine;
+	for(int commands = 0; commands < MAX_COMMANDS_PER_CHANGELINE; commands++)
+	{
+		if(line < 0 || (size_t)line >= M22ScriptCompiler::currentScript_c.size())
+		{
+			printf("[M22Script] Out of bounds line change!\n");
+			return;
+		};
 
-	M22Graphics::changeQueued = M22Graphics::BACKGROUND_UPDATE_TYPES::CHARACTER;
+		M22FrameScheduler::MarkDirty();
+		M22ScriptCompiler::CURRENT_LINE = &M22ScriptCompiler::currentScript_c.at(line);
+		M22Script::currentLineType = M22ScriptCompiler::CURRENT_LINE->m_lineType;
+		M22Script::currentLineIndex = line;
 
+		int nextLine = line + 1;
+		M22Script::linesExecuted++;
+		M22ScriptCompiler::EXECUTE_RESULT result;
+		{
+			M22_PROFILE_SCOPE("ExecuteCommand");
+			result = M22ScriptCompiler::COMMAND_HANDLERS[M22ScriptCompiler::CURRENT_LINE->m_lineType](*M22ScriptCompiler::CURRENT_LINE, nextLine);
+		};
+		if(result == M22ScriptCompiler::YIELD)
+		{
+			// Update currentLine variable, now that we've settled on a line
+			if((size_t)M22Script::currentLineIndex < M22ScriptCompiler::currentScript_c.size())
+			{
+				M22Script::currentLine = M22ScriptCompiler::currentScript_c.at(M22Script::currentLineIndex).m_lineContents;
+			};
+			M22Script::BeginTypewriter();
+			// Skipping goes through lines far faster than anything could load; M22Engine::FastForward catches up once a frame
+			if(!M22Engine::skipping)
+			{
+				M22Prefetcher::Update(M22Script::currentLineIndex + 1);
+			};
+			if(M22Script::currentLineType == M22Script::LINETYPE::SPEECH || M22Script::currentLineType == M22Script::LINETYPE::NARRATIVE)
+			{
+				M22Script::currentLineUnread = !M22Script::IsLineRead(M22Script::currentLineIndex);
+				M22Script::MarkLineRead(M22Script::currentLineIndex);
+			}
+			else
+			{
+				M22Script::currentLineUnread = false;
+			};
+			if(M22Script::currentLineType == M22Script::LINETYPE::SPEECH || M22Script::currentLineType == M22Script::LINETYPE::NARRATIVE || M22Script::currentLineType == M22Script::LINETYPE::MAKE_DECISION)
+			{
+				M22History::Record();
+			};
+			return;
+		};
+		line = nextLine;
+	};
+	printf("[M22Script] Ran %i commands without reaching one that waits; is there a Goto loop near line %i of %s?\n", MAX_COMMANDS_PER_CHANGELINE, line, M22Script::currentScriptFileName.c_str());
 	return;
 };
 
-void M22Script::ChangeLine(int _newLine)
+bool M22Script::IsLineRead(int _line)
+{
+	std::unordered_map<std::string, M22Script::ReadLineSet>::const_iterator found = M22Script::readLines.find(M22Script::currentScriptFileName);
+	if(found == M22Script::readLines.end() || _line < 0 || found->second.lineCount != M22ScriptCompiler::currentScript_c.size())
+	{
+		return false;
+	};
+	size_t word = size_t(_line) / 64;
+	return (word < found->second.bits.size() && (found->second.bits.at(word) & (Uint64(1) << (_line % 64))) != 0);
+};
+
+void M22Script::MarkLineRead(int _line)
 {
-	if((size_t)_newLine > M22ScriptCompiler::currentScript_c.size())
+	if(_line < 0 || M22Script::currentScriptFileName.empty())
 	{
-		printf("[M22Script] Out of bounds line change!\n");
 		return;
 	};
+	M22Script::ReadLineSet& lines = M22Script::readLines[M22Script::currentScriptFileName];
+	Uint32 lineCount = Uint32(M22ScriptCompiler::currentScript_c.size());
+	if(lines.lineCount != lineCount)
+	{
+		// The script's been edited since, so the old bits don't line up any more
+		lines.lineCount = lineCount;
+		lines.bits.assign((lineCount + 63) / 64, 0);
+	};
+	size_t word = size_t(_line) / 64;
+	if(word < lines.bits.size())
+	{
+		lines.bits.at(word) |= (Uint64(1) << (_line % 64));
+	};
+	return;
+};
 
-	// Update currentLine variable
-	M22Script::currentLine = M22Script::to_string(M22ScriptCompiler::currentScript_c.at(_newLine).m_lineContents);
-	M22Script::currentLine_w = M22ScriptCompiler::currentScript_c.at(_newLine).m_lineContents;
+short int M22Script::LoadReadLines(const char* _filename)
+{
+	std::ifstream input(_filename, std::ios::binary | std::ios::in);
+	if(!input)
+	{
+		printf("[M22Script] %s doesn't exist; no lines have been read yet\n", _filename);
+		return 0;
+	};
 
-	M22Script::updateCurrentLine = true;
+	input.seekg(0, std::ios::end);
+	const Uint64 fileSize = Uint64(input.tellg());
+	input.seekg(0, std::ios::beg);
 
-	M22ScriptCompiler::CURRENT_LINE = &M22ScriptCompiler::currentScript_c.at(_newLine);
-	M22Script::currentLineType = M22ScriptCompiler::CURRENT_LINE->m_lineType;
+	char magic[4];
+	Uint32 version = 0, numScripts = 0;
+	input.read(magic, sizeof(magic));
+	input.read((char*)&version, sizeof(version));
+	input.read((char*)&numScripts, sizeof(numScripts));
+	if(!input || memcmp(magic, "M22R", 4) != 0 || version != READ_LINES_VERSION)
+	{
+		printf("[M22Script] %s is invalid or out of date; ignoring it\n", _filename);
+		return -1;
+	};
 
-	M22Script::currentLineIndex = _newLine;
-	M22ScriptCompiler::ExecuteCommand(M22ScriptCompiler::currentScript_c.at(M22Script::currentLineIndex), M22Script::currentLineIndex);
-	return;
+	M22Script::readLines.clear();
+	for(Uint32 i = 0; i < numScripts; i++)
+	{
+		// The lengths come from the file, so nothing is allocated for more than what's left of it
+		Uint32 nameLength = 0;
+		input.read((char*)&nameLength, sizeof(nameLength));
+		if(!input || nameLength > fileSize - Uint64(input.tellg()))
+		{
+			printf("[M22Script] %s is truncated or corrupt; keeping the first %u scripts\n", _filename, i);
+			return -1;
+		};
+		std::string name(nameLength, '\0');
+		input.read(&name[0], nameLength);
+		M22Script::ReadLineSet lines;
+		lines.lineCount = 0;
+		input.read((char*)&lines.lineCount, sizeof(lines.lineCount));
+		if(!input || (Uint64(lines.lineCount) + 63) / 64 * sizeof(Uint64) > fileSize - Uint64(input.tellg()))
+		{
+			printf("[M22Script] %s is truncated or corrupt; keeping the first %u scripts\n", _filename, i);
+			return -1;
+		};
+		lines.bits.resize((size_t(lines.lineCount) + 63) / 64);
+		if(!lines.bits.empty())
+		{
+			input.read((char*)lines.bits.data(), lines.bits.size() * sizeof(Uint64));
+		};
+		if(!input)
+		{
+			printf("[M22Script] %s is truncated or corrupt; keeping the first %u scripts\n", _filename, i);
+			return -1;
+		};
+		M22Script::readLines[name] = lines;
+	};
+	return 0;
+};
+
+short int M22Script::SaveReadLines(const char* _filename)
+{
+	std::ofstream output(_filename, std::ios::binary | std::ios::out);
+	if(!output)
+	{
+		printf("[M22Script] Failed to save %s\n", _filename);
+		return -1;
+	};
+
+	Uint32 version = READ_LINES_VERSION;
+	Uint32 numScripts = Uint32(M22Script::readLines.size());
+	output.write("M22R", 4);
+	output.write((const char*)&version, sizeof(version));
+	output.write((const char*)&numScripts, sizeof(numScripts));
+	for(std::unordered_map<std::string, M22Script::ReadLineSet>::const_iterator it = M22Script::readLines.begin(); it != M22Script::readLines.end(); ++it)
+	{
+		Uint32 nameLength = Uint32(it->first.size());
+		output.write((const char*)&nameLength, sizeof(nameLength));
+		output.write(it->first.data(), nameLength);
+		output.write((const char*)&it->second.lineCount, sizeof(it->second.lineCount));
+		if(!it->second.bits.empty())
+		{
+			output.write((const char*)it->second.bits.data(), it->second.bits.size() * sizeof(Uint64));
+		};
+	};
+	output.close();
+	return 0;
 };
 
 bool M22Script::isColon(int _char)
@@ -312,138 +732,9 @@ void M22Script::FadeToBlack(void)
 	Checks the string against database of character names
 	and returns the character's enumerator
 */
-M22Script::LINETYPE M22Script::CheckLineType(std::wstring _input)
+static_assert(M22KeywordsSorted(M22Script::LINETYPE_KEYWORDS), "M22Script::LINETYPE_KEYWORDS must be sorted by name");
+
+M22Script::LINETYPE M22Script::CheckLineType(std::string_view _input)
 {
-	std::string temp = M22Script::to_string(_input);
-	temp.erase(std::remove_if(temp.begin(), temp.end(), isspace));
-	_input = M22Script::to_wstring(temp.c_str());
-	if(_input == M22Script::to_wstring("DrawBackground"))
-	{
-		return M22Script::LINETYPE::NEW_BACKGROUND;
-	}
-	else if (_input == M22Script::to_wstring("DrawBackgroundStealth"))
-	{
-		return M22Script::LINETYPE::NEW_BACKGROUND_STEALTH;
-	}
-	else if (_input == M22Script::to_wstring("//"))
-	{
-		return M22Script::LINETYPE::COMMENT;
-	}
-	else if (_input == M22Script::to_wstring("DrawSprite"))
-	{
-		return M22Script::LINETYPE::DRAW_SPRITE;
-	}
-	else if (_input == M22Script::to_wstring("DrawAnimSprite"))
-	{
-		return M22Script::LINETYPE::DRAW_SPRITE_ANIMATED;
-	}
-	else if(_input == M22Script::to_wstring("PlayMusic"))
-	{
-		return M22Script::LINETYPE::NEW_MUSIC;
-	}
-	else if(_input == M22Script::to_wstring("PlaySting"))
-	{
-		return M22Script::LINETYPE::PLAY_STING;
-	}
-	else if(_input == M22Script::to_wstring("DrawCharacter"))
-	{
-		return M22Script::LINETYPE::DRAW_CHARACTER;
-	}
-	else if(_input == M22Script::to_wstring("DrawCharacterBrutal"))
-	{
-		return M22Script::LINETYPE::DRAW_CHARACTER_BRUTAL;
-	}
-	else if(_input == M22Script::to_wstring("ClearCharacters"))
-	{
-		return M22Script::LINETYPE::CLEAR_CHARACTERS;
-	}
-	else if(_input == M22Script::to_wstring("ClearCharactersBrutal"))
-	{
-		return M22Script::LINETYPE::CLEAR_CHARACTERS_BRUTAL;
-	}
-	else if(_input == M22Script::to_wstring("LoadScriptGoto"))
-	{
-		return M22Script::LINETYPE::LOAD_SCRIPT_GOTO;
-	}
-	else if(_input == M22Script::to_wstring("LoadScript"))
-	{
-		return M22Script::LINETYPE::LOAD_SCRIPT;
-	}
-	else if(_input == M22Script::to_wstring("FadeToBlack"))
-	{
-		return M22Script::LINETYPE::FADE_TO_BLACK;
-	}
-	else if(_input == M22Script::to_wstring("FadeToBlackFancy"))
-	{
-		return M22Script::LINETYPE::FADE_TO_BLACK_FANCY;
-	}
-	else if(_input == M22Script::to_wstring("StopMusic"))
-	{
-		return M22Script::LINETYPE::STOP_MUSIC;
-	}
-	else if(_input == M22Script::to_wstring("DarkenScreen"))
-	{
-		return M22Script::LINETYPE::DARK_SCREEN;
-	}
-	else if(_input == M22Script::to_wstring("BrightenScreen"))
-	{
-		return M22Script::LINETYPE::BRIGHT_SCREEN;
-	}
-	else if(_input == M22Script::to_wstring("Goto"))
-	{
-		return M22Script::LINETYPE::GOTO;
-	}
-	else if(_input == M22Script::to_wstring("Goto_debug"))
-	{
-		return M22Script::LINETYPE::GOTO_DEBUG;
-	}
-	else if(_input == M22Script::to_wstring("PlayLoopedSting"))
-	{
-		return M22Script::LINETYPE::PLAY_STING_LOOPED;
-	}
-	else if(_input == M22Script::to_wstring("StopLoopedStings"))
-	{
-		return M22Script::LINETYPE::STOP_STING_LOOPED;
-	}
-	else if(_input == M22Script::to_wstring("ExitGame"))
-	{
-		return M22Script::LINETYPE::EXITGAME;
-	}
-	else if(_input == M22Script::to_wstring("MainMenu"))
-	{
-		return M22Script::LINETYPE::EXITTOMAINMENU;
-	}
-	else if(_input == M22Script::to_wstring("SetActiveTransition"))
-	{
-		return M22Script::LINETYPE::SET_ACTIVE_TRANSITION;
-	}
-	else if(_input == M22Script::to_wstring("Wait"))
-	{
-		return M22Script::LINETYPE::WAIT;
-	}
-	else if(_input == M22Script::to_wstring("m22IF"))
-	{
-		return M22Script::LINETYPE::IF_STATEMENT;
-	}
-	else if(_input == M22Script::to_wstring("SetDecision"))
-	{
-		return M22Script::LINETYPE::SET_DECISION;
-	}
-	else if (_input == M22Script::to_wstring("ClearSprites"))
-	{
-		return M22Script::LINETYPE::CLEAR_SPRITES;
-	}
-	else if(_input == M22Script::to_wstring("RunLuaScript"))
-	{
-		return M22Script::LINETYPE::RUN_LUA_SCRIPT;
-	}
-	else if(_input == M22Script::to_wstring("MakeDecision"))
-	{
-		return M22Script::LINETYPE::MAKE_DECISION;
-	}
-	else if (_input == M22Script::to_wstring("NewPage"))
-	{
-		return M22Script::LINETYPE::NEW_PAGE;
-	};
-	return M22Script::LINETYPE::SPEECH;
+	return M22FindKeyword(M22Script::LINETYPE_KEYWORDS, _input, M22Script::LINETYPE::SPEECH);
 };
\ No newline at end of file
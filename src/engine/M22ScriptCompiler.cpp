@@ -1,678 +1,1330 @@
 #include <engine/M22Engine.h>
+#include <sys/stat.h>
+#include <charconv>
+#include <cstdarg>
 
 using namespace March22;
 
 std::vector<M22ScriptCompiler::line_c> M22ScriptCompiler::currentScript_c;
 M22ScriptCompiler::line_c* M22ScriptCompiler::CURRENT_LINE;
 std::vector<M22ScriptCompiler::script_checkpoint> M22ScriptCompiler::currentScript_checkpoints;
+std::unordered_map<std::string, int> M22ScriptCompiler::currentScript_checkpointLookup;
+std::vector<int> M22ScriptCompiler::currentScript_assets;
+Uint64 M22ScriptCompiler::currentScript_hash = 0;
 
-int M22ScriptCompiler::CompileLoadScriptFile(std::string _filename)
+int M22ScriptCompiler::CompileLoadScriptFile(std::string _filename, bool _allowCompiled)
 {
-	std::locale ulocale(std::locale(), new std::codecvt_utf8<wchar_t>) ;
+	M22_PROFILE_SCOPE("CompileLoadScriptFile");
 	std::string filename = "scripts/";
 	filename += _filename;
-	printf("[M22ScriptCompiler] Loading \"%s\" \n", filename.c_str());
-	std::wifstream input(filename);
-	input.imbue(ulocale);
-	std::wstring temp;
-	std::vector<std::wstring> scriptLines;
-	std::vector<std::wstring> CURRENT_LINE_SPLIT;
+	std::string compiledFilename = M22ScriptCompiler::GetCompiledFilename(filename);
+	int result = -1;
 
-	if(input)
+	// Prefer the precompiled image when it's at least as new as the source, so edited .txt scripts still get picked up
+	if(compiledFilename == filename)
 	{
-		printf("[M22ScriptCompiler] Compiling \"%s\" \n", filename.c_str());
-		M22Script::currentScriptFileName = _filename;
+		result = M22ScriptCompiler::LoadCompiledScript(filename);
+	}
+	else
+	{
+		if(_allowCompiled && M22ScriptCompiler::IsCompiledScriptCurrent(compiledFilename, filename))
+		{
+			result = M22ScriptCompiler::LoadCompiledScript(compiledFilename);
+		};
+		if(result != 0)
+		{
+			result = M22ScriptCompiler::CompileTextScript(filename);
+		};
+	};
+	if(result != 0)
+	{
+		return result;
+	};
+	M22Script::currentScriptFileName = _filename;
+	M22ScriptCompiler::currentScript_hash = M22ScriptCompiler::HashScript(M22ScriptCompiler::currentScript_c);
 
-		// Clear the loaded backgrounds
-		for(size_t i = 0; i < M22Graphics::BACKGROUNDS.size(); i++)
+	// Nothing is loaded for the script as a whole; M22Prefetcher loads (and holds) what's coming up as it runs
+	for(size_t i = 0; i < M22ScriptCompiler::currentScript_c.size(); i++)
+	{
+		int asset = M22ScriptCompiler::currentScript_c.at(i).m_asset;
+		if(asset != -1 && std::find(M22ScriptCompiler::currentScript_assets.begin(), M22ScriptCompiler::currentScript_assets.end(), asset) == M22ScriptCompiler::currentScript_assets.end())
+		{
+			M22ScriptCompiler::currentScript_assets.push_back(asset);
+		};
+		// Every character the script can print, so the font can render them before the typewriter gets there
+		const M22ScriptCompiler::line_c& line = M22ScriptCompiler::currentScript_c.at(i);
+		if(line.m_lineType == M22Script::SPEECH || line.m_lineType == M22Script::NARRATIVE)
 		{
-			SDL_DestroyTexture(M22Graphics::BACKGROUNDS.at(i));
+			M22GlyphCache::Collect(line.m_lineContents);
 		};
-		M22Graphics::BACKGROUNDS.clear();
-		M22Graphics::backgroundIndex.clear();
+	};
+	// Each line is wrapped and split into pages as it comes up, for the font and column as they are now
+	M22TextLayer::LayoutScript();
+	return 0;
+};
 
-		// Clear the loaded character sprites
-		for(size_t i = 0; i < M22Engine::CHARACTERS_ARRAY.size(); i++)
+void M22ScriptCompiler::ResetScriptTables(void)
+{
+	// Clear the background/sprite tables; the textures belong to M22AssetLoader, and whatever
+	// M22Prefetcher holds stays resident across the change
+	M22ScriptCompiler::currentScript_assets.clear();
+	// Character indices are only good for the tables being cleared, so nothing still on screen can be shown again
+	M22CharacterLayer::Clear();
+	M22Graphics::BACKGROUNDS.clear();
+	M22Graphics::backgroundIndex.clear();
+	// Sprite sheets are the script's own textures, so they go with it (and whatever's showing them)
+	M22Graphics::ACTIVE_SPRITES.clear();
+	M22Graphics::LOADED_SPRITES.clear();
+	for(size_t i = 0; i < M22Engine::CHARACTERS_ARRAY.size(); i++)
+	{
+		M22Engine::CHARACTERS_ARRAY.at(i).emotions.clear();
+		M22Engine::CHARACTERS_ARRAY.at(i).outfits.clear();
+		M22Engine::CHARACTERS_ARRAY.at(i).sprites.clear();
+	};
+	M22AssetRegistry::Unbind(M22AssetRegistry::BACKGROUND);
+	M22AssetRegistry::Unbind(M22AssetRegistry::SPRITE);
+	M22AssetRegistry::Unbind(M22AssetRegistry::OUTFIT);
+	M22AssetRegistry::Unbind(M22AssetRegistry::EMOTION);
+	// The m22 table's commands index the tables just cleared
+	M22Lua::ClearCommands();
+
+	// The current line's text belongs to the script being cleared
+	M22Script::currentLine = std::string_view();
+	M22TextLayer::SCRIPT_LAYOUT.clear();
+	M22ScriptCompiler::currentScript_c.clear();
+	M22ScriptCompiler::currentScript_checkpoints.clear();
+	M22ScriptCompiler::currentScript_checkpointLookup.clear();
+	return;
+};
+
+namespace
+{
+	// Decisions and choices are added on demand, since the script that makes one may not have been loaded
+	// yet, but one that isn't in DECISIONS.txt is more likely a typo than a branch anything will take
+	int LinkDecision(const std::string& _name)
+	{
+		if(M22Script::gameDecisionLookup.find(_name) == M22Script::gameDecisionLookup.end())
 		{
-			M22Engine::CHARACTERS_ARRAY.at(i).emotions.clear();
-			M22Engine::CHARACTERS_ARRAY.at(i).outfits.clear();
-			for(size_t spr = 0; spr < M22Engine::CHARACTERS_ARRAY.at(i).sprites.size(); spr++)
-			{
-				M22Engine::DestroySDLTextureVector(M22Engine::CHARACTERS_ARRAY.at(i).sprites.at(spr));
-			};
-			M22Engine::CHARACTERS_ARRAY.at(i).sprites.clear();
+			printf("[M22ScriptCompiler] Decision \"%s\" in %s isn't in DECISIONS.txt!\n", _name.c_str(), M22Script::currentScriptFileName.c_str());
+		};
+		return M22Script::FindOrAddDecision(_name);
+	};
+
+	int LinkChoice(int _decision, const std::string& _name)
+	{
+		const M22Script::Decision& decision = M22Script::gameDecisions.at(_decision);
+		if(decision.choiceLookup.find(_name) == decision.choiceLookup.end())
+		{
+			printf("[M22ScriptCompiler] Choice \"%s\" of decision \"%s\" in %s isn't in DECISIONS.txt!\n", _name.c_str(), decision.name.c_str(), M22Script::currentScriptFileName.c_str());
+		};
+		return M22Script::FindOrAddChoice(_decision, _name);
+	};
+
+	void HashBytes(Uint64& _hash, const void* _data, size_t _size)
+	{
+		const Uint8* bytes = static_cast<const Uint8*>(_data);
+		for(size_t i = 0; i < _size; i++)
+		{
+			_hash ^= bytes[i];
+			_hash *= 1099511628211ULL;
+		};
+		return;
+	};
+
+	void HashLine(Uint64& _hash, const M22ScriptCompiler::line_c& _line)
+	{
+		Sint32 lineType = Sint32(_line.m_lineType);
+		HashBytes(_hash, &lineType, sizeof(lineType));
+		Uint32 contentsLength = Uint32(_line.m_lineContents.size());
+		HashBytes(_hash, &contentsLength, sizeof(contentsLength));
+		HashBytes(_hash, _line.m_lineContents.data(), contentsLength);
+		for(size_t i = 0; i < _line.m_parameters_txt.size(); i++)
+		{
+			Uint32 length = Uint32(_line.m_parameters_txt.at(i).size());
+			HashBytes(_hash, &length, sizeof(length));
+			HashBytes(_hash, _line.m_parameters_txt.at(i).data(), length);
+		};
+		for(size_t i = 0; i < _line.m_subLines.size(); i++)
+		{
+			HashLine(_hash, _line.m_subLines.at(i));
 		};
+		return;
+	};
 
-		M22ScriptCompiler::currentScript_c.clear();
+	// atoi for a token that isn't null-terminated; 0 if it isn't a number
+	int TokenToInt(std::string_view _token)
+	{
+		_token = M22TrimToken(_token);
+		int value = 0;
+		std::from_chars(_token.data(), _token.data() + _token.size(), value);
+		return value;
+	};
 
-		unsigned int linenumber = 0;
-		while (std::getline(input , temp)) 
+	// Warnings go to the console, or to the caller's list if it wants them (tools/m22lint)
+	void Report(std::vector<std::string>* _problems, const char* _format, ...)
+	{
+		char message[512];
+		va_list args;
+		va_start(args, _format);
+		vsnprintf(message, sizeof(message), _format, args);
+		va_end(args);
+		if(_problems != NULL)
 		{
-			if(temp.length() >= 2)
+			_problems->push_back(message);
+		}
+		else
+		{
+			printf("[M22ScriptCompiler] %s\n", message);
+		};
+		return;
+	};
+
+	// How many tokens (the command included) each line type needs; anything else needs just the command
+	size_t TokensNeeded(M22Script::LINETYPE _type)
+	{
+		switch(_type)
+		{
+			case M22Script::DRAW_CHARACTER_BRUTAL:
+			case M22Script::DRAW_CHARACTER:
+				return 5;
+			case M22Script::DRAW_SPRITE_ANIMATED:
+				return 6;
+			case M22Script::DRAW_SPRITE:
+			case M22Script::IF_STATEMENT:
+				return 4;
+			case M22Script::LOAD_SCRIPT_GOTO:
+			case M22Script::SET_DECISION:
+				return 3;
+			case M22Script::GOTO_DEBUG:
+			case M22Script::WAIT:
+			case M22Script::NEW_BACKGROUND_STEALTH:
+			case M22Script::NEW_BACKGROUND:
+			case M22Script::NEW_MUSIC:
+			case M22Script::PLAY_STING:
+			case M22Script::PLAY_STING_LOOPED:
+			case M22Script::SET_ACTIVE_TRANSITION:
+			case M22Script::GOTO:
+			case M22Script::RUN_LUA_SCRIPT:
+			case M22Script::LOAD_SCRIPT:
+			case M22Script::MAKE_DECISION:
+				return 2;
+			default:
+				return 1;
+		};
+	};
+
+	// Are there as many parameters as ParseLine gives the line type, so LinkLine and the Execute functions
+	// can take them? For lines out of a .m22c, which could be corrupt or from an older ParseLine
+	bool HasParameters(M22Script::LINETYPE _type, size_t _parameters, size_t _textParameters)
+	{
+		switch(_type)
+		{
+			case M22Script::DRAW_CHARACTER_BRUTAL:
+			case M22Script::DRAW_CHARACTER:
+				return _parameters >= 4 && _textParameters >= 3;
+			case M22Script::DRAW_SPRITE_ANIMATED:
+				return _parameters >= 6 && _textParameters >= 2;
+			case M22Script::DRAW_SPRITE:
+				return _parameters >= 3 && _textParameters >= 1;
+			case M22Script::IF_STATEMENT:
+				return _parameters >= 2 && _textParameters >= 3;
+			case M22Script::SET_DECISION:
+				return _parameters >= 2 && _textParameters >= 2;
+			case M22Script::MAKE_DECISION:
+				return _textParameters >= 1 && _parameters >= _textParameters;
+			case M22Script::NEW_BACKGROUND_STEALTH:
+			case M22Script::NEW_BACKGROUND:
+			case M22Script::NEW_MUSIC:
+			case M22Script::PLAY_STING:
+			case M22Script::PLAY_STING_LOOPED:
+			case M22Script::LOAD_SCRIPT_GOTO:
+			case M22Script::GOTO:
+			case M22Script::RUN_LUA_SCRIPT:
+				return _parameters >= 1 && _textParameters >= 1;
+			case M22Script::GOTO_DEBUG:
+			case M22Script::WAIT:
+			case M22Script::SET_ACTIVE_TRANSITION:
+				return _parameters >= 1;
+			case M22Script::LOAD_SCRIPT:
+				return _textParameters >= 1;
+			default:
+				return true;
+		};
+	};
+}
+
+Uint64 M22ScriptCompiler::HashScript(const std::vector<M22ScriptCompiler::line_c>& _script)
+{
+	Uint64 hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < _script.size(); i++)
+	{
+		HashLine(hash, _script.at(i));
+	};
+	return hash;
+};
+
+int M22ScriptCompiler::CompileTextScript(const std::string& _filename)
+{
+	printf("[M22ScriptCompiler] Loading \"%s\" \n", _filename.c_str());
+	// The whole file stays in the one buffer while it's parsed; the lines' tokens are views of it
+	std::string script;
+	if(!M22Archive::ReadText(_filename, script))
+	{
+		printf("[M22ScriptCompiler] Failed to load script file: %s \n", _filename.c_str());
+		return -1;
+	};
+	if(!M22IsValidUTF8(script))
+	{
+		printf("[M22ScriptCompiler] %s isn't valid UTF-8!\n", _filename.c_str());
+		return -1;
+	};
+	printf("[M22ScriptCompiler] Compiling \"%s\" \n", _filename.c_str());
+
+	// Parsing doesn't touch the tables, so the script that's running is only cleared once this one is good
+	std::vector<line_c> lines;
+	std::vector<script_checkpoint> checkpoints;
+	if(M22ScriptCompiler::ParseTextScript(script, lines, checkpoints) != 0)
+	{
+		printf("[M22ScriptCompiler] Failed to compile %s!\n", _filename.c_str());
+		return -1;
+	};
+	M22ScriptCompiler::ResetScriptTables();
+	M22ScriptCompiler::currentScript_c.swap(lines);
+	for(size_t i = 0; i < checkpoints.size(); i++)
+	{
+		M22ScriptCompiler::AddCheckpoint(checkpoints.at(i).m_name, checkpoints.at(i).m_position);
+	};
+	// Only once every checkpoint is in, so a Goto can jump forwards
+	for(size_t i = 0; i < M22ScriptCompiler::currentScript_c.size(); i++)
+	{
+		M22ScriptCompiler::LinkLine(M22ScriptCompiler::currentScript_c.at(i));
+	};
+	return 0;
+};
+
+int M22ScriptCompiler::ParseTextScript(std::string_view _script, std::vector<M22ScriptCompiler::line_c>& _lines, std::vector<M22ScriptCompiler::script_checkpoint>& _checkpoints, std::vector<std::string>* _problems, std::vector<unsigned int>* _sourceLines)
+{
+	std::vector<std::string_view> scriptLines;
+	std::vector<unsigned int> sourceLines;
+	std::vector<std::string_view> CURRENT_LINE_SPLIT;
+
+	unsigned int linenumber = 0;
+	unsigned int sourceLine = 0;
+	size_t lineStart = 0;
+	while (lineStart < _script.size()) 
+	{
+		size_t lineEnd = std::min(_script.find('\n', lineStart), _script.size());
+		std::string_view temp = _script.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		sourceLine++;
+		if(temp.length() >= 2)
+		{
+			if(temp.at(0) == '/' && temp.at(1) == '/')
 			{
-				if(temp.at(0) == '/' && temp.at(1) == '/')
-				{
-					// it's a comment! Deleeeete!
-					temp = M22Script::to_wstring("");
-				}
-				else if(temp.at(0) == '-' && temp.at(1) == '-')
-				{
-					// it's a checkpoint!
-					temp.erase(0, 2);
-					M22ScriptCompiler::script_checkpoint tempCheckpoint;
-					tempCheckpoint.m_name = M22Script::to_string(temp);
-					tempCheckpoint.m_position = linenumber;
-					M22ScriptCompiler::currentScript_checkpoints.push_back(tempCheckpoint);
-					temp = M22Script::to_wstring("");
-				};
-			};
-			if(temp != M22Script::to_wstring(""))
+				// it's a comment! Deleeeete!
+				temp = std::string_view();
+			}
+			else if(temp.at(0) == '-' && temp.at(1) == '-')
 			{
-				scriptLines.push_back(temp);
-				linenumber++;
+				// it's a checkpoint!
+				script_checkpoint checkpoint;
+				checkpoint.m_name = std::string(temp.substr(2));
+				checkpoint.m_position = int(linenumber);
+				_checkpoints.push_back(checkpoint);
+				temp = std::string_view();
 			};
 		};
-	}
-	else
-	{
-		printf("[M22ScriptCompiler] Failed to load script file: %s \n", filename.c_str());
-		return -1;
+		if(!temp.empty())
+		{
+			scriptLines.push_back(temp);
+			sourceLines.push_back(sourceLine);
+			linenumber++;
+		};
 	};
-	input.close();
 
+	// Problems are collected per line so they can say which one, then printed if the caller didn't want them
+	std::vector<std::string> printed;
+	std::vector<std::string>* problems = (_problems != NULL ? _problems : &printed);
+	int failed = 0;
+	_lines.reserve(_lines.size() + scriptLines.size());
 	for(size_t i = 0; i < scriptLines.size(); i++)
 	{
+		size_t reported = problems->size();
 		M22Script::SplitString(scriptLines.at(i), CURRENT_LINE_SPLIT, ' ');
-		M22ScriptCompiler::line_c tempLine_c;
+		_lines.emplace_back();
+		M22ScriptCompiler::line_c& tempLine_c = _lines.back();
 		tempLine_c.m_lineType = M22Script::CheckLineType(CURRENT_LINE_SPLIT.at(0));
 		
 		if(tempLine_c.m_lineType == M22Script::SPEECH)
 		{
-			tempLine_c.m_lineContents = scriptLines.at(i);
 			tempLine_c.m_speaker = M22Engine::GetCharacterIndexFromName(CURRENT_LINE_SPLIT.at(0), true);
 			if(tempLine_c.m_speaker > 0)
 			{
-				tempLine_c.m_lineContents.erase(0, CURRENT_LINE_SPLIT.at(0).length());
+				tempLine_c.m_lineContents = scriptLines.at(i).substr(CURRENT_LINE_SPLIT.at(0).length());
 			}
-			else if(tempLine_c.m_speaker == -1)
+			else
 			{
-				CURRENT_LINE_SPLIT.at(0).erase(std::remove_if(CURRENT_LINE_SPLIT.at(0).begin(), CURRENT_LINE_SPLIT.at(0).end(), isspace));
-				CURRENT_LINE_SPLIT.at(0).erase(std::remove_if(CURRENT_LINE_SPLIT.at(0).begin(), CURRENT_LINE_SPLIT.at(0).end(), M22Script::isColon));
-				printf("[M22ScriptCompiler] Character index \"%s\" not found!\n", M22Script::to_string(CURRENT_LINE_SPLIT.at(0)).c_str());
+				tempLine_c.m_lineContents = scriptLines.at(i);
+				if(tempLine_c.m_speaker == -1)
+				{
+					std::string name(M22TrimToken(CURRENT_LINE_SPLIT.at(0)));
+					name.erase(std::remove_if(name.begin(), name.end(), M22Script::isColon), name.end());
+					Report(problems, "Character index \"%s\" not found!", name.c_str());
+				};
 			};
 		}
-		else
+		else if(M22ScriptCompiler::ParseLine(tempLine_c, CURRENT_LINE_SPLIT, problems) != 0)
+		{
+			failed++;
+		};
+
+		for(size_t k = reported; k < problems->size(); k++)
+		{
+			problems->at(k).insert(0, "line " + std::to_string(sourceLines.at(i)) + ": ");
+		};
+		if(_problems == NULL)
 		{
-			CompileLine(tempLine_c, CURRENT_LINE_SPLIT);
+			for(size_t k = 0; k < printed.size(); k++)
+			{
+				printf("[M22ScriptCompiler] %s\n", printed.at(k).c_str());
+			};
+			printed.clear();
 		};
+	};
+	if(_sourceLines != NULL)
+	{
+		_sourceLines->insert(_sourceLines->end(), sourceLines.begin(), sourceLines.end());
+	};
+	return failed;
+};
 
-		M22ScriptCompiler::currentScript_c.push_back(tempLine_c);
+int M22ScriptCompiler::CompileLine(M22ScriptCompiler::line_c &tempLine_c, const std::vector<std::string_view>& CURRENT_LINE_SPLIT)
+{
+	if(M22ScriptCompiler::ParseLine(tempLine_c, CURRENT_LINE_SPLIT) != 0)
+	{
+		return -1;
 	};
-	return 0;
+	return M22ScriptCompiler::LinkLine(tempLine_c);
 };
 
-int M22ScriptCompiler::CompileLine(M22ScriptCompiler::line_c &tempLine_c, std::vector<std::wstring> CURRENT_LINE_SPLIT)
+int M22ScriptCompiler::ParseLine(M22ScriptCompiler::line_c &tempLine_c, const std::vector<std::string_view>& CURRENT_LINE_SPLIT, std::vector<std::string>* _problems)
 {
-	std::vector<int> tempint;
-	bool failed_char = false;
-	bool failed_emot = false;
-	bool failed_otft = false;
+	size_t needed = TokensNeeded(tempLine_c.m_lineType);
+	if(CURRENT_LINE_SPLIT.size() < needed)
+	{
+		Report(_problems, "\"%s\" needs %u parameter(s), but has %u!", std::string(M22TrimToken(CURRENT_LINE_SPLIT.empty() ? std::string_view() : CURRENT_LINE_SPLIT.at(0))).c_str(), (unsigned int)(needed - 1), (unsigned int)(CURRENT_LINE_SPLIT.empty() ? 0 : CURRENT_LINE_SPLIT.size() - 1));
+		return -1;
+	};
 	switch(tempLine_c.m_lineType)
 	{
 		case M22Script::DRAW_CHARACTER_BRUTAL:
 		case M22Script::DRAW_CHARACTER:
-			for(size_t i = 0; i < CURRENT_LINE_SPLIT.size(); i++)
+			// Names are kept for LinkLine (and the .m22c writer); the indices are filled in by LinkLine
+			tempLine_c.m_parameters_txt.push_back(std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(1))));
+			tempLine_c.m_parameters_txt.push_back(std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(2))));
+			tempLine_c.m_parameters_txt.push_back(std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(3))));
+			tempLine_c.m_parameters.push_back(-1);
+			tempLine_c.m_parameters.push_back(-1);
+			tempLine_c.m_parameters.push_back(-1);
+			tempLine_c.m_parameters.push_back(
+					TokenToInt(CURRENT_LINE_SPLIT.at(4))
+				);
+			break;
+		case M22Script::GOTO_DEBUG:
+		case M22Script::WAIT:
+			tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(1)));
+			break;
+		case M22Script::NEW_BACKGROUND_STEALTH:
+		case M22Script::NEW_BACKGROUND:
+		case M22Script::NEW_MUSIC:
+		case M22Script::PLAY_STING:
+		case M22Script::PLAY_STING_LOOPED:
+			tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(1)));
+			tempLine_c.m_parameters.push_back(-1);
+			break;
+		case M22Script::SET_ACTIVE_TRANSITION:
+			tempLine_c.m_parameters.push_back(
+				M22FindKeyword(M22Graphics::TRANSITION_KEYWORDS, CURRENT_LINE_SPLIT.at(1), M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS)
+			);
+			if(tempLine_c.m_parameters.back() == M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS) 
 			{
-				CURRENT_LINE_SPLIT.at(i).erase(std::remove_if(CURRENT_LINE_SPLIT.at(i).begin(), CURRENT_LINE_SPLIT.at(i).end(), isspace));
+				Report(_problems, "Unknown transition \"%s\"!", std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(1))).c_str());
 			};
-			tempint.push_back(
-					M22Engine::GetCharacterIndexFromName(CURRENT_LINE_SPLIT.at(1))
+			break;
+		case M22Script::LOAD_SCRIPT_GOTO:
+			tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(1)));
+			tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(2)));
+			break;
+		case M22Script::GOTO:
+			// The target line is filled in by LinkLine
+			tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(1)));
+			tempLine_c.m_parameters.push_back(-1);
+			break;
+		case M22Script::RUN_LUA_SCRIPT:
+			// The compiled chunk is filled in by LinkLine
+			tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(1)));
+			tempLine_c.m_parameters.push_back(-1);
+			break;
+		case M22Script::LOAD_SCRIPT:
+			tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(1)));
+			break;
+		case M22Script::DRAW_SPRITE:
+			tempLine_c.m_parameters_txt.push_back(std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(1))));
+			tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(2)));
+			tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(3)));
+			// The sheet is filled in by LinkLine
+			tempLine_c.m_parameters.push_back(-1);
+			break;
+		// DrawAnimSprite name x y speed frames [Loop/PingPong/Once]
+		// "name.png", a sheet of 5 frames side by side (or "name_0.png" -> "name_4.png")
+		case M22Script::DRAW_SPRITE_ANIMATED:
+			{
+				tempLine_c.m_parameters_txt.push_back(std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(1))));	// 0
+				tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(2)));						// 0
+				tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(3)));						// 1
+				// The sheet is filled in by LinkLine
+				tempLine_c.m_parameters.push_back(-1);															// 2
+				// because it only supports integers, save the float as a string
+				tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(4)));				// 1
+				tempLine_c.m_parameters.push_back(TokenToInt(CURRENT_LINE_SPLIT.at(5)));						// 3
+				// Speeds are in frames per frame at SPRITE_ANIMATION_FPS; playback goes by time, so keep it as milliseconds per frame
+				float speed = float(atof(tempLine_c.m_parameters_txt.at(1).c_str()));
+				tempLine_c.m_parameters.push_back(speed > 0.0f ? std::max(1, int(1000.0f / (speed * SPRITE_ANIMATION_FPS) + 0.5f)) : 0);	// 4
+				M22Graphics::ANIMATION_MODES mode = M22Graphics::LOOP;
+				if(CURRENT_LINE_SPLIT.size() > 6)
+				{
+					mode = M22FindKeyword(M22Graphics::ANIMATION_MODE_KEYWORDS, CURRENT_LINE_SPLIT.at(6), M22Graphics::NUMBER_OF_ANIMATION_MODES);
+					if(mode == M22Graphics::NUMBER_OF_ANIMATION_MODES)
+					{
+						Report(_problems, "Unknown animation mode \"%s\"; looping instead!", std::string(M22TrimToken(CURRENT_LINE_SPLIT.at(6))).c_str());
+						mode = M22Graphics::LOOP;
+					};
+				};
+				tempLine_c.m_parameters.push_back(mode);														// 5
+			}
+			break;
+		case M22Script::IF_STATEMENT:
+		case M22Script::MAKE_DECISION:
+		case M22Script::SET_DECISION:
+			// Spaces are wiped here, rather than every time the line runs
+			for(size_t k = 1; k < CURRENT_LINE_SPLIT.size(); k++)
+			{
+				tempLine_c.m_parameters_txt.push_back(std::string(CURRENT_LINE_SPLIT.at(k)));
+				tempLine_c.m_parameters_txt.back().erase(
+					std::remove_if(
+						tempLine_c.m_parameters_txt.back().begin(), 
+						tempLine_c.m_parameters_txt.back().end(), 
+						isspace
+					),
+					tempLine_c.m_parameters_txt.back().end()
 				);
+			};
+			// The decision and choice IDs are filled in by LinkLine; MakeDecision gets one per choice it offers
+			tempLine_c.m_parameters.push_back(-1);
+			if(tempLine_c.m_lineType == M22Script::MAKE_DECISION)
+			{
+				tempLine_c.m_parameters.resize(tempLine_c.m_parameters_txt.size(), -1);
+			}
+			else
+			{
+				tempLine_c.m_parameters.push_back(-1);
+			};
+			break;
+	};
+	if(tempLine_c.m_lineType == M22Script::IF_STATEMENT)
+	{
+		return M22ScriptCompiler::ParseSubLine(tempLine_c, _problems);
+	};
+	return 0;
+};
+
+int M22ScriptCompiler::ParseSubLine(M22ScriptCompiler::line_c& _ifStatement, std::vector<std::string>* _problems)
+{
+	// The command on the end of it is parsed with the line, instead of each time the statement is true
+	std::vector<std::string_view> tempStrVec;
+	tempStrVec.push_back(std::string_view());
+	for(size_t i = 3; i < _ifStatement.m_parameters_txt.size(); i++)
+	{
+		tempStrVec.push_back(_ifStatement.m_parameters_txt.at(i));
+	};
+	_ifStatement.m_subLines.assign(1, M22ScriptCompiler::line_c());
+	M22ScriptCompiler::line_c& subLine = _ifStatement.m_subLines.back();
+	subLine.m_lineType = M22Script::CheckLineType(_ifStatement.m_parameters_txt.at(2));
+	if(M22ScriptCompiler::ParseLine(subLine, tempStrVec, _problems) != 0)
+	{
+		_ifStatement.m_subLines.clear();
+		return -1;
+	};
+	return 0;
+};
+
+
+
+int M22ScriptCompiler::LinkLine(M22ScriptCompiler::line_c &tempLine_c)
+{
+	std::vector<int> tempint;
+	M22Engine::Character* tempCharacter = NULL;
+	switch(tempLine_c.m_lineType)
+	{
+		case M22Script::DRAW_CHARACTER_BRUTAL:
+		case M22Script::DRAW_CHARACTER:
 			tempint.push_back(
-					M22Engine::GetOutfitIndexFromName(M22Script::to_string(CURRENT_LINE_SPLIT.at(2)), 
-					tempint.at(0))
+					M22Engine::GetCharacterIndexFromName(tempLine_c.m_parameters_txt.at(0))
 				);
 			tempint.push_back(
-					M22Engine::GetEmotionIndexFromName(M22Script::to_string(CURRENT_LINE_SPLIT.at(3)), 
-					tempint.at(0))
+					M22Engine::GetOutfitIndexFromName(tempLine_c.m_parameters_txt.at(1), tempint.at(0))
 				);
 			tempint.push_back(
-					atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(4)).c_str())
+					M22Engine::GetEmotionIndexFromName(tempLine_c.m_parameters_txt.at(2), tempint.at(0))
 				);
 
-			// Failed to find character, so load it
+			// Failed to find character, so create it
 			if(tempint.at(0) == -1)
 			{
-				M22Engine::CHARACTERS_ARRAY.push_back(M22Engine::CreateCharacter(M22Script::to_string(CURRENT_LINE_SPLIT.at(1))));	
+				M22Engine::CHARACTERS_ARRAY.push_back(M22Engine::CreateCharacter(tempLine_c.m_parameters_txt.at(0)));	
 				tempint.at(0) = (M22Engine::CHARACTERS_ARRAY.size()-1);
-				failed_char = true;
+				M22AssetRegistry::Bind(M22AssetRegistry::CHARACTER, M22Engine::CHARACTERS_ARRAY.back().name, tempint.at(0));
 			};
+			tempCharacter = &M22Engine::CHARACTERS_ARRAY.at(tempint.at(0));
 			if(tempint.at(1) == -1)
 			{
-				M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).outfits.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(2)));
-				tempint.at(1) = (M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).outfits.size()-1);
-				failed_otft = true;
+				tempCharacter->outfits.push_back(tempLine_c.m_parameters_txt.at(1));
+				tempint.at(1) = (tempCharacter->outfits.size()-1);
+				M22AssetRegistry::Bind(M22AssetRegistry::OUTFIT, tempCharacter->outfits.back(), tempint.at(1), tempint.at(0));
 			};
 			if(tempint.at(2) == -1)
 			{
-				M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).emotions.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(3)));
-				tempint.at(2) = (M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).emotions.size()-1);
-				failed_emot = true;
+				tempCharacter->emotions.push_back(tempLine_c.m_parameters_txt.at(2));
+				tempint.at(2) = (tempCharacter->emotions.size()-1);
+				M22AssetRegistry::Bind(M22AssetRegistry::EMOTION, tempCharacter->emotions.back(), tempint.at(2), tempint.at(0));
 			};
 
-			if(failed_char == true || failed_emot == true || failed_otft == true)
+			// Make room for the sprite; ExecuteCommand fills it in from the asset loader when it's drawn
+			if(tempCharacter->sprites.size() < tempCharacter->outfits.size())
 			{
-				/*if(failed_char == true)
-				{
-					tempLine_c.m_parameters_txt.push_back(
-						"graphics/text_frames/" + 
-						M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).name + 
-						".png"
-					);
-					SDL_Texture* tempTexture = IMG_LoadTexture(M22Renderer::SDL_RENDERER, tempLine_c.m_parameters_txt.back().c_str());
-					if(!tempTexture) printf("[M22ScriptCompiler] Failed to load character textbox %s!\n", tempLine_c.m_parameters_txt.back().c_str());
-					M22Graphics::characterFrameHeaders.push_back(tempTexture);
-					tempLine_c.m_parameters_txt.pop_back();
-				};*/
-
-				tempLine_c.m_parameters_txt.push_back(
-					"graphics/characters/" + 
-					M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).name + 
-					"/" + 
-					M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).outfits.back() + 
-					"/" +
-					M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).emotions.back() +
-					".png"
-				);
-				SDL_Texture* tempTex = IMG_LoadTexture(M22Renderer::SDL_RENDERER, tempLine_c.m_parameters_txt.back().c_str());
-				if(!tempTex) printf("[M22ScriptCompiler] Failed to load character sprite %s!\n", tempLine_c.m_parameters_txt.back().c_str());
-				SDL_SetTextureAlphaMod( tempTex, 0 );
-				SDL_SetTextureBlendMode(tempTex, SDL_BLENDMODE_BLEND);
-				M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).sprites.resize(M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).outfits.size());
-				M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).sprites.at(tempint.at(1)).resize(M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).emotions.size());
-				M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).sprites.at(tempint.at(1)).at(tempint.at(2)) = tempTex;
-				tempLine_c.m_parameters_txt.pop_back();
+				tempCharacter->sprites.resize(tempCharacter->outfits.size());
 			};
-
-			if(!M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).sprites.at(tempint.at(1)).at(tempint.at(2)))
+			if(tempCharacter->sprites.at(tempint.at(1)).size() < tempCharacter->emotions.size())
 			{
-				tempLine_c.m_parameters_txt.push_back(
-					"graphics/characters/" + 
-					M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).name + 
-					"/" + 
-					M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).outfits.back() + 
-					"/" +
-					M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).emotions.back() +
-					".png"
-				);
-				SDL_Texture* tempTex = IMG_LoadTexture(M22Renderer::SDL_RENDERER, tempLine_c.m_parameters_txt.back().c_str());
-				if(!tempTex) printf("[M22ScriptCompiler] Failed to load character sprite %s!\n", tempLine_c.m_parameters_txt.back().c_str());
-				SDL_SetTextureAlphaMod( tempTex, 0 );
-				SDL_SetTextureBlendMode(tempTex, SDL_BLENDMODE_BLEND);
-				M22Engine::CHARACTERS_ARRAY.at(tempint.at(0)).sprites.at(tempint.at(1)).at(tempint.at(2)) = (tempTex);
+				tempCharacter->sprites.at(tempint.at(1)).resize(tempCharacter->emotions.size(), NULL);
 			};
+			tempLine_c.m_asset = M22AssetLoader::RegisterTexture(
+				"graphics/characters/" + 
+				tempCharacter->name + 
+				"/" + 
+				tempCharacter->outfits.at(tempint.at(1)) + 
+				"/" +
+				tempCharacter->emotions.at(tempint.at(2)) +
+				".png",
+				0,
+				true
+			);
 
-			tempLine_c.m_parameters.push_back(tempint.at(0));
-			tempLine_c.m_parameters.push_back(tempint.at(1));
-			tempLine_c.m_parameters.push_back(tempint.at(2));
-			tempLine_c.m_parameters.push_back(tempint.at(3));
-			break;
-		case M22Script::GOTO_DEBUG:
-		case M22Script::WAIT:
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(1)).c_str()));
+			tempLine_c.m_parameters.at(0) = tempint.at(0);
+			tempLine_c.m_parameters.at(1) = tempint.at(1);
+			tempLine_c.m_parameters.at(2) = tempint.at(2);
 			break;
 		case M22Script::NEW_BACKGROUND_STEALTH:
 		case M22Script::NEW_BACKGROUND:
 			tempint.push_back(
-				M22Engine::GetBackgroundIDFromName(M22Script::to_string(CURRENT_LINE_SPLIT.at(1)))
+				M22Engine::GetBackgroundIDFromName(tempLine_c.m_parameters_txt.at(0))
 			);
 
-			// If the ID wasn't found, load it
+			// If the ID wasn't found, add it
 			if(tempint.back() == -1)
 			{
-				// Use the m_parameters_txt for temporary string storage
-				tempLine_c.m_parameters_txt.push_back( "graphics/backgrounds/" + M22Script::to_string(CURRENT_LINE_SPLIT.at(1)) + ".png" );
+				std::string tempPath = "graphics/backgrounds/" + tempLine_c.m_parameters_txt.at(0) + ".png";
 				
-				// Load the texture to M22Graphics::BACKGROUNDS
-				SDL_Texture *temp = IMG_LoadTexture(M22Renderer::SDL_RENDERER, tempLine_c.m_parameters_txt.back().c_str());
-				if(!temp)
-				{
-					printf("[M22ScriptCompiler] Failed to load background %s!\n", tempLine_c.m_parameters_txt.back().c_str());
-				};
-				M22Graphics::BACKGROUNDS.push_back(temp);
+				// The texture is filled in by ExecuteCommand once the asset loader has it
+				M22Graphics::BACKGROUNDS.push_back(NULL);
 
 				// Push back the filename to the index
-				M22Graphics::backgroundIndex.push_back(tempLine_c.m_parameters_txt.back());
-				if(tempLine_c.m_parameters_txt.back() == "graphics/backgrounds/BLACK.webp") 
+				M22Graphics::backgroundIndex.push_back(tempPath);
+				M22AssetRegistry::Bind(M22AssetRegistry::BACKGROUND, tempPath, int(M22Graphics::backgroundIndex.size() - 1));
+				if(tempPath == "graphics/backgrounds/BLACK.webp") 
 				{
-					temp = NULL;
-					temp = IMG_LoadTexture(M22Renderer::SDL_RENDERER, tempLine_c.m_parameters_txt.back().c_str());
-					M22Graphics::BLACK_TEXTURE = temp;
+					M22Graphics::BLACK_TEXTURE = M22Renderer::LoadTexture(tempPath);
 					SDL_SetTextureBlendMode(M22Graphics::BLACK_TEXTURE, SDL_BLENDMODE_BLEND);
 					SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
-					temp = NULL;
 				};
 
-				//Delete the temporary string and push back the index location
-				tempLine_c.m_parameters_txt.pop_back();
+				// Push back the index location
 				tempint.back() = (M22Graphics::backgroundIndex.size()-1);
 			};
-			tempLine_c.m_parameters.push_back(tempint.at(0));
+			tempLine_c.m_asset = M22AssetLoader::RegisterTexture(M22Graphics::backgroundIndex.at(tempint.at(0)));
+			tempLine_c.m_parameters.at(0) = tempint.at(0);
 			break;
 		case M22Script::NEW_MUSIC:
-			tempint.push_back(M22Sound::FindMusicFromName(M22Script::to_string(CURRENT_LINE_SPLIT.at(1))));
-			if(tempint.at(0) == -1) printf("[M22ScriptCompiler] Failed to find music file \"%s\"!\n",		M22Script::to_string(CURRENT_LINE_SPLIT.at(1)).c_str());
-			tempLine_c.m_parameters.push_back(tempint.at(0));
+			tempLine_c.m_parameters.at(0) = M22Sound::FindMusicFromName(tempLine_c.m_parameters_txt.at(0));
+			if(tempLine_c.m_parameters.at(0) == -1) printf("[M22ScriptCompiler] Failed to find music file \"%s\"!\n", tempLine_c.m_parameters_txt.at(0).c_str());
 			break;
 		case M22Script::PLAY_STING:
 		case M22Script::PLAY_STING_LOOPED:
-			tempint.push_back(M22Sound::FindStingFromName(M22Script::to_string(CURRENT_LINE_SPLIT.at(1))));
-			if(tempint.at(0) == -1) printf("[M22ScriptCompiler] Failed to find sting \"%s\"!\n",M22Script::to_string(CURRENT_LINE_SPLIT.at(1)).c_str());
-			tempLine_c.m_parameters.push_back(tempint.at(0));
+			tempLine_c.m_parameters.at(0) = M22Sound::FindStingFromName(tempLine_c.m_parameters_txt.at(0));
+			if(tempLine_c.m_parameters.at(0) == -1) printf("[M22ScriptCompiler] Failed to find sting \"%s\"!\n", tempLine_c.m_parameters_txt.at(0).c_str());
 			break;
-		case M22Script::SET_ACTIVE_TRANSITION:
-			for(size_t i = 0; i < M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS; i++)
-			{
-				if(CURRENT_LINE_SPLIT.at(1) == M22Graphics::TRANSITION_NAMES[i])
-				{
-					tempLine_c.m_parameters.push_back(i);
-					break;
-				};
-			};
+		case M22Script::DRAW_SPRITE:
+			// Each sheet is loaded once, however many lines draw it
+			tempLine_c.m_parameters.at(2) = M22Graphics::LoadSprite(tempLine_c.m_parameters_txt.at(0));
 			break;
-		case M22Script::LOAD_SCRIPT_GOTO:
-			tempLine_c.m_parameters_txt.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(1)));
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(2)).c_str()));
+		case M22Script::DRAW_SPRITE_ANIMATED:
+			tempLine_c.m_parameters.at(2) = M22Graphics::LoadSprite(tempLine_c.m_parameters_txt.at(0), (unsigned short int)std::max(1, tempLine_c.m_parameters.at(3)));
 			break;
 		case M22Script::RUN_LUA_SCRIPT:
-		case M22Script::GOTO:
-		case M22Script::LOAD_SCRIPT:
-			tempLine_c.m_parameters_txt.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(1)));
+			tempLine_c.m_parameters.at(0) = M22Lua::LoadChunk(tempLine_c.m_parameters_txt.at(0));
 			break;
-		case M22Script::DRAW_SPRITE:
-			for (size_t i = 0; i < CURRENT_LINE_SPLIT.size(); i++)
+		case M22Script::GOTO:
+			if(M22ScriptCompiler::FindCheckpoint(tempLine_c.m_parameters_txt.at(0), tempLine_c.m_parameters.at(0)) != 0)
 			{
-				CURRENT_LINE_SPLIT.at(i).erase(std::remove_if(CURRENT_LINE_SPLIT.at(i).begin(), CURRENT_LINE_SPLIT.at(i).end(), isspace));
+				tempLine_c.m_parameters.at(0) = -1;
 			};
-			tempLine_c.m_parameters_txt.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(1)));
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(2)).c_str()));
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(3)).c_str()));
-			M22Graphics::LOADED_SPRITES.push_back(
-				*(
-					new M22Graphics::M22Sprite(
-						tempLine_c.m_parameters_txt.at(0),
-						M22Renderer::SDL_RENDERER,
-						tempLine_c.m_parameters.at(0), 
-						tempLine_c.m_parameters.at(1))
-					)
-			);
 			break;
-		// DrawAnimSprite anus 5
-		// "anus_0.png" -> "anus_4.png"
-		case M22Script::DRAW_SPRITE_ANIMATED:
-			tempLine_c.m_parameters_txt.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(1)));				// 0
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(2)).c_str()));	// 0
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(3)).c_str()));	// 1
-			// because it only supports integers, save the float as a string									
-			tempLine_c.m_parameters_txt.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(4)));				// 1
-			tempLine_c.m_parameters.push_back(atoi(M22Script::to_string(CURRENT_LINE_SPLIT.at(5)).c_str()));	// 2
-			M22Graphics::LOADED_SPRITES.push_back(
-				*(
-					new M22Graphics::M22Sprite(
-						tempLine_c.m_parameters_txt.at(0),
-						M22Renderer::SDL_RENDERER,
-						tempLine_c.m_parameters.at(0),
-						tempLine_c.m_parameters.at(1),
-						true,
-						(float)atof(tempLine_c.m_parameters_txt.at(1).c_str()),
-						tempLine_c.m_parameters.at(2))
-					)
-			);
+		case M22Script::MAKE_DECISION:
+			tempLine_c.m_parameters.at(0) = LinkDecision(tempLine_c.m_parameters_txt.at(0));
+			for(size_t i = 1; i < tempLine_c.m_parameters_txt.size(); i++)
+			{
+				tempLine_c.m_parameters.at(i) = LinkChoice(tempLine_c.m_parameters.at(0), tempLine_c.m_parameters_txt.at(i));
+			};
 			break;
 		case M22Script::IF_STATEMENT:
-		case M22Script::MAKE_DECISION:
-			for(size_t k = 1; k < CURRENT_LINE_SPLIT.size(); k++)
+		case M22Script::SET_DECISION:
+			// Decisions are made in whichever script gets to them first, so anything referenced here is
+			// added up-front; it just won't have a selected option until the player (or a SetDecision) picks one
+			tempLine_c.m_parameters.at(0) = LinkDecision(tempLine_c.m_parameters_txt.at(0));
+			tempLine_c.m_parameters.at(1) = LinkChoice(tempLine_c.m_parameters.at(0), tempLine_c.m_parameters_txt.at(1));
+			if(tempLine_c.m_lineType == M22Script::IF_STATEMENT)
 			{
-				tempLine_c.m_parameters_txt.push_back(M22Script::to_string(CURRENT_LINE_SPLIT.at(k)));
+				// Lines loaded from a .m22c haven't had their command parsed yet
+				if(tempLine_c.m_subLines.empty() && M22ScriptCompiler::ParseSubLine(tempLine_c) != 0)
+				{
+					break;
+				};
+				M22ScriptCompiler::LinkLine(tempLine_c.m_subLines.back());
+				tempLine_c.m_asset = tempLine_c.m_subLines.back().m_asset;
 			};
 			break;
+		default:
+			break;
 	};
 	return 0;
 };
 
-int M22ScriptCompiler::ExecuteCommand(M22ScriptCompiler::line_c _linec, int _line)
+// Indexed by M22Script::LINETYPE, so keep this in the same order as the enum
+M22ScriptCompiler::COMMAND_HANDLER M22ScriptCompiler::COMMAND_HANDLERS[] =
 {
-	M22ScriptCompiler::line_c* ACTV_LINE = &_linec;
-	std::string tempPath;
-	M22Script::Decision tempDecision;
-	bool exitflag = false;
-	short int specifiedDecision = -1;
-	short int specifiedChoice = -1;
+	&M22ScriptCompiler::ExecuteNewPage,					// NEW_PAGE
+	&M22ScriptCompiler::ExecuteNewBackground,			// NEW_BACKGROUND
+	&M22ScriptCompiler::ExecuteNewBackground,			// NEW_BACKGROUND_STEALTH
+	&M22ScriptCompiler::ExecuteFadeToBlack,				// FADE_TO_BLACK
+	&M22ScriptCompiler::ExecuteFadeToBlackFancy,		// FADE_TO_BLACK_FANCY
+	&M22ScriptCompiler::ExecuteNewMusic,				// NEW_MUSIC
+	&M22ScriptCompiler::ExecuteDarkScreen,				// DARK_SCREEN
+	&M22ScriptCompiler::ExecuteBrightScreen,			// BRIGHT_SCREEN
+	&M22ScriptCompiler::ExecuteStopMusic,				// STOP_MUSIC
+	&M22ScriptCompiler::ExecutePlaySting,				// PLAY_STING
+	&M22ScriptCompiler::ExecutePlayStingLooped,			// PLAY_STING_LOOPED
+	&M22ScriptCompiler::ExecuteStopStingLooped,			// STOP_STING_LOOPED
+	&M22ScriptCompiler::ExecuteGotoDebug,				// GOTO_DEBUG
+	&M22ScriptCompiler::ExecuteGoto,					// GOTO
+	&M22ScriptCompiler::ExecuteDrawCharacter,			// DRAW_CHARACTER
+	&M22ScriptCompiler::ExecuteClearCharacters,			// CLEAR_CHARACTERS
+	&M22ScriptCompiler::ExecuteClearCharacters,			// CLEAR_CHARACTERS_BRUTAL
+	&M22ScriptCompiler::ExecuteDrawCharacter,			// DRAW_CHARACTER_BRUTAL
+	&M22ScriptCompiler::ExecuteLoadScript,				// LOAD_SCRIPT
+	&M22ScriptCompiler::ExecuteLoadScript,				// LOAD_SCRIPT_GOTO
+	&M22ScriptCompiler::ExecuteSpeech,					// SPEECH
+	&M22ScriptCompiler::ExecuteSpeech,					// COMMENT
+	&M22ScriptCompiler::ExecuteWait,					// WAIT
+	&M22ScriptCompiler::ExecuteExitGame,				// EXITGAME
+	&M22ScriptCompiler::ExecuteSetActiveTransition,		// SET_ACTIVE_TRANSITION
+	&M22ScriptCompiler::ExecuteExitToMainMenu,			// EXITTOMAINMENU
+	&M22ScriptCompiler::ExecuteIfStatement,				// IF_STATEMENT
+	&M22ScriptCompiler::ExecuteMakeDecision,			// MAKE_DECISION
+	&M22ScriptCompiler::ExecuteSetDecision,				// SET_DECISION
+	&M22ScriptCompiler::ExecuteRunLuaScript,			// RUN_LUA_SCRIPT
+	&M22ScriptCompiler::ExecuteDrawSprite,				// DRAW_SPRITE
+	&M22ScriptCompiler::ExecuteDrawSprite,				// DRAW_SPRITE_ANIMATED
+	&M22ScriptCompiler::ExecuteClearSprites,			// CLEAR_SPRITES
+	&M22ScriptCompiler::ExecuteSpeech					// NARRATIVE
+};
+static_assert(sizeof(M22ScriptCompiler::COMMAND_HANDLERS) / sizeof(M22ScriptCompiler::COMMAND_HANDLERS[0]) == M22Script::NUM_OF_LINETYPES, "COMMAND_HANDLERS must have one entry per M22Script::LINETYPE");
 
-	switch(ACTV_LINE->m_lineType)
-	{
-		case M22Script::NEW_BACKGROUND_STEALTH:
-		case M22Script::NEW_BACKGROUND:
-			//tempPath = "graphics/backgrounds/";
-			//tempPath += M22Graphics::backgroundIndex.at(ACTV_LINE->m_parameters.at(0));
-			//tempPath += ".webp";
-			M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite = M22Graphics::BACKGROUNDS.at(ACTV_LINE->m_parameters.at(0));
-			M22Engine::ACTIVE_BACKGROUNDS.at(0).name = M22Graphics::backgroundIndex.at(ACTV_LINE->m_parameters.at(0));
-			SDL_SetTextureAlphaMod(M22Engine::ACTIVE_BACKGROUNDS.at(0).sprite, 255);
-			SDL_SetTextureAlphaMod(M22Engine::ACTIVE_BACKGROUNDS.at(1).sprite, 255);
-			SDL_SetTextureAlphaMod(M22Graphics::BACKGROUND_RENDER_TARGET, 255);
-			SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, 255);
-			M22Graphics::UpdateBackgroundRenderTarget();
-			SDL_SetTextureAlphaMod(M22Graphics::BACKGROUND_RENDER_TARGET, 255);
-			SDL_SetTextureAlphaMod(M22Graphics::NEXT_BACKGROUND_RENDER_TARGET, 255);
-			//if(ACTV_LINE->m_lineType == M22Script::NEW_BACKGROUND_STEALTH)
-			//	M22Script::ChangeLine(++_line);
-			return 0;
-
-		case M22Script::NEW_PAGE:
-			M22Script::typewriter_currPos = 0;
-			M22Script::typewriter_text.clear();
-			M22Script::typewriter_text.resize(0);
-			M22Script::ChangeLine(++_line);
-			return 0;
+int M22ScriptCompiler::ExecuteCommand(const M22ScriptCompiler::line_c& _linec, int _line)
+{
+	M22_PROFILE_SCOPE("ExecuteCommand");
+	int nextLine = _line + 1;
+	return M22ScriptCompiler::COMMAND_HANDLERS[_linec.m_lineType](_linec, nextLine);
+};
 
-		case M22Script::NEW_MUSIC:
-			M22Sound::ChangeMusicTrack(ACTV_LINE->m_parameters.at(0));
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteNewBackground(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	// Blocks only if the asset loader hasn't got to this background yet
+	M22Graphics::BACKGROUNDS.at(_linec.m_parameters.at(0)) = M22AssetLoader::WaitForTexture(_linec.m_asset);
+	M22Graphics::ShowBackground(_linec.m_asset, M22Graphics::backgroundIndex.at(_linec.m_parameters.at(0)));
+	// The transition moves on to the next line when it's done
+	return YIELD;
+};
 
-		case M22Script::STOP_MUSIC:
-			M22Sound::StopMusic();
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteNewPage(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Script::NewPage();
+	return CONTINUE;
+};
 
-		case M22Script::FADE_TO_BLACK:
-			M22Script::FadeToBlack();
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteNewMusic(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Sound::ChangeMusicTrack(_linec.m_parameters.at(0));
+	return CONTINUE;
+};
 
-		case M22Script::PLAY_STING:
-			M22Sound::PlaySting(ACTV_LINE->m_parameters.at(0), true);
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteStopMusic(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Sound::StopMusic();
+	return CONTINUE;
+};
 
-		case M22Script::DRAW_CHARACTER:
-			M22Graphics::AddCharacterToBackgroundRenderTarget(ACTV_LINE->m_parameters.at(0),ACTV_LINE->m_parameters.at(1), ACTV_LINE->m_parameters.at(2), ACTV_LINE->m_parameters.at(3), false);
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteFadeToBlack(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Script::FadeToBlack();
+	return CONTINUE;
+};
 
-		case M22Script::DRAW_CHARACTER_BRUTAL:
-			M22Graphics::AddCharacterToBackgroundRenderTarget(ACTV_LINE->m_parameters.at(0),ACTV_LINE->m_parameters.at(1), ACTV_LINE->m_parameters.at(2), ACTV_LINE->m_parameters.at(3), true);
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteFadeToBlackFancy(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Graphics::FadeToBlackFancy();
+	return CONTINUE;
+};
 
-		case M22Script::CLEAR_CHARACTERS:
-			M22Script::ClearCharacters();
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecutePlaySting(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Sound::PlaySting(_linec.m_parameters.at(0), true);
+	return CONTINUE;
+};
 
-		case M22Script::WAIT:
-			M22Engine::TIMER_CURR = 0;
-			M22Engine::TIMER_TARGET = ACTV_LINE->m_parameters.at(0);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecutePlayStingLooped(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Sound::PlayLoopedSting(_linec.m_parameters.at(0));
+	return CONTINUE;
+};
 
-		case M22Script::LOAD_SCRIPT_GOTO:
-			M22ScriptCompiler::currentScript_c.clear();
-			M22Script::ClearCharacters();
-			M22ScriptCompiler::CompileLoadScriptFile(ACTV_LINE->m_parameters_txt.at(0));
-			M22Script::ChangeLine(ACTV_LINE->m_parameters.at(0));
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteStopStingLooped(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Sound::StopLoopedStings();
+	return CONTINUE;
+};
 
-		case M22Script::LOAD_SCRIPT:
-			M22ScriptCompiler::currentScript_c.clear();
-			M22Script::ClearCharacters();
-			//M22Script::LoadScriptToCurrent(M22Script::to_string(temp.at(1)).c_str());
-			//M22Script::LoadScriptToCurrent_w(M22Script::to_string(temp.at(1)).c_str());
-			M22ScriptCompiler::CompileLoadScriptFile(ACTV_LINE->m_parameters_txt.at(0));
-			M22Script::ChangeLine(0);
-			return 0;
-
-		case M22Script::DARK_SCREEN:
-			SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, M22Script::DARKEN_SCREEN_OPACITY );
-			M22Script::ChangeLine(++_line);
-			return 0;
-
-		case M22Script::BRIGHT_SCREEN:
-			SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteDrawCharacter(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Engine::CHARACTERS_ARRAY.at(_linec.m_parameters.at(0)).sprites.at(_linec.m_parameters.at(1)).at(_linec.m_parameters.at(2)) = M22AssetLoader::WaitForTexture(_linec.m_asset);
+	M22CharacterLayer::Show(
+		_linec.m_parameters.at(0),
+		_linec.m_parameters.at(1),
+		_linec.m_parameters.at(2),
+		_linec.m_asset,
+		_linec.m_parameters.at(3),
+		(_linec.m_lineType == M22Script::DRAW_CHARACTER_BRUTAL)
+	);
+	return CONTINUE;
+};
 
-		case M22Script::PLAY_STING_LOOPED:
-			M22Sound::PlayLoopedSting(ACTV_LINE->m_parameters.at(0));
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteClearCharacters(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Script::ClearCharacters(_linec.m_lineType == M22Script::CLEAR_CHARACTERS_BRUTAL);
+	return CONTINUE;
+};
 
-		case M22Script::STOP_STING_LOOPED:
-			M22Sound::StopLoopedStings();
-			M22Script::ChangeLine(++_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteWait(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Engine::TIMER_CURR = 0;
+	M22Engine::TIMER_TARGET = _linec.m_parameters.at(0);
+	return YIELD;
+};
 
-		case M22Script::GOTO:
-			M22ScriptCompiler::FindCheckpoint(ACTV_LINE->m_parameters_txt.at(0), _line);
-			M22Script::ChangeLine(_line);
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteLoadScript(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	// _linec may live in the script being replaced, so take what we need from it first
+	std::string filename = _linec.m_parameters_txt.at(0);
+	int targetLine = 0;
+	if(_linec.m_lineType == M22Script::LOAD_SCRIPT_GOTO)
+	{
+		targetLine = _linec.m_parameters.at(0);
+	};
+	// Compiling only replaces the current script once the new one has loaded, so on failure this one stays put
+	if(M22ScriptCompiler::CompileLoadScriptFile(filename) != 0)
+	{
+		printf("[M22ScriptCompiler] Failed to load script \"%s\"; staying in %s!\n", filename.c_str(), M22Script::currentScriptFileName.c_str());
+		return YIELD;
+	};
+	M22Script::ClearCharacters();
+	M22Prefetcher::Update(targetLine);
+	_nextLine = targetLine;
+	return JUMP;
+};
 
-		case M22Script::GOTO_DEBUG:
-			if(ACTV_LINE->m_parameters.at(0) <= (int)M22ScriptCompiler::currentScript_c.size()) 
-			{
-				M22Script::ChangeLine(ACTV_LINE->m_parameters.at(0));
-			}
-			else
-			{
-				printf("[M22ScriptCompiler] Goto_debug error! Line number exceeds size of script!\n");
-			};
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteDarkScreen(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, M22Script::DARKEN_SCREEN_OPACITY );
+	return CONTINUE;
+};
 
-		case M22Script::EXITGAME:
-			M22Engine::QUIT = true;
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteBrightScreen(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	SDL_SetTextureAlphaMod( M22Graphics::BLACK_TEXTURE, 0 );
+	return CONTINUE;
+};
 
-		case M22Script::SET_DECISION:
-			//Wipe spaces
-			for(size_t i = 0; i < ACTV_LINE->m_parameters_txt.size(); i++)
-			{
-				ACTV_LINE->m_parameters_txt.at(i).erase(
-					std::remove_if(
-						ACTV_LINE->m_parameters_txt.at(i).begin(), 
-						ACTV_LINE->m_parameters_txt.at(i).end(), 
-						isspace
-					)
-				);
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteGoto(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	// Missing checkpoints were reported when the line was linked; the script carries on
+	if(_linec.m_parameters.at(0) == -1)
+	{
+		return CONTINUE;
+	};
+	_nextLine = _linec.m_parameters.at(0);
+	return JUMP;
+};
 
-			//Check decision doesn't already exist.
-			for(size_t i = 0; i < M22Script::gameDecisions.size(); i++)
-			{
-				// if decision is found
-				if(M22Script::gameDecisions.at(i).name == M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(0)))
-				{
-					for(size_t k = 0; k < M22Script::gameDecisions.at(i).choices.size(); k++)
-					{
-						// found choice
-						if(M22Script::gameDecisions.at(i).choices.at(k) == M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(1)))
-						{
-							exitflag = true;
-							M22Script::gameDecisions.at(i).selectedOption = (short int)k;
-						};
-						if(exitflag == true) break;
-					};
-				};
-				if(exitflag == true) break;
-			};
-			if(exitflag == false) printf("[M22ScriptCompiler] Decision/choice not found @ %s line %i!\n", M22Script::currentScriptFileName.c_str(), _line);
-			M22Script::ChangeLine(++_line);
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteGotoDebug(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	if(_linec.m_parameters.at(0) < (int)M22ScriptCompiler::currentScript_c.size()) 
+	{
+		_nextLine = _linec.m_parameters.at(0);
+		return JUMP;
+	};
+	printf("[M22ScriptCompiler] Goto_debug error! Line number exceeds size of script!\n");
+	return YIELD;
+};
 
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteExitGame(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Engine::QUIT = true;
+	return YIELD;
+};
 
-		case M22Script::EXITTOMAINMENU:
-			M22Engine::ResetGame();
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteSetDecision(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Script::gameDecisions.at(_linec.m_parameters.at(0)).selectedOption = (short int)_linec.m_parameters.at(1);
+	return CONTINUE;
+};
 
-		case M22Script::IF_STATEMENT:
-			for(size_t i = 0; i < ACTV_LINE->m_parameters_txt.size(); i++)
-			{
-				ACTV_LINE->m_parameters_txt.at(i).erase(
-					std::remove_if(
-						ACTV_LINE->m_parameters_txt.at(i).begin(), 
-						ACTV_LINE->m_parameters_txt.at(i).end(), 
-						isspace
-					)
-				);
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteExitToMainMenu(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Engine::ResetGame();
+	return YIELD;
+};
 
-			for(size_t i = 0; i < M22Script::gameDecisions.size(); i++)
-			{
-				if(M22Script::gameDecisions.at(i).name == M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(0)))
-				{
-					// found decision
-					specifiedDecision = (short int)i;
-					break;
-				};
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteIfStatement(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	if(M22Script::gameDecisions.at(_linec.m_parameters.at(0)).selectedOption != _linec.m_parameters.at(1) || _linec.m_subLines.empty())
+	{
+		// RETURN FALSE
+		return CONTINUE;
+	};
 
-			if(specifiedDecision == -1)
-			{
-				// INVALID DECISION
-				M22Script::ChangeLine(++_line);
-				return 0;
-			};
+	//IF STATEMENT RETURNS TRUE; run the command on the end of it in place of this line
+	const M22ScriptCompiler::line_c& subLine = _linec.m_subLines.front();
+	return M22ScriptCompiler::COMMAND_HANDLERS[subLine.m_lineType](subLine, _nextLine);
+};
 
-			for(size_t i = 0; i < M22Script::gameDecisions.at(specifiedDecision).choices.size(); i++)
-			{
-				if(M22Script::gameDecisions.at(specifiedDecision).choices.at(i) == M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(1)))
-				{
-					specifiedChoice = (short int)i;
-				};
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteMakeDecision(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Script::activeSpeakerIndex = 0;
+	M22Engine::skipping = false;
 
-			if(specifiedChoice == -1)
-			{
-				// INVALID CHOICE
-				M22Script::ChangeLine(++_line);
-				return 0;
-			};
+	M22Script::activeDecision = _linec.m_parameters.at(0);
+	M22Script::activeChoices.assign(_linec.m_parameters.begin()+1, _linec.m_parameters.end());
 
-			if(M22Script::gameDecisions.at(specifiedDecision).selectedOption == specifiedChoice)
-			{
-				//IF STATEMENT RETURNS TRUE
-				M22Script::LINETYPE tempType = M22Script::CheckLineType(M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(2)));
-				std::vector<std::wstring> tempStrVec;
-				for(size_t i = 3; i < ACTV_LINE->m_parameters_txt.size(); i++)
-				{
-					tempStrVec.push_back(M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(i)));
-				};
-				M22ScriptCompiler::line_c temporaryLineC;
-				temporaryLineC.m_lineType = tempType;
-				tempStrVec.insert(tempStrVec.begin(), M22Script::to_wstring(""));
-				M22ScriptCompiler::CompileLine(temporaryLineC, tempStrVec);
-				M22ScriptCompiler::ExecuteCommand(temporaryLineC, _line);
-				//M22Script::ExecuteM22ScriptCommand(tempType,tempStrVec,_line);
-				return 0;
-			}
-			else
-			{
-				// RETURN FALSE
-				M22Script::ChangeLine(++_line);
-			};
-			return 0;
+	// The decision interface moves on once a choice is made
+	return YIELD;
+};
 
-		case M22Script::MAKE_DECISION:
-			M22Script::activeSpeakerIndex = 0;
-			M22Engine::skipping = false;
-			for(size_t i = 0; i < ACTV_LINE->m_parameters_txt.size(); i++)
-			{
-				ACTV_LINE->m_parameters_txt.at(i).erase(
-					std::remove_if(
-						ACTV_LINE->m_parameters_txt.at(i).begin(), 
-						ACTV_LINE->m_parameters_txt.at(i).end(), 
-						isspace
-					)
-				);
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteRunLuaScript(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	// Compiled once, when the line was linked; errors loading it were reported then
+	M22Lua::RunChunk(_linec.m_parameters.at(0));
+	return CONTINUE;
+};
 
-			//Check decision doesn't already exist.
-			for(size_t i = 0; i < M22Script::gameDecisions.size(); i++)
-			{
-				if(M22Script::gameDecisions.at(i).name == M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(0)))
-				{
-					M22Engine::moveVectorItemToBack(M22Script::gameDecisions, i);
-					return 0;
-				};
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteSetActiveTransition(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	// Unknown transitions were reported at compile time; keep the current one
+	if(_linec.m_parameters.at(0) < M22Graphics::TRANSITIONS::NUMBER_OF_TRANSITIONS)
+	{
+		M22Graphics::activeTransition = _linec.m_parameters.at(0);
+	};
+	return CONTINUE;
+};
 
-			tempDecision.name = M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(0));
-			for(size_t i = 1; i < ACTV_LINE->m_parameters_txt.size(); i++)
-			{
-				tempDecision.choices.push_back(M22Script::to_wstring(ACTV_LINE->m_parameters_txt.at(i)));
-				tempDecision.num_of_choices++;
-			};
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteClearSprites(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	M22Graphics::ACTIVE_SPRITES.clear();
+	return CONTINUE;
+};
 
-			M22Script::gameDecisions.push_back(tempDecision);
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteDrawSprite(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	if(_linec.m_lineType == M22Script::DRAW_SPRITE_ANIMATED)
+	{
+		M22Graphics::ShowSprite(_linec.m_parameters.at(2), _linec.m_parameters.at(0), _linec.m_parameters.at(1), M22Graphics::ANIMATION_MODES(_linec.m_parameters.at(5)), Uint32(_linec.m_parameters.at(4)));
+	}
+	else
+	{
+		M22Graphics::ShowSprite(_linec.m_parameters.at(2), _linec.m_parameters.at(0), _linec.m_parameters.at(1));
+	};
+	return CONTINUE;
+};
 
-			return 0;
+M22ScriptCompiler::EXECUTE_RESULT M22ScriptCompiler::ExecuteSpeech(const M22ScriptCompiler::line_c& _linec, int& _nextLine)
+{
+	// Waits for the player to click on
+	M22Script::activeSpeakerIndex = _linec.m_speaker;
+	return YIELD;
+};
 
-		case M22Script::RUN_LUA_SCRIPT:
-			tempPath = "./scripts/lua/";
-			tempPath += ACTV_LINE->m_parameters_txt.at(0);
-			luaL_dofile(M22Lua::STATE, tempPath.c_str());
-			M22Script::ChangeLine(++_line);
-			return 0;
+int M22ScriptCompiler::FindCheckpoint(const std::string& _chkpnt, int &_line)
+{
+	std::unordered_map<std::string, int>::iterator found = M22ScriptCompiler::currentScript_checkpointLookup.find(_chkpnt);
+	if(found != M22ScriptCompiler::currentScript_checkpointLookup.end())
+	{
+		_line = found->second;
+		return 0;
+	};
 
-		case M22Script::SET_ACTIVE_TRANSITION:
-			M22Graphics::activeTransition = ACTV_LINE->m_parameters.at(0);
-			M22Script::ChangeLine(++_line);
-			return 0;
+	printf("[M22ScriptCompiler] FindCheckpoint error! Could not find: %s\n", _chkpnt.c_str());
+	return -1;
+};
 
-		case M22Script::CLEAR_CHARACTERS_BRUTAL:
-			M22Script::ClearCharacters();
-			M22Script::ChangeLine(++_line);
-			return 0;
+void M22ScriptCompiler::AddCheckpoint(const std::string& _chkpnt, int _line)
+{
+	M22ScriptCompiler::script_checkpoint tempCheckpoint;
+	tempCheckpoint.m_name = _chkpnt;
+	tempCheckpoint.m_position = _line;
+	M22ScriptCompiler::currentScript_checkpoints.push_back(tempCheckpoint);
+	M22ScriptCompiler::currentScript_checkpointLookup.emplace(_chkpnt, _line);
+	return;
+};
 
-		case M22Script::CLEAR_SPRITES:
-			M22Graphics::ACTIVE_SPRITES.clear();
-			M22Script::ChangeLine(++_line);
-			return 0;
+std::string M22ScriptCompiler::GetCompiledFilename(const std::string& _filename)
+{
+	size_t extension = _filename.find_last_of('.');
+	if(extension == std::string::npos || _filename.find_first_of("/\\", extension) != std::string::npos)
+	{
+		return _filename + ".m22c";
+	};
+	return _filename.substr(0, extension) + ".m22c";
+};
 
-		case M22Script::FADE_TO_BLACK_FANCY:
-			M22Graphics::FadeToBlackFancy();
-			M22Script::ChangeLine(++_line);
-			return 0;
+bool M22ScriptCompiler::IsCompiledScriptCurrent(const std::string& _compiled, const std::string& _source)
+{
+	struct stat compiledInfo;
+	struct stat sourceInfo;
+	if(stat(_compiled.c_str(), &compiledInfo) != 0)
+	{
+		// Packed scripts are packed with their source, so they're only out of date if the source has been unpacked to edit
+		const Uint8* data;
+		size_t size;
+		return (M22Archive::Find(_compiled, data, size) && stat(_source.c_str(), &sourceInfo) != 0);
+	};
+	if(stat(_source.c_str(), &sourceInfo) != 0)
+	{
+		// Shipped without the source, so the compiled one is all there is
+		return true;
+	};
+	return (compiledInfo.st_mtime >= sourceInfo.st_mtime);
+};
 
-		case M22Script::DRAW_SPRITE_ANIMATED:
-		case M22Script::DRAW_SPRITE:
-			for (size_t i = 0; i < M22Graphics::LOADED_SPRITES.size(); i++)
-			{
-				if (M22Graphics::LOADED_SPRITES.at(i).CompareName(ACTV_LINE->m_parameters_txt.at(0)))
-				{
-					M22Graphics::ACTIVE_SPRITES.push_back(&M22Graphics::LOADED_SPRITES.at(i));
-				};
-			}
-			M22Script::ChangeLine(++_line);
-			return 0;
+int M22ScriptCompiler::ReadCompiledDependencies(const std::string& _filename, size_t _max, std::vector<int>& _handles)
+{
+	M22MappedFile file;
+	const Uint8* data;
+	size_t size;
+	if(!M22Archive::Find(_filename, data, size))
+	{
+		if(!file.Open(_filename))
+		{
+			return -1;
+		};
+		data = file.GetData();
+		size = file.GetSize();
+	};
+	m22c_header header;
+	if(size < sizeof(m22c_header))
+	{
+		return -1;
+	};
+	memcpy(&header, data, sizeof(m22c_header));
+	if(memcmp(header.m_magic, "M22C", 4) != 0 || header.m_version != M22C_VERSION)
+	{
+		return -1;
+	};
+	Uint64 linesOffset = sizeof(m22c_header);
+	Uint64 parametersOffset = linesOffset + Uint64(header.m_numLines) * sizeof(m22c_line);
+	Uint64 textParametersOffset = parametersOffset + Uint64(header.m_numParameters) * sizeof(Sint32);
+	Uint64 checkpointsOffset = textParametersOffset + Uint64(header.m_numTextParameters) * sizeof(Uint32);
+	Uint64 dependenciesOffset = checkpointsOffset + Uint64(header.m_numCheckpoints) * sizeof(m22c_checkpoint);
+	Uint64 stringOffsetsOffset = dependenciesOffset + Uint64(header.m_numDependencies) * sizeof(m22c_dependency);
+	Uint64 stringDataOffset = stringOffsetsOffset + (Uint64(header.m_numStrings) + 1) * sizeof(Uint32);
+	if(stringDataOffset + header.m_stringDataSize > size)
+	{
+		return -1;
+	};
 
-		default:
-			M22Script::activeSpeakerIndex = ACTV_LINE->m_speaker;
-			return 0;
+	const m22c_dependency* dependencies = reinterpret_cast<const m22c_dependency*>(data + dependenciesOffset);
+	const Uint32* stringOffsets = reinterpret_cast<const Uint32*>(data + stringOffsetsOffset);
+	const char* stringData = reinterpret_cast<const char*>(data + stringDataOffset);
 
+	// Each line uses at most one texture, so the first _max dependencies cover at least the first _max lines
+	for(Uint32 i = 0; i < header.m_numDependencies && _handles.size() < _max; i++)
+	{
+		Uint32 path = dependencies[i].m_path;
+		if(path >= header.m_numStrings || stringOffsets[path] > stringOffsets[path+1] || stringOffsets[path+1] > header.m_stringDataSize)
+		{
+			return -1;
+		};
+		_handles.push_back(M22AssetLoader::RegisterTexture(
+			std::string(stringData + stringOffsets[path], stringData + stringOffsets[path+1]),
+			Uint8(dependencies[i].m_alpha),
+			(dependencies[i].m_blend != 0)
+		));
 	};
+	return 0;
 };
 
-int M22ScriptCompiler::FindCheckpoint(std::string _chkpnt, int &_line)
+int M22ScriptCompiler::LoadCompiledScript(const std::string& _filename)
 {
-	for(size_t i = 0; i < M22ScriptCompiler::currentScript_checkpoints.size(); i++)
+	printf("[M22ScriptCompiler] Loading \"%s\" \n", _filename.c_str());
+	// Read in place, either out of a packed archive or from the file mapped on its own
+	M22MappedFile file;
+	const Uint8* data;
+	size_t size;
+	if(!M22Archive::Find(_filename, data, size))
 	{
-		if(_chkpnt == M22ScriptCompiler::currentScript_checkpoints.at(i).m_name)
+		if(!file.Open(_filename))
 		{
-			_line = M22ScriptCompiler::currentScript_checkpoints.at(i).m_position;
-			return 0;
+			printf("[M22ScriptCompiler] Failed to load script file: %s \n", _filename.c_str());
+			return -1;
 		};
+		data = file.GetData();
+		size = file.GetSize();
 	};
 
-	printf("[M22ScriptCompiler] FindCheckpoint error! Could not find: %s\n", _chkpnt.c_str());
-	return -1;
-};
\ No newline at end of file
+	// Work out where each section lives, and make sure the file is big enough to hold them all
+	m22c_header header;
+	if(size < sizeof(m22c_header))
+	{
+		printf("[M22ScriptCompiler] %s is too small to be a compiled script!\n", _filename.c_str());
+		return -1;
+	};
+	memcpy(&header, data, sizeof(m22c_header));
+	if(memcmp(header.m_magic, "M22C", 4) != 0 || header.m_version != M22C_VERSION)
+	{
+		printf("[M22ScriptCompiler] %s is not a version %i compiled script!\n", _filename.c_str(), M22C_VERSION);
+		return -1;
+	};
+	Uint64 linesOffset = sizeof(m22c_header);
+	Uint64 parametersOffset = linesOffset + Uint64(header.m_numLines) * sizeof(m22c_line);
+	Uint64 textParametersOffset = parametersOffset + Uint64(header.m_numParameters) * sizeof(Sint32);
+	Uint64 checkpointsOffset = textParametersOffset + Uint64(header.m_numTextParameters) * sizeof(Uint32);
+	Uint64 dependenciesOffset = checkpointsOffset + Uint64(header.m_numCheckpoints) * sizeof(m22c_checkpoint);
+	Uint64 stringOffsetsOffset = dependenciesOffset + Uint64(header.m_numDependencies) * sizeof(m22c_dependency);
+	Uint64 stringDataOffset = stringOffsetsOffset + (Uint64(header.m_numStrings) + 1) * sizeof(Uint32);
+	if(stringDataOffset + header.m_stringDataSize > size)
+	{
+		printf("[M22ScriptCompiler] %s is truncated!\n", _filename.c_str());
+		return -1;
+	};
+
+	const m22c_line* lines = reinterpret_cast<const m22c_line*>(data + linesOffset);
+	const Sint32* parameters = reinterpret_cast<const Sint32*>(data + parametersOffset);
+	const Uint32* textParameters = reinterpret_cast<const Uint32*>(data + textParametersOffset);
+	const m22c_checkpoint* checkpoints = reinterpret_cast<const m22c_checkpoint*>(data + checkpointsOffset);
+	const m22c_dependency* dependencies = reinterpret_cast<const m22c_dependency*>(data + dependenciesOffset);
+	const Uint32* stringOffsets = reinterpret_cast<const Uint32*>(data + stringOffsetsOffset);
+	const char* stringData = reinterpret_cast<const char*>(data + stringDataOffset);
+
+	// Validate every index before touching the current script, so a bad file leaves it intact
+	bool valid = (stringOffsets[header.m_numStrings] <= header.m_stringDataSize);
+	for(Uint32 i = 0; valid && i < header.m_numStrings; i++)
+	{
+		valid = (stringOffsets[i] <= stringOffsets[i+1]);
+	};
+	for(Uint32 i = 0; valid && i < header.m_numLines; i++)
+	{
+		valid = (lines[i].m_lineType >= 0 && lines[i].m_lineType < M22Script::NUM_OF_LINETYPES) &&
+			(lines[i].m_lineContents == M22C_NO_STRING || lines[i].m_lineContents < header.m_numStrings) &&
+			(lines[i].m_speakerName == M22C_NO_STRING || lines[i].m_speakerName < header.m_numStrings) &&
+			(Uint64(lines[i].m_firstParameter) + lines[i].m_numParameters <= header.m_numParameters) &&
+			(Uint64(lines[i].m_firstTextParameter) + lines[i].m_numTextParameters <= header.m_numTextParameters) &&
+			HasParameters(M22Script::LINETYPE(lines[i].m_lineType), lines[i].m_numParameters, lines[i].m_numTextParameters);
+	};
+	for(Uint32 i = 0; valid && i < header.m_numTextParameters; i++)
+	{
+		valid = (textParameters[i] < header.m_numStrings);
+	};
+	for(Uint32 i = 0; valid && i < header.m_numCheckpoints; i++)
+	{
+		valid = (checkpoints[i].m_name < header.m_numStrings);
+	};
+	for(Uint32 i = 0; valid && i < header.m_numDependencies; i++)
+	{
+		valid = (dependencies[i].m_path < header.m_numStrings);
+	};
+	if(!valid)
+	{
+		printf("[M22ScriptCompiler] %s is corrupt!\n", _filename.c_str());
+		return -1;
+	};
+
+	M22ScriptCompiler::ResetScriptTables();
+
+	// Checkpoints go in first, so Goto lines can be linked to them
+	for(Uint32 i = 0; i < header.m_numCheckpoints; i++)
+	{
+		M22ScriptCompiler::AddCheckpoint(
+			std::string(stringData + stringOffsets[checkpoints[i].m_name], stringData + stringOffsets[checkpoints[i].m_name+1]),
+			checkpoints[i].m_position
+		);
+	};
+
+	M22ScriptCompiler::currentScript_c.resize(header.m_numLines);
+	for(Uint32 i = 0; i < header.m_numLines; i++)
+	{
+		const m22c_line& record = lines[i];
+		M22ScriptCompiler::line_c& tempLine_c = M22ScriptCompiler::currentScript_c.at(i);
+		tempLine_c.m_lineType = M22Script::LINETYPE(record.m_lineType);
+		tempLine_c.m_parameters.assign(parameters + record.m_firstParameter, parameters + record.m_firstParameter + record.m_numParameters);
+		for(Uint32 k = 0; k < record.m_numTextParameters; k++)
+		{
+			Uint32 str = textParameters[record.m_firstTextParameter + k];
+			tempLine_c.m_parameters_txt.push_back(std::string(stringData + stringOffsets[str], stringData + stringOffsets[str+1]));
+		};
+		if(record.m_lineContents != M22C_NO_STRING)
+		{
+			tempLine_c.m_lineContents.assign(stringData + stringOffsets[record.m_lineContents], stringData + stringOffsets[record.m_lineContents+1]);
+		};
+		tempLine_c.m_speaker = record.m_speaker;
+		if(record.m_speakerName != M22C_NO_STRING)
+		{
+			tempLine_c.m_speaker = M22Engine::GetCharacterIndexFromName(std::string(stringData + stringOffsets[record.m_speakerName], stringData + stringOffsets[record.m_speakerName+1]));
+		};
+		M22ScriptCompiler::LinkLine(tempLine_c);
+	};
+
+	return 0;
+};
+
+int M22ScriptCompiler::SaveCompiledScript(const std::string& _filename)
+{
+	return M22ScriptCompiler::SaveCompiledScript(_filename, M22ScriptCompiler::currentScript_c, M22ScriptCompiler::currentScript_checkpoints, M22ScriptCompiler::currentScript_assets);
+};
+
+int M22ScriptCompiler::SaveCompiledScript(const std::string& _filename, const std::vector<line_c>& _lines, const std::vector<script_checkpoint>& _checkpoints, const std::vector<int>& _assets)
+{
+	std::vector<m22c_line> lines;
+	std::vector<Sint32> parameters;
+	std::vector<Uint32> textParameters;
+	std::vector<m22c_checkpoint> checkpoints;
+	std::vector<m22c_dependency> dependencies;
+	std::vector<Uint32> stringOffsets;
+	std::string stringData;
+	std::unordered_map<std::string, Uint32> stringLookup;
+
+	// Identical strings are only stored once
+	auto InternString = [&](const std::string& _str) -> Uint32
+	{
+		std::unordered_map<std::string, Uint32>::iterator found = stringLookup.find(_str);
+		if(found != stringLookup.end())
+		{
+			return found->second;
+		};
+		Uint32 index = Uint32(stringOffsets.size());
+		stringOffsets.push_back(Uint32(stringData.size()));
+		stringData += _str;
+		stringLookup[_str] = index;
+		return index;
+	};
+
+	for(size_t i = 0; i < _lines.size(); i++)
+	{
+		const M22ScriptCompiler::line_c& tempLine_c = _lines.at(i);
+		m22c_line record;
+		record.m_lineType = Sint32(tempLine_c.m_lineType);
+		record.m_speaker = tempLine_c.m_speaker;
+		record.m_speakerName = M22C_NO_STRING;
+		if(tempLine_c.m_lineType == M22Script::SPEECH && tempLine_c.m_speaker >= 0 && size_t(tempLine_c.m_speaker) < M22Engine::CHARACTERS_ARRAY.size())
+		{
+			record.m_speakerName = InternString(M22Engine::CHARACTERS_ARRAY.at(tempLine_c.m_speaker).name);
+		};
+		record.m_lineContents = M22C_NO_STRING;
+		if(!tempLine_c.m_lineContents.empty())
+		{
+			record.m_lineContents = InternString(tempLine_c.m_lineContents);
+		};
+		record.m_firstParameter = Uint32(parameters.size());
+		record.m_numParameters = Uint32(tempLine_c.m_parameters.size());
+		parameters.insert(parameters.end(), tempLine_c.m_parameters.begin(), tempLine_c.m_parameters.end());
+		record.m_firstTextParameter = Uint32(textParameters.size());
+		record.m_numTextParameters = Uint32(tempLine_c.m_parameters_txt.size());
+		for(size_t k = 0; k < tempLine_c.m_parameters_txt.size(); k++)
+		{
+			textParameters.push_back(InternString(tempLine_c.m_parameters_txt.at(k)));
+		};
+		lines.push_back(record);
+	};
+
+	for(size_t i = 0; i < _checkpoints.size(); i++)
+	{
+		m22c_checkpoint tempCheckpoint;
+		tempCheckpoint.m_name = InternString(_checkpoints.at(i).m_name);
+		tempCheckpoint.m_position = _checkpoints.at(i).m_position;
+		checkpoints.push_back(tempCheckpoint);
+	};
+
+	for(size_t i = 0; i < _assets.size(); i++)
+	{
+		const M22AssetLoader::TextureAsset& asset = M22AssetLoader::ASSETS.at(_assets.at(i));
+		m22c_dependency tempDependency;
+		tempDependency.m_path = InternString(asset.path);
+		tempDependency.m_alpha = asset.alpha;
+		tempDependency.m_blend = (asset.blend ? 1 : 0);
+		dependencies.push_back(tempDependency);
+	};
+
+	// Pad the string data so the file stays a multiple of 4 bytes
+	Uint32 numStrings = Uint32(stringOffsets.size());
+	stringOffsets.push_back(Uint32(stringData.size()));
+	while(stringData.size() % 4 != 0)
+	{
+		stringData.push_back('\0');
+	};
+
+	m22c_header header;
+	memcpy(header.m_magic, "M22C", 4);
+	header.m_version = M22C_VERSION;
+	header.m_numLines = Uint32(lines.size());
+	header.m_numParameters = Uint32(parameters.size());
+	header.m_numTextParameters = Uint32(textParameters.size());
+	header.m_numCheckpoints = Uint32(checkpoints.size());
+	header.m_numDependencies = Uint32(dependencies.size());
+	header.m_numStrings = numStrings;
+	header.m_stringDataSize = Uint32(stringData.size());
+
+	std::ofstream output(_filename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if(!output)
+	{
+		printf("[M22ScriptCompiler] Failed to open %s for writing!\n", _filename.c_str());
+		return -1;
+	};
+	output.write(reinterpret_cast<const char*>(&header), sizeof(m22c_header));
+	if(!lines.empty()) output.write(reinterpret_cast<const char*>(&lines[0]), lines.size() * sizeof(m22c_line));
+	if(!parameters.empty()) output.write(reinterpret_cast<const char*>(&parameters[0]), parameters.size() * sizeof(Sint32));
+	if(!textParameters.empty()) output.write(reinterpret_cast<const char*>(&textParameters[0]), textParameters.size() * sizeof(Uint32));
+	if(!checkpoints.empty()) output.write(reinterpret_cast<const char*>(&checkpoints[0]), checkpoints.size() * sizeof(m22c_checkpoint));
+	if(!dependencies.empty()) output.write(reinterpret_cast<const char*>(&dependencies[0]), dependencies.size() * sizeof(m22c_dependency));
+	output.write(reinterpret_cast<const char*>(&stringOffsets[0]), stringOffsets.size() * sizeof(Uint32));
+	output.write(stringData.data(), stringData.size());
+	output.close();
+
+	printf("[M22ScriptCompiler] Wrote %s (%u lines, %u strings)\n", _filename.c_str(), header.m_numLines, header.m_numStrings);
+	return 0;
+};
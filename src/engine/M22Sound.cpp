@@ -4,19 +4,27 @@ using namespace March22;
 
 std::vector<Mix_Chunk*> M22Sound::SOUND_FX;
 std::vector<Mix_Music*> M22Sound::MUSIC;
+std::vector<bool> M22Sound::MUSIC_FAILED;
 float* M22Sound::MUSIC_VOLUME = &M22Engine::OPTIONS.MUSIC_VOLUME;
 float* M22Sound::SFX_VOLUME = &M22Engine::OPTIONS.SFX_VOLUME;
 int M22Sound::currentTrack = 0;
+int M22Sound::currentLoopedSting = -1;
 std::vector<std::string> M22Sound::MUSIC_NAMES;
 std::vector<std::string> M22Sound::SFX_NAMES;
+std::vector<Uint32> M22Sound::SFX_LAST_USED;
+size_t M22Sound::SFX_RESIDENT_BYTES = 0;
+size_t M22Sound::SFX_BUDGET = size_t(SFX_CACHE_BUDGET_MB) * 1024 * 1024;
+std::deque<int> M22Sound::SFX_WARM_QUEUE;
+int M22Sound::prefetchedTrack = -1;
 
 short int M22Sound::PlaySting(short int _position)
 {
-	if(M22Sound::SOUND_FX[_position])
+	Mix_Chunk* sting = M22Sound::GetSting(_position);
+	if(sting)
 	{
 		if(!Mix_Playing(M22Sound::MIXERS::SFX))
 		{
-			Mix_PlayChannel( M22Sound::MIXERS::SFX, M22Sound::SOUND_FX[_position], 0);
+			Mix_PlayChannel( M22Sound::MIXERS::SFX, sting, 0);
 			return 0;
 		}
 		else
@@ -32,9 +40,9 @@ short int M22Sound::PlaySting(short int _position)
 
 short int M22Sound::InitializeMusic()
 {
-	std::fstream input("sfx/music/index.txt");
+	std::stringstream input;
 	int length;
-	if(input)
+	if(M22Archive::OpenStream("sfx/music/index.txt", input))
 	{
 		length=int(std::count(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>(), '\n'));
 		length++; // Linecount is number of '\n' + 1
@@ -43,14 +51,11 @@ short int M22Sound::InitializeMusic()
 		{
 			std::string currentfile;
 			input >> currentfile;
-			Mix_Music *temp = Mix_LoadMUS(currentfile.c_str());
-			if(!temp)
-			{
-				std::cout << "Failed to load file: " << currentfile << std::endl;
-				return -1;
-			};
+			// Streams are only opened when a track is played (or coming up); see GetMusic
 			M22Sound::MUSIC_NAMES.push_back(currentfile);
-			M22Sound::MUSIC.push_back(temp);
+			M22Sound::MUSIC.push_back(NULL);
+			M22Sound::MUSIC_FAILED.push_back(false);
+			M22AssetRegistry::Bind(M22AssetRegistry::MUSIC, currentfile, i);
 		};
 	}
 	else
@@ -58,15 +63,14 @@ short int M22Sound::InitializeMusic()
 		std::cout << "Failed to load index file for music!" << std::endl;
 		return -1;
 	};
-	input.close();
 	return 0;
 };
 
 short int M22Sound::InitializeSFX()
 {
-	std::fstream input("sfx/stings/index.txt");
+	std::stringstream input;
 	int length;
-	if(input)
+	if(M22Archive::OpenStream("sfx/stings/index.txt", input))
 	{
 		length=int(std::count(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>(), '\n'));
 		length++; // Linecount is number of '\n' + 1
@@ -75,14 +79,11 @@ short int M22Sound::InitializeSFX()
 		{
 			std::string currentfile;
 			input >> currentfile;
-			Mix_Chunk *temp = Mix_LoadWAV(currentfile.c_str());
-			if(!temp)
-			{
-				std::cout << "Failed to load file: " << currentfile << std::endl;
-				return -1;
-			};
-			M22Sound::SOUND_FX.push_back(temp);
+			// Decoded the first time they're played (or coming up); see GetSting
+			M22Sound::SOUND_FX.push_back(NULL);
+			M22Sound::SFX_LAST_USED.push_back(0);
 			M22Sound::SFX_NAMES.push_back(currentfile);
+			M22AssetRegistry::Bind(M22AssetRegistry::STING, currentfile, i);
 			//Mix_VolumeChunk(M22Sound::SOUND_FX[i], int(MIX_MAX_VOLUME*M22Sound::SFX_VOLUME));
 		};
 	}
@@ -91,7 +92,6 @@ short int M22Sound::InitializeSFX()
 		std::cout << "Failed to load index file for music!" << std::endl;
 		return -1;
 	};
-	input.close();
 	return 0;
 };
 
@@ -112,20 +112,156 @@ short int M22Sound::InitializeSound()
 
 void M22Sound::UpdateSound()
 {
+	M22_PROFILE_SCOPE("UpdateSound");
 	if( !Mix_PlayingMusic() )
 	{
 		M22Sound::ChangeMusicTrack(M22Sound::currentTrack);
 	};
+
+	// One decode a frame, so warming the cache never stalls a frame for long
+	while(!M22Sound::SFX_WARM_QUEUE.empty())
+	{
+		int position = M22Sound::SFX_WARM_QUEUE.front();
+		M22Sound::SFX_WARM_QUEUE.pop_front();
+		if(M22Sound::SOUND_FX.at(position) == NULL)
+		{
+			M22Sound::GetSting(position);
+			break;
+		};
+	};
+	return;
+};
+
+Mix_Chunk* M22Sound::GetSting(int _position)
+{
+	if(_position < 0 || size_t(_position) >= M22Sound::SOUND_FX.size())
+	{
+		return NULL;
+	};
+	M22Sound::SFX_LAST_USED.at(_position) = SDL_GetTicks();
+	if(M22Sound::SOUND_FX.at(_position) != NULL)
+	{
+		return M22Sound::SOUND_FX.at(_position);
+	};
+
+	Mix_Chunk* temp = Mix_LoadWAV_RW(M22Archive::OpenRW(M22Sound::SFX_NAMES.at(_position)), 1);
+	if(!temp)
+	{
+		std::cout << "Failed to load file: " << M22Sound::SFX_NAMES.at(_position) << std::endl;
+		return NULL;
+	};
+	M22Sound::EvictStings(temp->alen);
+	M22Sound::SOUND_FX.at(_position) = temp;
+	M22Sound::SFX_RESIDENT_BYTES += temp->alen;
+	return temp;
+};
+
+void M22Sound::EvictStings(size_t _needed)
+{
+	while(M22Sound::SFX_RESIDENT_BYTES + _needed > M22Sound::SFX_BUDGET)
+	{
+		int oldest = -1;
+		for(size_t i = 0; i < M22Sound::SOUND_FX.size(); i++)
+		{
+			Mix_Chunk* chunk = M22Sound::SOUND_FX.at(i);
+			if(chunk == NULL)
+			{
+				continue;
+			};
+			// A chunk still on a channel can't be freed
+			if((Mix_Playing(M22Sound::MIXERS::SFX) && Mix_GetChunk(M22Sound::MIXERS::SFX) == chunk) ||
+				(Mix_Playing(M22Sound::MIXERS::LOOPED_SFX) && Mix_GetChunk(M22Sound::MIXERS::LOOPED_SFX) == chunk))
+			{
+				continue;
+			};
+			if(oldest == -1 || M22Sound::SFX_LAST_USED.at(i) < M22Sound::SFX_LAST_USED.at(oldest))
+			{
+				oldest = int(i);
+			};
+		};
+		if(oldest == -1)
+		{
+			// Everything left is playing; go over budget rather than cut a sound off
+			return;
+		};
+		M22Sound::SFX_RESIDENT_BYTES -= M22Sound::SOUND_FX.at(oldest)->alen;
+		Mix_FreeChunk(M22Sound::SOUND_FX.at(oldest));
+		M22Sound::SOUND_FX.at(oldest) = NULL;
+	};
+	return;
+};
+
+Mix_Music* M22Sound::GetMusic(int _position)
+{
+	if(_position < 0 || size_t(_position) >= M22Sound::MUSIC.size())
+	{
+		return NULL;
+	};
+	// UpdateSound asks for the current track every frame it isn't playing, so one that can't be opened is only tried once
+	if(M22Sound::MUSIC.at(_position) == NULL && !M22Sound::MUSIC_FAILED.at(_position))
+	{
+		// Mix_Music streams from the file as it plays, so opening it is cheap; only the headers are read
+		M22Sound::MUSIC.at(_position) = Mix_LoadMUS_RW(M22Archive::OpenRW(M22Sound::MUSIC_NAMES.at(_position)), 1);
+		if(!M22Sound::MUSIC.at(_position))
+		{
+			std::cout << "Failed to load file: " << M22Sound::MUSIC_NAMES.at(_position) << std::endl;
+			M22Sound::MUSIC_FAILED.at(_position) = true;
+		};
+	};
+	return M22Sound::MUSIC.at(_position);
+};
+
+void M22Sound::WarmStings(const std::vector<int>& _positions)
+{
+	M22Sound::SFX_WARM_QUEUE.clear();
+	for(size_t i = 0; i < _positions.size(); i++)
+	{
+		int position = _positions.at(i);
+		if(position < 0 || size_t(position) >= M22Sound::SOUND_FX.size())
+		{
+			continue;
+		};
+		if(M22Sound::SOUND_FX.at(position) == NULL)
+		{
+			M22Sound::SFX_WARM_QUEUE.push_back(position);
+		}
+		else
+		{
+			// Keep it from being evicted before it's played
+			M22Sound::SFX_LAST_USED.at(position) = SDL_GetTicks();
+		};
+	};
+	return;
+};
+
+void M22Sound::PrefetchTrack(int _position)
+{
+	if(_position == M22Sound::currentTrack)
+	{
+		_position = -1;
+	};
+	if(_position == M22Sound::prefetchedTrack)
+	{
+		return;
+	};
+	// Only the one coming up is kept open; anything further ahead can wait
+	if(M22Sound::prefetchedTrack != -1 && M22Sound::prefetchedTrack != M22Sound::currentTrack && M22Sound::MUSIC.at(M22Sound::prefetchedTrack) != NULL)
+	{
+		Mix_FreeMusic(M22Sound::MUSIC.at(M22Sound::prefetchedTrack));
+		M22Sound::MUSIC.at(M22Sound::prefetchedTrack) = NULL;
+	};
+	M22Sound::prefetchedTrack = (M22Sound::GetMusic(_position) != NULL ? _position : -1);
 	return;
 };
 
 short int M22Sound::PlaySting(short int _position, bool _forceplayback)
 {
-	if(M22Sound::SOUND_FX[_position])
+	Mix_Chunk* sting = M22Sound::GetSting(_position);
+	if(sting)
 	{
 		if(!Mix_Playing(M22Sound::MIXERS::SFX) || _forceplayback == true)
 		{
-			Mix_PlayChannel( M22Sound::MIXERS::SFX, M22Sound::SOUND_FX[_position], 0);
+			Mix_PlayChannel( M22Sound::MIXERS::SFX, sting, 0);
 			return 0;
 		}
 		else
@@ -142,6 +278,7 @@ short int M22Sound::PlaySting(short int _position, bool _forceplayback)
 void M22Sound::StopLoopedStings(void)
 {
 	Mix_HaltChannel(M22Sound::MIXERS::LOOPED_SFX);
+	M22Sound::currentLoopedSting = -1;
 	return;
 };
 
@@ -152,9 +289,11 @@ short int M22Sound::PlayLoopedSting(short int _position)
 		printf("[M22Sound] Cannot play sting because -1!\n");
 		return -2;
 	};
-	if(M22Sound::SOUND_FX.at(_position))
+	Mix_Chunk* sting = M22Sound::GetSting(_position);
+	if(sting)
 	{
-		Mix_PlayChannel( M22Sound::MIXERS::LOOPED_SFX, M22Sound::SOUND_FX.at(_position), -1);
+		Mix_PlayChannel( M22Sound::MIXERS::LOOPED_SFX, sting, -1);
+		M22Sound::currentLoopedSting = _position;
 		return 0;
 	}
 	else
@@ -165,19 +304,23 @@ short int M22Sound::PlayLoopedSting(short int _position)
 
 short int M22Sound::PlayLoopedSting(std::string _name)
 {
-	for(size_t i = 0; i < M22Sound::SOUND_FX.size(); i++)
+	int i = M22AssetRegistry::Lookup(M22AssetRegistry::STING, _name);
+	if(i == -1)
+	{
+		return -1;
+	};
+	if(!Mix_Playing(M22Sound::MIXERS::LOOPED_SFX))
 	{
-		if(_name == M22Sound::SFX_NAMES[i])
+		Mix_Chunk* sting = M22Sound::GetSting(i);
+		if(!sting)
 		{
-			if(!Mix_Playing(M22Sound::MIXERS::LOOPED_SFX))
-			{
-				Mix_PlayChannel( M22Sound::MIXERS::LOOPED_SFX, M22Sound::SOUND_FX[i], -1);
-				return 0;
-			};
-			return -2;
+			return -1;
 		};
+		Mix_PlayChannel( M22Sound::MIXERS::LOOPED_SFX, sting, -1);
+		M22Sound::currentLoopedSting = i;
+		return 0;
 	};
-	return -1;
+	return -2;
 };
 
 /*
@@ -187,32 +330,31 @@ short int M22Sound::PlayLoopedSting(std::string _name)
 */
 short int M22Sound::PlaySting(std::string _name, bool _forceplayback)
 {
-	for(size_t i = 0; i < M22Sound::SOUND_FX.size(); i++)
+	int i = M22AssetRegistry::Lookup(M22AssetRegistry::STING, _name);
+	if(i == -1)
 	{
-		if(_name == M22Sound::SFX_NAMES[i])
+		printf("Failed to find and play sting: %s", _name.c_str());
+		return -1;
+	};
+	if(!Mix_Playing(M22Sound::MIXERS::SFX) || _forceplayback == true)
+	{
+		Mix_Chunk* sting = M22Sound::GetSting(i);
+		if(!sting)
 		{
-			if(!Mix_Playing(M22Sound::MIXERS::SFX) || _forceplayback == true)
-			{
-				Mix_PlayChannel( M22Sound::MIXERS::SFX, M22Sound::SOUND_FX[i], 0);
-				return 0;
-			};
-			return -2;
+			return -1;
 		};
+		Mix_PlayChannel( M22Sound::MIXERS::SFX, sting, 0);
+		return 0;
 	};
-	printf("Failed to find and play sting: %s", _name.c_str());
-	return -1;
+	return -2;
 };
 
 short int M22Sound::ChangeMusicTrack(std::string _name)
 {
-	for(size_t i = 0; i < M22Sound::MUSIC.size(); i++)
+	int i = M22AssetRegistry::Lookup(M22AssetRegistry::MUSIC, _name);
+	if(i != -1)
 	{
-		if(_name == M22Sound::MUSIC_NAMES.at(i))
-		{
-			Mix_PlayMusic( M22Sound::MUSIC.at(i), -1 );
-			M22Sound::currentTrack = i;
-			return 0;
-		};
+		return M22Sound::ChangeMusicTrack((short int)i);
 	};
 	printf("Failed to find music file: %s", _name.c_str());
 	M22Sound::StopMusic();
@@ -221,10 +363,24 @@ short int M22Sound::ChangeMusicTrack(std::string _name)
 
 short int M22Sound::ChangeMusicTrack(short int _position)
 {
-	if(M22Sound::MUSIC.at(_position))
+	Mix_Music* music = M22Sound::GetMusic(_position);
+	if(music)
 	{
-		Mix_PlayMusic( M22Sound::MUSIC.at(_position), -1 );
+		Mix_PlayMusic( music, -1 );
 		M22Sound::currentTrack = _position;
+		if(M22Sound::prefetchedTrack == _position)
+		{
+			M22Sound::prefetchedTrack = -1;
+		};
+		// Mix_PlayMusic halted whatever was playing, so only this track and the one coming up need to stay open
+		for(size_t i = 0; i < M22Sound::MUSIC.size(); i++)
+		{
+			if(M22Sound::MUSIC.at(i) != NULL && int(i) != _position && int(i) != M22Sound::prefetchedTrack)
+			{
+				Mix_FreeMusic(M22Sound::MUSIC.at(i));
+				M22Sound::MUSIC.at(i) = NULL;
+			};
+		};
 		return 0;
 	}
 	else
@@ -0,0 +1,249 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+std::vector<M22Startup::Task> M22Startup::TASKS;
+std::deque<int> M22Startup::LOAD_QUEUE;
+int M22Startup::LOADS_PENDING = 0;
+std::vector<std::thread> M22Startup::WORKERS;
+std::mutex M22Startup::MUTEX;
+std::condition_variable M22Startup::QUEUE_CONDITION;
+std::condition_variable M22Startup::LOADED_CONDITION;
+bool M22Startup::RUNNING = false;
+std::unordered_map<std::string, SDL_Surface*> M22Startup::IMAGES;
+std::mutex M22Startup::IMAGES_MUTEX;
+Uint64 M22Startup::START = 0;
+
+namespace
+{
+	double MillisecondsSince(Uint64 _start)
+	{
+		return double(SDL_GetPerformanceCounter() - _start) * 1000.0 / double(SDL_GetPerformanceFrequency());
+	};
+
+	bool AllDone(const std::vector<int>& _dependencies)
+	{
+		for(size_t i = 0; i < _dependencies.size(); i++)
+		{
+			if(!M22Startup::TASKS.at(_dependencies.at(i)).done)
+			{
+				return false;
+			};
+		};
+		return true;
+	};
+}
+
+int M22Startup::AddTask(const std::string& _name, TaskFunction _load, TaskFunction _upload, const std::vector<int>& _loadDependencies, const std::vector<int>& _uploadDependencies)
+{
+	Task task;
+	task.name = _name;
+	task.load = _load;
+	task.upload = _upload;
+	// Only earlier tasks can be depended on, so there can't be a cycle
+	int index = int(M22Startup::TASKS.size());
+	for(size_t i = 0; i < _loadDependencies.size(); i++)
+	{
+		if(_loadDependencies.at(i) >= 0 && _loadDependencies.at(i) < index) task.loadDependencies.push_back(_loadDependencies.at(i));
+	};
+	for(size_t i = 0; i < _uploadDependencies.size(); i++)
+	{
+		if(_uploadDependencies.at(i) >= 0 && _uploadDependencies.at(i) < index) task.uploadDependencies.push_back(_uploadDependencies.at(i));
+	};
+	M22Startup::TASKS.push_back(task);
+	return index;
+};
+
+void M22Startup::QueueReadyLoads(void)
+{
+	for(size_t i = 0; i < M22Startup::TASKS.size(); i++)
+	{
+		Task& task = M22Startup::TASKS.at(i);
+		if(task.queued || !AllDone(task.loadDependencies))
+		{
+			continue;
+		};
+		task.queued = true;
+		if(task.load)
+		{
+			M22Startup::LOAD_QUEUE.push_back(int(i));
+			M22Startup::LOADS_PENDING++;
+			M22Startup::QUEUE_CONDITION.notify_one();
+		}
+		else
+		{
+			task.loaded = true;
+		};
+	};
+	return;
+};
+
+void M22Startup::WorkerLoop(void)
+{
+	std::unique_lock<std::mutex> lock(M22Startup::MUTEX);
+	while(true)
+	{
+		M22Startup::QUEUE_CONDITION.wait(lock, []{ return !M22Startup::LOAD_QUEUE.empty() || !M22Startup::RUNNING; });
+		if(M22Startup::LOAD_QUEUE.empty())
+		{
+			return;
+		};
+		int index = M22Startup::LOAD_QUEUE.front();
+		M22Startup::LOAD_QUEUE.pop_front();
+		// TASKS isn't resized while running, so the function can be called without the lock
+		TaskFunction load = M22Startup::TASKS.at(index).load;
+		lock.unlock();
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		short int result = load();
+		double elapsed = MillisecondsSince(start);
+
+		lock.lock();
+		Task& task = M22Startup::TASKS.at(index);
+		task.loadMs = elapsed;
+		task.result = result;
+		task.loaded = true;
+		M22Startup::LOADS_PENDING--;
+		M22Startup::LOADED_CONDITION.notify_one();
+	};
+};
+
+short int M22Startup::Run(unsigned int _num_of_workers)
+{
+	M22Startup::START = SDL_GetPerformanceCounter();
+	if(_num_of_workers == 0)
+	{
+		_num_of_workers = std::thread::hardware_concurrency();
+		_num_of_workers = (_num_of_workers > 1 ? _num_of_workers - 1 : 1);
+	};
+	// Load the decoder libraries up-front, so the load steps never race to do it
+	IMG_Init(IMG_INIT_PNG | IMG_INIT_WEBP);
+	M22Startup::RUNNING = true;
+	for(unsigned int i = 0; i < _num_of_workers; i++)
+	{
+		M22Startup::WORKERS.push_back(std::thread(M22Startup::WorkerLoop));
+	};
+
+	short int failed = 0;
+	size_t finished = 0;
+	std::unique_lock<std::mutex> lock(M22Startup::MUTEX);
+	M22Startup::QueueReadyLoads();
+	while(finished < M22Startup::TASKS.size())
+	{
+		// Uploads go in the order the tasks were added, so the renderer sees the same order every run
+		int next = -1;
+		for(size_t i = 0; i < M22Startup::TASKS.size() && next == -1; i++)
+		{
+			const Task& task = M22Startup::TASKS.at(i);
+			if(task.loaded && !task.done && AllDone(task.uploadDependencies))
+			{
+				next = int(i);
+			};
+		};
+		if(next == -1)
+		{
+			if(M22Startup::LOADS_PENDING == 0)
+			{
+				printf("[M22Startup] %u tasks can never run!\n", (unsigned int)(M22Startup::TASKS.size() - finished));
+				failed += short(M22Startup::TASKS.size() - finished);
+				break;
+			};
+			M22Startup::LOADED_CONDITION.wait(lock);
+			continue;
+		};
+
+		TaskFunction upload = M22Startup::TASKS.at(next).upload;
+		lock.unlock();
+		Uint64 start = SDL_GetPerformanceCounter();
+		short int result = (upload ? upload() : 0);
+		double elapsed = MillisecondsSince(start);
+		lock.lock();
+
+		Task& task = M22Startup::TASKS.at(next);
+		task.uploadMs = elapsed;
+		task.finishedAt = MillisecondsSince(M22Startup::START);
+		if(task.result == 0)
+		{
+			task.result = result;
+		};
+		if(task.result != 0)
+		{
+			printf("[M22Startup] %s failed with error %i\n", task.name.c_str(), task.result);
+			failed++;
+		};
+		task.done = true;
+		finished++;
+		M22Startup::QueueReadyLoads();
+	};
+	M22Startup::RUNNING = false;
+	M22Startup::QUEUE_CONDITION.notify_all();
+	lock.unlock();
+	for(size_t i = 0; i < M22Startup::WORKERS.size(); i++)
+	{
+		M22Startup::WORKERS.at(i).join();
+	};
+	M22Startup::PrintReport();
+	M22Startup::WORKERS.clear();
+
+	std::lock_guard<std::mutex> imagesLock(M22Startup::IMAGES_MUTEX);
+	for(std::unordered_map<std::string, SDL_Surface*>::iterator it = M22Startup::IMAGES.begin(); it != M22Startup::IMAGES.end(); ++it)
+	{
+		printf("[M22Startup] %s was decoded but never used\n", it->first.c_str());
+		SDL_FreeSurface(it->second);
+	};
+	M22Startup::IMAGES.clear();
+	M22Startup::TASKS.clear();
+	M22Startup::LOAD_QUEUE.clear();
+	M22Startup::LOADS_PENDING = 0;
+	return failed;
+};
+
+void M22Startup::PrintReport(void)
+{
+	double total = MillisecondsSince(M22Startup::START);
+	double loading = 0.0, uploading = 0.0;
+	printf("[M22Startup] Started up in %.1f ms on %u worker threads:\n", total, (unsigned int)M22Startup::WORKERS.size());
+	for(size_t i = 0; i < M22Startup::TASKS.size(); i++)
+	{
+		const Task& task = M22Startup::TASKS.at(i);
+		printf("[M22Startup]   %-24s load %8.2f ms   upload %8.2f ms   done at %8.2f ms\n", task.name.c_str(), task.loadMs, task.uploadMs, task.finishedAt);
+		loading += task.loadMs;
+		uploading += task.uploadMs;
+	};
+	printf("[M22Startup] %.1f ms of work in all; %.1f ms loading on the workers, %.1f ms uploading on the main thread\n", loading + uploading, loading, uploading);
+	return;
+};
+
+short int M22Startup::DecodeImage(const std::string& _path)
+{
+	SDL_Surface* decoded = IMG_Load_RW(M22Archive::OpenRW(_path), 1);
+	if(decoded == NULL)
+	{
+		// Left for the upload step to try (and report) again
+		return -1;
+	};
+	std::lock_guard<std::mutex> lock(M22Startup::IMAGES_MUTEX);
+	std::pair<std::unordered_map<std::string, SDL_Surface*>::iterator, bool> inserted = M22Startup::IMAGES.insert(std::make_pair(_path, decoded));
+	if(!inserted.second)
+	{
+		SDL_FreeSurface(decoded);
+	};
+	return 0;
+};
+
+SDL_Surface* M22Startup::TakeImage(const std::string& _path)
+{
+	std::lock_guard<std::mutex> lock(M22Startup::IMAGES_MUTEX);
+	if(M22Startup::IMAGES.empty())
+	{
+		return NULL;
+	};
+	std::unordered_map<std::string, SDL_Surface*>::iterator found = M22Startup::IMAGES.find(_path);
+	if(found == M22Startup::IMAGES.end())
+	{
+		return NULL;
+	};
+	SDL_Surface* surface = found->second;
+	M22Startup::IMAGES.erase(found);
+	return surface;
+};
@@ -0,0 +1,397 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+SDL_Texture* M22TextLayer::LAYER = NULL;
+int M22TextLayer::LAYER_WIDTH = 0;
+int M22TextLayer::LAYER_HEIGHT = 0;
+std::string M22TextLayer::PAGE;
+std::vector<M22TextLayer::LayoutLine> M22TextLayer::LINES;
+size_t M22TextLayer::DRAWN = 0;
+bool M22TextLayer::VALID = false;
+float M22TextLayer::COLUMN_X = 0;
+float M22TextLayer::COLUMN_Y = 0;
+int M22TextLayer::COLUMN_WIDTH = 0;
+
+std::vector<M22TextLayer::LineLayout> M22TextLayer::SCRIPT_LAYOUT;
+const NFont* M22TextLayer::SCRIPT_LAYOUT_FONT = NULL;
+int M22TextLayer::SCRIPT_LAYOUT_WIDTH = 0;
+int M22TextLayer::SCRIPT_LAYOUT_ROWS = 0;
+
+float M22TextLayer::MeasureRange(std::string_view _text, size_t _from, size_t _to)
+{
+	if(_to <= _from)
+	{
+		return 0;
+	};
+	// The text is already UTF-8, so NFont reads the range straight out of it
+	return float(M22Script::font->getWidth("%.*s", int(_to - _from), _text.data() + _from));
+};
+
+void M22TextLayer::WrapText(std::string_view _text, size_t _start, int _columnWidth, float& _y, std::vector<LayoutLine>& _rows)
+{
+	// Greedy word wrap, like NFont::drawColumn; words wider than the column are broken between characters
+	const float lineStep = float(M22Script::font->getHeight() + M22Script::font->getLineSpacing());
+	size_t paragraphStart = _start;
+	while(paragraphStart <= _text.size())
+	{
+		size_t paragraphEnd = _text.find('\n', paragraphStart);
+		if(paragraphEnd == std::string_view::npos)
+		{
+			paragraphEnd = _text.size();
+		};
+
+		size_t lineStart = paragraphStart;
+		size_t lineEnd = paragraphStart;
+		size_t cursor = paragraphStart;
+		bool lineOpen = true;
+		while(true)
+		{
+			size_t wordEnd = _text.find(' ', cursor);
+			if(wordEnd == std::string_view::npos || wordEnd > paragraphEnd)
+			{
+				wordEnd = paragraphEnd;
+			};
+
+			if(M22TextLayer::MeasureRange(_text, lineStart, wordEnd) <= _columnWidth)
+			{
+				lineEnd = wordEnd;
+			}
+			else if(lineEnd == lineStart)
+			{
+				// Nothing on the line yet, so the word has to be split (between characters, not bytes)
+				lineEnd = M22NextUTF8(_text, lineStart);
+				while(lineEnd < wordEnd && M22TextLayer::MeasureRange(_text, lineStart, M22NextUTF8(_text, lineEnd)) <= _columnWidth)
+				{
+					lineEnd = M22NextUTF8(_text, lineEnd);
+				};
+				LayoutLine line = { lineStart, lineEnd - lineStart, _y };
+				_rows.push_back(line);
+				_y += lineStep;
+				lineStart = cursor = lineEnd;
+				if(lineEnd >= paragraphEnd)
+				{
+					lineOpen = false;
+					break;
+				};
+				continue;
+			}
+			else
+			{
+				// Break on the space before this word
+				LayoutLine line = { lineStart, lineEnd - lineStart, _y };
+				_rows.push_back(line);
+				_y += lineStep;
+				lineStart = lineEnd = cursor = lineEnd + 1;
+				continue;
+			};
+
+			if(wordEnd >= paragraphEnd)
+			{
+				break;
+			};
+			cursor = wordEnd + 1;
+		};
+
+		if(lineOpen)
+		{
+			LayoutLine line = { lineStart, lineEnd - lineStart, _y };
+			_rows.push_back(line);
+			_y += lineStep;
+		};
+		paragraphStart = paragraphEnd + 1;
+	};
+	return;
+};
+
+void M22TextLayer::Layout(int _columnWidth, const std::string& _oldPage, const std::vector<LayoutLine>& _oldLines, std::string_view _line, const LineLayout* _layout, size_t _page)
+{
+	M22_PROFILE_SCOPE("M22TextLayer::Layout");
+	const float lineStep = float(M22Script::font->getHeight() + M22Script::font->getLineSpacing());
+	const std::string& page = M22TextLayer::PAGE;
+	M22TextLayer::LINES.clear();
+	float y = 0;
+	size_t start = 0;
+
+	// Paragraphs before the first change from the old page wrap the same as they did, so keep their rows
+	size_t common = 0;
+	size_t shared = std::min(_oldPage.size(), page.size());
+	while(common < shared && _oldPage[common] == page[common])
+	{
+		common++;
+	};
+	size_t kept = (common > 0 ? page.rfind('\n', common - 1) : std::string::npos);
+	if(common == _oldPage.size() && common < page.size() && page[common] == '\n')
+	{
+		// The old page's last paragraph has just been ended, so it's unchanged too
+		kept = common;
+	};
+	if(kept != std::string::npos && !_oldLines.empty())
+	{
+		for(size_t i = 0; i < _oldLines.size() && _oldLines.at(i).start <= kept; i++)
+		{
+			M22TextLayer::LINES.push_back(_oldLines.at(i));
+		};
+		if(!M22TextLayer::LINES.empty())
+		{
+			y = M22TextLayer::LINES.back().y + lineStep;
+			start = kept + 1;
+		};
+	};
+
+	// The line's page ends the page, and was wrapped when the script was loaded; it can only be used as it is
+	// if it starts a paragraph, which it does unless the page has been put together some other way
+	size_t lineOffset = (page.size() >= _line.size() ? page.size() - _line.size() : 0);
+	bool fromLayout = (_layout != NULL && _page < _layout->pages.size() &&
+		page.size() >= _line.size() && lineOffset >= start &&
+		(lineOffset == 0 || page[lineOffset - 1] == '\n') &&
+		page.compare(lineOffset, std::string::npos, _line.data(), _line.size()) == 0);
+	if(!fromLayout)
+	{
+		M22TextLayer::WrapText(page, start, _columnWidth, y, M22TextLayer::LINES);
+		return;
+	};
+	if(lineOffset > start)
+	{
+		M22TextLayer::WrapText(std::string_view(page).substr(0, lineOffset - 1), start, _columnWidth, y, M22TextLayer::LINES);
+	};
+
+	size_t first = _layout->pages.at(_page);
+	size_t last = (_page + 1 < _layout->pages.size() ? _layout->pages.at(_page + 1) : _layout->rows.size());
+	size_t from = M22TextLayer::PageStart(*_layout, _page);
+	float top = (first < last ? _layout->rows.at(first).y : 0);
+	for(size_t i = first; i < last; i++)
+	{
+		LayoutLine row = _layout->rows.at(i);
+		row.start = row.start - from + lineOffset;
+		row.y = row.y - top + y;
+		M22TextLayer::LINES.push_back(row);
+	};
+	return;
+};
+
+int M22TextLayer::ColumnWidth(void)
+{
+	return int(M22Engine::ScrSize.x()) - TEXT_COLUMN_MARGIN;
+};
+
+int M22TextLayer::RowsPerPage(void)
+{
+	if(M22Script::font == NULL)
+	{
+		return 1;
+	};
+	int lineStep = M22Script::font->getHeight() + M22Script::font->getLineSpacing();
+	int height = int(M22Engine::ScrSize.y()) - TEXT_COLUMN_Y - TEXT_PAGE_MARGIN_BOTTOM;
+	return std::max(1, (lineStep > 0 ? height / lineStep : 1));
+};
+
+void M22TextLayer::LayoutScript(void)
+{
+	// Lines are only measured when they come up, so loading a script doesn't render every glyph in it at once
+	M22TextLayer::SCRIPT_LAYOUT.clear();
+	M22TextLayer::SCRIPT_LAYOUT_FONT = M22Script::font;
+	M22TextLayer::SCRIPT_LAYOUT_WIDTH = M22TextLayer::ColumnWidth();
+	M22TextLayer::SCRIPT_LAYOUT_ROWS = M22TextLayer::RowsPerPage();
+	M22TextLayer::SCRIPT_LAYOUT.resize(M22ScriptCompiler::currentScript_c.size());
+	return;
+};
+
+const M22TextLayer::LineLayout* M22TextLayer::GetLineLayout(int _line)
+{
+	if(M22Script::font == NULL || _line < 0 || size_t(_line) >= M22ScriptCompiler::currentScript_c.size())
+	{
+		return NULL;
+	};
+	if(M22TextLayer::SCRIPT_LAYOUT_FONT != M22Script::font ||
+		M22TextLayer::SCRIPT_LAYOUT_WIDTH != M22TextLayer::ColumnWidth() ||
+		M22TextLayer::SCRIPT_LAYOUT_ROWS != M22TextLayer::RowsPerPage() ||
+		M22TextLayer::SCRIPT_LAYOUT.size() != M22ScriptCompiler::currentScript_c.size())
+	{
+		M22TextLayer::LayoutScript();
+	};
+	LineLayout& layout = M22TextLayer::SCRIPT_LAYOUT.at(_line);
+	const M22ScriptCompiler::line_c& line = M22ScriptCompiler::currentScript_c.at(_line);
+	if(!layout.laidOut && (line.m_lineType == M22Script::LINETYPE::SPEECH || line.m_lineType == M22Script::LINETYPE::NARRATIVE))
+	{
+		M22_PROFILE_SCOPE("M22TextLayer::GetLineLayout");
+		float y = 0;
+		M22TextLayer::WrapText(line.m_lineContents, 0, M22TextLayer::SCRIPT_LAYOUT_WIDTH, y, layout.rows);
+		for(size_t row = 0; row < layout.rows.size(); row += size_t(M22TextLayer::SCRIPT_LAYOUT_ROWS))
+		{
+			layout.pages.push_back(row);
+		};
+	};
+	layout.laidOut = true;
+	return (layout.pages.empty() ? NULL : &layout);
+};
+
+size_t M22TextLayer::PageStart(const LineLayout& _layout, size_t _page)
+{
+	return _layout.rows.at(_layout.pages.at(_page)).start;
+};
+
+size_t M22TextLayer::PageEnd(const LineLayout& _layout, size_t _page)
+{
+	size_t last = (_page + 1 < _layout.pages.size() ? _layout.pages.at(_page + 1) : _layout.rows.size()) - 1;
+	return _layout.rows.at(last).start + _layout.rows.at(last).length;
+};
+
+int M22TextLayer::CountRows(std::string_view _text, int _columnWidth)
+{
+	if(M22Script::font == NULL)
+	{
+		return 0;
+	};
+	std::vector<LayoutLine> rows;
+	float y = 0;
+	M22TextLayer::WrapText(_text, 0, _columnWidth, y, rows);
+	return int(rows.size());
+};
+
+void M22TextLayer::DrawRange(size_t _from, size_t _to)
+{
+	for(size_t i = 0; i < M22TextLayer::LINES.size(); i++)
+	{
+		const LayoutLine& line = M22TextLayer::LINES.at(i);
+		size_t from = std::max(_from, line.start);
+		size_t to = std::min(_to, line.start + line.length);
+		if(from >= to)
+		{
+			continue;
+		};
+		float x = M22TextLayer::COLUMN_X + M22TextLayer::MeasureRange(M22TextLayer::PAGE, line.start, from);
+		M22Script::font->draw(M22Renderer::SDL_RENDERER, x, M22TextLayer::COLUMN_Y + line.y, "%.*s", int(to - from), M22TextLayer::PAGE.data() + from);
+	};
+	return;
+};
+
+void M22TextLayer::Draw(const std::string& _revealed, std::string_view _line, size_t _revealedInLine, float _x, float _y, int _columnWidth, int ScrW, int ScrH, const LineLayout* _layout, size_t _page)
+{
+	if(M22Script::font == NULL)
+	{
+		return;
+	};
+	_revealedInLine = std::min(_revealedInLine, _line.size());
+
+	// At the output resolution; the page is laid out in logical (ScrW x ScrH) coordinates and scaled into it
+	if(M22TextLayer::LAYER != NULL && (M22TextLayer::LAYER_WIDTH != M22Compositor::WIDTH || M22TextLayer::LAYER_HEIGHT != M22Compositor::HEIGHT))
+	{
+		M22TextLayer::Shutdown();
+	};
+	if(M22TextLayer::LAYER == NULL && M22Compositor::WIDTH > 0 && SDL_RenderTargetSupported(M22Renderer::SDL_RENDERER))
+	{
+		M22TextLayer::LAYER = M22Compositor::CreateLayer();
+		if(M22TextLayer::LAYER == NULL)
+		{
+			printf("[M22TextLayer] Failed to create text layer; drawing text directly: %s\n", SDL_GetError());
+		}
+		else
+		{
+			M22TextLayer::LAYER_WIDTH = M22Compositor::WIDTH;
+			M22TextLayer::LAYER_HEIGHT = M22Compositor::HEIGHT;
+		};
+		M22TextLayer::VALID = false;
+	};
+
+	// Only lay out again when the page itself changes (a new line, or a new page), not as it's typed out
+	size_t pending = _line.size() - _revealedInLine;
+	bool sameColumn = (M22TextLayer::COLUMN_X == _x && M22TextLayer::COLUMN_Y == _y && M22TextLayer::COLUMN_WIDTH == _columnWidth);
+	bool samePage = sameColumn &&
+		(M22TextLayer::PAGE.size() == _revealed.size() + pending) &&
+		(M22TextLayer::PAGE.compare(0, _revealed.size(), _revealed) == 0) &&
+		(M22TextLayer::PAGE.compare(_revealed.size(), pending, _line.substr(_revealedInLine)) == 0);
+	if(!samePage)
+	{
+		std::string oldPage;
+		oldPage.swap(M22TextLayer::PAGE);
+		std::vector<LayoutLine> oldLines;
+		oldLines.swap(M22TextLayer::LINES);
+
+		M22TextLayer::PAGE = _revealed;
+		M22TextLayer::PAGE.append(_line.substr(_revealedInLine));
+		M22TextLayer::COLUMN_X = _x;
+		M22TextLayer::COLUMN_Y = _y;
+		M22TextLayer::COLUMN_WIDTH = _columnWidth;
+		if(!sameColumn)
+		{
+			oldLines.clear();
+		};
+		// A layout wrapped for some other column is no use
+		if(_layout != NULL && M22TextLayer::SCRIPT_LAYOUT_WIDTH != _columnWidth)
+		{
+			_layout = NULL;
+		};
+		M22TextLayer::Layout(_columnWidth, oldPage, oldLines, _line, _layout, _page);
+
+		// Appending to the page normally leaves the glyphs already drawn where they were; if not, start over
+		bool keepDrawn = sameColumn && M22TextLayer::DRAWN <= M22TextLayer::PAGE.size() &&
+			oldPage.compare(0, M22TextLayer::DRAWN, M22TextLayer::PAGE, 0, M22TextLayer::DRAWN) == 0;
+		for(size_t i = 0; keepDrawn && i < oldLines.size() && oldLines.at(i).start < M22TextLayer::DRAWN; i++)
+		{
+			keepDrawn = (i < M22TextLayer::LINES.size()) &&
+				(M22TextLayer::LINES.at(i).start == oldLines.at(i).start) &&
+				(M22TextLayer::LINES.at(i).y == oldLines.at(i).y) &&
+				(M22TextLayer::LINES.at(i).length == oldLines.at(i).length || oldLines.at(i).start + oldLines.at(i).length >= M22TextLayer::DRAWN);
+		};
+		if(!keepDrawn)
+		{
+			M22TextLayer::VALID = false;
+		};
+	};
+
+	if(M22TextLayer::LAYER == NULL)
+	{
+		M22TextLayer::DRAWN = _revealed.size();
+		M22Script::font->drawColumn(M22Renderer::SDL_RENDERER, _x + 2, _y + 2, _columnWidth, NFont::Color(0, 0, 0, 255), "%s", _revealed.c_str());
+		M22Script::font->drawColumn(M22Renderer::SDL_RENDERER, _x, _y, _columnWidth, "%s", _revealed.c_str());
+		return;
+	};
+
+	if(!M22TextLayer::VALID || _revealed.size() != M22TextLayer::DRAWN)
+	{
+		Uint8 r, g, b, a;
+		SDL_GetRenderDrawColor(M22Renderer::SDL_RENDERER, &r, &g, &b, &a);
+		M22Compositor::Begin(M22TextLayer::LAYER);
+		if(!M22TextLayer::VALID || _revealed.size() < M22TextLayer::DRAWN)
+		{
+			// Cleared to transparent white, so blending the (white) glyphs in doesn't darken their edges
+			SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, 255, 255, 255, 0);
+			SDL_RenderClear(M22Renderer::SDL_RENDERER);
+			M22TextLayer::DRAWN = 0;
+			M22TextLayer::VALID = true;
+		};
+		M22TextLayer::DrawRange(M22TextLayer::DRAWN, _revealed.size());
+		M22TextLayer::DRAWN = _revealed.size();
+		M22Compositor::End();
+		SDL_SetRenderDrawColor(M22Renderer::SDL_RENDERER, r, g, b, a);
+	};
+
+	// The shadow is the same layer tinted black, so the whole page is two copies of one texture
+	SDL_Rect shadowRect = { 2, 2, ScrW, ScrH };
+	SDL_Rect pageRect = { 0, 0, ScrW, ScrH };
+	SDL_SetTextureColorMod(M22TextLayer::LAYER, 0, 0, 0);
+	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22TextLayer::LAYER, NULL, &shadowRect);
+	SDL_SetTextureColorMod(M22TextLayer::LAYER, 255, 255, 255);
+	SDL_RenderCopy(M22Renderer::SDL_RENDERER, M22TextLayer::LAYER, NULL, &pageRect);
+	return;
+};
+
+void M22TextLayer::Invalidate(void)
+{
+	M22TextLayer::VALID = false;
+	return;
+};
+
+void M22TextLayer::Shutdown(void)
+{
+	if(M22TextLayer::LAYER != NULL)
+	{
+		SDL_DestroyTexture(M22TextLayer::LAYER);
+		M22TextLayer::LAYER = NULL;
+	};
+	M22TextLayer::LAYER_WIDTH = 0;
+	M22TextLayer::LAYER_HEIGHT = 0;
+	M22TextLayer::VALID = false;
+	return;
+};
@@ -0,0 +1,135 @@
+#include <engine/M22Engine.h>
+
+using namespace March22;
+
+M22Tween::Tween M22Tween::TWEENS[TWEEN_SLOTS];
+size_t M22Tween::COUNT = 0;
+
+float M22Tween::Ease(M22Tween::EASINGS _easing, float _t)
+{
+	switch(_easing)
+	{
+		case EASE_OUT:
+			return 1.0f - (1.0f - _t) * (1.0f - _t);
+		case EASE_IN_OUT:
+			return _t * _t * (3.0f - 2.0f * _t);
+		case LINEAR:
+		default:
+			return _t;
+	};
+};
+
+short int M22Tween::Start(float* _value, float _to, Uint32 _ms, M22Tween::EASINGS _easing)
+{
+	if(_ms == 0)
+	{
+		M22Tween::Stop(_value);
+		*_value = _to;
+		return 0;
+	};
+
+	size_t i = 0;
+	while(i < M22Tween::COUNT && M22Tween::TWEENS[i].value != _value)
+	{
+		i++;
+	};
+	if(i == M22Tween::COUNT)
+	{
+		if(M22Tween::COUNT == TWEEN_SLOTS)
+		{
+			printf("[M22Tween] All %i tweens are running; setting the value straight away\n", TWEEN_SLOTS);
+			*_value = _to;
+			return -1;
+		};
+		M22Tween::COUNT++;
+	};
+
+	Tween& tween = M22Tween::TWEENS[i];
+	tween.value = _value;
+	tween.from = *_value;
+	tween.to = _to;
+	tween.duration = _ms;
+	tween.elapsed = 0;
+	tween.easing = _easing;
+	M22FrameScheduler::MarkDirty();
+	return 0;
+};
+
+void M22Tween::Stop(const float* _value)
+{
+	for(size_t i = 0; i < M22Tween::COUNT; i++)
+	{
+		if(M22Tween::TWEENS[i].value == _value)
+		{
+			M22Tween::TWEENS[i] = M22Tween::TWEENS[--M22Tween::COUNT];
+			return;
+		};
+	};
+	return;
+};
+
+bool M22Tween::IsRunning(const float* _value)
+{
+	for(size_t i = 0; i < M22Tween::COUNT; i++)
+	{
+		if(M22Tween::TWEENS[i].value == _value)
+		{
+			return true;
+		};
+	};
+	return false;
+};
+
+float M22Tween::Target(const float* _value)
+{
+	for(size_t i = 0; i < M22Tween::COUNT; i++)
+	{
+		if(M22Tween::TWEENS[i].value == _value)
+		{
+			return M22Tween::TWEENS[i].to;
+		};
+	};
+	return *_value;
+};
+
+void M22Tween::Update(Uint32 _ms)
+{
+	M22_PROFILE_SCOPE("M22Tween::Update");
+	size_t i = 0;
+	while(i < M22Tween::COUNT)
+	{
+		Tween& tween = M22Tween::TWEENS[i];
+		tween.elapsed += _ms;
+		if(tween.elapsed >= tween.duration)
+		{
+			// Done; the last one takes its place, and gets looked at next
+			*tween.value = tween.to;
+			tween = M22Tween::TWEENS[--M22Tween::COUNT];
+			continue;
+		};
+		float t = M22Tween::Ease(tween.easing, float(tween.elapsed) / float(tween.duration));
+		*tween.value = tween.from + (tween.to - tween.from) * t;
+		i++;
+	};
+	return;
+};
+
+void M22Tween::Finish(void)
+{
+	for(size_t i = 0; i < M22Tween::COUNT; i++)
+	{
+		*M22Tween::TWEENS[i].value = M22Tween::TWEENS[i].to;
+	};
+	if(M22Tween::COUNT > 0)
+	{
+		M22FrameScheduler::MarkDirty();
+	};
+	M22Tween::COUNT = 0;
+	return;
+};
+
+void M22Tween::Reset(void)
+{
+	M22Tween::COUNT = 0;
+	return;
+};
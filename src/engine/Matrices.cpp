@@ -1,183 +1,119 @@
 #include <engine/Matrices.h>
+#include <algorithm>
 
-Matrix Matrix::Sum ( Matrix* _mat1, Matrix* _mat2)
-{
-	if(_mat1->matrix_.size() != _mat2->matrix_.size() || _mat1->matrix_[0].size() != _mat2->matrix_[0].size())
-	{
-		// INCOMPATIBLE!!!
-		throw;
-	};
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define M22_SSE2
+	#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define M22_NEON
+	#include <arm_neon.h>
+#endif
 
-	Matrix result_matrix(_mat1->matrix_.size(),_mat1->matrix_[0].size());
-	for ( size_t y = 0 ; y < _mat1->matrix_.size() ; y++ )
-		for ( size_t x = 0 ; x < _mat1->matrix_[y].size() ; x++ )
-			result_matrix.matrix_[y][x] = _mat1->matrix_[y][x] + _mat2->matrix_[y][x];
-
-	return result_matrix;
+Vec4f Matrix::Multiply ( const Mat4f& _mat1, const Vec4f& _vec)
+{
+	Vec4f result;
+#if defined(M22_SSE2)
+	__m128 sum = _mm_mul_ps(_mm_load_ps(_mat1.column(0).data()), _mm_set1_ps(_vec[0]));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(_mat1.column(1).data()), _mm_set1_ps(_vec[1])));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(_mat1.column(2).data()), _mm_set1_ps(_vec[2])));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(_mat1.column(3).data()), _mm_set1_ps(_vec[3])));
+	_mm_store_ps(result.data(), sum);
+#elif defined(M22_NEON)
+	float32x4_t sum = vmulq_n_f32(vld1q_f32(_mat1.column(0).data()), _vec[0]);
+	sum = vmlaq_n_f32(sum, vld1q_f32(_mat1.column(1).data()), _vec[1]);
+	sum = vmlaq_n_f32(sum, vld1q_f32(_mat1.column(2).data()), _vec[2]);
+	sum = vmlaq_n_f32(sum, vld1q_f32(_mat1.column(3).data()), _vec[3]);
+	vst1q_f32(result.data(), sum);
+#else
+	result = _mat1 * _vec;
+#endif
+	return result;
 };
 
-Vec4* Matrix::Multiply ( Matrix* _mat1, Vec4* _vec)
+void Matrix::TransformRects ( const Mat3f& _transform, const int* _rects, int* _out, size_t _count)
 {
-	if(_mat1->matrix_.size() != 4 || _mat1->matrix_[0].size() != 4)
+	// x' = a*x + b*y + tx is separate in x and y, so the extremes of a transformed box are the
+	// extremes of each term added up; no need to transform all 4 corners
+	const float a = _transform(0, 0), b = _transform(0, 1), tx = _transform(0, 2);
+	const float c = _transform(1, 0), d = _transform(1, 1), ty = _transform(1, 2);
+	size_t i = 0;
+
+#if defined(M22_SSE2)
+	const __m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), vtx = _mm_set1_ps(tx);
+	const __m128 vc = _mm_set1_ps(c), vd = _mm_set1_ps(d), vty = _mm_set1_ps(ty);
+	for(; i + 4 <= _count; i += 4)
 	{
-		// INCOMPATIBLE!!!
-		throw;
+		const __m128i* in = reinterpret_cast<const __m128i*>(_rects + i * 4);
+		__m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(in + 0));
+		__m128 y = _mm_cvtepi32_ps(_mm_loadu_si128(in + 1));
+		__m128 w = _mm_cvtepi32_ps(_mm_loadu_si128(in + 2));
+		__m128 h = _mm_cvtepi32_ps(_mm_loadu_si128(in + 3));
+		// Rects in, one per register; transposed, it's x/y/w/h of all four
+		_MM_TRANSPOSE4_PS(x, y, w, h);
+		__m128 x1 = _mm_add_ps(x, w), y1 = _mm_add_ps(y, h);
+
+		__m128 ax0 = _mm_mul_ps(va, x), ax1 = _mm_mul_ps(va, x1);
+		__m128 by0 = _mm_mul_ps(vb, y), by1 = _mm_mul_ps(vb, y1);
+		__m128 cx0 = _mm_mul_ps(vc, x), cx1 = _mm_mul_ps(vc, x1);
+		__m128 dy0 = _mm_mul_ps(vd, y), dy1 = _mm_mul_ps(vd, y1);
+		__m128i left = _mm_cvtps_epi32(_mm_add_ps(vtx, _mm_add_ps(_mm_min_ps(ax0, ax1), _mm_min_ps(by0, by1))));
+		__m128i right = _mm_cvtps_epi32(_mm_add_ps(vtx, _mm_add_ps(_mm_max_ps(ax0, ax1), _mm_max_ps(by0, by1))));
+		__m128i top = _mm_cvtps_epi32(_mm_add_ps(vty, _mm_add_ps(_mm_min_ps(cx0, cx1), _mm_min_ps(dy0, dy1))));
+		__m128i bottom = _mm_cvtps_epi32(_mm_add_ps(vty, _mm_add_ps(_mm_max_ps(cx0, cx1), _mm_max_ps(dy0, dy1))));
+
+		// Back to one rect per register; the shuffles don't care that they're ints
+		__m128 ox = _mm_castsi128_ps(left);
+		__m128 oy = _mm_castsi128_ps(top);
+		__m128 ow = _mm_castsi128_ps(_mm_sub_epi32(right, left));
+		__m128 oh = _mm_castsi128_ps(_mm_sub_epi32(bottom, top));
+		_MM_TRANSPOSE4_PS(ox, oy, ow, oh);
+		__m128i* out = reinterpret_cast<__m128i*>(_out + i * 4);
+		_mm_storeu_si128(out + 0, _mm_castps_si128(ox));
+		_mm_storeu_si128(out + 1, _mm_castps_si128(oy));
+		_mm_storeu_si128(out + 2, _mm_castps_si128(ow));
+		_mm_storeu_si128(out + 3, _mm_castps_si128(oh));
 	};
-	Vec4* tempVec = new Vec4();
-	
-	tempVec->x( (_mat1->GetValue(0,0) * _vec->x()) + (_mat1->GetValue(0,1) * _vec->y()) + (_mat1->GetValue(0,2) * _vec->z()) + (_mat1->GetValue(0,3) * _vec->w()) );
-	tempVec->y( (_mat1->GetValue(1,0) * _vec->x()) + (_mat1->GetValue(1,1) * _vec->y()) + (_mat1->GetValue(1,2) * _vec->z()) + (_mat1->GetValue(1,3) * _vec->w()) );
-	tempVec->z( (_mat1->GetValue(2,0) * _vec->x()) + (_mat1->GetValue(2,1) * _vec->y()) + (_mat1->GetValue(2,2) * _vec->z()) + (_mat1->GetValue(2,3) * _vec->w()) );
-	tempVec->w( (_mat1->GetValue(3,0) * _vec->x()) + (_mat1->GetValue(3,1) * _vec->y()) + (_mat1->GetValue(3,2) * _vec->z()) + (_mat1->GetValue(3,3) * _vec->w()) );
-
-	return tempVec;
-};
-
-Vec3* Matrix::Multiply ( Matrix* _mat1, Vec3* _vec)
-{
-	if(_mat1->matrix_.size() != 3 || _mat1->matrix_[0].size() != 3)
+#elif defined(M22_NEON)
+	for(; i + 4 <= _count; i += 4)
 	{
-		// INCOMPATIBLE!!!
-		throw;
+		// De-interleaves x/y/w/h of four rects on the way in
+		int32x4x4_t in = vld4q_s32(_rects + i * 4);
+		float32x4_t x = vcvtq_f32_s32(in.val[0]), y = vcvtq_f32_s32(in.val[1]);
+		float32x4_t x1 = vaddq_f32(x, vcvtq_f32_s32(in.val[2])), y1 = vaddq_f32(y, vcvtq_f32_s32(in.val[3]));
+
+		float32x4_t ax0 = vmulq_n_f32(x, a), ax1 = vmulq_n_f32(x1, a);
+		float32x4_t by0 = vmulq_n_f32(y, b), by1 = vmulq_n_f32(y1, b);
+		float32x4_t cx0 = vmulq_n_f32(x, c), cx1 = vmulq_n_f32(x1, c);
+		float32x4_t dy0 = vmulq_n_f32(y, d), dy1 = vmulq_n_f32(y1, d);
+		int32x4_t left = vcvtnq_s32_f32(vaddq_f32(vdupq_n_f32(tx), vaddq_f32(vminq_f32(ax0, ax1), vminq_f32(by0, by1))));
+		int32x4_t right = vcvtnq_s32_f32(vaddq_f32(vdupq_n_f32(tx), vaddq_f32(vmaxq_f32(ax0, ax1), vmaxq_f32(by0, by1))));
+		int32x4_t top = vcvtnq_s32_f32(vaddq_f32(vdupq_n_f32(ty), vaddq_f32(vminq_f32(cx0, cx1), vminq_f32(dy0, dy1))));
+		int32x4_t bottom = vcvtnq_s32_f32(vaddq_f32(vdupq_n_f32(ty), vaddq_f32(vmaxq_f32(cx0, cx1), vmaxq_f32(dy0, dy1))));
+
+		int32x4x4_t out;
+		out.val[0] = left;
+		out.val[1] = top;
+		out.val[2] = vsubq_s32(right, left);
+		out.val[3] = vsubq_s32(bottom, top);
+		vst4q_s32(_out + i * 4, out);
 	};
-	Vec3* tempVec = new Vec3();
-
-	tempVec->x( (_mat1->GetValue(0,0) * _vec->x()) + (_mat1->GetValue(0,1) * _vec->y()) + (_mat1->GetValue(0,2) * _vec->z()) );
-	tempVec->y( (_mat1->GetValue(1,0) * _vec->x()) + (_mat1->GetValue(1,1) * _vec->y()) + (_mat1->GetValue(1,2) * _vec->z()) );
-	tempVec->z( (_mat1->GetValue(2,0) * _vec->x()) + (_mat1->GetValue(2,1) * _vec->y()) + (_mat1->GetValue(2,2) * _vec->z()) );
-
-	return tempVec;
-};
-
-Vec2* Matrix::Rotate ( Vec2* _vector, float _angle )
-{
-	// Create rotation matrix
-	Matrix* temp = new Matrix(3,3);
-	temp->SetValue(0,0,cos(_angle));
-	temp->SetValue(1,0,-sin(_angle));
-	temp->SetValue(2,0,0.0);
-	temp->SetValue(0,1,sin(_angle));
-	temp->SetValue(1,1,cos(_angle));
-	temp->SetValue(2,1,0.0);
-	temp->SetValue(0,2,0.0);
-	temp->SetValue(1,2,0.0);
-	temp->SetValue(2,2,1.0);
-
-	// Convert Vec2 to Vec3, and multiply
-	Vec3* tempVec3 = new Vec3(_vector->x(),_vector->y(),1.0);
-	tempVec3 = Matrix::Multiply(temp, tempVec3);
-
-	// Convert back to Vec2
-	Vec2* tempVec2 = new Vec2(tempVec3->x(), tempVec3->y());
-
-	// Cleanup
-	delete temp;
-	delete tempVec3;
-
-	// Return the rotated Vec2
-	return tempVec2;
-
-	/*Vec2* temp = new Vec2(_vector->x(),_vector->y());
-	temp->x( (_vector->x() * cos(_angle) ) - (_vector->y() * sin(_angle) ) );
-	temp->y( (_vector->y() * cos(_angle) ) + (_vector->x() * sin(_angle) ) );
-	return temp;*/
-};
-
-Vec3* Matrix::RotateX ( Vec3* _vector, float _angle)
-{
-	// Create rotation matrix
-	Matrix* temp = new Matrix(4,4);
-	temp->SetValue(0,0,	1.0);
-	temp->SetValue(1,0,	0.0);
-	temp->SetValue(2,0,	0.0);
-	temp->SetValue(3,0,	0.0);
-	temp->SetValue(0,1,0.0);
-	temp->SetValue(1,1,cos(_angle));
-	temp->SetValue(2,1,-sin(_angle));
-	temp->SetValue(3,1,0.0);
-	temp->SetValue(0,2,0.0);
-	temp->SetValue(1,2,sin(_angle));
-	temp->SetValue(2,2,cos(_angle));
-	temp->SetValue(3,2,0.0);
-	temp->SetValue(0,3,0.0);
-	temp->SetValue(1,3,0.0);
-	temp->SetValue(2,3,0.0);
-	temp->SetValue(3,3,1.0);
+#endif
 
-	// Convert Vec3 to Vec4, and multiply
-	Vec4* tempVec4 = new Vec4(_vector->x(),_vector->y(),_vector->z(),1.0f);
-	tempVec4 = Matrix::Multiply(temp, tempVec4);
-
-	// Convert back to Vec3
-	Vec3* tempVec3 = new Vec3(tempVec4->x(), tempVec4->y(), tempVec4->z());
-
-
-
-	return tempVec3;
-};
-
-Vec3* Matrix::RotateY ( Vec3* _vector, float _angle)
-{
-	// Create rotation matrix
-	Matrix* temp = new Matrix(4,4);
-	temp->SetValue(0,0,	cos(_angle));
-	temp->SetValue(1,0,	0.0);
-	temp->SetValue(2,0,	sin(_angle));
-	temp->SetValue(3,0,	0.0);
-	temp->SetValue(0,1,0.0);
-	temp->SetValue(1,1,1.0);
-	temp->SetValue(2,1,0.0);
-	temp->SetValue(3,1,0.0);
-	temp->SetValue(0,2,-sin(_angle));
-	temp->SetValue(1,2,0.0);
-	temp->SetValue(2,2,cos(_angle));
-	temp->SetValue(3,2,0.0);
-	temp->SetValue(0,3,0.0);
-	temp->SetValue(1,3,0.0);
-	temp->SetValue(2,3,0.0);
-	temp->SetValue(3,3,1.0);
-
-	// Convert Vec3 to Vec4, and multiply
-	Vec4* tempVec4 = new Vec4(_vector->x(),_vector->y(),_vector->z(),1.0f);
-	tempVec4 = Matrix::Multiply(temp, tempVec4);
-
-	// Convert back to Vec3
-	Vec3* tempVec3 = new Vec3(tempVec4->x(), tempVec4->y(), tempVec4->z());
-
-
-
-	return tempVec3;
+	// Whatever's left over (or everything, without SIMD); nearbyint rounds like the SIMD paths do
+	for(; i < _count; i++)
+	{
+		const int* in = _rects + i * 4;
+		float x = float(in[0]), y = float(in[1]);
+		float x1 = float(in[0] + in[2]), y1 = float(in[1] + in[3]);
+		int left = int(std::nearbyint(tx + std::min(a * x, a * x1) + std::min(b * y, b * y1)));
+		int right = int(std::nearbyint(tx + std::max(a * x, a * x1) + std::max(b * y, b * y1)));
+		int top = int(std::nearbyint(ty + std::min(c * x, c * x1) + std::min(d * y, d * y1)));
+		int bottom = int(std::nearbyint(ty + std::max(c * x, c * x1) + std::max(d * y, d * y1)));
+		int* out = _out + i * 4;
+		out[0] = left;
+		out[1] = top;
+		out[2] = right - left;
+		out[3] = bottom - top;
+	};
+	return;
 };
-
-Vec3* Matrix::RotateZ ( Vec3* _vector, float _angle)
-{
-	// Create rotation matrix
-	Matrix* temp = new Matrix(4,4);
-	temp->SetValue(0,0,	cos(_angle));
-	temp->SetValue(1,0,	-sin(_angle));
-	temp->SetValue(2,0,	0.0);
-	temp->SetValue(3,0,	0.0);
-	temp->SetValue(0,1,	sin(_angle));
-	temp->SetValue(1,1,	cos(_angle));
-	temp->SetValue(2,1,	0.0);
-	temp->SetValue(3,1,	0.0);
-	temp->SetValue(0,2,	0.0);
-	temp->SetValue(1,2,0.0);
-	temp->SetValue(2,2,1.0);
-	temp->SetValue(3,2,0.0);
-	temp->SetValue(0,3,0.0);
-	temp->SetValue(1,3,0.0);
-	temp->SetValue(2,3,0.0);
-	temp->SetValue(3,3,1.0);
-
-	// Convert Vec3 to Vec4, and multiply
-	Vec4* tempVec4 = new Vec4(_vector->x(),_vector->y(),_vector->z(),1.0f);
-	tempVec4 = Matrix::Multiply(temp, tempVec4);
-
-	// Convert back to Vec3
-	Vec3* tempVec3 = new Vec3(tempVec4->x(), tempVec4->y(), tempVec4->z());
-
-
-
-	return tempVec3;
-};
\ No newline at end of file
@@ -0,0 +1,407 @@
+// m22bench - headless benchmark, for catching performance regressions
+//
+// Starts the engine on SDL's dummy video/audio drivers with the software renderer, so nothing is shown or
+// played, then for START_SCRIPT.txt and a generated script (written outside scripts/, so m22pak and m22lint
+// don't pick it up) in turn: compiles it from the text, loads every texture it uses, and plays it through. Each line is moved on from as soon as
+// nothing is animating, and the first choice is always taken at decisions, so every run does the same work.
+// Reports the compile time, script commands run per second, texture load time, DrawInGame frame times and
+// peak memory. Run it from the game's root directory, like the engine. Returns 1 if either script didn't play
+// through to the end.
+//
+// Usage: m22bench [--json FILE] [--lines N] [--frames N] [--script FILE]
+//		--json FILE		also writes the results to FILE as JSON, for build/CI scripts
+//		--lines N		lines of dialogue in the generated script (default 20000)
+//		--frames N		stops playing a script after this many frames (default 100000)
+//		--script FILE	where to write the generated script (default m22bench_synthetic.txt in the temp directory)
+
+#include <engine/M22Engine.h>
+#include <cmath>
+#include <filesystem>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+namespace
+{
+	const char* SYNTHETIC_SCRIPT = "m22bench_synthetic.txt";
+
+	struct ScriptResult
+	{
+		std::string name;
+		size_t lines;
+		double compileMs;
+		size_t textures;
+		double textureLoadMs;
+		Uint64 commands;
+		double playbackMs;
+		std::vector<double> drawMs;
+		bool finished;
+		ScriptResult()
+		{
+			lines = textures = 0;
+			compileMs = textureLoadMs = playbackMs = 0.0;
+			commands = 0;
+			finished = false;
+		};
+	};
+
+	double MillisecondsSince(Uint64 _start)
+	{
+		return double(SDL_GetPerformanceCounter() - _start) * 1000.0 / double(SDL_GetPerformanceFrequency());
+	};
+
+	double Average(const std::vector<double>& _values)
+	{
+		double total = 0.0;
+		for(size_t i = 0; i < _values.size(); i++)
+		{
+			total += _values.at(i);
+		};
+		return (_values.empty() ? 0.0 : total / double(_values.size()));
+	};
+
+	double Percentile(std::vector<double> _values, double _percentile)
+	{
+		if(_values.empty())
+		{
+			return 0.0;
+		};
+		std::sort(_values.begin(), _values.end());
+		size_t rank = size_t(std::ceil(_percentile * double(_values.size())));
+		return _values.at(std::min(_values.size() - 1, (rank > 0 ? rank - 1 : 0)));
+	};
+
+	unsigned long long PeakMemoryKB(void)
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return (unsigned long long)(counters.PeakWorkingSetSize / 1024);
+		};
+		return 0;
+#else
+		rusage usage;
+		if(getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return 0;
+		};
+	#ifdef __APPLE__
+		return (unsigned long long)(usage.ru_maxrss / 1024);	// bytes on macOS
+	#else
+		return (unsigned long long)usage.ru_maxrss;			// kilobytes on Linux
+	#endif
+#endif
+	};
+
+	// The parts of InitializeEverything that playing a script needs, one after another, without the options file
+	short int InitializeHeadless(void)
+	{
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+		// InitializeSDL asks for RENDERING_API, which the dummy driver doesn't have
+		SDL_SetHintWithPriority(SDL_HINT_RENDER_DRIVER, "software", SDL_HINT_OVERRIDE);
+
+		March22::M22Archive::Mount(M22PAK_FILENAME);
+		March22::M22Lua::Initialize();
+		March22::M22Engine::InitializeSDL("m22bench ", Vec2(0, 0));
+		if(March22::M22Renderer::SDL_RENDERER == NULL)
+		{
+			printf("[m22bench] Couldn't create a renderer: %s\n", SDL_GetError());
+			return -1;
+		};
+		March22::M22AssetLoader::Initialize();
+		March22::M22Sound::InitializeSound();
+		if(March22::M22Engine::LoadCharacterNames() != 0 || March22::M22Engine::InitializeM22(1920, 1080) != 0)
+		{
+			return -1;
+		};
+
+		if(March22::M22Compositor::Initialize() != 0)
+		{
+			return -1;
+		};
+		March22::M22Interface::InitTextBox();
+		March22::M22Script::LoadGameDecisions("scripts/DECISIONS.txt");
+		March22::M22Script::LoadTextBoxPosition("graphics/TEXT_BOX_POSITION.txt");
+		// Through M22Archive, so the font can be packed like everything else; both keep their RWops open to read glyphs
+		March22::M22Graphics::textFont = TTF_OpenFontRW(March22::M22Archive::OpenRW("graphics/FONT.ttf"), 1, 19);
+		March22::M22Script::font = new NFont(March22::M22Renderer::SDL_RENDERER, March22::M22Archive::OpenRW("graphics/FONT.ttf"), 1, 29, NFont::Color(255, 255, 255, 255));
+
+		March22::M22Interface::storedInterfaces.resize(March22::M22Interface::INTERFACES::NUM_OF_INTERFACES);
+		March22::M22Interface::InitializeInterface(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::INGAME_INTRFC], 2, 0, "graphics/interface/GAME_BUTTONS.txt", true, March22::M22Interface::INTERFACES::INGAME_INTRFC);
+		return 0;
+	};
+
+	// Dialogue with a background change, page break and decision every so often; the same every time for the same _lines
+	short int WriteSyntheticScript(const std::string& _filename, int _lines)
+	{
+		std::vector<std::string> backgrounds;
+		std::stringstream index;
+		if(March22::M22Archive::OpenStream("graphics/backgrounds/index.txt", index))
+		{
+			std::string path;
+			while(index >> path)
+			{
+				size_t slash = path.find_last_of('/');
+				size_t dot = path.find_last_of('.');
+				backgrounds.push_back(path.substr(slash + 1, dot - (slash + 1)));
+			};
+		};
+		std::string speaker = (March22::M22Engine::CHARACTERS_ARRAY.empty() ? std::string("") : March22::M22Engine::CHARACTERS_ARRAY.back().name);
+
+		std::ofstream output(_filename, std::ios::out | std::ios::trunc);
+		if(!output)
+		{
+			printf("[m22bench] Failed to open %s for writing!\n", _filename.c_str());
+			return -1;
+		};
+		output << "--start\nSetActiveTransition Fade\n";
+		for(int i = 0; i < _lines; i++)
+		{
+			if(i % 50 == 0 && !backgrounds.empty())
+			{
+				output << "DrawBackground " << backgrounds.at((i / 50) % backgrounds.size()) << "\n";
+			};
+			if(i % 8 == 7)
+			{
+				output << "NewPage\n";
+			};
+			if(i % 200 == 199)
+			{
+				output << "MakeDecision TEST_DECISION YES NO\n";
+			};
+			if(i % 2 == 0 && !speaker.empty())
+			{
+				output << speaker << " \"Line " << i << " of the benchmark; long enough to wrap across the text box, the way most of the game's dialogue does.\"\n";
+			}
+			else
+			{
+				output << "Line " << i << " of the benchmark is narration, which is laid out and typed out the same way as the dialogue around it.\n";
+			};
+		};
+		return 0;
+	};
+
+	bool RunScript(const std::string& _name, int _maxFrames, ScriptResult& _result)
+	{
+		_result.name = _name;
+		March22::M22Script::ClearCharacters();
+		March22::M22Script::typewriter_text.clear();
+
+		// From the text, so the compiler's time is what's measured rather than a .m22c being mapped
+		Uint64 start = SDL_GetPerformanceCounter();
+		if(March22::M22ScriptCompiler::CompileLoadScriptFile(_name, false) != 0)
+		{
+			return false;
+		};
+		_result.compileMs = MillisecondsSince(start);
+		_result.lines = March22::M22ScriptCompiler::currentScript_c.size();
+
+		// Every texture the script draws, cold: decoded on the loader's workers and uploaded here
+		std::vector<int> handles;
+		for(size_t i = 0; i < March22::M22ScriptCompiler::currentScript_c.size(); i++)
+		{
+			int handle = March22::M22ScriptCompiler::currentScript_c.at(i).m_asset;
+			if(handle != -1 && std::find(handles.begin(), handles.end(), handle) == handles.end())
+			{
+				handles.push_back(handle);
+			};
+		};
+		start = SDL_GetPerformanceCounter();
+		for(size_t i = 0; i < handles.size(); i++)
+		{
+			March22::M22AssetLoader::QueueTexture(handles.at(i));
+		};
+		for(size_t i = 0; i < handles.size(); i++)
+		{
+			March22::M22AssetLoader::WaitForTexture(handles.at(i));
+		};
+		_result.textureLoadMs = MillisecondsSince(start);
+		_result.textures = handles.size();
+
+		March22::M22Engine::GAMESTATE = March22::M22Engine::GAMESTATES::INGAME;
+		March22::M22Interface::activeInterfaces.clear();
+		March22::M22Interface::activeInterfaces.push_back(&March22::M22Interface::storedInterfaces[March22::M22Interface::INTERFACES::INGAME_INTRFC]);
+		std::string script = March22::M22Script::currentScriptFileName;
+		Uint64 commands = March22::M22Script::linesExecuted;
+
+		start = SDL_GetPerformanceCounter();
+		March22::M22Prefetcher::Update(0);
+		March22::M22Script::ChangeLine(0);
+		for(int frame = 0; frame < _maxFrames; frame++)
+		{
+			// A LoadScript ends the run, so each script is measured on its own; leaving the game or the script this way is getting to the end of it
+			if(March22::M22Engine::QUIT || March22::M22Engine::GAMESTATE != March22::M22Engine::GAMESTATES::INGAME || March22::M22Script::currentScriptFileName != script)
+			{
+				_result.finished = true;
+				break;
+			};
+			// Nothing reads the events, so don't let the loader's wake-ups pile up
+			SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+			// Move on as soon as a player could: once the transitions are done
+			if(March22::M22Graphics::changeQueued == March22::M22Graphics::BACKGROUND_UPDATE_TYPES::NONE)
+			{
+				if(March22::M22Engine::TIMER_TARGET != 0)
+				{
+					March22::M22Engine::TIMER_CURR = 0;
+					March22::M22Engine::TIMER_TARGET = 0;
+					March22::M22Script::ChangeLine(++March22::M22Script::currentLineIndex);
+				}
+				else if(March22::M22Script::currentLineType == March22::M22Script::LINETYPE::MAKE_DECISION)
+				{
+					if(March22::M22Script::SelectChoice(0) != 0)
+					{
+						break;
+					};
+				}
+				else if((size_t)(March22::M22Script::currentLineIndex + 1) >= March22::M22ScriptCompiler::currentScript_c.size())
+				{
+					_result.finished = true;
+					break;
+				}
+				else
+				{
+					March22::M22Script::FinishLine();
+					March22::M22Script::ChangeLine(++March22::M22Script::currentLineIndex);
+				};
+			};
+			March22::M22AssetLoader::UpdateUploads();
+			// Nothing updates DELTA_TIME here, so the fades move on a 60fps frame at a time
+			March22::M22Tween::Update(1000 / 60);
+			March22::M22Script::UpdateTypewriter(1000 / 60);
+			March22::M22CharacterLayer::Update();
+
+			March22::M22Renderer::RenderClear();
+			Uint64 drawStart = SDL_GetPerformanceCounter();
+			March22::M22Graphics::DrawInGame();
+			_result.drawMs.push_back(MillisecondsSince(drawStart));
+			March22::M22Renderer::RenderPresent();
+		};
+		_result.playbackMs = MillisecondsSince(start);
+		_result.commands = March22::M22Script::linesExecuted - commands;
+		return true;
+	};
+
+	void PrintResult(const ScriptResult& _result)
+	{
+		double perSecond = (_result.playbackMs > 0.0 ? double(_result.commands) * 1000.0 / _result.playbackMs : 0.0);
+		printf("[m22bench] %s (%u lines)%s\n", _result.name.c_str(), (unsigned int)_result.lines, (_result.finished ? "" : " - didn't reach the end"));
+		printf("[m22bench]   compile        %10.2f ms\n", _result.compileMs);
+		printf("[m22bench]   textures       %10.2f ms for %u\n", _result.textureLoadMs, (unsigned int)_result.textures);
+		printf("[m22bench]   playback       %10.2f ms, %llu commands (%.0f/s) over %u frames\n", _result.playbackMs, (unsigned long long)_result.commands, perSecond, (unsigned int)_result.drawMs.size());
+		printf("[m22bench]   DrawInGame     %10.3f ms average, %.3f ms p99\n", Average(_result.drawMs), Percentile(_result.drawMs, 0.99));
+		return;
+	};
+
+	short int WriteJSON(const std::string& _filename, double _startupMs, const std::vector<ScriptResult>& _results)
+	{
+		std::ofstream output(_filename, std::ios::out | std::ios::trunc);
+		if(!output)
+		{
+			printf("[m22bench] Failed to open %s for writing!\n", _filename.c_str());
+			return -1;
+		};
+		char buffer[1024];
+		snprintf(buffer, sizeof(buffer), "{\n\t\"startup_ms\": %.3f,\n\t\"peak_memory_kb\": %llu,\n\t\"scripts\": [", _startupMs, PeakMemoryKB());
+		output << buffer;
+		for(size_t i = 0; i < _results.size(); i++)
+		{
+			const ScriptResult& result = _results.at(i);
+			double perSecond = (result.playbackMs > 0.0 ? double(result.commands) * 1000.0 / result.playbackMs : 0.0);
+			snprintf(buffer, sizeof(buffer),
+				"%s\n\t\t{ \"name\": \"%s\", \"lines\": %u, \"finished\": %s, \"compile_ms\": %.3f, \"textures\": %u, \"texture_load_ms\": %.3f, "
+				"\"commands\": %llu, \"playback_ms\": %.3f, \"commands_per_second\": %.1f, \"frames\": %u, \"draw_avg_ms\": %.4f, \"draw_p99_ms\": %.4f }",
+				(i == 0 ? "" : ","), result.name.c_str(), (unsigned int)result.lines, (result.finished ? "true" : "false"), result.compileMs,
+				(unsigned int)result.textures, result.textureLoadMs, (unsigned long long)result.commands, result.playbackMs, perSecond,
+				(unsigned int)result.drawMs.size(), Average(result.drawMs), Percentile(result.drawMs, 0.99));
+			output << buffer;
+		};
+		output << "\n\t]\n}\n";
+		return 0;
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	std::string jsonFilename;
+	std::string scriptFilename;
+	int lines = 20000;
+	int frames = 100000;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if(argument == "--json" && i + 1 < argc)
+		{
+			jsonFilename = argv[++i];
+		}
+		else if(argument == "--lines" && i + 1 < argc)
+		{
+			lines = std::max(1, atoi(argv[++i]));
+		}
+		else if(argument == "--frames" && i + 1 < argc)
+		{
+			frames = std::max(1, atoi(argv[++i]));
+		}
+		else if(argument == "--script" && i + 1 < argc)
+		{
+			scriptFilename = argv[++i];
+		}
+		else
+		{
+			printf("Usage: %s [--json FILE] [--lines N] [--frames N] [--script FILE]\n", argv[0]);
+			printf("Run it from the game's root directory; the generated script goes in the temp directory unless --script says otherwise\n");
+			return 1;
+		};
+	};
+
+	std::error_code error;
+	if(scriptFilename.empty())
+	{
+		scriptFilename = (std::filesystem::temp_directory_path(error) / SYNTHETIC_SCRIPT).string();
+	};
+	// Scripts are loaded relative to scripts/, so that's where the generated one is found from
+	std::string syntheticScript = std::filesystem::relative(std::filesystem::absolute(scriptFilename, error), std::filesystem::absolute("scripts", error), error).generic_string();
+	if(error || syntheticScript.empty())
+	{
+		printf("[m22bench] Can't reach %s from scripts/; pass --script with a path on the same drive\n", scriptFilename.c_str());
+		return 1;
+	};
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	if(InitializeHeadless() != 0 || WriteSyntheticScript(scriptFilename, lines) != 0)
+	{
+		return 1;
+	};
+	double startupMs = MillisecondsSince(start);
+
+	std::vector<ScriptResult> results(2);
+	bool ran = RunScript("START_SCRIPT.txt", frames, results.at(0)) && RunScript(syntheticScript, frames, results.at(1));
+	// A script that stalls before its end is a regression too, not just a slow one
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		ran = ran && results.at(i).finished;
+	};
+
+	printf("[m22bench] Started up in %.2f ms\n", startupMs);
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		PrintResult(results.at(i));
+	};
+	printf("[m22bench] Peak memory %llu KB\n", PeakMemoryKB());
+	if(!jsonFilename.empty() && WriteJSON(jsonFilename, startupMs, results) != 0)
+	{
+		ran = false;
+	};
+
+	// Not M22Engine::Shutdown, which would save the lines played here to READLINES.SAV
+	March22::M22AssetLoader::Shutdown();
+	SDL_Quit();
+	return (ran ? 0 : 1);
+};
@@ -0,0 +1,90 @@
+// m22c - offline compiler for M22 scripts
+//
+// Compiles scripts/<name>.txt into scripts/<name>.m22c, which M22ScriptCompiler::CompileLoadScriptFile
+// memory-maps instead of parsing the text. Run it from the game's root directory, like the engine.
+// Scripts are only parsed (M22ScriptCompiler::ParseTextScript, like m22lint), never linked, so no
+// renderer, audio or Lua is needed; the engine links every line by name when it loads the .m22c.
+//
+// Usage: m22c START_SCRIPT.txt [MORE_SCRIPTS.txt ...]
+
+#include <engine/M22Engine.h>
+
+#include <algorithm>
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		printf("Usage: %s <script.txt> [more scripts...]\n", argv[0]);
+		printf("Scripts are looked up in scripts/, and written next to their source as .m22c\n");
+		return 1;
+	};
+
+	// Only the character names are needed; the asset loader just records paths without its workers
+	if(March22::M22Engine::LoadCharacterNames() != 0)
+	{
+		return 1;
+	};
+
+	int failed = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string path = std::string("scripts/") + argv[i];
+		std::string text;
+		if(!March22::M22Archive::ReadText(path, text))
+		{
+			printf("[m22c] Failed to load script file: %s\n", path.c_str());
+			failed++;
+			continue;
+		};
+		if(!March22::M22IsValidUTF8(text))
+		{
+			printf("[m22c] %s isn't valid UTF-8!\n", path.c_str());
+			failed++;
+			continue;
+		};
+		std::vector<March22::M22ScriptCompiler::line_c> lines;
+		std::vector<March22::M22ScriptCompiler::script_checkpoint> checkpoints;
+		if(March22::M22ScriptCompiler::ParseTextScript(text, lines, checkpoints) != 0)
+		{
+			printf("[m22c] Failed to compile %s!\n", path.c_str());
+			failed++;
+			continue;
+		};
+
+		// The textures LinkLine would register, in order of first use, so M22Prefetcher can still
+		// queue them from the .m22c before it's loaded
+		std::vector<int> assets;
+		for(size_t k = 0; k < lines.size(); k++)
+		{
+			const March22::M22ScriptCompiler::line_c& line = lines.at(k);
+			int asset = -1;
+			switch(line.m_lineType)
+			{
+				case March22::M22Script::NEW_BACKGROUND:
+				case March22::M22Script::NEW_BACKGROUND_STEALTH:
+					asset = March22::M22AssetLoader::RegisterTexture("graphics/backgrounds/" + line.m_parameters_txt.at(0) + ".png");
+					break;
+				case March22::M22Script::DRAW_CHARACTER:
+				case March22::M22Script::DRAW_CHARACTER_BRUTAL:
+					asset = March22::M22AssetLoader::RegisterTexture("graphics/characters/" + line.m_parameters_txt.at(0) + "/" + line.m_parameters_txt.at(1) + "/" + line.m_parameters_txt.at(2) + ".png", 0, true);
+					break;
+				default:
+					break;
+			};
+			if(asset != -1 && std::find(assets.begin(), assets.end(), asset) == assets.end())
+			{
+				assets.push_back(asset);
+			};
+		};
+
+		std::string output = March22::M22ScriptCompiler::GetCompiledFilename(path);
+		if(March22::M22ScriptCompiler::SaveCompiledScript(output, lines, checkpoints, assets) != 0)
+		{
+			failed++;
+		};
+	};
+
+	March22::M22AssetLoader::Shutdown();
+	return (failed == 0 ? 0 : 1);
+};
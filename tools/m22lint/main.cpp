@@ -0,0 +1,575 @@
+// m22lint - checks every script without running the game
+//
+// Parses every script in scripts/ (a thread per core, with M22ScriptCompiler::ParseTextScript, so no renderer
+// is needed), then checks what they refer to: Goto checkpoints, LoadScript/LoadScriptGoto targets and lines,
+// backgrounds, character sprites, sprites, music, stings, Lua scripts and decisions. Files are looked for in
+// data.m22pak (if there is one) and then on disk, like the engine does. The scripts are followed from the start
+// script through LoadScript, LoadScriptGoto, Goto and m22IF, and anything that can't be reached is listed.
+// Run it from the game's root directory, like the engine.
+//
+// Usage: m22lint [-s SCRIPT] [-p ARCHIVE] [-m DIRECTORY]
+//		-s SCRIPT		script the game starts on (default START_SCRIPT.txt)
+//		-p ARCHIVE		archive to look for files in (default data.m22pak, if it exists)
+//		-m DIRECTORY	writes DIRECTORY/<script>.manifest for each script (in the script's subdirectory of scripts/,
+//						if any): every file it uses, one per line, which m22pak takes in place of a directory
+// Returns 1 if any script has errors; unreachable scripts and lines are only warnings.
+
+#include <engine/M22Engine.h>
+#include <filesystem>
+#include <atomic>
+#include <cstdarg>
+
+namespace
+{
+	const char* START_SCRIPT = "START_SCRIPT.txt";
+	const char* DECISIONS_SCRIPT = "DECISIONS.txt";
+
+	/// Everything found out about one script; filled in by whichever worker thread gets to it
+	struct ScriptReport
+	{
+		std::string name;																///< As LoadScript names it, relative to scripts/
+		bool parsed;																	///< Was it read and parsed?
+		std::vector<March22::M22ScriptCompiler::line_c> lines;							///< The parsed (not linked) lines
+		std::vector<unsigned int> sourceLines;											///< Line number in the file of each line
+		std::vector<March22::M22ScriptCompiler::script_checkpoint> checkpoints;			///< Checkpoints in the order they're in the file
+		std::unordered_map<std::string, int> checkpointLookup;							///< Checkpoint names to lines; the first of any duplicates wins, as in the engine
+		std::vector<std::string> errors;
+		std::vector<std::string> warnings;
+		std::vector<std::string> files;													///< Files it uses, in order of first use (its manifest)
+		std::unordered_set<std::string> filesSeen;
+		ScriptReport()
+		{
+			parsed = false;
+		};
+	};
+
+	void Problem(std::vector<std::string>& _list, unsigned int _sourceLine, const char* _format, ...)
+	{
+		char message[512];
+		va_list args;
+		va_start(args, _format);
+		vsnprintf(message, sizeof(message), _format, args);
+		va_end(args);
+		_list.push_back("line " + std::to_string(_sourceLine) + ": " + message);
+		return;
+	};
+
+	bool Exists(const std::string& _path)
+	{
+		const Uint8* data = NULL;
+		size_t size = 0;
+		std::error_code error;
+		return March22::M22Archive::Find(_path, data, size) || std::filesystem::is_regular_file(March22::M22Archive::NormalisePath(_path), error);
+	};
+
+	void UseFile(ScriptReport& _report, unsigned int _sourceLine, const char* _what, const std::string& _path)
+	{
+		std::string path = March22::M22Archive::NormalisePath(_path);
+		if(!_report.filesSeen.insert(path).second)
+		{
+			return;
+		};
+		if(!Exists(path))
+		{
+			Problem(_report.errors, _sourceLine, "Missing %s \"%s\"", _what, path.c_str());
+			return;
+		};
+		_report.files.push_back(path);
+		return;
+	};
+
+	void CheckDecision(ScriptReport& _report, unsigned int _sourceLine, const std::string& _decision)
+	{
+		if(March22::M22Script::gameDecisionLookup.find(_decision) == March22::M22Script::gameDecisionLookup.end())
+		{
+			Problem(_report.errors, _sourceLine, "Decision \"%s\" isn't declared in %s", _decision.c_str(), DECISIONS_SCRIPT);
+		};
+		return;
+	};
+
+	// Everything here only reads the engine's tables, which are all loaded before the workers start
+	void CheckLine(ScriptReport& _report, const March22::M22ScriptCompiler::line_c& _line, unsigned int _sourceLine)
+	{
+		const std::vector<std::string>& names = _line.m_parameters_txt;
+		switch(_line.m_lineType)
+		{
+			case March22::M22Script::NEW_BACKGROUND_STEALTH:
+			case March22::M22Script::NEW_BACKGROUND:
+				UseFile(_report, _sourceLine, "background", "graphics/backgrounds/" + names.at(0) + ".png");
+				break;
+			case March22::M22Script::DRAW_CHARACTER_BRUTAL:
+			case March22::M22Script::DRAW_CHARACTER:
+				if(March22::M22Engine::GetCharacterIndexFromName(names.at(0)) == -1)
+				{
+					Problem(_report.errors, _sourceLine, "Character \"%s\" isn't in CHARACTERS.txt", names.at(0).c_str());
+				};
+				UseFile(_report, _sourceLine, "character sprite", "graphics/characters/" + names.at(0) + "/" + names.at(1) + "/" + names.at(2) + ".png");
+				break;
+			case March22::M22Script::DRAW_SPRITE:
+				UseFile(_report, _sourceLine, "sprite", "graphics/sprites/" + names.at(0) + SPRITE_DEFAULT_FORMAT);
+				break;
+			case March22::M22Script::DRAW_SPRITE_ANIMATED:
+				{
+					// A sheet, or failing that a file per frame, as M22Sprite loads them
+					std::string sheet = "graphics/sprites/" + names.at(0) + SPRITE_DEFAULT_FORMAT;
+					int frames = _line.m_parameters.at(3);
+					if(frames <= 1 || Exists(sheet))
+					{
+						UseFile(_report, _sourceLine, "sprite", sheet);
+						break;
+					};
+					for(int i = 0; i < frames; i++)
+					{
+						UseFile(_report, _sourceLine, "sprite frame", "graphics/sprites/" + names.at(0) + "_" + std::to_string(i) + SPRITE_DEFAULT_FORMAT);
+					};
+				}
+				break;
+			case March22::M22Script::NEW_MUSIC:
+				if(March22::M22Sound::FindMusicFromName(names.at(0)) == -1)
+				{
+					Problem(_report.errors, _sourceLine, "Music \"%s\" isn't in sfx/music/index.txt", names.at(0).c_str());
+				};
+				UseFile(_report, _sourceLine, "music", "sfx/music/" + names.at(0) + ".OGG");
+				break;
+			case March22::M22Script::PLAY_STING:
+			case March22::M22Script::PLAY_STING_LOOPED:
+				if(March22::M22Sound::FindStingFromName(names.at(0)) == -1)
+				{
+					Problem(_report.errors, _sourceLine, "Sting \"%s\" isn't in sfx/stings/index.txt", names.at(0).c_str());
+				};
+				UseFile(_report, _sourceLine, "sting", "sfx/stings/" + names.at(0) + ".OGG");
+				break;
+			case March22::M22Script::RUN_LUA_SCRIPT:
+				UseFile(_report, _sourceLine, "Lua script", "scripts/lua/" + names.at(0));
+				break;
+			case March22::M22Script::LOAD_SCRIPT:
+			case March22::M22Script::LOAD_SCRIPT_GOTO:
+				UseFile(_report, _sourceLine, "script", "scripts/" + names.at(0));
+				break;
+			case March22::M22Script::GOTO:
+				if(_report.checkpointLookup.find(names.at(0)) == _report.checkpointLookup.end())
+				{
+					Problem(_report.errors, _sourceLine, "No checkpoint \"%s\" to Goto", names.at(0).c_str());
+				};
+				break;
+			case March22::M22Script::GOTO_DEBUG:
+				if(_line.m_parameters.at(0) < 0 || size_t(_line.m_parameters.at(0)) >= _report.lines.size())
+				{
+					Problem(_report.errors, _sourceLine, "Goto_debug line %i is past the end of the script (%u lines)", _line.m_parameters.at(0), (unsigned int)_report.lines.size());
+				};
+				break;
+			case March22::M22Script::MAKE_DECISION:
+			case March22::M22Script::SET_DECISION:
+				CheckDecision(_report, _sourceLine, names.at(0));
+				break;
+			case March22::M22Script::IF_STATEMENT:
+				CheckDecision(_report, _sourceLine, names.at(0));
+				if(!_line.m_subLines.empty())
+				{
+					CheckLine(_report, _line.m_subLines.front(), _sourceLine);
+				};
+				break;
+			default:
+				break;
+		};
+		return;
+	};
+
+	void AnalyzeScript(ScriptReport& _report)
+	{
+		std::string text;
+		std::string path = "scripts/" + _report.name;
+		if(!March22::M22Archive::ReadText(path, text))
+		{
+			_report.errors.push_back("Can't read " + path);
+			return;
+		};
+		if(!March22::M22IsValidUTF8(text))
+		{
+			_report.errors.push_back(path + " isn't valid UTF-8");
+			return;
+		};
+		March22::M22ScriptCompiler::ParseTextScript(text, _report.lines, _report.checkpoints, &_report.errors, &_report.sourceLines);
+		_report.parsed = true;
+		_report.filesSeen.insert(path);
+		_report.files.push_back(path);
+		std::string compiled = March22::M22ScriptCompiler::GetCompiledFilename(path);
+		if(Exists(compiled))
+		{
+			_report.filesSeen.insert(compiled);
+			_report.files.push_back(compiled);
+		};
+
+		for(size_t i = 0; i < _report.checkpoints.size(); i++)
+		{
+			const March22::M22ScriptCompiler::script_checkpoint& checkpoint = _report.checkpoints.at(i);
+			if(!_report.checkpointLookup.emplace(checkpoint.m_name, checkpoint.m_position).second)
+			{
+				unsigned int sourceLine = (size_t(checkpoint.m_position) < _report.sourceLines.size() ? _report.sourceLines.at(checkpoint.m_position) : 0);
+				Problem(_report.warnings, sourceLine, "Checkpoint \"%s\" is there more than once; Goto only goes to the first", checkpoint.m_name.c_str());
+			};
+		};
+		for(size_t i = 0; i < _report.lines.size(); i++)
+		{
+			CheckLine(_report, _report.lines.at(i), _report.sourceLines.at(i));
+		};
+		return;
+	};
+
+	/// Analyzes the reports from _from on, a thread per core
+	unsigned int AnalyzeAll(std::vector<ScriptReport>& _reports, size_t _from)
+	{
+		std::atomic<size_t> next(_from);
+		unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<std::thread> workers;
+		for(unsigned int i = 0; i < threads; i++)
+		{
+			workers.push_back(std::thread([&_reports, &next]
+			{
+				for(size_t k = next++; k < _reports.size(); k = next++)
+				{
+					AnalyzeScript(_reports.at(k));
+				};
+			}));
+		};
+		for(size_t i = 0; i < workers.size(); i++)
+		{
+			workers.at(i).join();
+		};
+		return threads;
+	};
+
+	/// The script a line (or the command on the end of an m22IF) loads, NULL if none
+	const March22::M22ScriptCompiler::line_c* LoadedScript(const March22::M22ScriptCompiler::line_c& _line)
+	{
+		if(_line.m_lineType == March22::M22Script::IF_STATEMENT)
+		{
+			return (_line.m_subLines.empty() ? NULL : LoadedScript(_line.m_subLines.front()));
+		};
+		if(_line.m_lineType == March22::M22Script::LOAD_SCRIPT || _line.m_lineType == March22::M22Script::LOAD_SCRIPT_GOTO)
+		{
+			return &_line;
+		};
+		return NULL;
+	};
+
+	/// Follows the scripts from the start, the way ChangeLine would run them, marking every line that can be run
+	void FollowScripts(const std::vector<ScriptReport>& _reports, const std::unordered_map<std::string, size_t>& _lookup, size_t _start, std::vector<std::vector<bool>>& _reached)
+	{
+		_reached.assign(_reports.size(), std::vector<bool>());
+		for(size_t i = 0; i < _reports.size(); i++)
+		{
+			_reached.at(i).assign(_reports.at(i).lines.size(), false);
+		};
+
+		std::vector<std::pair<size_t, int>> pending(1, std::make_pair(_start, 0));
+		while(!pending.empty())
+		{
+			size_t script = pending.back().first;
+			int line = pending.back().second;
+			pending.pop_back();
+			const ScriptReport& report = _reports.at(script);
+			if(line < 0 || size_t(line) >= report.lines.size() || _reached.at(script).at(line))
+			{
+				continue;
+			};
+			_reached.at(script).at(line) = true;
+
+			const March22::M22ScriptCompiler::line_c& current = report.lines.at(line);
+			const March22::M22ScriptCompiler::line_c* command = &current;
+			bool carriesOn = true;
+			if(current.m_lineType == March22::M22Script::IF_STATEMENT)
+			{
+				// The line after it if the choice wasn't made, wherever its command goes if it was
+				pending.push_back(std::make_pair(script, line + 1));
+				command = (current.m_subLines.empty() ? NULL : &current.m_subLines.front());
+			};
+			if(command == NULL)
+			{
+				continue;
+			};
+			switch(command->m_lineType)
+			{
+				case March22::M22Script::GOTO:
+					{
+						// A missing checkpoint was reported already; the engine carries on past it
+						std::unordered_map<std::string, int>::const_iterator found = report.checkpointLookup.find(command->m_parameters_txt.at(0));
+						if(found != report.checkpointLookup.end())
+						{
+							pending.push_back(std::make_pair(script, found->second));
+							carriesOn = false;
+						};
+					}
+					break;
+				case March22::M22Script::GOTO_DEBUG:
+					pending.push_back(std::make_pair(script, command->m_parameters.at(0)));
+					carriesOn = false;
+					break;
+				case March22::M22Script::LOAD_SCRIPT:
+				case March22::M22Script::LOAD_SCRIPT_GOTO:
+					{
+						std::unordered_map<std::string, size_t>::const_iterator found = _lookup.find(command->m_parameters_txt.at(0));
+						if(found != _lookup.end())
+						{
+							pending.push_back(std::make_pair(found->second, (command->m_lineType == March22::M22Script::LOAD_SCRIPT_GOTO ? command->m_parameters.at(0) : 0)));
+						};
+						carriesOn = false;
+					}
+					break;
+				case March22::M22Script::EXITGAME:
+				case March22::M22Script::EXITTOMAINMENU:
+					carriesOn = false;
+					break;
+				default:
+					break;
+			};
+			if(carriesOn && command == &current)
+			{
+				pending.push_back(std::make_pair(script, line + 1));
+			};
+		};
+		return;
+	};
+
+	void WarnUnreached(ScriptReport& _report, const std::vector<bool>& _reached)
+	{
+		// One warning per run of lines, rather than per line
+		size_t i = 0;
+		while(i < _reached.size())
+		{
+			if(_reached.at(i))
+			{
+				i++;
+				continue;
+			};
+			size_t end = i;
+			while(end + 1 < _reached.size() && !_reached.at(end + 1))
+			{
+				end++;
+			};
+			if(end == i)
+			{
+				Problem(_report.warnings, _report.sourceLines.at(i), "Can't be reached");
+			}
+			else
+			{
+				Problem(_report.warnings, _report.sourceLines.at(i), "Can't be reached, nor can anything up to line %u", _report.sourceLines.at(end));
+			};
+			i = end + 1;
+		};
+		return;
+	};
+
+	void CheckChoices(ScriptReport& _report, const std::unordered_map<std::string, std::unordered_set<std::string>>& _offered, const March22::M22ScriptCompiler::line_c& _line, unsigned int _sourceLine)
+	{
+		if(_line.m_lineType != March22::M22Script::IF_STATEMENT && _line.m_lineType != March22::M22Script::SET_DECISION)
+		{
+			return;
+		};
+		const std::string& decision = _line.m_parameters_txt.at(0);
+		const std::string& choice = _line.m_parameters_txt.at(1);
+		std::unordered_map<std::string, std::unordered_set<std::string>>::const_iterator found = _offered.find(decision);
+		if(found == _offered.end() || found->second.find(choice) == found->second.end())
+		{
+			Problem(_report.errors, _sourceLine, "\"%s\" is never offered for decision \"%s\"", choice.c_str(), decision.c_str());
+		};
+		return;
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	std::string startScript = START_SCRIPT;
+	std::string archive = M22PAK_FILENAME;
+	std::string manifestDirectory;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if(option == "-s" && i + 1 < argc)
+		{
+			startScript = argv[++i];
+		}
+		else if(option == "-p" && i + 1 < argc)
+		{
+			archive = argv[++i];
+		}
+		else if(option == "-m" && i + 1 < argc)
+		{
+			manifestDirectory = argv[++i];
+		}
+		else
+		{
+			printf("Usage: %s [-s %s] [-p %s] [-m directory]\n", argv[0], START_SCRIPT, M22PAK_FILENAME);
+			printf("Checks every script in scripts/; run it from the game's root directory\n");
+			return 1;
+		};
+	};
+
+	std::error_code error;
+	if(std::filesystem::is_regular_file(archive, error) && March22::M22Archive::Mount(archive) != 0)
+	{
+		return 1;
+	};
+	// The tables the scripts are checked against; nothing changes them once the workers start
+	if(March22::M22Engine::LoadCharacterNames() != 0 ||
+		March22::M22Script::LoadGameDecisions((std::string("scripts/") + DECISIONS_SCRIPT).c_str()) != 0 ||
+		March22::M22Sound::InitializeMusic() != 0 ||
+		March22::M22Sound::InitializeSFX() != 0)
+	{
+		return 1;
+	};
+
+	std::vector<ScriptReport> reports;
+	std::unordered_map<std::string, size_t> lookup;
+	std::vector<std::string> names(1, startScript);
+	for(std::filesystem::directory_iterator it("scripts", error); !error && it != std::filesystem::directory_iterator(); it.increment(error))
+	{
+		std::string name = it->path().filename().string();
+		if(it->is_regular_file() && it->path().extension() == ".txt" && name != DECISIONS_SCRIPT)
+		{
+			names.push_back(name);
+		};
+	};
+	std::sort(names.begin() + 1, names.end());
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned int threads = 1;
+	size_t analyzed = 0;
+	while(!names.empty())
+	{
+		for(size_t i = 0; i < names.size(); i++)
+		{
+			if(lookup.emplace(names.at(i), reports.size()).second)
+			{
+				reports.emplace_back();
+				reports.back().name = names.at(i);
+			};
+		};
+		names.clear();
+		threads = AnalyzeAll(reports, analyzed);
+
+		// Scripts loaded from these that aren't in scripts/ itself (in the archive, or a subdirectory) get the next round
+		for(size_t i = analyzed; i < reports.size(); i++)
+		{
+			for(size_t k = 0; k < reports.at(i).lines.size(); k++)
+			{
+				const March22::M22ScriptCompiler::line_c* load = LoadedScript(reports.at(i).lines.at(k));
+				if(load != NULL && lookup.find(load->m_parameters_txt.at(0)) == lookup.end() && Exists("scripts/" + load->m_parameters_txt.at(0)))
+				{
+					names.push_back(load->m_parameters_txt.at(0));
+				};
+			};
+		};
+		analyzed = reports.size();
+	};
+
+	// Checks across scripts: where they jump to, and the choices their decisions can end up with
+	std::unordered_map<std::string, std::unordered_set<std::string>> offered;
+	for(size_t i = 0; i < March22::M22Script::gameDecisions.size(); i++)
+	{
+		const March22::M22Script::Decision& decision = March22::M22Script::gameDecisions.at(i);
+		offered[decision.name].insert(decision.choices.begin(), decision.choices.end());
+	};
+	for(size_t i = 0; i < reports.size(); i++)
+	{
+		for(size_t k = 0; k < reports.at(i).lines.size(); k++)
+		{
+			const March22::M22ScriptCompiler::line_c& line = reports.at(i).lines.at(k);
+			if(line.m_lineType == March22::M22Script::MAKE_DECISION)
+			{
+				offered[line.m_parameters_txt.at(0)].insert(line.m_parameters_txt.begin() + 1, line.m_parameters_txt.end());
+			};
+		};
+	};
+	for(size_t i = 0; i < reports.size(); i++)
+	{
+		ScriptReport& report = reports.at(i);
+		for(size_t k = 0; k < report.lines.size(); k++)
+		{
+			const March22::M22ScriptCompiler::line_c& line = report.lines.at(k);
+			CheckChoices(report, offered, line, report.sourceLines.at(k));
+			const March22::M22ScriptCompiler::line_c* load = LoadedScript(line);
+			if(load == NULL || load->m_lineType != March22::M22Script::LOAD_SCRIPT_GOTO)
+			{
+				continue;
+			};
+			std::unordered_map<std::string, size_t>::const_iterator target = lookup.find(load->m_parameters_txt.at(0));
+			if(target != lookup.end() && reports.at(target->second).parsed && (load->m_parameters.at(0) < 0 || size_t(load->m_parameters.at(0)) >= reports.at(target->second).lines.size()))
+			{
+				Problem(report.errors, report.sourceLines.at(k), "LoadScriptGoto line %i is past the end of %s (%u lines)", load->m_parameters.at(0), load->m_parameters_txt.at(0).c_str(), (unsigned int)reports.at(target->second).lines.size());
+			};
+		};
+	};
+
+	std::vector<std::vector<bool>> reached;
+	FollowScripts(reports, lookup, 0, reached);
+	for(size_t i = 0; i < reports.size(); i++)
+	{
+		if(!reports.at(i).parsed)
+		{
+			continue;
+		};
+		if(std::find(reached.at(i).begin(), reached.at(i).end(), true) == reached.at(i).end())
+		{
+			reports.at(i).warnings.push_back("Not loaded by anything " + startScript + " leads to");
+		}
+		else
+		{
+			WarnUnreached(reports.at(i), reached.at(i));
+		};
+	};
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	size_t errors = 0, warnings = 0, lines = 0;
+	for(size_t i = 0; i < reports.size(); i++)
+	{
+		const ScriptReport& report = reports.at(i);
+		for(size_t k = 0; k < report.errors.size(); k++)
+		{
+			printf("[m22lint] %s %s\n", report.name.c_str(), report.errors.at(k).c_str());
+		};
+		for(size_t k = 0; k < report.warnings.size(); k++)
+		{
+			printf("[m22lint] %s (warning) %s\n", report.name.c_str(), report.warnings.at(k).c_str());
+		};
+		errors += report.errors.size();
+		warnings += report.warnings.size();
+		lines += report.lines.size();
+	};
+
+	if(!manifestDirectory.empty())
+	{
+		std::filesystem::create_directories(manifestDirectory, error);
+		for(size_t i = 0; i < reports.size(); i++)
+		{
+			const ScriptReport& report = reports.at(i);
+			if(!report.parsed)
+			{
+				continue;
+			};
+			// Under the same subdirectories as the script, so scripts with the same filename don't overwrite each other
+			std::filesystem::path relative = std::filesystem::path(report.name).lexically_normal();
+			if(relative.empty() || relative.is_absolute() || *relative.begin() == "..")
+			{
+				printf("[m22lint] %s is outside scripts/, so it has no manifest\n", report.name.c_str());
+				continue;
+			};
+			std::filesystem::path path = std::filesystem::path(manifestDirectory) / relative.replace_extension(".manifest");
+			std::filesystem::create_directories(path.parent_path(), error);
+			std::ofstream output(path, std::ios::out | std::ios::trunc);
+			for(size_t k = 0; k < report.files.size(); k++)
+			{
+				output << report.files.at(k) << '\n';
+			};
+			if(!output)
+			{
+				printf("[m22lint] Failed to write %s!\n", path.string().c_str());
+				errors++;
+			};
+		};
+	};
+
+	printf("[m22lint] Checked %u scripts (%u lines) on %u threads in %.1f ms: %u errors, %u warnings\n", (unsigned int)reports.size(), (unsigned int)lines, threads, elapsedMs, (unsigned int)errors, (unsigned int)warnings);
+	March22::M22Archive::Shutdown();
+	return (errors == 0 ? 0 : 1);
+};
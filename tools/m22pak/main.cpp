@@ -0,0 +1,191 @@
+// m22pak - packs the game's asset directories into a .m22pak archive
+//
+// Every file under the given directories is stored under its path relative to the current directory,
+// the way the engine opens it (e.g. "graphics/backgrounds/BLACK.webp"), so run it from the game's root
+// directory, like the engine. Compile scripts with m22c first if the .m22c files should go in as well.
+// The engine mounts data.m22pak at startup and reads anything it can't find in there from disk.
+// A .manifest from m22lint -m can be given in place of a directory, to pack just the files a script uses.
+//
+// Usage: m22pak [-o data.m22pak] [DIRECTORY|MANIFEST ...]        (defaults to graphics, sfx and scripts)
+
+#include <engine/M22Engine.h>
+#include <filesystem>
+
+namespace
+{
+	struct PackedFile
+	{
+		std::string path;
+		Uint64 hash;
+		Uint64 size;
+	};
+
+	bool AddFile(const std::filesystem::path& _path, std::vector<PackedFile>& _files)
+	{
+		std::error_code error;
+		PackedFile file;
+		file.path = March22::M22Archive::NormalisePath(_path.generic_string());
+		file.hash = March22::M22Archive::HashPath(file.path);
+		file.size = Uint64(std::filesystem::file_size(_path, error));
+		if(error)
+		{
+			printf("[m22pak] Can't read %s: %s\n", file.path.c_str(), error.message().c_str());
+			return false;
+		};
+		_files.push_back(file);
+		return true;
+	};
+
+	Uint64 AlignUp(Uint64 _offset)
+	{
+		return (_offset + (M22PAK_ALIGNMENT - 1)) & ~Uint64(M22PAK_ALIGNMENT - 1);
+	};
+
+	void WritePadding(std::ofstream& _output, Uint64 _from, Uint64 _to)
+	{
+		static const char zeroes[M22PAK_ALIGNMENT] = {};
+		_output.write(zeroes, std::streamsize(_to - _from));
+		return;
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	std::string outputFilename = M22PAK_FILENAME;
+	std::vector<std::string> directories;
+	for(int i = 1; i < argc; i++)
+	{
+		if(std::string(argv[i]) == "-o" && i + 1 < argc)
+		{
+			outputFilename = argv[++i];
+		}
+		else if(argv[i][0] == '-')
+		{
+			printf("Usage: %s [-o %s] [directory|manifest ...]\n", argv[0], M22PAK_FILENAME);
+			printf("Directories default to graphics, sfx and scripts; run it from the game's root directory\n");
+			return 1;
+		}
+		else
+		{
+			directories.push_back(argv[i]);
+		};
+	};
+	if(directories.empty())
+	{
+		directories.push_back("graphics");
+		directories.push_back("sfx");
+		directories.push_back("scripts");
+	};
+
+	std::vector<PackedFile> files;
+	for(size_t i = 0; i < directories.size(); i++)
+	{
+		std::error_code error;
+		if(std::filesystem::path(directories.at(i)).extension() == ".manifest")
+		{
+			// One path per line
+			std::ifstream manifest(directories.at(i));
+			if(!manifest)
+			{
+				printf("[m22pak] Can't read %s\n", directories.at(i).c_str());
+				return 1;
+			};
+			std::string path;
+			while(std::getline(manifest, path))
+			{
+				if(!path.empty() && !AddFile(path, files))
+				{
+					return 1;
+				};
+			};
+			continue;
+		};
+		std::filesystem::recursive_directory_iterator it(directories.at(i), error);
+		if(error)
+		{
+			printf("[m22pak] Can't read %s: %s\n", directories.at(i).c_str(), error.message().c_str());
+			return 1;
+		};
+		for(; it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+		{
+			if(!it->is_regular_file())
+			{
+				continue;
+			};
+			if(!AddFile(it->path(), files))
+			{
+				return 1;
+			};
+		};
+	};
+
+	// Manifests share files (and can overlap the directories), but each only goes in once
+	std::sort(files.begin(), files.end(), [](const PackedFile& _a, const PackedFile& _b) { return _a.path < _b.path; });
+	files.erase(std::unique(files.begin(), files.end(), [](const PackedFile& _a, const PackedFile& _b) { return _a.path == _b.path; }), files.end());
+
+	// The engine binary searches the hashes; the paths are compared too, so a collision only costs a probe
+	std::sort(files.begin(), files.end(), [](const PackedFile& _a, const PackedFile& _b)
+	{
+		return (_a.hash != _b.hash ? _a.hash < _b.hash : _a.path < _b.path);
+	});
+
+	std::string pathData;
+	std::vector<March22::M22Archive::m22pak_entry> entries(files.size());
+	for(size_t i = 0; i < files.size(); i++)
+	{
+		entries.at(i).m_hash = files.at(i).hash;
+		entries.at(i).m_size = files.at(i).size;
+		entries.at(i).m_path = Uint32(pathData.size());
+		entries.at(i).m_pathLength = Uint32(files.at(i).path.size());
+		pathData += files.at(i).path;
+	};
+	Uint64 offset = AlignUp(sizeof(March22::M22Archive::m22pak_header) + entries.size() * sizeof(March22::M22Archive::m22pak_entry) + pathData.size());
+	for(size_t i = 0; i < entries.size(); i++)
+	{
+		entries.at(i).m_offset = offset;
+		offset = AlignUp(offset + entries.at(i).m_size);
+	};
+
+	March22::M22Archive::m22pak_header header;
+	memcpy(header.m_magic, "M22P", 4);
+	header.m_version = M22PAK_VERSION;
+	header.m_numEntries = Uint32(entries.size());
+	header.m_pathDataSize = Uint32(pathData.size());
+
+	std::ofstream output(outputFilename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if(!output)
+	{
+		printf("[m22pak] Failed to open %s for writing!\n", outputFilename.c_str());
+		return 1;
+	};
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if(!entries.empty()) output.write(reinterpret_cast<const char*>(&entries[0]), entries.size() * sizeof(March22::M22Archive::m22pak_entry));
+	output.write(pathData.data(), pathData.size());
+	Uint64 written = sizeof(header) + entries.size() * sizeof(March22::M22Archive::m22pak_entry) + pathData.size();
+
+	std::vector<char> buffer;
+	for(size_t i = 0; i < files.size(); i++)
+	{
+		WritePadding(output, written, entries.at(i).m_offset);
+		written = entries.at(i).m_offset;
+
+		std::ifstream input(files.at(i).path, std::ios::binary | std::ios::in);
+		buffer.resize(size_t(files.at(i).size));
+		if(!input || !input.read(buffer.data(), std::streamsize(buffer.size())))
+		{
+			printf("[m22pak] Failed to read %s!\n", files.at(i).path.c_str());
+			return 1;
+		};
+		output.write(buffer.data(), std::streamsize(buffer.size()));
+		written += files.at(i).size;
+	};
+	if(!output)
+	{
+		printf("[m22pak] Failed writing %s!\n", outputFilename.c_str());
+		return 1;
+	};
+	output.close();
+
+	printf("[m22pak] Wrote %s (%u files, %llu KB)\n", outputFilename.c_str(), header.m_numEntries, (unsigned long long)(written / 1024));
+	return 0;
+};